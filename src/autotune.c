@@ -0,0 +1,235 @@
+//
+// Sweeps the libbladeRF stream buffer geometry (buffer length, number of buffers, number of transfers) to find the
+// lowest latency setting that runs without drops at the configured sample rate
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <libbladeRF.h>
+
+#include "autotune.h"
+#include "helpers.h"
+#include "sampleConversion.h"
+#include "rtPolicy.h"
+
+//The latency is measured by comparing the timestamp of the buffer to the bladeRF's current timestamp.  Getting the
+//current timestamp is a USB control transfer which is too slow to do for every buffer without causing drops
+#define AUTOTUNE_LATENCY_SAMPLE_PERIOD (16) //Buffers
+#define AUTOTUNE_MIN_BLOCKS (64)
+
+static const uint32_t autotuneBlockLens[] = {1024, 2048, 4096, 8192, 16384, 32768};
+static const uint32_t autotuneNumBuffers[] = {4, 8, 16, 32, 64}; //The number of transfers is half the number of buffers
+
+typedef struct{
+    uint32_t blockLen;
+    uint32_t numBuffers;
+    uint32_t numTransfers;
+
+    bool failed; //libbladeRF rejected the setting or a stream error occurred
+    uint64_t drops; //Rx: overruns or timestamp discontinuities, Tx: buffers submitted after their transmit time
+    double meanLatency_us; //Rx: age of the last sample when the buffer is returned, Tx: time until the last sample is transmitted when the buffer is submitted
+    double maxLatency_us;
+} autotuneResult_t;
+
+static void runAutotuneTrial(radioDevice_t *device, bool tx, radioConfig_t *config, double trialDurationSec, autotuneResult_t *result){
+    int numChannels = config->numChannels;
+    sampleFormat_t sampleFormat = config->sampleFormat;
+    unsigned int sampRate = tx ? config->txSampRate : config->rxSampRate;
+    unsigned int timeout_ms = tx ? config->txBladeRFTimeout : config->rxBladeRFTimeout;
+    //The worker thread is placed as it will be when streaming.  The trial itself runs on the main thread
+    int workerCpu = tx ? config->txWorkerCpu : config->rxWorkerCpu;
+    int workerPriority = tx ? config->txWorkerPriority : config->rxWorkerPriority;
+
+    result->failed = false;
+    result->drops = 0;
+    result->meanLatency_us = 0;
+    result->maxLatency_us = 0;
+
+    bladerf_channel_layout layout;
+    if(tx){
+        layout = numChannels == 2 ? BLADERF_TX_X2 : BLADERF_TX_X1;
+    }else{
+        layout = numChannels == 2 ? BLADERF_RX_X2 : BLADERF_RX_X1;
+    }
+
+    //Metadata is required to detect overruns and for the timestamps
+    int status = radioDeviceSyncConfig(device, layout, bladeRFFormat(sampleFormat, true),
+                                       result->numBuffers, result->blockLen, result->numTransfers, timeout_ms,
+                                       workerCpu, config->rtPolicy, workerPriority, tx ? "Tx" : "Rx");
+    if(status != 0){
+        result->failed = true;
+        return;
+    }
+
+    //The Tx sends zeros
+    void* buffer = vitis_aligned_alloc(MEM_ALIGNMENT, bladeRFSampleSize(sampleFormat)*result->blockLen);
+    memset(buffer, 0, bladeRFSampleSize(sampleFormat)*result->blockLen);
+
+    for(int chan = 0; chan<numChannels; chan++) {
+        status = radioDeviceEnableModule(device, tx ? BLADERF_CHANNEL_TX(chan) : BLADERF_CHANNEL_RX(chan), true);
+        if(status != 0){
+            result->failed = true;
+        }
+    }
+
+    uint32_t sampsPerChan = result->blockLen/numChannels;
+    uint64_t numBlocks = (uint64_t) (trialDurationSec*sampRate/sampsPerChan);
+    //Latency is only measured once the buffers have filled
+    uint64_t warmupBlocks = 2*result->numBuffers;
+    if(numBlocks < warmupBlocks + AUTOTUNE_MIN_BLOCKS){
+        numBlocks = warmupBlocks + AUTOTUNE_MIN_BLOCKS;
+    }
+
+    bladerf_direction dir = tx ? BLADERF_TX : BLADERF_RX;
+    bladerf_timestamp expectedTimestamp = 0;
+    bladerf_timestamp now;
+    if(tx && !result->failed){
+        //Start the burst far enough in the future for the buffers to fill
+        status = radioDeviceGetTimestamp(device, dir, &now);
+        if(status != 0){
+            result->failed = true;
+        }
+        expectedTimestamp = now + 2*result->numBuffers*sampsPerChan + sampRate/100;
+    }
+
+    double latencySum = 0;
+    int latencyCount = 0;
+    for(uint64_t block = 0; block<numBlocks && !result->failed; block++){
+        struct bladerf_metadata meta;
+        memset(&meta, 0, sizeof(meta));
+
+        if(tx){
+            if(block == 0){
+                meta.flags |= BLADERF_META_FLAG_TX_BURST_START;
+                meta.timestamp = expectedTimestamp;
+            }
+            if(block == numBlocks-1){
+                meta.flags |= BLADERF_META_FLAG_TX_BURST_END;
+            }
+            status = radioDeviceSyncTx(device, buffer, result->blockLen, &meta, timeout_ms);
+            //The timestamp of the sample after the end of this buffer
+            expectedTimestamp += sampsPerChan;
+        }else{
+            if(block == 0){
+                meta.flags |= BLADERF_META_FLAG_RX_NOW;
+            }
+            status = radioDeviceSyncRx(device, buffer, result->blockLen, &meta, timeout_ms);
+            if(status == 0){
+                if((meta.status & BLADERF_META_STATUS_OVERRUN) || meta.actual_count != result->blockLen ||
+                   (block > 0 && meta.timestamp != expectedTimestamp)){
+                    result->drops++;
+                }
+                expectedTimestamp = meta.timestamp + sampsPerChan;
+            }
+        }
+
+        if(status == BLADERF_ERR_TIME_PAST){
+            result->drops++;
+            break;
+        }else if(status != 0){
+            result->failed = true;
+            break;
+        }
+
+        if(block >= warmupBlocks && block % AUTOTUNE_LATENCY_SAMPLE_PERIOD == 0){
+            status = radioDeviceGetTimestamp(device, dir, &now);
+            if(status != 0){
+                result->failed = true;
+                break;
+            }
+            int64_t latencySamps = tx ? (int64_t) (expectedTimestamp - now) : (int64_t) (now - expectedTimestamp);
+            if(tx && latencySamps < 0){
+                //The buffer was submitted after it should have been transmitted
+                result->drops++;
+            }
+            double latency_us = latencySamps*1e6/sampRate;
+            latencySum += latency_us;
+            latencyCount++;
+            if(latency_us > result->maxLatency_us){
+                result->maxLatency_us = latency_us;
+            }
+        }
+    }
+
+    for(int chan = 0; chan<numChannels; chan++) {
+        radioDeviceEnableModule(device, tx ? BLADERF_CHANNEL_TX(chan) : BLADERF_CHANNEL_RX(chan), false);
+    }
+    free(buffer);
+
+    if(latencyCount > 0){
+        result->meanLatency_us = latencySum/latencyCount;
+    }else if(!result->failed){
+        //Too short to measure
+        result->failed = true;
+    }
+}
+
+static void autotuneDirection(radioPipeline_t *pipeline, bool tx, double trialDurationSec, bool print){
+    radioConfig_t *config = &pipeline->config;
+    char *dirStr = tx ? "Tx" : "Rx";
+    unsigned int sampRate = tx ? config->txSampRate : config->rxSampRate;
+
+    printf("[%s] Autotuning %s buffer geometry at %u Hz (%s)\n", config->serial, dirStr, sampRate, sampleFormatToStr(config->sampleFormat));
+    if(print){
+        printf("[%s] %s %8s %8s %8s %12s %12s %12s\n", config->serial, dirStr, "BlockLen", "Buffers", "Xfers", "Drops", "Mean (us)", "Max (us)");
+    }
+
+    bool found = false;
+    autotuneResult_t best;
+    for(int i = 0; i<sizeof(autotuneBlockLens)/sizeof(autotuneBlockLens[0]); i++){
+        for(int j = 0; j<sizeof(autotuneNumBuffers)/sizeof(autotuneNumBuffers[0]); j++){
+            autotuneResult_t result;
+            result.blockLen = autotuneBlockLens[i];
+            result.numBuffers = autotuneNumBuffers[j];
+            result.numTransfers = autotuneNumBuffers[j]/2;
+            runAutotuneTrial(&pipeline->device, tx, config, trialDurationSec, &result);
+
+            if(print){
+                if(result.failed){
+                    printf("[%s] %s %8u %8u %8u %12s\n", config->serial, dirStr, result.blockLen, result.numBuffers, result.numTransfers, "Failed");
+                }else{
+                    printf("[%s] %s %8u %8u %8u %12lu %12.1f %12.1f\n", config->serial, dirStr, result.blockLen, result.numBuffers, result.numTransfers,
+                           result.drops, result.meanLatency_us, result.maxLatency_us);
+                }
+            }
+
+            if(!result.failed && result.drops == 0 && (!found || result.meanLatency_us < best.meanLatency_us)){
+                best = result;
+                found = true;
+            }
+        }
+    }
+
+    if(!found){
+        printf("[%s] Warning: No %s buffer geometry ran without drops, keeping BlockLen: %d, Buffers: %d, Transfers: %d\n", config->serial, dirStr,
+               tx ? config->txBladeRFBlockLen : config->rxBladeRFBlockLen,
+               tx ? config->txBladeRFNumBuffers : config->rxBladeRFNumBuffers,
+               tx ? config->txBladeRFNumTransfers : config->rxBladeRFNumTransfers);
+        return;
+    }
+
+    printf("[%s] Autotuned %s: BlockLen: %u, Buffers: %u, Transfers: %u (Mean Latency: %.1f us, Max Latency: %.1f us)\n", config->serial, dirStr,
+           best.blockLen, best.numBuffers, best.numTransfers, best.meanLatency_us, best.maxLatency_us);
+    if(tx){
+        config->txBladeRFBlockLen = best.blockLen;
+        config->txBladeRFNumBuffers = best.numBuffers;
+        config->txBladeRFNumTransfers = best.numTransfers;
+    }else{
+        config->rxBladeRFBlockLen = best.blockLen;
+        config->rxBladeRFNumBuffers = best.numBuffers;
+        config->rxBladeRFNumTransfers = best.numTransfers;
+    }
+}
+
+void autotuneRadioPipeline(radioPipeline_t *pipeline, double trialDurationSec, bool print){
+    //The directions are tuned one at a time with the other direction idle
+    if(pipeline->rxEnabled){
+        autotuneDirection(pipeline, false, trialDurationSec, print);
+    }
+    if(pipeline->txEnabled){
+        autotuneDirection(pipeline, true, trialDurationSec, print);
+    }
+}
@@ -0,0 +1,20 @@
+//
+// Sweeps the libbladeRF stream buffer geometry (buffer length, number of buffers, number of transfers) to find the
+// lowest latency setting that runs without drops at the configured sample rate
+//
+
+#ifndef BLADERFTOFIFO_AUTOTUNE_H
+#define BLADERFTOFIFO_AUTOTUNE_H
+
+#include <stdbool.h>
+
+#include "radioPipeline.h"
+
+#define AUTOTUNE_DEFAULT_TRIAL_DURATION (0.5) //Seconds per setting
+
+//Runs the sweep for each enabled direction of the pipeline (after bring-up, before the pipeline is started).
+//The configuration of the pipeline is updated with the selected settings.  If no setting runs without drops, the
+//configuration is left unchanged.
+void autotuneRadioPipeline(radioPipeline_t *pipeline, double trialDurationSec, bool print);
+
+#endif //BLADERFTOFIFO_AUTOTUNE_H
@@ -0,0 +1,252 @@
+//
+// Helpers for opening and configuring bladeRF devices
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bladeRFConfig.h"
+#include "helpers.h"
+
+void openBladeRF(struct bladerf **dev, char* serialNum){
+    int status = tryOpenBladeRF(dev, serialNum);
+    if (status != 0) {
+        fprintf(stderr, "Unable to open bladeRF device: %s\n", bladerf_strerror(status));
+        exit(1);
+    }
+}
+
+int tryOpenBladeRF(struct bladerf **dev, char* serialNum){
+    //From BladeRF Boilerplate:
+
+    struct bladerf_devinfo dev_info;
+    bladerf_init_devinfo(&dev_info);
+    //Can specify the serial number of the bladeRF device here
+    //TODO: Remove Sanity Check
+    if(sizeof(dev_info.serial) != strlen(serialNum)+1){ //Includes Null Char
+        fprintf(stderr, "Invalid Serial Number: %s\n", serialNum);
+        exit(1);
+    }
+    strncpy(dev_info.serial, serialNum, sizeof(dev_info.serial) - 1);
+
+    int status = bladerf_open_with_devinfo(dev, &dev_info);
+    if (status != 0) {
+        *dev = NULL;
+    }
+    return status;
+}
+
+typedef int (*bladeRFGetRange_t)(struct bladerf *dev, bladerf_channel ch, const struct bladerf_range **range);
+
+static bool checkBladeRFRange(struct bladerf *dev, bladerf_channel chan, bladeRFGetRange_t getRange, char *chanStr,
+                              char *setting, double value, char *err, size_t errLen){
+    const struct bladerf_range *range;
+    int status = getRange(dev, chan, &range);
+    if(status != 0){
+        snprintf(err, errLen, "unable to get the %s %s range: %s", chanStr, setting, bladerf_strerror(status));
+        return false;
+    }
+    double min = range->min*range->scale;
+    double max = range->max*range->scale;
+    if(value < min || value > max){
+        snprintf(err, errLen, "%s %s %.0f is outside [%.0f, %.0f]", chanStr, setting, value, min, max);
+        return false;
+    }
+    return true;
+}
+
+bool checkBladeRFChannelRanges(struct bladerf *dev, bool tx, int chanNum, bladerf_frequency carrierFreqHz, bladerf_bandwidth bandwidthHz, bladerf_sample_rate sampleRateHz, bladerf_gain gainDB, char *err, size_t errLen){
+    bladerf_channel chan = tx ? BLADERF_CHANNEL_TX(chanNum) : BLADERF_CHANNEL_RX(chanNum);
+    char chanStr[5];
+    snprintf(chanStr, 5, tx ? "Tx%d" : "Rx%d", chanNum);
+    return checkBladeRFRange(dev, chan, bladerf_get_frequency_range, chanStr, "frequency", carrierFreqHz, err, errLen) &&
+           checkBladeRFRange(dev, chan, bladerf_get_bandwidth_range, chanStr, "bandwidth", bandwidthHz, err, errLen) &&
+           checkBladeRFRange(dev, chan, bladerf_get_sample_rate_range, chanStr, "sample rate", sampleRateHz, err, errLen) &&
+           checkBladeRFRange(dev, chan, bladerf_get_gain_range, chanStr, "gain", gainDB, err, errLen);
+}
+
+int configBladeRFChannel(struct bladerf *dev, bool tx, int chanNum, bladerf_frequency carrierFreqHz, bladerf_bandwidth bandwidthHz, bladerf_sample_rate sampleRateHz, bladerf_gain gainDB, cachedChannelConfig_t *cached, bool verbose){
+    bladerf_channel chan = tx ? BLADERF_CHANNEL_TX(chanNum) : BLADERF_CHANNEL_RX(chanNum);
+    char chanHelpStr[5];
+    snprintf(chanHelpStr, 5, tx ? "Tx%d" : "Rx%d", chanNum);
+
+    bool useCache = cached != NULL && cached->valid;
+    int stepsSkipped = 0;
+
+    //According to https://www.nuand.com/bladeRF-doc/libbladeRF/v2.2.1/group___f_n___t_u_n_i_n_g.html#ga4e9b635f18a9531bcd3c6b4d2dd8a4e0
+    //  changing one of them will change the other
+    bladerf_frequency reportedFreq = carrierFreqHz;
+    useCache = useCache && cached->freq == carrierFreqHz;
+    if(useCache){
+        stepsSkipped++;
+    }else{
+        int status = bladerf_set_frequency(dev, chan, carrierFreqHz);
+        if (status != 0) {
+            fprintf(stderr, "Failed to set %s frequency = %lu: %s\n", chanHelpStr, carrierFreqHz, bladerf_strerror(status));
+            exit(1);
+        }
+
+        status = bladerf_get_frequency(dev, chan, &reportedFreq);
+        if (status != 0) {
+            fprintf(stderr, "Failed to get %s frequency: %s\n", chanHelpStr, bladerf_strerror(status));
+            exit(1);
+        }
+    }
+
+    bladerf_bandwidth actualBW = bandwidthHz;
+    useCache = useCache && cached->bw == bandwidthHz;
+    if(useCache){
+        stepsSkipped++;
+    }else{
+        int status = bladerf_set_bandwidth(dev, chan, bandwidthHz, &actualBW);
+        if (status != 0) {
+            fprintf(stderr, "Failed to set %s bandwidth = %u: %s\n", chanHelpStr, bandwidthHz, bladerf_strerror(status));
+            exit(1);
+        }
+    }
+
+    bladerf_sample_rate actualSampRate = sampleRateHz;
+    useCache = useCache && cached->sampRate == sampleRateHz;
+    if(useCache){
+        stepsSkipped++;
+    }else{
+        int status = bladerf_set_sample_rate(dev, chan, sampleRateHz, &actualSampRate);
+        if (status != 0) {
+            fprintf(stderr, "Failed to set %s sample rate = %u: %s\n", chanHelpStr, sampleRateHz, bladerf_strerror(status));
+            exit(1);
+        }
+    }
+
+    //Turn AGC Off (a cached Rx channel was set to manual gain control)
+    bladerf_gain_mode gainMode = BLADERF_GAIN_MGC;
+    bladerf_gain_mode reportedGainMode = BLADERF_GAIN_MGC;
+    bladerf_gain reportedGain = gainDB;
+    useCache = useCache && cached->gain == gainDB;
+    if(useCache){
+        stepsSkipped++;
+    }else{
+        if(!tx){
+            int status = bladerf_set_gain_mode(dev, chan, gainMode);
+            if (status != 0) {
+                fprintf(stderr, "Failed to set %s AGC = %s: %s\n", chanHelpStr, bladeRFGainModeToStr(gainMode), bladerf_strerror(status));
+                exit(1);
+            }
+
+            status = bladerf_get_gain_mode(dev, chan, &reportedGainMode);
+            if (status != 0) {
+                fprintf(stderr, "Failed to get %s gain mode: %s\n", chanHelpStr, bladerf_strerror(status));
+                exit(1);
+            }
+        }
+
+        int status = bladerf_set_gain(dev, chan, gainDB);
+        if (status != 0) {
+            fprintf(stderr, "Failed to set %s gain = %u: %s\n", chanHelpStr, gainDB, bladerf_strerror(status));
+            exit(1);
+        }
+
+        status = bladerf_get_gain(dev, chan, &reportedGain);
+        if (status != 0) {
+            fprintf(stderr, "Failed to get %s gain: %s\n", chanHelpStr, bladerf_strerror(status));
+            exit(1);
+        }
+    }
+
+    if(cached != NULL){
+        cached->valid = true;
+        cached->freq = carrierFreqHz;
+        cached->bw = bandwidthHz;
+        cached->sampRate = sampleRateHz;
+        cached->gain = gainDB;
+    }
+
+    if(verbose){
+        printf("[%s] Freq      Requested: %10lu, Reported:  %10lu\n", chanHelpStr, carrierFreqHz, reportedFreq);
+        printf("[%s] BW        Requested: %10u, Currently: %10u\n", chanHelpStr, bandwidthHz, actualBW);
+        printf("[%s] Samp Rate Requested: %10u, Currently: %10u\n", chanHelpStr, sampleRateHz, actualSampRate);
+        if(!tx){
+            printf("[%s] AGC: \n\tRequested %s\n\tReported: %s\n", chanHelpStr, bladeRFGainModeToStr(gainMode), bladeRFGainModeToStr(reportedGainMode));
+        }
+        printf("[%s] Gain      Requested: %10u, Reported:  %10u\n", chanHelpStr, gainDB, reportedGain);
+        if(stepsSkipped > 0){
+            printf("[%s] %d setting%s unchanged from the configuration cache\n", chanHelpStr, stepsSkipped, stepsSkipped == 1 ? "" : "s");
+        }
+    }
+
+    return stepsSkipped;
+}
+
+void setCorrection(struct bladerf *dev, bool tx, int chanNum, bladerf_correction_value dcOff_I, bladerf_correction_value dcOff_Q, bladerf_correction_value iq_phase, bladerf_correction_value iq_gain){
+    bladerf_channel chan = tx ? BLADERF_CHANNEL_TX(chanNum) : BLADERF_CHANNEL_RX(chanNum);
+    char chanHelpStr[5];
+    snprintf(chanHelpStr, 5, tx ? "Tx%d" : "Rx%d", chanNum);
+
+    int status = bladerf_set_correction(dev, chan, BLADERF_CORR_DCOFF_I, dcOff_I);
+    if (status != 0) {
+        fprintf(stderr, "Failed to set %s DC Offset Correction - I: %s\n", chanHelpStr, bladerf_strerror(status));
+        exit(1);
+    }
+
+    status = bladerf_set_correction(dev, chan, BLADERF_CORR_DCOFF_Q, dcOff_Q);
+    if (status != 0) {
+        fprintf(stderr, "Failed to set %s DC Offset Correction - Q: %s\n", chanHelpStr, bladerf_strerror(status));
+        exit(1);
+    }
+
+    status = bladerf_set_correction(dev, chan, BLADERF_CORR_PHASE, iq_phase);
+    if (status != 0) {
+        fprintf(stderr, "Failed to set %s IQ Imballance Correction - Phase: %s\n", chanHelpStr, bladerf_strerror(status));
+        exit(1);
+    }
+
+    status = bladerf_set_correction(dev, chan, BLADERF_CORR_GAIN, iq_gain);
+    if (status != 0) {
+        fprintf(stderr, "Failed to set %s IQ Imballance Correction - Gain: %s\n", chanHelpStr, bladerf_strerror(status));
+        exit(1);
+    }
+
+    printf("[%s] Set DC Offset Correction - I:      %5d\n", chanHelpStr, dcOff_I);
+    printf("[%s] Set DC Offset Correction - Q:      %5d\n", chanHelpStr, dcOff_Q);
+    printf("[%s] Set I/Q Imbal. Correction - Phase: %5d\n", chanHelpStr, iq_phase);
+    printf("[%s] Set I/Q Imbal. Correction - Gain:  %5d\n", chanHelpStr, iq_gain);
+}
+
+void printCorrection(struct bladerf *dev, bool tx, int chanNum){
+    bladerf_channel chan = tx ? BLADERF_CHANNEL_TX(chanNum) : BLADERF_CHANNEL_RX(chanNum);
+    char chanHelpStr[5];
+    snprintf(chanHelpStr, 5, tx ? "Tx%d" : "Rx%d", chanNum);
+
+    bladerf_correction_value dcOff_I;
+    int status = bladerf_get_correction(dev, chan, BLADERF_CORR_DCOFF_I, &dcOff_I);
+    if (status != 0) {
+        fprintf(stderr, "Failed to get %s DC Offset Correction - I: %s\n", chanHelpStr, bladerf_strerror(status));
+        exit(1);
+    }
+
+    bladerf_correction_value dcOff_Q;
+    status = bladerf_get_correction(dev, chan, BLADERF_CORR_DCOFF_Q, &dcOff_Q);
+    if (status != 0) {
+        fprintf(stderr, "Failed to get %s DC Offset Correction - Q: %s\n", chanHelpStr, bladerf_strerror(status));
+        exit(1);
+    }
+
+    bladerf_correction_value iq_phase;
+    status = bladerf_get_correction(dev, chan, BLADERF_CORR_PHASE, &iq_phase);
+    if (status != 0) {
+        fprintf(stderr, "Failed to get %s IQ Imballance Correction - Phase: %s\n", chanHelpStr, bladerf_strerror(status));
+        exit(1);
+    }
+
+    bladerf_correction_value iq_gain;
+    status = bladerf_get_correction(dev, chan, BLADERF_CORR_GAIN, &iq_gain);
+    if (status != 0) {
+        fprintf(stderr, "Failed to get %s IQ Imballance Correction - Gain: %s\n", chanHelpStr, bladerf_strerror(status));
+        exit(1);
+    }
+
+    printf("[%s] DC Offset Correction - I:      %5d\n", chanHelpStr, dcOff_I);
+    printf("[%s] DC Offset Correction - Q:      %5d\n", chanHelpStr, dcOff_Q);
+    printf("[%s] I/Q Imbal. Correction - Phase: %5d\n", chanHelpStr, iq_phase);
+    printf("[%s] I/Q Imbal. Correction - Gain:  %5d\n", chanHelpStr, iq_gain);
+}
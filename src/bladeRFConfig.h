@@ -0,0 +1,34 @@
+//
+// Helpers for opening and configuring bladeRF devices
+//
+
+#ifndef BLADERFTOFIFO_BLADERFCONFIG_H
+#define BLADERFTOFIFO_BLADERFCONFIG_H
+
+#include <stdbool.h>
+
+#include <libbladeRF.h>
+
+#include "configCache.h"
+
+void openBladeRF(struct bladerf **dev, char* serialNum);
+
+//Like openBladeRF but returns the libbladeRF status rather than exiting if the device cannot be opened (ex. while it
+//is reenumerating after a USB error)
+int tryOpenBladeRF(struct bladerf **dev, char* serialNum);
+
+//cached holds the settings the channel was last configured with (NULL if unknown).  The steps are applied in order and
+//leading steps whose setting matches the cache are skipped (once a step is applied, the following steps are applied
+//as well because the RFIC may have changed dependent settings).  The cache entry is updated.  Returns the number of
+//steps skipped
+int configBladeRFChannel(struct bladerf *dev, bool tx, int chanNum, bladerf_frequency carrierFreqHz, bladerf_bandwidth bandwidthHz, bladerf_sample_rate sampleRateHz, bladerf_gain gainDB, cachedChannelConfig_t *cached, bool verbose);
+
+//Checks the settings against the ranges the board reports (configBladeRFChannel exits if a setting is rejected).  Returns
+//false with a description of the first setting out of range in err
+bool checkBladeRFChannelRanges(struct bladerf *dev, bool tx, int chanNum, bladerf_frequency carrierFreqHz, bladerf_bandwidth bandwidthHz, bladerf_sample_rate sampleRateHz, bladerf_gain gainDB, char *err, size_t errLen);
+
+void setCorrection(struct bladerf *dev, bool tx, int chanNum, bladerf_correction_value dcOff_I, bladerf_correction_value dcOff_Q, bladerf_correction_value iq_phase, bladerf_correction_value iq_gain);
+
+void printCorrection(struct bladerf *dev, bool tx, int chanNum);
+
+#endif //BLADERFTOFIFO_BLADERFCONFIG_H
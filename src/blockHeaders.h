@@ -0,0 +1,74 @@
+//
+// Headers optionally prepended to blocks transacted over the Shared Memory FIFOs
+//
+
+#ifndef BLADERFTOFIFO_BLOCKHEADERS_H
+#define BLADERFTOFIFO_BLOCKHEADERS_H
+
+#include <stdint.h>
+#include <assert.h>
+
+//---- Tx Burst Header ----
+//When the Tx is in burst mode (-txBurst), each block in the Tx FIFO is prefixed with this header.  The block is still
+//blockLen samples long (re[blockLen] followed by im[blockLen]) but only the first numSamples are transmitted.
+//
+//A burst starts with a block marked TX_BLOCK_FLAG_BURST_START and ends with a block marked TX_BLOCK_FLAG_BURST_END
+//(a single block may be marked with both).  Blocks between them are transmitted contiguously after the start of the burst.
+//The radio idles (transmits nothing) between bursts.  A block with numSamples == 0 outside of a burst is a no-op but
+//still returns a feedback token.
+//
+//Per the libbladeRF documentation, the DAC holds the last sample of a burst until the next burst.  The producer should
+//end each burst with a few zero samples to avoid transmitting a DC value while idle.
+//
+//When hopping on the block markers (-hop with -hopDwell 0), a block marked with both TX_BLOCK_FLAG_BURST_START and
+//TX_BLOCK_FLAG_HOP retunes the Tx channels to entry hopIndex of the hop list at the timestamp of the burst.
+
+#define TX_BLOCK_FLAG_BURST_START     (1u << 0) //This block starts a new burst at the given timestamp
+#define TX_BLOCK_FLAG_BURST_END       (1u << 1) //The last valid sample in this block ends the burst
+#define TX_BLOCK_FLAG_TX_NOW          (1u << 2) //Ignore the timestamp and start the burst as soon as possible
+#define TX_BLOCK_FLAG_ABSOLUTE_TIME   (1u << 3) //The timestamp is in bladeRF Tx sample clock ticks rather than relative to the Tx epoch
+#define TX_BLOCK_FLAG_HOP             (1u << 4) //Retune to hopIndex at the start of the burst
+
+typedef struct{
+    uint64_t timestamp;  //Time (in samples) to transmit the first sample of the burst.  Only used when TX_BLOCK_FLAG_BURST_START is set.
+                         //By default, relative to the Tx epoch (time 0 is the first sample time after the Tx stream is started + -txBurstLead)
+    uint32_t flags;      //TX_BLOCK_FLAG_*
+    int32_t numSamples;  //Number of valid samples in this block [0, blockLen]
+    uint32_t hopIndex;   //Entry of the hop list to retune to.  Only used when TX_BLOCK_FLAG_HOP is set
+    uint8_t reserved[12]; //Pads the header to 32 bytes to keep the sample arrays that follow it aligned
+} txBlockHeader_t;
+
+static_assert(sizeof(txBlockHeader_t) == 32, "txBlockHeader_t is expected to be 32 bytes");
+
+//---- Rx Block Header ----
+//When -rxBlockHeader is given, each block in the Rx FIFO is prefixed with this header.  The block is still blockLen
+//samples long (re[blockLen] followed by im[blockLen]).
+//
+//When the consumer falls behind and the Rx overflow policy drops blocks (-rxOverflowPolicy dropNewest or dropOldest),
+//the first block delivered after the dropped range is marked with RX_BLOCK_FLAG_DISCONTINUITY.  The dropped range is
+//[sampleIndex - droppedSamples, sampleIndex).  In MIMO mode, the same blocks are dropped from every channel.
+//
+//When a change is applied through the control socket (-controlSocket), the block starting at the sample index reported
+//to the control client is marked with RX_BLOCK_FLAG_CONFIG_CHANGE and configSeq is incremented.  Correction changes
+//(DC offset, IQ) apply exactly from this block.  RF changes (frequency, gain, bandwidth) are issued at this block but
+//samples already buffered by libbladeRF (up to -rxBladeRFNumBuffers*-rxBladeRFBlockLen) were captured before them.
+//
+//When the stream fails and the device is reopened (-recoveryTimeout), the first block of the restarted stream is marked
+//with RX_BLOCK_FLAG_RECOVERED and RX_BLOCK_FLAG_DISCONTINUITY.  droppedSamples covers the partial block that was
+//discarded and the outage (estimated from the wall clock time and the sample rate).  The device timestamps restart.
+
+#define RX_BLOCK_FLAG_DISCONTINUITY   (1u << 0) //Samples were dropped immediately before this block
+#define RX_BLOCK_FLAG_CONFIG_CHANGE   (1u << 1) //A runtime change was applied starting at this block
+#define RX_BLOCK_FLAG_RECOVERED       (1u << 2) //The device was reopened immediately before this block
+
+typedef struct{
+    uint64_t sampleIndex;    //Index (per channel) of the first sample in this block, counted from the start of the Rx stream
+    uint64_t droppedSamples; //Number of samples (per channel) dropped between the previous delivered block and this one
+    uint32_t flags;          //RX_BLOCK_FLAG_*
+    uint32_t configSeq;      //Number of runtime changes applied before this block
+    uint8_t reserved[8];    //Pads the header to 32 bytes to keep the sample arrays that follow it aligned
+} rxBlockHeader_t;
+
+static_assert(sizeof(rxBlockHeader_t) == 32, "rxBlockHeader_t is expected to be 32 bytes");
+
+#endif //BLADERFTOFIFO_BLOCKHEADERS_H
@@ -0,0 +1,490 @@
+//
+// Pre-trigger capture of the Rx stream
+//
+
+#define _GNU_SOURCE //MAP_HUGETLB and MADV_HUGEPAGE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "capture.h"
+
+#define CAPTURE_SLACK_FRACTION (0.25) //Extra ring (relative to the window) so that the dump can fall behind the Rx
+#define CAPTURE_MIN_SLACK_SEC (0.5)
+#define CAPTURE_RING_ALIGNMENT (2*1024*1024) //Huge page size
+#define CAPTURE_WRITE_BYTES (4*1024*1024)
+#define CAPTURE_POLL_US (1000)
+#define CAPTURE_MAX_MARKS (1024) //Discontinuities remembered for the dump metadata
+#define CAPTURE_TRIGGER_STRLEN (64)
+
+typedef struct{
+    uint64_t frame; //Position in the ring (frames since the start)
+    uint64_t globalIndex; //Index in the stream
+} captureMark_t;
+
+typedef struct{
+    bool active;
+    int fd;
+    char dataPath[512];
+    char metaPath[512];
+    uint64_t start; //Frames (ring position)
+    uint64_t trigger;
+    uint64_t end;
+    uint64_t pos; //Next frame to write
+    bool truncated; //The Rx overwrote samples before they were written
+    char triggerDesc[CAPTURE_TRIGGER_STRLEN];
+    struct timespec triggerTime; //Wall clock
+} captureDump_t;
+
+struct capture_s{
+    char *path;
+    char *label;
+    bool print;
+    int numChannels;
+    sampleFormat_t sampleFormat;
+    unsigned int sampRate;
+    unsigned long freq;
+    size_t frameBytes; //One sample of every channel
+    uint64_t preFrames;
+    uint64_t postFrames;
+
+    //Ring (positions count frames since the start of the capture).  The Rx thread publishes writeEnd before it overwrites
+    //the oldest samples and head after, so that the capture thread can tell whether the samples it read were intact
+    uint8_t *ring;
+    size_t ringBytes;
+    uint64_t ringFrames;
+    _Atomic uint64_t head;
+    _Atomic uint64_t writeEnd;
+
+    //Written by the Rx thread
+    captureMark_t marks[CAPTURE_MAX_MARKS];
+    _Atomic uint64_t numMarks;
+    uint64_t expectedIndex;
+    bool started;
+
+    //Triggers
+    char *triggerShmName;
+    _Atomic uint32_t *triggerShm;
+    uint32_t lastShmCount;
+    uint32_t lastSignalCount;
+    bool energyTrigger;
+    double energyThreshold; //Mean power relative to full scale
+    uint32_t energyWindow;
+    uint64_t energyPos;
+    bool energyArmed; //Energy triggers on the rising edge
+
+    atomic_bool stopCapture;
+    pthread_t thread;
+
+    //Capture thread only
+    captureDump_t dump;
+    int numDumps;
+    uint64_t triggersIgnored;
+};
+
+static atomic_uint captureSignalCount;
+
+void initCaptureConfig(captureConfig_t *config){
+    config->path = NULL;
+    config->preSec = CAPTURE_DEFAULT_PRE_SEC;
+    config->postSec = CAPTURE_DEFAULT_POST_SEC;
+    config->hugePages = false;
+    config->triggerShmName = NULL;
+    config->energyTrigger = false;
+    config->energyThreshold_dBFS = 0;
+    config->energyWindow = CAPTURE_DEFAULT_ENERGY_WINDOW;
+}
+
+void captureSignalTrigger(void){
+    atomic_fetch_add_explicit(&captureSignalCount, 1, memory_order_relaxed);
+}
+
+//Returns true if the frames starting at pos were not overwritten while they were read.  Call after reading
+static bool captureIntact(capture_t *capture, uint64_t pos){
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t writeEnd = atomic_load_explicit(&capture->writeEnd, memory_order_relaxed);
+    return writeEnd <= pos + capture->ringFrames;
+}
+
+static uint8_t* captureFrame(capture_t *capture, uint64_t pos){
+    return capture->ring + (pos%capture->ringFrames)*capture->frameBytes;
+}
+
+//Mean power of the loudest channel over the window starting at pos, relative to full scale
+static double captureWindowPower(capture_t *capture, uint64_t pos, uint32_t frames){
+    double power[BLADERF_MAX_CHANNELS] = {0};
+    int numComponents = 2*capture->numChannels;
+    for(uint32_t i = 0; i<frames; i++){
+        uint8_t *frame = captureFrame(capture, pos+i);
+        for(int comp = 0; comp<numComponents; comp++){
+            double val = capture->sampleFormat == SAMPLE_FORMAT_SC8_Q7 ? ((int8_t*) frame)[comp] : ((int16_t*) frame)[comp];
+            power[comp/2] += val*val;
+        }
+    }
+
+    double fullScale = capture->sampleFormat == SAMPLE_FORMAT_SC8_Q7 ? BLADERF_FULL_RANGE_VALUE_SC8 : BLADERF_FULL_RANGE_VALUE;
+    double maxPower = 0;
+    for(int chan = 0; chan<capture->numChannels; chan++){
+        double chanPower = power[chan]/frames/(fullScale*fullScale);
+        maxPower = chanPower > maxPower ? chanPower : maxPower;
+    }
+    return maxPower;
+}
+
+static void writeCaptureMeta(capture_t *capture, captureDump_t *dump){
+    FILE *meta = fopen(dump->metaPath, "w");
+    if(meta == NULL){
+        fprintf(stderr, "[%s] Unable to create capture metadata %s: %s\n", capture->label, dump->metaPath, strerror(errno));
+        return;
+    }
+
+    //The time of the first sample is estimated from the time the trigger was seen
+    struct timespec startTime = dump->triggerTime;
+    double preSec = ((double) (dump->trigger - dump->start))/capture->sampRate;
+    startTime.tv_sec -= (time_t) preSec;
+    startTime.tv_nsec -= (long) ((preSec - (time_t) preSec)*1e9);
+    if(startTime.tv_nsec < 0){
+        startTime.tv_nsec += 1000000000;
+        startTime.tv_sec--;
+    }
+    struct tm startUTC;
+    gmtime_r(&startTime.tv_sec, &startUTC);
+    char datetime[32];
+    strftime(datetime, sizeof(datetime), "%Y-%m-%dT%H:%M:%S", &startUTC);
+
+    fprintf(meta, "{\n");
+    fprintf(meta, "    \"global\": {\n");
+    fprintf(meta, "        \"core:datatype\": \"%s\",\n", capture->sampleFormat == SAMPLE_FORMAT_SC8_Q7 ? "ci8" : "ci16_le");
+    fprintf(meta, "        \"core:sample_rate\": %u,\n", capture->sampRate);
+    fprintf(meta, "        \"core:num_channels\": %d,\n", capture->numChannels);
+    fprintf(meta, "        \"core:version\": \"1.0.0\",\n");
+    fprintf(meta, "        \"core:recorder\": \"bladeRFToFIFO\",\n");
+    fprintf(meta, "        \"core:hw\": \"bladeRF %s\",\n", capture->label);
+    fprintf(meta, "        \"core:description\": \"Raw bladeRF samples around a trigger (%s)%s\"\n", dump->triggerDesc,
+            dump->truncated ? ".  Truncated: the dump fell behind the Rx" : "");
+    fprintf(meta, "    },\n");
+
+    //The segment containing the start of the dump, then one per discontinuity in the dump
+    fprintf(meta, "    \"captures\": [\n");
+    uint64_t numMarks = atomic_load_explicit(&capture->numMarks, memory_order_acquire);
+    uint64_t firstMark = numMarks > CAPTURE_MAX_MARKS ? numMarks - CAPTURE_MAX_MARKS : 0;
+    uint64_t globalIndex = dump->start;
+    for(uint64_t i = firstMark; i<numMarks; i++){
+        captureMark_t *mark = &capture->marks[i%CAPTURE_MAX_MARKS];
+        if(mark->frame <= dump->start){
+            globalIndex = mark->globalIndex + (dump->start - mark->frame);
+        }
+    }
+    fprintf(meta, "        {\"core:sample_start\": 0, \"core:global_index\": %lu, \"core:frequency\": %lu, \"core:datetime\": \"%s.%06ldZ\"}",
+            globalIndex, capture->freq, datetime, startTime.tv_nsec/1000);
+    for(uint64_t i = firstMark; i<numMarks; i++){
+        captureMark_t *mark = &capture->marks[i%CAPTURE_MAX_MARKS];
+        if(mark->frame > dump->start && mark->frame < dump->pos){
+            fprintf(meta, ",\n        {\"core:sample_start\": %lu, \"core:global_index\": %lu, \"core:frequency\": %lu}",
+                    mark->frame - dump->start, mark->globalIndex, capture->freq);
+        }
+    }
+    fprintf(meta, "\n    ],\n");
+    fprintf(meta, "    \"annotations\": [\n");
+    fprintf(meta, "        {\"core:sample_start\": %lu, \"core:label\": \"Trigger: %s\"}\n", dump->trigger - dump->start, dump->triggerDesc);
+    fprintf(meta, "    ]\n");
+    fprintf(meta, "}\n");
+    fclose(meta);
+}
+
+static void startDump(capture_t *capture, uint64_t trigger, uint64_t head, char *triggerDesc){
+    captureDump_t *dump = &capture->dump;
+    //The pre-trigger window is shorter if the capture started recently
+    uint64_t oldest = head > capture->ringFrames ? head - capture->ringFrames : 0;
+    dump->start = trigger > capture->preFrames ? trigger - capture->preFrames : 0;
+    dump->start = dump->start < oldest ? oldest : dump->start;
+    dump->trigger = trigger;
+    dump->end = trigger + capture->postFrames;
+    dump->pos = dump->start;
+    dump->truncated = false;
+    snprintf(dump->triggerDesc, sizeof(dump->triggerDesc), "%s", triggerDesc);
+    clock_gettime(CLOCK_REALTIME, &dump->triggerTime);
+
+    snprintf(dump->dataPath, sizeof(dump->dataPath), "%s_%d.sigmf-data", capture->path, capture->numDumps);
+    snprintf(dump->metaPath, sizeof(dump->metaPath), "%s_%d.sigmf-meta", capture->path, capture->numDumps);
+    capture->numDumps++;
+    dump->fd = open(dump->dataPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(dump->fd < 0){
+        fprintf(stderr, "[%s] Unable to create capture %s: %s\n", capture->label, dump->dataPath, strerror(errno));
+        return;
+    }
+    dump->active = true;
+
+    if(capture->print){
+        printf("[%s] Capture triggered (%s), dumping %.3f s before and %.3f s after to %s\n", capture->label, triggerDesc,
+               ((double) (trigger - dump->start))/capture->sampRate, ((double) capture->postFrames)/capture->sampRate, dump->dataPath);
+    }
+}
+
+static void finishDump(capture_t *capture){
+    captureDump_t *dump = &capture->dump;
+    close(dump->fd);
+    writeCaptureMeta(capture, dump);
+    dump->active = false;
+    if(capture->print || dump->truncated){
+        printf("[%s] Captured %lu Samples to %s%s\n", capture->label, dump->pos - dump->start, dump->dataPath,
+               dump->truncated ? " (Truncated: the dump fell behind the Rx, raise -capturePre/-capturePost slack or use faster storage)" : "");
+    }
+}
+
+//Writes the samples of the dump available so far.  Returns true if anything was written
+static bool continueDump(capture_t *capture, uint64_t head, bool stop){
+    captureDump_t *dump = &capture->dump;
+    uint64_t available = head < dump->end ? head : dump->end;
+    bool wrote = false;
+    while(dump->pos < available){
+        uint64_t frames = available - dump->pos;
+        uint64_t maxFrames = CAPTURE_WRITE_BYTES/capture->frameBytes;
+        frames = frames < maxFrames ? frames : maxFrames;
+        uint64_t framesToWrap = capture->ringFrames - dump->pos%capture->ringFrames;
+        frames = frames < framesToWrap ? frames : framesToWrap;
+
+        size_t bytes = frames*capture->frameBytes;
+        ssize_t written = write(dump->fd, captureFrame(capture, dump->pos), bytes);
+        if(written != (ssize_t) bytes){
+            fprintf(stderr, "[%s] Capture write failed: %s\n", capture->label, written < 0 ? strerror(errno) : "short write");
+            dump->truncated = true;
+            break;
+        }
+        if(!captureIntact(capture, dump->pos)){
+            //The samples were overwritten while being written, they are not kept
+            dump->truncated = true;
+            if(ftruncate(dump->fd, (off_t) ((dump->pos - dump->start)*capture->frameBytes)) != 0){
+                fprintf(stderr, "[%s] Unable to truncate capture: %s\n", capture->label, strerror(errno));
+            }
+            break;
+        }
+        dump->pos += frames;
+        wrote = true;
+    }
+
+    if(dump->truncated || dump->pos == dump->end || (stop && dump->pos == head)){
+        finishDump(capture);
+    }
+    return wrote;
+}
+
+static void* captureThread(void *uncastArgs){
+    capture_t *capture = (capture_t*) uncastArgs;
+
+    while(true){
+        //Stop is read before head so that the final head is seen
+        bool stop = atomic_load_explicit(&capture->stopCapture, memory_order_acquire);
+        uint64_t head = atomic_load_explicit(&capture->head, memory_order_acquire);
+
+        bool triggered = false;
+        uint64_t trigger = head;
+        char triggerDesc[CAPTURE_TRIGGER_STRLEN] = "";
+        uint32_t signalCount = atomic_load_explicit(&captureSignalCount, memory_order_relaxed);
+        if(signalCount != capture->lastSignalCount){
+            capture->lastSignalCount = signalCount;
+            triggered = true;
+            snprintf(triggerDesc, sizeof(triggerDesc), "SIGUSR2");
+        }
+        if(capture->triggerShm != NULL){
+            uint32_t shmCount = atomic_load_explicit(capture->triggerShm, memory_order_relaxed);
+            if(shmCount != capture->lastShmCount){
+                capture->lastShmCount = shmCount;
+                if(!triggered){
+                    triggered = true;
+                    snprintf(triggerDesc, sizeof(triggerDesc), "shm %s", capture->triggerShmName);
+                }
+            }
+        }
+        if(capture->energyTrigger){
+            //Skip ahead if the window fell out of the ring.  The energy is not monitored during a dump
+            if(capture->dump.active || head - capture->energyPos > capture->ringFrames/2){
+                capture->energyPos = head;
+            }
+            while(head - capture->energyPos >= capture->energyWindow){
+                double power = captureWindowPower(capture, capture->energyPos, capture->energyWindow);
+                if(captureIntact(capture, capture->energyPos)){
+                    bool above = power >= capture->energyThreshold;
+                    if(above && capture->energyArmed && !triggered){
+                        triggered = true;
+                        trigger = capture->energyPos;
+                        snprintf(triggerDesc, sizeof(triggerDesc), "energy %.1f dBFS", 10*log10(power));
+                    }
+                    capture->energyArmed = !above;
+                }
+                capture->energyPos += capture->energyWindow;
+            }
+        }
+
+        if(triggered){
+            if(capture->dump.active){
+                capture->triggersIgnored++;
+            }else{
+                startDump(capture, trigger, head, triggerDesc);
+            }
+        }
+
+        bool wrote = false;
+        if(capture->dump.active){
+            wrote = continueDump(capture, head, stop);
+        }
+        if(stop && !capture->dump.active){
+            break;
+        }
+        if(!wrote){
+            usleep(CAPTURE_POLL_US);
+        }
+    }
+
+    return NULL;
+}
+
+static uint8_t* captureAllocRing(size_t bytes, bool hugePages, char *label){
+    uint8_t *ring = MAP_FAILED;
+    if(hugePages){
+        ring = (uint8_t*) mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(ring == MAP_FAILED){
+            printf("[%s] Warning: Unable to allocate %.1f MB of huge pages for the capture ring (%s), using transparent huge pages\n",
+                   label, bytes/1e6, strerror(errno));
+        }
+    }
+    if(ring == MAP_FAILED){
+        ring = (uint8_t*) mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(ring == MAP_FAILED){
+            fprintf(stderr, "[%s] Unable to allocate the %.1f MB capture ring: %s\n", label, bytes/1e6, strerror(errno));
+            exit(1);
+        }
+        if(hugePages){
+            madvise(ring, bytes, MADV_HUGEPAGE);
+        }
+    }
+    //The ring is touched up front so that the Rx thread does not take page faults while the ring first fills
+    if(!prefaultBuffer(ring, bytes)){
+        printf("[%s] Warning: Unable to lock the capture ring in memory\n", label);
+    }
+    return ring;
+}
+
+capture_t* captureOpen(captureConfig_t *config, int numChannels, sampleFormat_t sampleFormat, unsigned int sampRate,
+                       unsigned long freq, char *label, bool print){
+    capture_t *capture = (capture_t*) calloc(1, sizeof(capture_t));
+    capture->path = config->path;
+    capture->label = label;
+    capture->print = print;
+    capture->numChannels = numChannels;
+    capture->sampleFormat = sampleFormat;
+    capture->sampRate = sampRate;
+    capture->freq = freq;
+    capture->frameBytes = numChannels*bladeRFSampleSize(sampleFormat);
+    capture->preFrames = (uint64_t) (config->preSec*sampRate);
+    capture->postFrames = (uint64_t) (config->postSec*sampRate);
+
+    double windowSec = config->preSec + config->postSec;
+    double slackSec = windowSec*CAPTURE_SLACK_FRACTION > CAPTURE_MIN_SLACK_SEC ? windowSec*CAPTURE_SLACK_FRACTION : CAPTURE_MIN_SLACK_SEC;
+    size_t ringBytes = (size_t) ((windowSec + slackSec)*sampRate)*capture->frameBytes;
+    capture->ringBytes = (ringBytes + CAPTURE_RING_ALIGNMENT - 1) / CAPTURE_RING_ALIGNMENT * CAPTURE_RING_ALIGNMENT;
+    capture->ringFrames = capture->ringBytes/capture->frameBytes;
+    capture->ring = captureAllocRing(capture->ringBytes, config->hugePages, label);
+    atomic_init(&capture->head, 0);
+    atomic_init(&capture->writeEnd, 0);
+    atomic_init(&capture->numMarks, 0);
+    atomic_init(&capture->stopCapture, false);
+    capture->lastSignalCount = atomic_load(&captureSignalCount);
+
+    if(config->triggerShmName != NULL){
+        int fd = shm_open(config->triggerShmName, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+        struct stat shmStat;
+        if(fd < 0 || fstat(fd, &shmStat) != 0 ||
+           (shmStat.st_size < (off_t) sizeof(uint32_t) && ftruncate(fd, sizeof(uint32_t)) != 0)){
+            fprintf(stderr, "[%s] Unable to create the capture trigger segment %s: %s\n", label, config->triggerShmName, strerror(errno));
+            exit(1);
+        }
+        void *shm = mmap(NULL, sizeof(uint32_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if(shm == MAP_FAILED){
+            fprintf(stderr, "[%s] Unable to map the capture trigger segment %s: %s\n", label, config->triggerShmName, strerror(errno));
+            exit(1);
+        }
+        capture->triggerShmName = config->triggerShmName;
+        capture->triggerShm = (_Atomic uint32_t*) shm;
+        capture->lastShmCount = atomic_load(capture->triggerShm);
+    }
+
+    capture->energyTrigger = config->energyTrigger;
+    capture->energyThreshold = pow(10, config->energyThreshold_dBFS/10);
+    capture->energyWindow = config->energyWindow;
+    capture->energyArmed = true;
+
+    int status = pthread_create(&capture->thread, NULL, captureThread, capture);
+    if (status != 0) {
+        printf("Could not create capture thread ... exiting");
+        errno = status;
+        perror(NULL);
+        exit(1);
+    }
+
+    if(print){
+        printf("[%s] Pre-trigger capture: %.3f s before, %.3f s after, %.1f MB ring, triggers: SIGUSR2", label,
+               config->preSec, config->postSec, capture->ringBytes/1e6);
+        if(config->triggerShmName != NULL){
+            printf(", shm %s", config->triggerShmName);
+        }
+        if(config->energyTrigger){
+            printf(", energy > %.1f dBFS", config->energyThreshold_dBFS);
+        }
+        printf("\n");
+    }
+    return capture;
+}
+
+void captureWriteRaw(capture_t *capture, const void *samples, uint32_t sampsPerChan, uint64_t sampleIndex){
+    uint64_t head = atomic_load_explicit(&capture->head, memory_order_relaxed);
+
+    if(!capture->started || sampleIndex != capture->expectedIndex){
+        uint64_t numMarks = atomic_load_explicit(&capture->numMarks, memory_order_relaxed);
+        capture->marks[numMarks%CAPTURE_MAX_MARKS].frame = head;
+        capture->marks[numMarks%CAPTURE_MAX_MARKS].globalIndex = sampleIndex;
+        atomic_store_explicit(&capture->numMarks, numMarks+1, memory_order_release);
+        capture->started = true;
+    }
+    capture->expectedIndex = sampleIndex + sampsPerChan;
+
+    //Announce the samples about to be overwritten before overwriting them
+    atomic_store_explicit(&capture->writeEnd, head + sampsPerChan, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    size_t bytes = sampsPerChan*capture->frameBytes;
+    size_t pos = (head%capture->ringFrames)*capture->frameBytes;
+    size_t firstBytes = capture->ringBytes - pos < bytes ? capture->ringBytes - pos : bytes;
+    memcpy(capture->ring + pos, samples, firstBytes);
+    memcpy(capture->ring, (const uint8_t*) samples + firstBytes, bytes - firstBytes);
+
+    atomic_store_explicit(&capture->head, head + sampsPerChan, memory_order_release);
+}
+
+void captureClose(capture_t *capture){
+    atomic_store_explicit(&capture->stopCapture, true, memory_order_release);
+    pthread_join(capture->thread, NULL);
+
+    if(capture->print){
+        printf("[%s] Captures: %d Dumps, %lu Triggers Ignored (During a Dump)\n", capture->label, capture->numDumps,
+               capture->triggersIgnored);
+    }
+
+    if(capture->triggerShm != NULL){
+        munmap((void*) capture->triggerShm, sizeof(uint32_t));
+        shm_unlink(capture->triggerShmName);
+    }
+    munmap(capture->ring, capture->ringBytes);
+    free(capture);
+}
@@ -0,0 +1,51 @@
+//
+// Pre-trigger capture of the Rx stream.  The Rx thread copies the raw samples into a preallocated in-memory ring that
+// holds the last few seconds.  A capture thread watches for triggers (SIGUSR2, a shared memory trigger counter, or the
+// signal energy) and dumps the window around each trigger to <path>_<n>.sigmf-data (with <path>_<n>.sigmf-meta) while
+// the Rx keeps overwriting the oldest samples.
+//
+
+#ifndef BLADERFTOFIFO_CAPTURE_H
+#define BLADERFTOFIFO_CAPTURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "helpers.h"
+#include "sampleConversion.h"
+
+#define CAPTURE_DEFAULT_PRE_SEC (5.0)
+#define CAPTURE_DEFAULT_POST_SEC (1.0)
+#define CAPTURE_DEFAULT_ENERGY_WINDOW (4096)
+
+typedef struct{
+    char *path; //Prefix of the dumps (NULL to disable)
+    double preSec; //Samples kept before the trigger
+    double postSec; //Samples captured after the trigger
+    bool hugePages; //Allocate the ring from explicit huge pages (falls back to transparent huge pages)
+    char *triggerShmName; //Shared memory segment holding a trigger counter (NULL to disable)
+    bool energyTrigger;
+    double energyThreshold_dBFS; //Mean power of any channel over the energy window
+    uint32_t energyWindow; //Samples (per channel)
+} captureConfig_t;
+
+typedef struct capture_s capture_t;
+
+void initCaptureConfig(captureConfig_t *config);
+
+//Allocates the ring (sized for the pre and post trigger windows plus slack for the dump) and starts the capture thread.
+//Exits if the ring or the trigger segment cannot be created
+capture_t* captureOpen(captureConfig_t *config, int numChannels, sampleFormat_t sampleFormat, unsigned int sampRate,
+                       unsigned long freq, char *label, bool print);
+
+//Rx thread: MIMO samples are interleaved by channel (as received from the bladeRF).  sampleIndex is the stream index
+//(per channel) of the first sample.  Never blocks, the oldest samples are overwritten
+void captureWriteRaw(capture_t *capture, const void *samples, uint32_t sampsPerChan, uint64_t sampleIndex);
+
+//Triggers every open capture.  Async signal safe (called from the SIGUSR2 handler)
+void captureSignalTrigger(void);
+
+//Finishes a dump in progress (with the samples received so far).  Call after the Rx thread has stopped
+void captureClose(capture_t *capture);
+
+#endif //BLADERFTOFIFO_CAPTURE_H
@@ -0,0 +1,101 @@
+//
+// Cache of the settings last applied to each bladeRF board
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "configCache.h"
+
+void initConfigCache(configCache_t *cache){
+    memset(cache, 0, sizeof(configCache_t));
+}
+
+static void configCachePath(char *dir, char *serial, char *path, size_t pathLen){
+    snprintf(path, pathLen, "%s/%s.cache", dir, serial);
+}
+
+bool configCacheLoad(char *dir, char *serial, configCache_t *cache){
+    initConfigCache(cache);
+    char path[4096];
+    configCachePath(dir, serial, path, sizeof(path));
+    FILE *file = fopen(path, "r");
+    if(file == NULL){
+        return false;
+    }
+
+    bool valid = true;
+    char line[256];
+    int version = -1;
+    while(valid && fgets(line, sizeof(line), file) != NULL){
+        char dirStr[3];
+        int chan, correctionsCleared, loopback;
+        cachedChannelConfig_t channel;
+        if(sscanf(line, "version %d", &version) == 1){
+            continue;
+        }
+        if(sscanf(line, "loopback %d", &loopback) == 1){
+            cache->loopbackValid = true;
+            cache->loopback = (bladerf_loopback) loopback;
+            continue;
+        }
+        if(sscanf(line, "%2[rxt]%d %lu %u %u %d %d", dirStr, &chan, &channel.freq, &channel.bw, &channel.sampRate,
+                  &channel.gain, &correctionsCleared) == 7 && chan >= 0 && chan < BLADERF_MAX_CHANNELS){
+            channel.valid = true;
+            channel.correctionsCleared = correctionsCleared != 0;
+            if(strcmp(dirStr, "rx") == 0){
+                cache->rx[chan] = channel;
+            }else if(strcmp(dirStr, "tx") == 0){
+                cache->tx[chan] = channel;
+            }else{
+                valid = false;
+            }
+            continue;
+        }
+        valid = false;
+    }
+    fclose(file);
+
+    //Only trusted for this run
+    unlink(path);
+
+    if(!valid || version != CONFIG_CACHE_VERSION){
+        initConfigCache(cache);
+        return false;
+    }
+    return true;
+}
+
+void configCacheSave(char *dir, char *serial, configCache_t *cache){
+    char path[4096];
+    configCachePath(dir, serial, path, sizeof(path));
+    //Written to a temporary file and renamed so that a partial cache is never read
+    char tmpPath[4096+4];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+    FILE *file = fopen(tmpPath, "w");
+    if(file == NULL){
+        printf("[%s] Warning: Unable to write the configuration cache %s: %s\n", serial, tmpPath, strerror(errno));
+        return;
+    }
+    fprintf(file, "version %d\n", CONFIG_CACHE_VERSION);
+    for(int chan = 0; chan<BLADERF_MAX_CHANNELS; chan++){
+        for(int dir = 0; dir<2; dir++){
+            cachedChannelConfig_t *channel = dir == 0 ? &cache->rx[chan] : &cache->tx[chan];
+            if(channel->valid){
+                fprintf(file, "%s%d %lu %u %u %d %d\n", dir == 0 ? "rx" : "tx", chan, channel->freq, channel->bw,
+                        channel->sampRate, channel->gain, channel->correctionsCleared ? 1 : 0);
+            }
+        }
+    }
+    if(cache->loopbackValid){
+        fprintf(file, "loopback %d\n", (int) cache->loopback);
+    }
+    bool written = fclose(file) == 0;
+    if(!written || rename(tmpPath, path) != 0){
+        printf("[%s] Warning: Unable to write the configuration cache %s: %s\n", serial, path, strerror(errno));
+        unlink(tmpPath);
+    }
+}
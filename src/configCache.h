@@ -0,0 +1,48 @@
+//
+// Cache of the settings last applied to each bladeRF board (-configCache).  The RFIC keeps its settings while the board
+// stays powered, so a restart with the same settings can skip the set/get round trips (and the RFIC retuning) of the
+// steps that did not change.
+//
+// The cache file of a board is removed when it is loaded and only written back at a clean exit, and only if the RF
+// settings were not changed at runtime (control socket, hopping).  A crash therefore leads to a full configuration on
+// the next start.  The frequency of one channel is read back before the cache is trusted to catch a board that was
+// power cycled or reconfigured by another program.
+//
+
+#ifndef BLADERFTOFIFO_CONFIGCACHE_H
+#define BLADERFTOFIFO_CONFIGCACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <libbladeRF.h>
+
+#include "helpers.h"
+
+#define CONFIG_CACHE_VERSION (1)
+
+typedef struct{
+    bool valid;
+    uint64_t freq;
+    uint32_t bw;
+    uint32_t sampRate;
+    int gain;
+    bool correctionsCleared; //The libbladeRF corrections were set to 0 (the corrections are done in software)
+} cachedChannelConfig_t;
+
+typedef struct{
+    cachedChannelConfig_t rx[BLADERF_MAX_CHANNELS];
+    cachedChannelConfig_t tx[BLADERF_MAX_CHANNELS];
+    bool loopbackValid;
+    bladerf_loopback loopback;
+} configCache_t;
+
+void initConfigCache(configCache_t *cache);
+
+//Loads (and removes) <dir>/<serial>.cache.  Returns false (with an empty cache) if there is no usable cache
+bool configCacheLoad(char *dir, char *serial, configCache_t *cache);
+
+//Writes <dir>/<serial>.cache.  Prints a warning if it cannot be written
+void configCacheSave(char *dir, char *serial, configCache_t *cache);
+
+#endif //BLADERFTOFIFO_CONFIGCACHE_H
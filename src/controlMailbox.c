@@ -0,0 +1,179 @@
+//
+// Runtime changes handed from the control socket to the Rx or Tx thread
+//
+
+#include <time.h>
+#include <errno.h>
+
+#include "controlMailbox.h"
+
+//The result of the last change and the RF params changed
+static void resetControlMailbox(controlMailbox_t *mailbox){
+    mailbox->status = 0;
+    mailbox->sampleIndex = 0;
+    mailbox->numApplied = 0;
+    mailbox->rfChanged = false;
+    for(int param = 0; param<=CONTROL_BANDWIDTH; param++){
+        mailbox->rfValid[param] = false;
+        mailbox->rf[param] = 0;
+    }
+}
+
+void initControlMailbox(controlMailbox_t *mailbox){
+    pthread_mutex_init(&mailbox->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&mailbox->done, &attr);
+    pthread_condattr_destroy(&attr);
+    atomic_init(&mailbox->pending, false);
+    mailbox->closed = false;
+    resetControlMailbox(mailbox);
+}
+
+void controlMailboxReopen(controlMailbox_t *mailbox){
+    pthread_mutex_lock(&mailbox->lock);
+    mailbox->closed = false;
+    atomic_store_explicit(&mailbox->pending, false, memory_order_relaxed);
+    resetControlMailbox(mailbox);
+    pthread_mutex_unlock(&mailbox->lock);
+}
+
+controlSubmitResult_t controlMailboxSubmit(controlMailbox_t *mailbox, controlChange_t *change, double timeoutSec,
+                                           int *status, uint64_t *sampleIndex){
+    pthread_mutex_lock(&mailbox->lock);
+    if(mailbox->closed){
+        pthread_mutex_unlock(&mailbox->lock);
+        return CONTROL_SUBMIT_CLOSED;
+    }
+    if(atomic_load_explicit(&mailbox->pending, memory_order_relaxed)){
+        pthread_mutex_unlock(&mailbox->lock);
+        return CONTROL_SUBMIT_BUSY;
+    }
+    mailbox->change = *change;
+    uint64_t numApplied = mailbox->numApplied;
+    atomic_store_explicit(&mailbox->pending, true, memory_order_release);
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += (time_t) timeoutSec;
+    deadline.tv_nsec += (long) ((timeoutSec - (time_t) timeoutSec)*1e9);
+    if(deadline.tv_nsec >= 1000000000){
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    while(mailbox->numApplied == numApplied && !mailbox->closed){
+        if(pthread_cond_timedwait(&mailbox->done, &mailbox->lock, &deadline) == ETIMEDOUT){
+            break;
+        }
+    }
+
+    controlSubmitResult_t result;
+    if(mailbox->numApplied != numApplied){
+        *status = mailbox->status;
+        *sampleIndex = mailbox->sampleIndex;
+        result = CONTROL_SUBMIT_APPLIED;
+    }else{
+        result = mailbox->closed ? CONTROL_SUBMIT_CLOSED : CONTROL_SUBMIT_QUEUED;
+    }
+    pthread_mutex_unlock(&mailbox->lock);
+    return result;
+}
+
+void controlMailboxLast(controlMailbox_t *mailbox, uint64_t *numApplied, uint64_t *sampleIndex, bool *pending, bool *closed){
+    pthread_mutex_lock(&mailbox->lock);
+    *numApplied = mailbox->numApplied;
+    *sampleIndex = mailbox->sampleIndex;
+    *pending = atomic_load_explicit(&mailbox->pending, memory_order_relaxed);
+    *closed = mailbox->closed;
+    pthread_mutex_unlock(&mailbox->lock);
+}
+
+bool controlMailboxRFChanged(controlMailbox_t *mailbox){
+    pthread_mutex_lock(&mailbox->lock);
+    bool rfChanged = mailbox->rfChanged;
+    pthread_mutex_unlock(&mailbox->lock);
+    return rfChanged;
+}
+
+bool controlMailboxLastRF(controlMailbox_t *mailbox, controlParam_t param, double *value){
+    pthread_mutex_lock(&mailbox->lock);
+    bool valid = param <= CONTROL_BANDWIDTH && mailbox->rfValid[param];
+    if(valid){
+        *value = mailbox->rf[param];
+    }
+    pthread_mutex_unlock(&mailbox->lock);
+    return valid;
+}
+
+void controlMailboxClose(controlMailbox_t *mailbox){
+    pthread_mutex_lock(&mailbox->lock);
+    mailbox->closed = true;
+    atomic_store_explicit(&mailbox->pending, false, memory_order_relaxed);
+    pthread_cond_broadcast(&mailbox->done);
+    pthread_mutex_unlock(&mailbox->lock);
+}
+
+static int controlApplyRF(controlChange_t *change, radioDevice_t *device, bool tx, int numChannels){
+    for(int chan = 0; chan<numChannels; chan++){
+        bladerf_channel ch = tx ? BLADERF_CHANNEL_TX(chan) : BLADERF_CHANNEL_RX(chan);
+        int status = 0;
+        switch(change->param){
+            case CONTROL_FREQUENCY:
+                status = radioDeviceSetFrequency(device, ch, (bladerf_frequency) change->value[0]);
+                break;
+            case CONTROL_GAIN:
+                status = radioDeviceSetGain(device, ch, (bladerf_gain) change->value[0]);
+                break;
+            case CONTROL_BANDWIDTH:
+                status = radioDeviceSetBandwidth(device, ch, (bladerf_bandwidth) change->value[0]);
+                break;
+            default:
+                break;
+        }
+        if(status != 0){
+            return status;
+        }
+    }
+    return 0;
+}
+
+int controlMailboxApply(controlMailbox_t *mailbox, uint64_t sampleIndex, radioDevice_t *device, bool tx, int numChannels,
+                        iqCorrection_t *corrections, double dcOffsetScale, double *dcOffsetI, double *dcOffsetQ,
+                        double *iqGain, double *iqPhase_deg){
+    controlChange_t *change = &mailbox->change;
+    int status = 0;
+    bool rfChange = false;
+    if(change->param == CONTROL_DC_OFFSET || change->param == CONTROL_IQ_CORRECTION){
+        int chan = change->chan;
+        if(chan < 0 || chan >= numChannels){
+            status = BLADERF_ERR_INVAL;
+        }else{
+            if(change->param == CONTROL_DC_OFFSET){
+                dcOffsetI[chan] = change->value[0];
+                dcOffsetQ[chan] = change->value[1];
+            }else{
+                iqGain[chan] = change->value[0];
+                iqPhase_deg[chan] = change->value[1];
+            }
+            initIQCorrection(&corrections[chan], dcOffsetI[chan]*dcOffsetScale, dcOffsetQ[chan]*dcOffsetScale, iqGain[chan], iqPhase_deg[chan]);
+        }
+    }else{
+        status = controlApplyRF(change, device, tx, numChannels);
+        rfChange = true; //Even if it failed part way
+    }
+
+    pthread_mutex_lock(&mailbox->lock);
+    mailbox->rfChanged |= rfChange;
+    if(rfChange && status == 0){
+        mailbox->rfValid[change->param] = true;
+        mailbox->rf[change->param] = change->value[0];
+    }
+    mailbox->status = status;
+    mailbox->sampleIndex = sampleIndex;
+    mailbox->numApplied++;
+    atomic_store_explicit(&mailbox->pending, false, memory_order_release);
+    pthread_cond_broadcast(&mailbox->done);
+    pthread_mutex_unlock(&mailbox->lock);
+    return status;
+}
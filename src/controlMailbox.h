@@ -0,0 +1,88 @@
+//
+// Runtime changes (frequency, gain, bandwidth, corrections) handed from the control socket (controlSocket.h) to the Rx or
+// Tx thread.  The thread applies a change at its next block boundary so that the sample index at which the change took
+// effect is known.
+//
+
+#ifndef BLADERFTOFIFO_CONTROLMAILBOX_H
+#define BLADERFTOFIFO_CONTROLMAILBOX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "radioDevice.h"
+#include "sampleConversion.h"
+
+typedef enum{
+    CONTROL_FREQUENCY = 0,    //value[0]: Hz (every channel)
+    CONTROL_GAIN = 1,         //value[0]: dB (every channel)
+    CONTROL_BANDWIDTH = 2,    //value[0]: Hz (every channel)
+    CONTROL_DC_OFFSET = 3,    //value[0], value[1]: I, Q (12 bit ADC/DAC scale) of channel chan
+    CONTROL_IQ_CORRECTION = 4 //value[0], value[1]: gain, phase (deg) of channel chan
+} controlParam_t;
+
+typedef struct{
+    controlParam_t param;
+    int chan;
+    double value[2];
+} controlChange_t;
+
+typedef enum{
+    CONTROL_SUBMIT_APPLIED = 0, //The thread applied the change (see status)
+    CONTROL_SUBMIT_QUEUED = 1,  //The thread has not reached a block boundary yet (ex. the Tx is waiting for a block)
+    CONTROL_SUBMIT_BUSY = 2,    //The previous change is still queued
+    CONTROL_SUBMIT_CLOSED = 3   //The thread has exited
+} controlSubmitResult_t;
+
+//A single change is in flight at a time
+typedef struct{
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    atomic_bool pending; //Polled by the Rx/Tx thread at each block boundary
+    bool closed;
+    controlChange_t change;
+
+    //Result of the last change
+    int status; //libbladeRF status
+    uint64_t sampleIndex; //First sample (per channel) of the stream with the change applied
+    uint64_t numApplied;
+    bool rfChanged; //A frequency, gain, or bandwidth change was applied (the board no longer has the configured settings)
+    bool rfValid[CONTROL_BANDWIDTH+1]; //Indexed by the RF params
+    double rf[CONTROL_BANDWIDTH+1]; //Last value of each RF param applied successfully
+} controlMailbox_t;
+
+void initControlMailbox(controlMailbox_t *mailbox);
+
+//Control side: waits up to timeoutSec for the thread to apply the change
+controlSubmitResult_t controlMailboxSubmit(controlMailbox_t *mailbox, controlChange_t *change, double timeoutSec,
+                                           int *status, uint64_t *sampleIndex);
+
+//The result of the last change
+void controlMailboxLast(controlMailbox_t *mailbox, uint64_t *numApplied, uint64_t *sampleIndex, bool *pending, bool *closed);
+
+//True if an RF param (frequency, gain, bandwidth) was changed
+bool controlMailboxRFChanged(controlMailbox_t *mailbox);
+
+//The last value an RF param (frequency, gain, bandwidth) was changed to.  Returns false if it was not changed
+bool controlMailboxLastRF(controlMailbox_t *mailbox, controlParam_t param, double *value);
+
+//Refuses later changes.  Call after the Rx/Tx thread has exited
+void controlMailboxClose(controlMailbox_t *mailbox);
+
+//Accepts changes again (for a new Rx/Tx thread) with the results and RF params of the previous thread cleared
+void controlMailboxReopen(controlMailbox_t *mailbox);
+
+//Rx/Tx thread side
+static inline bool controlMailboxPending(controlMailbox_t *mailbox){
+    return mailbox != NULL && atomic_load_explicit(&mailbox->pending, memory_order_acquire);
+}
+
+//Applies the pending change to the device (RF params) or to the corrections of the thread (the per channel correction
+//settings are updated in place), then completes it.  Returns the libbladeRF status
+int controlMailboxApply(controlMailbox_t *mailbox, uint64_t sampleIndex, radioDevice_t *device, bool tx, int numChannels,
+                        iqCorrection_t *corrections, double dcOffsetScale, double *dcOffsetI, double *dcOffsetQ,
+                        double *iqGain, double *iqPhase_deg);
+
+#endif //BLADERFTOFIFO_CONTROLMAILBOX_H
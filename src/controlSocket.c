@@ -0,0 +1,303 @@
+//
+// UNIX domain control socket for runtime changes
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "controlSocket.h"
+
+#define CONTROL_SOCKET_LINE_LEN (256)
+#define CONTROL_SOCKET_POLL_MS (100)
+
+typedef struct{
+    int fd; //-1 if unused
+    char line[CONTROL_SOCKET_LINE_LEN];
+    size_t lineLen;
+} controlClient_t;
+
+struct controlSocket_s{
+    char *path;
+    int listenFd;
+    radioPipeline_t *pipelines;
+    int numPipelines;
+    bool print;
+    controlClient_t clients[CONTROL_SOCKET_MAX_CLIENTS];
+
+    atomic_bool stopControl;
+    pthread_t thread;
+};
+
+static void controlReply(int fd, const char *fmt, ...){
+    char reply[CONTROL_SOCKET_LINE_LEN];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(reply, sizeof(reply), fmt, args);
+    va_end(args);
+    if(len < 0){
+        return;
+    }
+    if(len >= (int) sizeof(reply)){
+        len = sizeof(reply) - 1;
+    }
+    //A client that does not read its replies is not waited for
+    ssize_t written = send(fd, reply, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+    (void) written;
+}
+
+static void controlStatus(controlSocket_t *control, int fd){
+    for(int i = 0; i<control->numPipelines; i++){
+        radioPipeline_t *pipeline = &control->pipelines[i];
+        for(int dir = 0; dir<2; dir++){
+            bool tx = dir == 1;
+            if(tx ? !pipeline->txEnabled : !pipeline->rxEnabled){
+                continue;
+            }
+            uint64_t numApplied, sampleIndex;
+            bool pending, closed;
+            controlMailboxLast(tx ? &pipeline->txControl : &pipeline->rxControl, &numApplied, &sampleIndex, &pending, &closed);
+            controlReply(fd, "status %s %s %s %lu %lu %d\n", pipeline->config.serial, tx ? "tx" : "rx",
+                         closed ? "stopped" : "running", numApplied, sampleIndex, pending ? 1 : 0);
+        }
+    }
+}
+
+static bool controlParseDouble(char *str, double *val){
+    if(str == NULL){
+        return false;
+    }
+    char *end;
+    *val = strtod(str, &end);
+    return end != str && *end == '\0';
+}
+
+static void controlCommand(controlSocket_t *control, int fd, char *line){
+    char *tokens[8];
+    int numTokens = 0;
+    char *savePtr;
+    for(char *token = strtok_r(line, " \t\r", &savePtr); token != NULL && numTokens < 8; token = strtok_r(NULL, " \t\r", &savePtr)){
+        tokens[numTokens++] = token;
+    }
+    if(numTokens == 0){
+        return;
+    }
+    if(strcmp(tokens[0], "status") == 0){
+        controlStatus(control, fd);
+        return;
+    }
+
+    //The serial number is optional with a single board
+    int tok = 0;
+    radioPipeline_t *pipeline = NULL;
+    if(strcmp(tokens[0], "rx") != 0 && strcmp(tokens[0], "tx") != 0){
+        for(int i = 0; i<control->numPipelines; i++){
+            if(strcmp(tokens[0], control->pipelines[i].config.serial) == 0){
+                pipeline = &control->pipelines[i];
+            }
+        }
+        if(pipeline == NULL){
+            controlReply(fd, "error unknown board %s\n", tokens[0]);
+            return;
+        }
+        tok++;
+    }else if(control->numPipelines == 1){
+        pipeline = &control->pipelines[0];
+    }else{
+        controlReply(fd, "error the serial number is required with multiple boards\n");
+        return;
+    }
+
+    if(numTokens - tok < 3 || (strcmp(tokens[tok], "rx") != 0 && strcmp(tokens[tok], "tx") != 0)){
+        controlReply(fd, "error expected [<serial>] <rx|tx> <freq|gain|bw|dcoffset|iq> <value(s)>\n");
+        return;
+    }
+    bool tx = strcmp(tokens[tok], "tx") == 0;
+    char *paramStr = tokens[tok+1];
+    char **values = &tokens[tok+2];
+    int numValues = numTokens - tok - 2;
+
+    controlChange_t change;
+    change.chan = 0;
+    change.value[0] = 0;
+    change.value[1] = 0;
+    bool valid;
+    if(strcmp(paramStr, "freq") == 0 || strcmp(paramStr, "gain") == 0 || strcmp(paramStr, "bw") == 0){
+        change.param = paramStr[0] == 'f' ? CONTROL_FREQUENCY : (paramStr[0] == 'g' ? CONTROL_GAIN : CONTROL_BANDWIDTH);
+        valid = numValues == 1 && controlParseDouble(values[0], &change.value[0]);
+        valid &= change.param == CONTROL_GAIN || change.value[0] > 0;
+    }else if(strcmp(paramStr, "dcoffset") == 0 || strcmp(paramStr, "iq") == 0){
+        change.param = paramStr[0] == 'd' ? CONTROL_DC_OFFSET : CONTROL_IQ_CORRECTION;
+        double chan = -1;
+        valid = numValues == 3 && controlParseDouble(values[0], &chan) &&
+                controlParseDouble(values[1], &change.value[0]) && controlParseDouble(values[2], &change.value[1]);
+        valid &= chan >= 0 && chan < pipeline->config.numChannels;
+        change.chan = (int) chan;
+    }else{
+        controlReply(fd, "error unknown parameter %s\n", paramStr);
+        return;
+    }
+    if(!valid){
+        controlReply(fd, "error invalid value(s) for %s\n", paramStr);
+        return;
+    }
+
+    char *dirStr = tx ? "tx" : "rx";
+    int status = 0;
+    uint64_t sampleIndex = 0;
+    controlSubmitResult_t result = controlMailboxSubmit(tx ? &pipeline->txControl : &pipeline->rxControl, &change,
+                                                        CONTROL_SOCKET_TIMEOUT_SEC, &status, &sampleIndex);
+    switch(result){
+        case CONTROL_SUBMIT_APPLIED:
+            if(status != 0){
+                controlReply(fd, "error %s %s %s: %s\n", pipeline->config.serial, dirStr, paramStr, bladerf_strerror(status));
+            }else{
+                controlReply(fd, "ok %s %s %lu\n", pipeline->config.serial, dirStr, sampleIndex);
+            }
+            if(control->print){
+                printf("[%s] Control: %s %s applied at sample %lu (status %d)\n", pipeline->config.serial, dirStr, paramStr, sampleIndex, status);
+            }
+            break;
+        case CONTROL_SUBMIT_QUEUED:
+            controlReply(fd, "queued %s %s\n", pipeline->config.serial, dirStr);
+            break;
+        case CONTROL_SUBMIT_BUSY:
+            controlReply(fd, "error %s %s a change is already queued\n", pipeline->config.serial, dirStr);
+            break;
+        default:
+            controlReply(fd, "error %s %s is not running\n", pipeline->config.serial, dirStr);
+            break;
+    }
+}
+
+//Returns false once the client has disconnected
+static bool controlReadClient(controlSocket_t *control, controlClient_t *client){
+    char buf[CONTROL_SOCKET_LINE_LEN];
+    ssize_t bytesRead = recv(client->fd, buf, sizeof(buf), 0);
+    if(bytesRead <= 0){
+        return bytesRead < 0 && (errno == EAGAIN || errno == EINTR);
+    }
+    for(ssize_t i = 0; i<bytesRead; i++){
+        if(buf[i] == '\n'){
+            client->line[client->lineLen] = '\0';
+            controlCommand(control, client->fd, client->line);
+            client->lineLen = 0;
+        }else if(client->lineLen < CONTROL_SOCKET_LINE_LEN-1){
+            client->line[client->lineLen++] = buf[i];
+        }
+    }
+    return true;
+}
+
+static void* controlSocketThread(void *uncastArgs){
+    controlSocket_t *control = (controlSocket_t*) uncastArgs;
+    while(!atomic_load_explicit(&control->stopControl, memory_order_acquire)){
+        struct pollfd fds[CONTROL_SOCKET_MAX_CLIENTS+1];
+        fds[0].fd = control->listenFd;
+        fds[0].events = POLLIN;
+        for(int i = 0; i<CONTROL_SOCKET_MAX_CLIENTS; i++){
+            fds[i+1].fd = control->clients[i].fd; //Negative fds are ignored by poll
+            fds[i+1].events = POLLIN;
+            fds[i+1].revents = 0;
+        }
+        int ready = poll(fds, CONTROL_SOCKET_MAX_CLIENTS+1, CONTROL_SOCKET_POLL_MS);
+        if(ready <= 0){
+            continue;
+        }
+
+        for(int i = 0; i<CONTROL_SOCKET_MAX_CLIENTS; i++){
+            controlClient_t *client = &control->clients[i];
+            if(client->fd >= 0 && (fds[i+1].revents & (POLLIN | POLLHUP | POLLERR))){
+                if(!controlReadClient(control, client)){
+                    close(client->fd);
+                    client->fd = -1;
+                }
+            }
+        }
+
+        if(fds[0].revents & POLLIN){
+            int fd = accept(control->listenFd, NULL, NULL);
+            if(fd < 0){
+                continue;
+            }
+            int slot = -1;
+            for(int i = 0; i<CONTROL_SOCKET_MAX_CLIENTS && slot < 0; i++){
+                if(control->clients[i].fd < 0){
+                    slot = i;
+                }
+            }
+            if(slot < 0){
+                controlReply(fd, "error too many clients (max %d)\n", CONTROL_SOCKET_MAX_CLIENTS);
+                close(fd);
+                continue;
+            }
+            control->clients[slot].fd = fd;
+            control->clients[slot].lineLen = 0;
+        }
+    }
+    return NULL;
+}
+
+controlSocket_t* controlSocketOpen(char *path, radioPipeline_t *pipelines, int numPipelines, bool print){
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(strlen(path) >= sizeof(addr.sun_path)){
+        fprintf(stderr, "Control socket path is too long (max %lu characters): %s\n", sizeof(addr.sun_path)-1, path);
+        exit(1);
+    }
+    strcpy(addr.sun_path, path);
+
+    controlSocket_t *control = (controlSocket_t*) calloc(1, sizeof(controlSocket_t));
+    control->path = path;
+    control->pipelines = pipelines;
+    control->numPipelines = numPipelines;
+    control->print = print;
+    for(int i = 0; i<CONTROL_SOCKET_MAX_CLIENTS; i++){
+        control->clients[i].fd = -1;
+    }
+    atomic_init(&control->stopControl, false);
+
+    //A socket left by a previous run that did not exit cleanly
+    unlink(path);
+    control->listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(control->listenFd < 0 || bind(control->listenFd, (struct sockaddr*) &addr, sizeof(addr)) != 0 ||
+       listen(control->listenFd, CONTROL_SOCKET_MAX_CLIENTS) != 0){
+        fprintf(stderr, "Unable to create the control socket %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+
+    int status = pthread_create(&control->thread, NULL, controlSocketThread, control);
+    if (status != 0) {
+        printf("Could not create control socket thread ... exiting");
+        errno = status;
+        perror(NULL);
+        exit(1);
+    }
+
+    if(print){
+        printf("Listening for runtime changes on %s\n", path);
+    }
+    return control;
+}
+
+void controlSocketClose(controlSocket_t *control){
+    atomic_store_explicit(&control->stopControl, true, memory_order_release);
+    pthread_join(control->thread, NULL);
+    for(int i = 0; i<CONTROL_SOCKET_MAX_CLIENTS; i++){
+        if(control->clients[i].fd >= 0){
+            close(control->clients[i].fd);
+        }
+    }
+    close(control->listenFd);
+    unlink(control->path);
+    free(control);
+}
@@ -0,0 +1,40 @@
+//
+// UNIX domain control socket (-controlSocket) for changing the frequency, gain, bandwidth, and corrections of the running
+// boards without restarting the streams.
+//
+// Each line sent to the socket is a command.  The serial number may be omitted when there is a single board:
+//     [<serial>] <rx|tx> freq <Hz>
+//     [<serial>] <rx|tx> gain <dB>
+//     [<serial>] <rx|tx> bw <Hz>
+//     [<serial>] <rx|tx> dcoffset <chan> <I> <Q>
+//     [<serial>] <rx|tx> iq <chan> <gain> <phase_deg>
+//     status
+// The change is applied by the Rx/Tx thread at its next block boundary and the reply is one of:
+//     ok <serial> <rx|tx> <sampleIndex>
+//     queued <serial> <rx|tx>   (not applied within CONTROL_SOCKET_TIMEOUT_SEC, see status)
+//     error <message>
+// sampleIndex is the first sample (per channel) of the stream with the change applied: counted from the start of the Rx
+// stream (the block with that rxBlockHeader_t::sampleIndex is marked RX_BLOCK_FLAG_CONFIG_CHANGE), or of the samples
+// read from the Tx FIFOs.  status replies with one line per board and direction:
+//     status <serial> <rx|tx> <running|stopped> <changes applied> <sampleIndex of the last> <pending (0|1)>
+//
+
+#ifndef BLADERFTOFIFO_CONTROLSOCKET_H
+#define BLADERFTOFIFO_CONTROLSOCKET_H
+
+#include <stdbool.h>
+
+#include "radioPipeline.h"
+
+#define CONTROL_SOCKET_MAX_CLIENTS (8)
+#define CONTROL_SOCKET_TIMEOUT_SEC (1.0)
+
+typedef struct controlSocket_s controlSocket_t;
+
+//Creates the socket (replacing a stale one at path) and starts the control thread.  Exits if it cannot be created
+controlSocket_t* controlSocketOpen(char *path, radioPipeline_t *pipelines, int numPipelines, bool print);
+
+//Stops the control thread and removes the socket.  Call before closing the pipelines
+void controlSocketClose(controlSocket_t *control);
+
+#endif //BLADERFTOFIFO_CONTROLSOCKET_H
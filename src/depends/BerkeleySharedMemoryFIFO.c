@@ -41,6 +41,31 @@
 #include <string.h>
 #include <fcntl.h>
 #include <sys/types.h>
+#include <errno.h>
+#include <time.h>
+
+#define CONSUMER_STOP_CHECK_NS (100000000) //consumerOpenFIFOUnlessStopped checks the stop flag this often while waiting
+
+static uint64_t livenessNowNs(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t) now.tv_sec)*1000000000 + (uint64_t) now.tv_nsec;
+}
+
+static char* livenessSegmentName(char *sharedName){
+    char *name = malloc(strlen(sharedName)+6);
+    strcpy(name, sharedName);
+    strcat(name, "_LIVE");
+    return name;
+}
+
+//Locks the FIFO mapping in memory so that it is not paged out under memory pressure.
+//Failure (ex. due to RLIMIT_MEMLOCK) is not fatal as the mapping has already been prefaulted.
+static void lockFifoBlock(sharedMemoryFIFO_t *fifo){
+    if(mlock(fifo->fifoBlock, fifo->fifoSharedBlockSizeBytes) != 0){
+        printf("Warning: Unable to lock FIFO %s in memory: %s\n", fifo->sharedName, strerror(errno));
+    }
+}
 
 void initSharedMemoryFIFO(sharedMemoryFIFO_t *fifo){
     fifo->sharedName = NULL;
@@ -56,6 +81,10 @@ void initSharedMemoryFIFO(sharedMemoryFIFO_t *fifo){
     fifo->currentOffset = 0;
     fifo->fifoSharedBlockSizeBytes = 0;
     fifo->rxReady = false;
+    fifo->livenessName = NULL;
+    fifo->liveness = NULL;
+    fifo->generation = 0;
+    fifo->consumerTimeoutSec = 0;
 }
 
 int producerOpenInitFIFO(char *sharedName, size_t fifoSizeBytes, sharedMemoryFIFO_t *fifo){
@@ -79,6 +108,8 @@ int producerOpenInitFIFO(char *sharedName, size_t fifoSizeBytes, sharedMemoryFIF
         perror(NULL);
         exit(1);
     }
+    //The semaphores may be left over from a previous producer (consumers return the Tx semaphore once they pass it)
+    while(sem_trywait(fifo->txSem) == 0){}
 
     fifo->rxSemaphoreName = malloc(sharedNameLen+5);
     strcpy(fifo->rxSemaphoreName, "/");
@@ -90,6 +121,27 @@ int producerOpenInitFIFO(char *sharedName, size_t fifoSizeBytes, sharedMemoryFIF
         perror(NULL);
         exit(1);
     }
+    while(sem_trywait(fifo->rxSem) == 0){}
+
+    //---- Init liveness ----
+    fifo->livenessName = livenessSegmentName(sharedName);
+    int livenessFD = shm_open(fifo->livenessName, O_CREAT | O_RDWR, S_IRWXU);
+    if (livenessFD == -1 || ftruncate(livenessFD, sizeof(sharedMemoryFIFOLiveness_t)) == -1){
+        printf("Unable to open liveness shm\n");
+        perror(NULL);
+        exit(1);
+    }
+    fifo->liveness = (sharedMemoryFIFOLiveness_t*) mmap(NULL, sizeof(sharedMemoryFIFOLiveness_t), PROT_READ | PROT_WRITE, MAP_SHARED, livenessFD, 0);
+    if (fifo->liveness == MAP_FAILED){
+        printf("Liveness mmap failed\n");
+        perror(NULL);
+        exit(1);
+    }
+    close(livenessFD);
+    atomic_init(&fifo->liveness->generation, 0);
+    atomic_init(&fifo->liveness->resetGeneration, 0);
+    atomic_init(&fifo->liveness->heartbeatNs, 0);
+    fifo->generation = 0;
 
     //---- Init shared mem ----
     fifo->sharedFD = shm_open(sharedName, O_CREAT | O_RDWR, S_IRWXU);
@@ -107,12 +159,15 @@ int producerOpenInitFIFO(char *sharedName, size_t fifoSizeBytes, sharedMemoryFIF
         exit(1);
     }
 
-    fifo->fifoBlock = mmap(NULL, sharedBlockSize, PROT_READ | PROT_WRITE, MAP_SHARED, fifo->sharedFD, 0);
+    //MAP_POPULATE prefaults the mapping so that the first writes do not incur page faults
+    //The pages are allocated by the calling thread and, with the default NUMA policy, are placed on its node
+    fifo->fifoBlock = mmap(NULL, sharedBlockSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fifo->sharedFD, 0);
     if (fifo->fifoBlock == MAP_FAILED){
         printf("Rx mmap failed\n");
         perror(NULL);
         exit(1);
     }
+    lockFifoBlock(fifo);
 
     //---- Init the fifoCount ----
     fifo->fifoCount = (atomic_int_fast32_t*) fifo->fifoBlock;
@@ -131,6 +186,10 @@ int producerOpenInitFIFO(char *sharedName, size_t fifoSizeBytes, sharedMemoryFIF
 }
 
 int consumerOpenFIFOBlock(char *sharedName, size_t fifoSizeBytes, sharedMemoryFIFO_t *fifo){
+    return consumerOpenFIFOUnlessStopped(sharedName, fifoSizeBytes, fifo, NULL);
+}
+
+int consumerOpenFIFOUnlessStopped(char *sharedName, size_t fifoSizeBytes, sharedMemoryFIFO_t *fifo, volatile bool *stop){
     fifo->sharedName = sharedName;
     fifo->fifoSizeBytes = fifoSizeBytes;
     size_t sharedBlockSize = fifoSizeBytes + sizeof(atomic_int_fast32_t);
@@ -161,12 +220,36 @@ int consumerOpenFIFOBlock(char *sharedName, size_t fifoSizeBytes, sharedMemoryFI
     }
 
     //Block on the semaphore while the producer is initializing
-    int status = sem_wait(fifo->txSem);
+    int status;
+    if(stop == NULL){
+        status = sem_wait(fifo->txSem);
+    }else{
+        do{
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += CONSUMER_STOP_CHECK_NS;
+            if(deadline.tv_nsec >= 1000000000){
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000;
+            }
+            status = sem_timedwait(fifo->txSem, &deadline);
+        }while(status == -1 && (errno == ETIMEDOUT || errno == EINTR) && !(*stop));
+        if(status == -1 && *stop){
+            sem_close(fifo->txSem);
+            sem_close(fifo->rxSem);
+            free(fifo->txSemaphoreName);
+            free(fifo->rxSemaphoreName);
+            initSharedMemoryFIFO(fifo);
+            return 0;
+        }
+    }
     if(status == -1){
         printf("Unable to wait on tx semaphore\n");
         perror(NULL);
         exit(1);
     }
+    //Leave it posted for a consumer that reattaches later
+    sem_post(fifo->txSem);
 
     //The semaphore is an implicit fence
 
@@ -180,12 +263,14 @@ int consumerOpenFIFOBlock(char *sharedName, size_t fifoSizeBytes, sharedMemoryFI
 
     //No need to resize shared memory, the producer has already done that
 
-    fifo->fifoBlock = mmap(NULL, sharedBlockSize, PROT_READ | PROT_WRITE, MAP_SHARED, fifo->sharedFD, 0);
+    //MAP_POPULATE prefaults the mapping so that the first reads do not incur page faults
+    fifo->fifoBlock = mmap(NULL, sharedBlockSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fifo->sharedFD, 0);
     if(fifo->fifoBlock == MAP_FAILED){
         printf("Rx mmap failed\n");
         perror(NULL);
         exit(1);
     }
+    lockFifoBlock(fifo);
 
     //---- Get appropriate pointers from the shared memory block ----
     fifo->fifoCount = (atomic_int_fast32_t*) fifo->fifoBlock;
@@ -193,12 +278,93 @@ int consumerOpenFIFOBlock(char *sharedName, size_t fifoSizeBytes, sharedMemoryFI
     char* fifoBlockBytes = (char*) fifo->fifoBlock;
     fifo->fifoBuffer = (void*) (fifoBlockBytes + sizeof(atomic_int_fast32_t));
 
+    //---- Attach (if the producer supports reattaching) ----
+    fifo->livenessName = livenessSegmentName(sharedName);
+    int livenessFD = shm_open(fifo->livenessName, O_RDWR, S_IRWXU);
+    if(livenessFD != -1){
+        fifo->liveness = (sharedMemoryFIFOLiveness_t*) mmap(NULL, sizeof(sharedMemoryFIFOLiveness_t), PROT_READ | PROT_WRITE, MAP_SHARED, livenessFD, 0);
+        if(fifo->liveness == MAP_FAILED){
+            fifo->liveness = NULL;
+        }
+        close(livenessFD);
+    }
+    if(fifo->liveness != NULL){
+        atomic_store_explicit(&fifo->liveness->heartbeatNs, livenessNowNs(), memory_order_relaxed);
+        //The producer discards the FIFO contents when it sees the new generation.  Reads wait until it has
+        fifo->generation = atomic_fetch_add_explicit(&fifo->liveness->generation, 1, memory_order_acq_rel) + 1;
+    }
+
     //inform producer that consumer is ready
     sem_post(fifo->rxSem);
 
     return sharedBlockSize;
 }
 
+void producerWaitForConsumer(sharedMemoryFIFO_t *fifo){
+    if(!fifo->rxReady) {
+        //---- Wait for consumer to join ---
+        sem_wait(fifo->rxSem);
+        fifo->rxReady = true;
+    }
+    producerCheckReattach(fifo);
+}
+
+bool producerCheckReattach(sharedMemoryFIFO_t *fifo){
+    if(fifo->liveness == NULL){
+        return false;
+    }
+    uint64_t generation = atomic_load_explicit(&fifo->liveness->generation, memory_order_acquire);
+    if(generation == fifo->generation){
+        return false;
+    }
+
+    //The new consumer starts reading at the start of the buffer.  It does not read until the reset is acknowledged
+    atomic_store_explicit(fifo->fifoCount, 0, memory_order_relaxed);
+    fifo->currentOffset = 0;
+    fifo->generation = generation;
+    fifo->rxReady = true;
+    while(sem_trywait(fifo->rxSem) == 0){}
+    atomic_store_explicit(&fifo->liveness->resetGeneration, generation, memory_order_release);
+    return true;
+}
+
+void producerDetachConsumer(sharedMemoryFIFO_t *fifo){
+    if(fifo->liveness != NULL){
+        //Looks like a consumer that attached and exited
+        atomic_store_explicit(&fifo->liveness->heartbeatNs, 0, memory_order_relaxed);
+        atomic_fetch_add_explicit(&fifo->liveness->generation, 1, memory_order_acq_rel);
+    }
+    if(fifo->rxSem != NULL){
+        sem_post(fifo->rxSem);
+    }
+}
+
+bool producerConsumerAttached(sharedMemoryFIFO_t *fifo){
+    if(fifo->liveness == NULL || atomic_load_explicit(&fifo->liveness->generation, memory_order_relaxed) == 0){
+        return true;
+    }
+    uint64_t heartbeatNs = atomic_load_explicit(&fifo->liveness->heartbeatNs, memory_order_relaxed);
+    if(heartbeatNs == 0){
+        return false;
+    }
+    if(fifo->consumerTimeoutSec <= 0){
+        return true;
+    }
+    uint64_t nowNs = livenessNowNs();
+    return nowNs < heartbeatNs || nowNs - heartbeatNs < (uint64_t) (fifo->consumerTimeoutSec*1e9);
+}
+
+//The consumer does not read until the producer has discarded the contents left for the previous consumer
+static bool consumerAttachAcknowledged(sharedMemoryFIFO_t *fifo){
+    return fifo->liveness == NULL || atomic_load_explicit(&fifo->liveness->resetGeneration, memory_order_acquire) >= fifo->generation;
+}
+
+static void consumerHeartbeat(sharedMemoryFIFO_t *fifo){
+    if(fifo->liveness != NULL){
+        atomic_store_explicit(&fifo->liveness->heartbeatNs, livenessNowNs(), memory_order_relaxed);
+    }
+}
+
 //currentOffset is updated by the call
 //currentOffset is in bytes
 //fifosize is in bytes
@@ -209,17 +375,18 @@ int writeFifo(void* src_uncast, size_t elementSize, int numElements, sharedMemor
     char* dst = (char*) fifo->fifoBuffer;
     char* src = (char*) src_uncast;
 
-    if(!fifo->rxReady) {
-        //---- Wait for consumer to join ---
-        sem_wait(fifo->rxSem);
-        fifo->rxReady = true;
-    }
+    producerWaitForConsumer(fifo);
 
     bool hasRoom = false;
 
     size_t bytesToWrite = elementSize*numElements;
 
+    int spins = 0;
     while(!hasRoom){
+        if(spins++ % CONSUMER_TIMEOUT_CHECK_SPINS == 0 && !producerCheckReattach(fifo) && !producerConsumerAttached(fifo)){
+            //Nobody is going to make room
+            return 0;
+        }
         int currentCount = atomic_load_explicit(fifo->fifoCount, memory_order_acquire);
         int spaceInFIFO = fifo->fifoSizeBytes - currentCount;
         //TODO: REMOVE
@@ -272,6 +439,9 @@ int readFifo(void* dst_uncast, size_t elementSize, int numElements, sharedMemory
     size_t bytesToRead = elementSize*numElements;
 
     while(!hasData){
+        if(!consumerAttachAcknowledged(fifo)){
+            continue;
+        }
         int currentCount = atomic_load_explicit(fifo->fifoCount, memory_order_acquire);
         //TODO: REMOVE
         if(currentCount<0){
@@ -311,6 +481,7 @@ int readFifo(void* dst_uncast, size_t elementSize, int numElements, sharedMemory
 
     //Update the fifoCount, do not need the new value
     atomic_fetch_sub_explicit(fifo->fifoCount, bytesToRead, memory_order_acq_rel);
+    consumerHeartbeat(fifo);
 
     return numElements;
 }
@@ -340,6 +511,11 @@ void cleanupHelper(sharedMemoryFIFO_t *fifo){
             perror(NULL);
         }
     }
+
+    if(fifo->liveness != NULL) {
+        munmap(fifo->liveness, sizeof(sharedMemoryFIFOLiveness_t));
+        fifo->liveness = NULL;
+    }
 }
 
 void cleanupProducer(sharedMemoryFIFO_t *fifo){
@@ -373,6 +549,11 @@ void cleanupProducer(sharedMemoryFIFO_t *fifo){
         }
     }
 
+    if(fifo->livenessName != NULL){
+        shm_unlink(fifo->livenessName);
+        free(fifo->livenessName);
+    }
+
     if(fifo->txSemaphoreName != NULL){
         free(fifo->txSemaphoreName);
     }
@@ -383,8 +564,16 @@ void cleanupProducer(sharedMemoryFIFO_t *fifo){
 }
 
 void cleanupConsumer(sharedMemoryFIFO_t *fifo) {
+    //Detach unless another consumer has attached since
+    if(fifo->liveness != NULL && atomic_load_explicit(&fifo->liveness->generation, memory_order_relaxed) == fifo->generation){
+        atomic_store_explicit(&fifo->liveness->heartbeatNs, 0, memory_order_relaxed);
+    }
     cleanupHelper(fifo);
 
+    if (fifo->livenessName != NULL) {
+        free(fifo->livenessName);
+    }
+
     if (fifo->txSemaphoreName != NULL) {
         free(fifo->txSemaphoreName);
     }
@@ -395,11 +584,23 @@ void cleanupConsumer(sharedMemoryFIFO_t *fifo) {
 }
 
 bool isReadyForReading(sharedMemoryFIFO_t *fifo){
+    if(!consumerAttachAcknowledged(fifo)){
+        return false;
+    }
     int32_t currentCount = atomic_load_explicit(fifo->fifoCount, memory_order_acquire);
     return currentCount != 0;
 }
 
+bool hasDataForReading(size_t bytesToRead, sharedMemoryFIFO_t *fifo){
+    if(!consumerAttachAcknowledged(fifo)){
+        return false;
+    }
+    int32_t currentCount = atomic_load_explicit(fifo->fifoCount, memory_order_acquire);
+    return currentCount >= bytesToRead;
+}
+
 bool isReadyForWriting(sharedMemoryFIFO_t *fifo){
+    producerCheckReattach(fifo);
     if(!fifo->rxReady) {
         //---- Check if consumer joined ----
         int status = sem_trywait(fifo->rxSem);
@@ -413,4 +614,13 @@ bool isReadyForWriting(sharedMemoryFIFO_t *fifo){
 
     int32_t currentCount = atomic_load_explicit(fifo->fifoCount, memory_order_acquire);
     return currentCount < fifo->fifoSizeBytes;
-}
\ No newline at end of file
+}
+
+bool hasRoomForWriting(size_t bytesToWrite, sharedMemoryFIFO_t *fifo){
+    if(!isReadyForWriting(fifo)){
+        return false;
+    }
+
+    int32_t currentCount = atomic_load_explicit(fifo->fifoCount, memory_order_acquire);
+    return bytesToWrite <= fifo->fifoSizeBytes - currentCount;
+}
@@ -41,11 +41,27 @@
 #endif
 
 #include <stdatomic.h>
+#include <stdint.h>
 #include <semaphore.h>
 #include <sys/mman.h>
 #include <unistd.h>
 #include <stdbool.h>
 
+//---- Consumer Reattach ----
+//The producer also creates a liveness segment (<sharedName>_LIVE).  Each consumer that opens the FIFO increments the
+//generation and heartbeats as it reads.  When the producer sees a new generation, it discards the contents of the FIFO
+//(left for the previous consumer) and acknowledges the generation.  The consumer does not read until then.  A
+//consumer that exits (cleanupConsumer), or that does not read for longer than the producer's consumerTimeoutSec while
+//the FIFO is full, is detached: writeFifo stops waiting for it.  A single consumer is attached at a time.  Consumers
+//without this support do not increment the generation and are never treated as detached.
+#define CONSUMER_TIMEOUT_CHECK_SPINS (1024) //writeFifo checks for a detached consumer every this many polls of a full FIFO
+
+typedef struct{
+    atomic_uint_fast64_t generation;      //Incremented by each consumer that attaches
+    atomic_uint_fast64_t resetGeneration; //Last generation the producer discarded the FIFO contents for
+    atomic_uint_fast64_t heartbeatNs;     //CLOCK_MONOTONIC of the last read by the consumer (0 once it has exited)
+} sharedMemoryFIFOLiveness_t;
+
 typedef struct{
     char *sharedName;
     int sharedFD;
@@ -60,6 +76,10 @@ typedef struct{
     size_t fifoSharedBlockSizeBytes;
     size_t currentOffset;
     bool rxReady;
+    char *livenessName;
+    sharedMemoryFIFOLiveness_t *liveness; //NULL if the other side does not support reattaching
+    uint64_t generation; //Producer: the last generation acknowledged, Consumer: the generation attached as
+    double consumerTimeoutSec; //Producer: 0 to only detach a consumer once it exits
 } sharedMemoryFIFO_t;
 
 void initSharedMemoryFIFO(sharedMemoryFIFO_t *fifo);
@@ -68,7 +88,15 @@ int producerOpenInitFIFO(char *sharedName, size_t fifoSizeBytes, sharedMemoryFIF
 
 int consumerOpenFIFOBlock(char *sharedName, size_t fifoSizeBytes, sharedMemoryFIFO_t *fifo);
 
-//NOTE: this function blocks until numElements can be written into the FIFO
+//Same as consumerOpenFIFOBlock but stops waiting for the producer once *stop is set.  Returns 0 (with nothing left to
+//clean up) if stopped
+int consumerOpenFIFOUnlessStopped(char *sharedName, size_t fifoSizeBytes, sharedMemoryFIFO_t *fifo, volatile bool *stop);
+
+//Blocks until the consumer has opened the FIFO.  Called by writeFifo before the first write
+void producerWaitForConsumer(sharedMemoryFIFO_t *fifo);
+
+//NOTE: this function blocks until numElements can be written into the FIFO.  Returns 0 without writing if the consumer
+//is detached while waiting
 int writeFifo(void* src, size_t elementSize, int numElements, sharedMemoryFIFO_t *fifo);
 
 int readFifo(void* dst, size_t elementSize, int numElements, sharedMemoryFIFO_t *fifo);
@@ -79,6 +107,23 @@ void cleanupConsumer(sharedMemoryFIFO_t *fifo);
 
 bool isReadyForReading(sharedMemoryFIFO_t *fifo);
 
+//Non-blocking check that bytesToRead can be read without blocking
+bool hasDataForReading(size_t bytesToRead, sharedMemoryFIFO_t *fifo);
+
 bool isReadyForWriting(sharedMemoryFIFO_t *fifo);
 
+//Non-blocking check that the consumer has joined and bytesToWrite can be written without blocking
+bool hasRoomForWriting(size_t bytesToWrite, sharedMemoryFIFO_t *fifo);
+
+//False once the consumer has exited or (with consumerTimeoutSec) has not read for that long.  True before a consumer
+//supporting reattach has joined
+bool producerConsumerAttached(sharedMemoryFIFO_t *fifo);
+
+//Discards the contents of the FIFO if a new consumer has attached.  Returns true if it did.  Called by the write calls
+bool producerCheckReattach(sharedMemoryFIFO_t *fifo);
+
+//Treats the consumer as detached (writeFifo returns 0 rather than waiting for room) and releases a producer waiting for
+//a consumer to join.  Used to stop a producer without its consumer.  Another thread may call it
+void producerDetachConsumer(sharedMemoryFIFO_t *fifo);
+
 #endif //BERKELEYSHAREDMEMORYFIFO_H
\ No newline at end of file
@@ -0,0 +1,153 @@
+//
+// Block lifecycle tracing in the Chrome trace event format
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "eventTrace.h"
+
+static const char *traceEventNames[TRACE_NUM_EVENT_TYPES] = {
+    "Device Read", "Device Submit", "Conversion", "FIFO Wait", "FIFO Commit", "Feedback", "Rx Drop", "Tx Underflow"
+};
+
+struct eventTrace_s{
+    FILE *file;
+    bool print;
+    int pid;
+    uint64_t eventsWritten;
+
+    pthread_mutex_t buffersLock; //Tracks are added while the trace thread runs
+    traceBuffer_t *buffers[EVENT_TRACE_MAX_BUFFERS];
+    int numBuffers;
+    int numBuffersNamed; //Tracks whose thread_name metadata has been written
+
+    atomic_bool stopTrace;
+    pthread_t thread;
+};
+
+static void eventTraceWriteEvent(eventTrace_t *trace, traceBuffer_t *buffer, traceEvent_t *event){
+    //ts and dur are in us
+    const char *name = traceEventNames[event->type < TRACE_NUM_EVENT_TYPES ? event->type : 0];
+    if(event->type == TRACE_RX_DROP || event->type == TRACE_TX_UNDERFLOW){
+        fprintf(trace->file, ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"args\":{\"block\":%lu}}",
+                name, trace->pid, buffer->tid, event->startNs/1e3, event->arg);
+    }else{
+        fprintf(trace->file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"block\":%lu}}",
+                name, trace->pid, buffer->tid, event->startNs/1e3, event->durationNs/1e3, event->arg);
+    }
+    trace->eventsWritten++;
+}
+
+//Writes the events logged since the last flush
+static void eventTraceFlush(eventTrace_t *trace){
+    pthread_mutex_lock(&trace->buffersLock);
+    int numBuffers = trace->numBuffers;
+    for(int i = trace->numBuffersNamed; i<numBuffers; i++){
+        fprintf(trace->file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                trace->pid, trace->buffers[i]->tid, trace->buffers[i]->name);
+    }
+    trace->numBuffersNamed = numBuffers;
+    pthread_mutex_unlock(&trace->buffersLock);
+
+    for(int i = 0; i<numBuffers; i++){
+        traceBuffer_t *buffer = trace->buffers[i];
+        uint64_t tail = atomic_load_explicit(&buffer->tail, memory_order_relaxed);
+        uint64_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+        for(; tail<head; tail++){
+            eventTraceWriteEvent(trace, buffer, &buffer->events[tail & (EVENT_TRACE_BUFFER_EVENTS - 1)]);
+        }
+        atomic_store_explicit(&buffer->tail, tail, memory_order_release);
+    }
+}
+
+static void* eventTraceThread(void *uncastArgs){
+    eventTrace_t *trace = (eventTrace_t*) uncastArgs;
+    while(!atomic_load_explicit(&trace->stopTrace, memory_order_acquire)){
+        eventTraceFlush(trace);
+        usleep(EVENT_TRACE_FLUSH_PERIOD_US);
+    }
+    return NULL;
+}
+
+eventTrace_t* eventTraceOpen(char *path, bool print){
+    eventTrace_t *trace = (eventTrace_t*) calloc(1, sizeof(eventTrace_t));
+    trace->file = fopen(path, "w");
+    if(trace->file == NULL){
+        fprintf(stderr, "Unable to create the trace file %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+    trace->print = print;
+    trace->pid = (int) getpid();
+    pthread_mutex_init(&trace->buffersLock, NULL);
+    atomic_init(&trace->stopTrace, false);
+
+    //Each later record is written with a leading comma
+    fprintf(trace->file, "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"clock\":\"CLOCK_MONOTONIC\"},\"traceEvents\":[\n");
+    fprintf(trace->file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"bladeRFToFIFO\"}}", trace->pid);
+
+    int status = pthread_create(&trace->thread, NULL, eventTraceThread, trace);
+    if (status != 0) {
+        printf("Could not create trace thread ... exiting");
+        errno = status;
+        perror(NULL);
+        exit(1);
+    }
+
+    if(print){
+        printf("Tracing the block lifecycle to %s\n", path);
+    }
+    return trace;
+}
+
+traceBuffer_t* eventTraceAddBuffer(eventTrace_t *trace, char *name){
+    traceBuffer_t *buffer = (traceBuffer_t*) aligned_alloc(64, (sizeof(traceBuffer_t) + 63)/64*64);
+    traceEvent_t *events = (traceEvent_t*) malloc(sizeof(traceEvent_t)*EVENT_TRACE_BUFFER_EVENTS);
+    if(buffer == NULL || events == NULL){
+        fprintf(stderr, "Unable to allocate the trace buffer\n");
+        exit(1);
+    }
+    //Touch the buffer so that tracing does not page fault in the traced thread
+    memset(events, 0, sizeof(traceEvent_t)*EVENT_TRACE_BUFFER_EVENTS);
+    atomic_init(&buffer->head, 0);
+    atomic_init(&buffer->tail, 0);
+    atomic_init(&buffer->dropped, 0);
+    snprintf(buffer->name, sizeof(buffer->name), "%s", name);
+    buffer->events = events;
+
+    pthread_mutex_lock(&trace->buffersLock);
+    if(trace->numBuffers == EVENT_TRACE_MAX_BUFFERS){
+        fprintf(stderr, "Too many traced threads (max %d)\n", EVENT_TRACE_MAX_BUFFERS);
+        exit(1);
+    }
+    buffer->tid = trace->numBuffers + 1;
+    trace->buffers[trace->numBuffers] = buffer;
+    trace->numBuffers++;
+    pthread_mutex_unlock(&trace->buffersLock);
+    return buffer;
+}
+
+void eventTraceClose(eventTrace_t *trace){
+    atomic_store_explicit(&trace->stopTrace, true, memory_order_release);
+    pthread_join(trace->thread, NULL);
+    eventTraceFlush(trace);
+
+    fprintf(trace->file, "\n]}\n");
+    fclose(trace->file);
+
+    uint64_t dropped = 0;
+    for(int i = 0; i<trace->numBuffers; i++){
+        dropped += atomic_load(&trace->buffers[i]->dropped);
+        free(trace->buffers[i]->events);
+        free(trace->buffers[i]);
+    }
+    if(trace->print || dropped > 0){
+        printf("Trace: %lu Events Written, %lu Dropped (Trace Buffer Full)\n", trace->eventsWritten, dropped);
+    }
+    pthread_mutex_destroy(&trace->buffersLock);
+    free(trace);
+}
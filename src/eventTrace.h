@@ -0,0 +1,99 @@
+//
+// Block lifecycle tracing.  The Rx and Tx threads log the spans of each stage (device read/submit, conversion, FIFO
+// wait, FIFO commit, feedback token) into their own lock-free buffers.  A trace thread drains the buffers into a
+// Chrome trace event (JSON) file that can be opened in Perfetto or chrome://tracing.  Timestamps are CLOCK_MONOTONIC
+// so the trace lines up with a trace of the process on the other side of the FIFOs taken with the same clock.
+//
+
+#ifndef BLADERFTOFIFO_EVENTTRACE_H
+#define BLADERFTOFIFO_EVENTTRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#define EVENT_TRACE_BUFFER_EVENTS (65536) //Per thread, must be a power of 2.  Events are dropped (and counted) if it fills
+#define EVENT_TRACE_MAX_BUFFERS (64)
+#define EVENT_TRACE_FLUSH_PERIOD_US (20000)
+
+typedef enum{
+    TRACE_DEVICE_READ = 0,   //bladerf_sync_rx
+    TRACE_DEVICE_SUBMIT = 1, //bladerf_sync_tx
+    TRACE_CONVERT = 2,
+    TRACE_FIFO_WAIT = 3,     //Tx: readFifo
+    TRACE_FIFO_COMMIT = 4,   //Rx: writeFifo
+    TRACE_FEEDBACK = 5,      //Tx: feedback token returned
+    TRACE_RX_DROP = 6,       //Instant: Rx block dropped (FIFO full)
+    TRACE_TX_UNDERFLOW = 7,  //Instant: Tx producer missed the deadline
+    TRACE_NUM_EVENT_TYPES = 8
+} traceEventType_t;
+
+typedef struct{
+    uint64_t startNs;
+    uint64_t durationNs;
+    uint64_t arg; //Sample index (Rx) or block number (Tx) of the FIFO block the event belongs to
+    uint32_t type;
+    uint32_t reserved;
+} traceEvent_t;
+
+//Single producer (the traced thread), single consumer (the trace thread)
+typedef struct{
+    _Alignas(64) atomic_uint_fast64_t head; //Written by the traced thread
+    _Alignas(64) atomic_uint_fast64_t tail; //Written by the trace thread
+    atomic_uint_fast64_t dropped;
+    int tid; //Track in the trace
+    char name[64];
+    traceEvent_t *events;
+} traceBuffer_t;
+
+typedef struct eventTrace_s eventTrace_t;
+
+//Opens the trace file and starts the trace thread.  Exits if the file cannot be created
+eventTrace_t* eventTraceOpen(char *path, bool print);
+
+//Adds a track (one per traced thread).  Not for the hot path
+traceBuffer_t* eventTraceAddBuffer(eventTrace_t *trace, char *name);
+
+//Drains the buffers and completes the JSON.  Call after the traced threads have stopped
+void eventTraceClose(eventTrace_t *trace);
+
+//Returns 0 when not tracing (buffer is NULL)
+static inline uint64_t traceNow(traceBuffer_t *buffer){
+    if(buffer == NULL){
+        return 0;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t) now.tv_sec)*1000000000 + (uint64_t) now.tv_nsec;
+}
+
+static inline void traceLog(traceBuffer_t *buffer, traceEventType_t type, uint64_t startNs, uint64_t endNs, uint64_t arg){
+    uint64_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    if(head - atomic_load_explicit(&buffer->tail, memory_order_acquire) >= EVENT_TRACE_BUFFER_EVENTS){
+        atomic_store_explicit(&buffer->dropped, atomic_load_explicit(&buffer->dropped, memory_order_relaxed) + 1, memory_order_relaxed);
+        return;
+    }
+    traceEvent_t *event = &buffer->events[head & (EVENT_TRACE_BUFFER_EVENTS - 1)];
+    event->startNs = startNs;
+    event->durationNs = endNs - startNs;
+    event->arg = arg;
+    event->type = (uint32_t) type;
+    atomic_store_explicit(&buffer->head, head + 1, memory_order_release);
+}
+
+//Logs the span from startNs (from traceNow) to now.  No-op when not tracing
+static inline void traceSpan(traceBuffer_t *buffer, traceEventType_t type, uint64_t startNs, uint64_t arg){
+    if(buffer != NULL){
+        traceLog(buffer, type, startNs, traceNow(buffer), arg);
+    }
+}
+
+static inline void traceInstant(traceBuffer_t *buffer, traceEventType_t type, uint64_t arg){
+    if(buffer != NULL){
+        uint64_t now = traceNow(buffer);
+        traceLog(buffer, type, now, now, arg);
+    }
+}
+
+#endif //BLADERFTOFIFO_EVENTTRACE_H
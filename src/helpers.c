@@ -6,6 +6,7 @@
 #include <memory.h>
 #include <stdio.h>
 #include <math.h>
+#include <sys/mman.h>
 
 #include "helpers.h"
 
@@ -16,6 +17,11 @@ void* vitis_aligned_alloc(size_t alignment, size_t size){
     return rtnVal;
 }
 
+bool prefaultBuffer(void* buffer, size_t size){
+    memset(buffer, 0, size);
+    return mlock(buffer, size) == 0;
+}
+
 char* bladeRFGainModeToStr(bladerf_gain_mode mode){
     switch(mode) {
         case BLADERF_GAIN_DEFAULT:
@@ -111,4 +117,8 @@ void getIQImbalCorrections(double iqGain, double iqPhase_deg, double* A, double*
     *A = 1/iqGain;
     *C = -tan(iQPhase)/iqGain;
     *D = 1/cos(iQPhase);
-}
\ No newline at end of file
+}
+
+double difftimespec(struct timespec* a, struct timespec* b){
+    return (a->tv_sec - b->tv_sec) + ((double) (a->tv_nsec - b->tv_nsec))*(0.000000001);
+}
@@ -5,15 +5,20 @@
 #ifndef BLADERFTOFIFO_HELPERS_H
 #define BLADERFTOFIFO_HELPERS_H
 
+#include <stdbool.h>
 #include <libbladeRF.h>
+#include <time.h>
 
 #include "math.h"
 
 #define MEM_ALIGNMENT (64)
 #define BLADERF_FULL_RANGE_VALUE (2047)
+#define BLADERF_FULL_RANGE_VALUE_SC8 (127) //SC8_Q7 carries the 8 MSBs of the 12 bit samples
+#define BLADERF_MAX_SAMP_RATE_SC16 (61440000) //Above this, SC8_Q7 with the oversample feature is required
 #define SAMPLE_COMPONENT_DATATYPE float
 #define SAMPLE_SIZE (sizeof(SAMPLE_COMPONENT_DATATYPE)*2)
 #define FEEDBACK_DATATYPE int32_t
+#define BLADERF_MAX_CHANNELS (2) //The bladeRF 2.0 micro has 2 Rx and 2 Tx channels
 
 #if SAMPLE_COMPONENT_DATATYPE == float
 #define SAMPLE_ROUND_FCTN(X) (lroundf(X))
@@ -30,6 +35,11 @@
 //Borrowed from Laminar/Vitis emit
 void* vitis_aligned_alloc(size_t alignment, size_t size);
 
+//Touches every page of the buffer (zeroing it) and locks it in memory so that the first use does not incur page faults.
+//Should be called from the thread that uses the buffer so that, with the default NUMA policy, the pages are placed on
+//the node of that thread (first touch).  Returns false if the buffer could not be locked.
+bool prefaultBuffer(void* buffer, size_t size);
+
 char* bladeRFGainModeToStr(bladerf_gain_mode mode);
 
 char* bladeRFLoopbackModeToStr(bladerf_loopback mode);
@@ -38,4 +48,7 @@ void reportBladeRFChannelState(struct bladerf *dev, bool tx, int chanNum);
 
 void getIQImbalCorrections(double iqGain, double iqPhase_deg, double* A, double* C, double* D);
 
+//Returns a-b in seconds
+double difftimespec(struct timespec* a, struct timespec* b);
+
 #endif //BLADERFTOFIFO_HELPERS_H
@@ -0,0 +1,293 @@
+//
+// Frequency hopping with quick tunes and scheduled retunes
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "hopper.h"
+
+struct hopper_s{
+    hopConfig_t config;
+    radioDevice_t *device;
+    int numChannels;
+    char *label;
+    bool print;
+
+    //Indexed by direction (0 for Rx, 1 for Tx)
+    bool hop[2];
+    unsigned int sampRate[2];
+    struct bladerf_quick_tune *quickTunes[2]; //[chan*numFreqs + freq]
+    pipelineStats_t *stats[2];
+
+    volatile bool *stop;
+    atomic_bool stopHop;
+    bool threadRunning;
+    pthread_t thread;
+};
+
+void initHopConfig(hopConfig_t *config){
+    config->numFreqs = 0;
+    config->dwell_us = 0;
+    config->rx = true;
+    config->tx = true;
+}
+
+bool parseHopFrequencies(char *str, hopConfig_t *config){
+    int numFreqs = 0;
+    char *pos = str;
+    while(*pos != '\0'){
+        if(numFreqs == HOP_MAX_FREQS){
+            return false;
+        }
+        char *end;
+        double freq = strtod(pos, &end);
+        if(end == pos || freq <= 0 || (*end != ',' && *end != '\0')){
+            return false;
+        }
+        config->freqs[numFreqs++] = (uint64_t) freq;
+        pos = *end == ',' ? end + 1 : end;
+    }
+    if(numFreqs == 0){
+        return false;
+    }
+    config->numFreqs = numFreqs;
+    return true;
+}
+
+bool parseHopDirection(char *str, hopConfig_t *config){
+    if(strcmp(str, "rx") == 0){
+        config->rx = true;
+        config->tx = false;
+    }else if(strcmp(str, "tx") == 0){
+        config->rx = false;
+        config->tx = true;
+    }else if(strcmp(str, "both") == 0){
+        config->rx = true;
+        config->tx = true;
+    }else{
+        return false;
+    }
+    return true;
+}
+
+static bladerf_channel hopperChannel(int dir, int chan){
+    return dir == 1 ? BLADERF_CHANNEL_TX(chan) : BLADERF_CHANNEL_RX(chan);
+}
+
+//Hops every channel of the direction.  Returns the libbladeRF status
+static int hopperScheduleRetune(hopper_t *hopper, int dir, uint32_t index, bladerf_timestamp timestamp){
+    for(int chan = 0; chan<hopper->numChannels; chan++){
+        int status = radioDeviceScheduleRetune(hopper->device, hopperChannel(dir, chan), timestamp, hopper->config.freqs[index],
+                                               &hopper->quickTunes[dir][chan*hopper->config.numFreqs + index]);
+        if(status != 0){
+            return status;
+        }
+    }
+    return 0;
+}
+
+hopper_t* hopperOpen(hopConfig_t *config, radioDevice_t *device, int numChannels, bool rx, bool tx,
+                     unsigned int rxSampRate, unsigned int txSampRate, unsigned long rxFreq, unsigned long txFreq,
+                     char *label, bool print){
+    hopper_t *hopper = (hopper_t*) calloc(1, sizeof(hopper_t));
+    hopper->config = *config;
+    hopper->device = device;
+    hopper->numChannels = numChannels;
+    hopper->label = label;
+    hopper->print = print;
+    //Without a schedule, the hops come from the Tx block markers
+    hopper->hop[0] = rx && config->rx && config->dwell_us > 0;
+    hopper->hop[1] = tx && config->tx;
+    hopper->sampRate[0] = rxSampRate;
+    hopper->sampRate[1] = txSampRate;
+    atomic_init(&hopper->stopHop, false);
+
+    int numFreqs = config->numFreqs;
+    unsigned long homeFreq[2] = {rxFreq, txFreq};
+    for(int dir = 0; dir<2; dir++){
+        if(!hopper->hop[dir]){
+            continue;
+        }
+        char *dirStr = dir == 1 ? "Tx" : "Rx";
+        hopper->quickTunes[dir] = (struct bladerf_quick_tune*) malloc(sizeof(struct bladerf_quick_tune)*numChannels*numFreqs);
+
+        //A full tune runs the tuning algorithm, the quick tune is read back for later
+        uint64_t fullTuneNs = 0, fullTuneMaxNs = 0;
+        for(int chan = 0; chan<numChannels; chan++){
+            for(int freq = 0; freq<numFreqs; freq++){
+                uint64_t start = pipelineStatsNow();
+                int status = radioDeviceSetFrequency(device, hopperChannel(dir, chan), config->freqs[freq]);
+                uint64_t tuneNs = pipelineStatsNow() - start;
+                if(status == 0){
+                    status = radioDeviceGetQuickTune(device, hopperChannel(dir, chan), &hopper->quickTunes[dir][chan*numFreqs + freq]);
+                }
+                if(status != 0){
+                    fprintf(stderr, "[%s] Unable to compute the %s quick tune for %lu Hz: %s\n", label, dirStr, config->freqs[freq], bladerf_strerror(status));
+                    exit(1);
+                }
+                fullTuneNs += tuneNs;
+                fullTuneMaxNs = tuneNs > fullTuneMaxNs ? tuneNs : fullTuneMaxNs;
+            }
+        }
+
+        //Time the quick tunes applied immediately
+        uint64_t quickTuneNs = 0, quickTuneMaxNs = 0;
+        for(int freq = 0; freq<numFreqs; freq++){
+            uint64_t start = pipelineStatsNow();
+            int status = hopperScheduleRetune(hopper, dir, freq, BLADERF_RETUNE_NOW);
+            uint64_t tuneNs = pipelineStatsNow() - start;
+            if(status != 0){
+                fprintf(stderr, "[%s] Unable to quick tune the %s to %lu Hz: %s\n", label, dirStr, config->freqs[freq], bladerf_strerror(status));
+                exit(1);
+            }
+            quickTuneNs += tuneNs;
+            quickTuneMaxNs = tuneNs > quickTuneMaxNs ? tuneNs : quickTuneMaxNs;
+        }
+
+        for(int chan = 0; chan<numChannels; chan++){
+            int status = radioDeviceSetFrequency(device, hopperChannel(dir, chan), homeFreq[dir]);
+            if(status != 0){
+                fprintf(stderr, "[%s] Unable to return the %s to %lu Hz: %s\n", label, dirStr, homeFreq[dir], bladerf_strerror(status));
+                exit(1);
+            }
+        }
+
+        if(print){
+            printf("[%s] %s Hop List: %d Frequencies, Full Tune %.1f us (Max %.1f us), Quick Tune %.1f us (Max %.1f us)\n",
+                   label, dirStr, numFreqs, fullTuneNs/1e3/(numChannels*numFreqs), fullTuneMaxNs/1e3,
+                   quickTuneNs/1e3/numFreqs, quickTuneMaxNs/1e3);
+        }
+    }
+    return hopper;
+}
+
+bool hopperTxMarkers(hopper_t *hopper){
+    return hopper->hop[1] && hopper->config.dwell_us <= 0;
+}
+
+//Keeps the retune queue of each hopping direction filled HOP_SCHEDULE_AHEAD hops ahead of the device clock
+static void* hopperThread(void *uncastArgs){
+    hopper_t *hopper = (hopper_t*) uncastArgs;
+    int numFreqs = hopper->config.numFreqs;
+
+    bladerf_timestamp epoch[2] = {0, 0};
+    uint64_t dwellSamples[2] = {0, 0};
+    uint64_t nextHop[2] = {0, 0};
+    for(int dir = 0; dir<2; dir++){
+        if(!hopper->hop[dir]){
+            continue;
+        }
+        dwellSamples[dir] = (uint64_t) (hopper->config.dwell_us*1e-6*hopper->sampRate[dir]);
+        if(dwellSamples[dir] < 1){
+            dwellSamples[dir] = 1;
+        }
+        int status = radioDeviceGetTimestamp(hopper->device, dir == 1 ? BLADERF_TX : BLADERF_RX, &epoch[dir]);
+        if(status != 0){
+            fprintf(stderr, "[%s] Failed to get the bladeRF timestamp for hopping: %s\n", hopper->label, bladerf_strerror(status));
+            return NULL;
+        }
+        epoch[dir] += (uint64_t) (HOP_START_LEAD_US*1e-6*hopper->sampRate[dir]);
+        if(hopper->print){
+            printf("[%s] %s Hopping Every %lu Samples from Timestamp %lu\n", hopper->label, dir == 1 ? "Tx" : "Rx", dwellSamples[dir], epoch[dir]);
+        }
+    }
+
+    //Wake up a few times per lookahead window
+    double sleep_us = hopper->config.dwell_us*HOP_SCHEDULE_AHEAD/4;
+    sleep_us = sleep_us < 200 ? 200 : (sleep_us > 100000 ? 100000 : sleep_us);
+
+    while(!atomic_load_explicit(&hopper->stopHop, memory_order_acquire) && !(*hopper->stop)){
+        for(int dir = 0; dir<2; dir++){
+            if(!hopper->hop[dir]){
+                continue;
+            }
+            bladerf_timestamp now;
+            int status = radioDeviceGetTimestamp(hopper->device, dir == 1 ? BLADERF_TX : BLADERF_RX, &now);
+            if(status != 0){
+                fprintf(stderr, "[%s] Failed to get the bladeRF timestamp for hopping: %s\n", hopper->label, bladerf_strerror(status));
+                return NULL;
+            }
+
+            //Hops whose dwell has already ended are skipped
+            while(epoch[dir] + (nextHop[dir]+1)*dwellSamples[dir] <= now){
+                pipelineStatsHopMissed(hopper->stats[dir]);
+                nextHop[dir]++;
+            }
+            while(epoch[dir] + nextHop[dir]*dwellSamples[dir] < now + HOP_SCHEDULE_AHEAD*dwellSamples[dir]){
+                bladerf_timestamp hopTime = epoch[dir] + nextHop[dir]*dwellSamples[dir];
+                if(hopTime <= now){
+                    //Late, hop now to stay on the pattern for the rest of the dwell
+                    pipelineStatsHopMissed(hopper->stats[dir]);
+                    hopTime = BLADERF_RETUNE_NOW;
+                }
+                uint64_t start = pipelineStatsNow();
+                status = hopperScheduleRetune(hopper, dir, (uint32_t) (nextHop[dir] % numFreqs), hopTime);
+                if(status != 0){
+                    fprintf(stderr, "[%s] Failed to schedule the %s hop: %s\n", hopper->label, dir == 1 ? "Tx" : "Rx", bladerf_strerror(status));
+                    return NULL;
+                }
+                pipelineStatsHop(hopper->stats[dir], pipelineStatsNow() - start);
+                nextHop[dir]++;
+            }
+        }
+        usleep((useconds_t) sleep_us);
+    }
+    return NULL;
+}
+
+void hopperStart(hopper_t *hopper, pipelineStats_t *rxStats, pipelineStats_t *txStats, volatile bool *stop){
+    hopper->stats[0] = rxStats;
+    hopper->stats[1] = txStats;
+    hopper->stop = stop;
+    if(hopper->config.dwell_us <= 0 || (!hopper->hop[0] && !hopper->hop[1])){
+        return;
+    }
+    int status = pthread_create(&hopper->thread, NULL, hopperThread, hopper);
+    if (status != 0) {
+        printf("Could not create hop thread ... exiting");
+        errno = status;
+        perror(NULL);
+        exit(1);
+    }
+    hopper->threadRunning = true;
+}
+
+int hopperRetuneTx(hopper_t *hopper, uint32_t index, bladerf_timestamp timestamp){
+    if(index >= (uint32_t) hopper->config.numFreqs){
+        return BLADERF_ERR_INVAL;
+    }
+    uint64_t start = pipelineStatsNow();
+    int status = hopperScheduleRetune(hopper, 1, index, timestamp);
+    if(status == 0){
+        pipelineStatsHop(hopper->stats[1], pipelineStatsNow() - start);
+    }
+    return status;
+}
+
+void hopperClose(hopper_t *hopper){
+    if(hopper->threadRunning){
+        atomic_store_explicit(&hopper->stopHop, true, memory_order_release);
+        pthread_join(hopper->thread, NULL);
+    }
+    for(int dir = 0; dir<2; dir++){
+        if(!hopper->hop[dir]){
+            continue;
+        }
+        for(int chan = 0; chan<hopper->numChannels; chan++){
+            radioDeviceCancelScheduledRetunes(hopper->device, hopperChannel(dir, chan));
+        }
+        if(hopper->print && hopper->stats[dir] != NULL){
+            printf("[%s] %s Hops: %lu, Missed: %lu, Longest Retune Call: %.1f us\n", hopper->label, dir == 1 ? "Tx" : "Rx",
+                   atomic_load(&hopper->stats[dir]->hops), atomic_load(&hopper->stats[dir]->hopsMissed),
+                   atomic_load(&hopper->stats[dir]->retuneMaxNs)/1e3);
+        }
+        free(hopper->quickTunes[dir]);
+    }
+    free(hopper);
+}
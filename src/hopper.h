@@ -0,0 +1,60 @@
+//
+// Frequency hopping with quick tunes.  A bladerf_quick_tune entry is computed for each frequency of the hop list when the
+// board is brought up so that a hop skips the tuning algorithm and only writes the precomputed RFIC settings.  The hops
+// are scheduled on the FPGA retune queue (bladerf_schedule_retune) at sample timestamps, either on a fixed dwell schedule
+// (a hop thread keeps the queue filled) or by TX_BLOCK_FLAG_HOP markers in the Tx burst headers.
+//
+
+#ifndef BLADERFTOFIFO_HOPPER_H
+#define BLADERFTOFIFO_HOPPER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <libbladeRF.h>
+
+#include "radioDevice.h"
+#include "pipelineStats.h"
+
+#define HOP_MAX_FREQS (64)
+#define HOP_SCHEDULE_AHEAD (8) //Hops queued on the FPGA ahead of their time (the retune queue holds 16)
+#define HOP_START_LEAD_US (20000) //From starting the schedule to the first hop
+
+typedef struct{
+    uint64_t freqs[HOP_MAX_FREQS]; //Hz, visited in order (0 entries to disable)
+    int numFreqs;
+    double dwell_us; //Time on each frequency.  0 to hop on the Tx block markers instead of a schedule
+    bool rx; //Directions that hop (if enabled)
+    bool tx;
+} hopConfig_t;
+
+typedef struct hopper_s hopper_t;
+
+void initHopConfig(hopConfig_t *config);
+
+//Parses a comma separated list of frequencies (Hz).  Returns false if the list is invalid
+bool parseHopFrequencies(char *str, hopConfig_t *config);
+
+//Parses "rx", "tx", or "both".  Returns false if the string is not a known direction
+bool parseHopDirection(char *str, hopConfig_t *config);
+
+//Computes the quick tune of each frequency on each channel of the hopping directions (the channels are returned to
+//rxFreq/txFreq afterwards) and reports the full and quick tune times.  Exits if the board cannot be tuned
+hopper_t* hopperOpen(hopConfig_t *config, radioDevice_t *device, int numChannels, bool rx, bool tx,
+                     unsigned int rxSampRate, unsigned int txSampRate, unsigned long rxFreq, unsigned long txFreq,
+                     char *label, bool print);
+
+//True if the Tx hops on the TX_BLOCK_FLAG_HOP markers rather than on the schedule
+bool hopperTxMarkers(hopper_t *hopper);
+
+//Starts the hop schedule thread (if there is a dwell).  Call once the streams are running
+void hopperStart(hopper_t *hopper, pipelineStats_t *rxStats, pipelineStats_t *txStats, volatile bool *stop);
+
+//Tx thread: schedules a retune of the Tx channels to entry index of the hop list at timestamp (BLADERF_RETUNE_NOW for
+//immediately).  Returns the libbladeRF status
+int hopperRetuneTx(hopper_t *hopper, uint32_t index, bladerf_timestamp timestamp);
+
+//Stops the schedule thread and cancels the queued retunes
+void hopperClose(hopper_t *hopper);
+
+#endif //BLADERFTOFIFO_HOPPER_H
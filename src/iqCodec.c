@@ -0,0 +1,151 @@
+//
+// Lossless compression of integer I/Q samples for recordings
+//
+
+#include "iqCodec.h"
+
+#define IQ_GROUP_DELTA (0x80) //Group header: the group codes differences rather than samples
+#define IQ_GROUP_WIDTH_MASK (0x1F)
+
+static inline uint32_t zigzag(int32_t val){
+    return (((uint32_t) val) << 1) ^ (uint32_t) (val >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t val){
+    return (int32_t) (val >> 1) ^ -((int32_t) (val & 1));
+}
+
+static inline int bitWidth(uint32_t val){
+    return val == 0 ? 0 : 32 - __builtin_clz(val);
+}
+
+static inline int32_t loadComponent(const void *samples, size_t idx, int sampleBits){
+    return sampleBits == 8 ? ((const int8_t*) samples)[idx] : ((const int16_t*) samples)[idx];
+}
+
+static inline void storeComponent(void *samples, size_t idx, int sampleBits, int32_t val){
+    if(sampleBits == 8){
+        ((int8_t*) samples)[idx] = (int8_t) val;
+    }else{
+        ((int16_t*) samples)[idx] = (int16_t) val;
+    }
+}
+
+//A group of IQ_CODEC_GROUP_FRAMES values at width bits is exactly 8*width bytes, so groups stay byte aligned
+static uint8_t* packGroup(const uint32_t *vals, int width, uint8_t *out){
+    uint64_t acc = 0;
+    int bits = 0;
+    for(int i = 0; i<IQ_CODEC_GROUP_FRAMES; i++){
+        acc |= ((uint64_t) vals[i]) << bits;
+        bits += width;
+        if(bits >= 32){
+            out[0] = (uint8_t) acc;
+            out[1] = (uint8_t) (acc >> 8);
+            out[2] = (uint8_t) (acc >> 16);
+            out[3] = (uint8_t) (acc >> 24);
+            out += 4;
+            acc >>= 32;
+            bits -= 32;
+        }
+    }
+    return out;
+}
+
+static const uint8_t* unpackGroup(const uint8_t *in, int width, uint32_t *vals){
+    uint64_t acc = 0;
+    int bits = 0;
+    uint32_t mask = (uint32_t) ((1ULL << width) - 1);
+    for(int i = 0; i<IQ_CODEC_GROUP_FRAMES; i++){
+        if(bits < width){
+            acc |= ((uint64_t) in[0] | ((uint64_t) in[1] << 8) | ((uint64_t) in[2] << 16) | ((uint64_t) in[3] << 24)) << bits;
+            in += 4;
+            bits += 32;
+        }
+        vals[i] = (uint32_t) acc & mask;
+        acc >>= width;
+        bits -= width;
+    }
+    return in;
+}
+
+size_t iqMaxEncodedBytes(uint32_t numFrames, int numLanes, int sampleBits){
+    size_t numGroups = (numFrames + IQ_CODEC_GROUP_FRAMES - 1) / IQ_CODEC_GROUP_FRAMES;
+    //Samples never take more than sampleBits since the group falls back to coding the samples
+    return numGroups*numLanes*(1 + IQ_CODEC_GROUP_FRAMES/8*sampleBits);
+}
+
+size_t iqEncodeChunk(const void *samples, uint32_t numFrames, int numLanes, int sampleBits, uint8_t *out){
+    uint8_t *start = out;
+    int32_t prev[IQ_CODEC_MAX_LANES] = {0}; //Each chunk is coded independently
+    uint32_t rawVals[IQ_CODEC_GROUP_FRAMES];
+    uint32_t deltaVals[IQ_CODEC_GROUP_FRAMES];
+
+    for(uint32_t groupStart = 0; groupStart<numFrames; groupStart += IQ_CODEC_GROUP_FRAMES){
+        uint32_t groupFrames = numFrames - groupStart < IQ_CODEC_GROUP_FRAMES ? numFrames - groupStart : IQ_CODEC_GROUP_FRAMES;
+        for(int lane = 0; lane<numLanes; lane++){
+            uint32_t rawBits = 0;
+            uint32_t deltaBits = 0;
+            int32_t last = prev[lane];
+            for(uint32_t i = 0; i<IQ_CODEC_GROUP_FRAMES; i++){
+                //The last group is padded by repeating the last sample
+                int32_t val = i < groupFrames ? loadComponent(samples, (groupStart+i)*numLanes + lane, sampleBits) : last;
+                rawVals[i] = zigzag(val);
+                deltaVals[i] = zigzag(val - last);
+                rawBits |= rawVals[i];
+                deltaBits |= deltaVals[i];
+                last = val;
+            }
+            prev[lane] = last;
+
+            int rawWidth = bitWidth(rawBits);
+            int deltaWidth = bitWidth(deltaBits);
+            if(deltaWidth < rawWidth){
+                *(out++) = (uint8_t) (IQ_GROUP_DELTA | deltaWidth);
+                out = packGroup(deltaVals, deltaWidth, out);
+            }else{
+                *(out++) = (uint8_t) rawWidth;
+                out = packGroup(rawVals, rawWidth, out);
+            }
+        }
+    }
+
+    return (size_t) (out - start);
+}
+
+bool iqDecodeChunk(const uint8_t *in, size_t inBytes, uint32_t numFrames, int numLanes, int sampleBits, void *samples){
+    const uint8_t *end = in + inBytes;
+    int32_t prev[IQ_CODEC_MAX_LANES] = {0};
+    uint32_t vals[IQ_CODEC_GROUP_FRAMES];
+
+    if(numLanes <= 0 || numLanes > IQ_CODEC_MAX_LANES){
+        return false;
+    }
+
+    for(uint32_t groupStart = 0; groupStart<numFrames; groupStart += IQ_CODEC_GROUP_FRAMES){
+        uint32_t groupFrames = numFrames - groupStart < IQ_CODEC_GROUP_FRAMES ? numFrames - groupStart : IQ_CODEC_GROUP_FRAMES;
+        for(int lane = 0; lane<numLanes; lane++){
+            if(in >= end){
+                return false;
+            }
+            uint8_t header = *(in++);
+            int width = header & IQ_GROUP_WIDTH_MASK;
+            if(width > sampleBits || (size_t) (end - in) < (size_t) IQ_CODEC_GROUP_FRAMES/8*width){
+                return false;
+            }
+            in = unpackGroup(in, width, vals);
+
+            int32_t last = prev[lane];
+            for(uint32_t i = 0; i<groupFrames; i++){
+                int32_t val = unzigzag(vals[i]);
+                if(header & IQ_GROUP_DELTA){
+                    val += last;
+                }
+                storeComponent(samples, (groupStart+i)*numLanes + lane, sampleBits, val);
+                last = val;
+            }
+            prev[lane] = last;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,62 @@
+//
+// Lossless compression of integer I/Q samples (SC16_Q11 or SC8_Q7) for recordings.  Each component (I or Q of each
+// channel) is coded in groups of IQ_CODEC_GROUP_FRAMES samples: either the zigzag coded samples or the zigzag coded
+// differences from the previous sample, bit packed with the smallest width that holds the group.  12 bit samples take at
+// most 12 bits, and fewer when the signal is narrowband or weak.
+//
+// A compressed file is a file header followed by independently decodable chunks (each starting with a chunk header) and
+// an index of the chunk offsets, so chunks can be decoded in parallel and from any position.  All fields are little
+// endian.
+//
+
+#ifndef BLADERFTOFIFO_IQCODEC_H
+#define BLADERFTOFIFO_IQCODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define IQ_CODEC_VERSION (1)
+#define IQ_CODEC_GROUP_FRAMES (64)
+#define IQ_CODEC_MAX_LANES (4) //I and Q of 2 channels
+#define IQ_CODEC_FILE_MAGIC "BRFZ"
+#define IQ_CODEC_CHUNK_MAGIC "CHNK"
+#define IQ_CODEC_INDEX_MAGIC "BRFI"
+
+typedef struct{
+    char magic[4]; //IQ_CODEC_FILE_MAGIC
+    uint16_t version;
+    uint8_t numLanes; //Components per frame (2 per channel)
+    uint8_t sampleBits; //16 (SC16_Q11) or 8 (SC8_Q7)
+    uint32_t chunkFrames; //Frames in every chunk but the last
+    uint32_t reserved;
+} iqFileHeader_t;
+
+typedef struct{
+    char magic[4]; //IQ_CODEC_CHUNK_MAGIC
+    uint32_t payloadBytes; //Compressed bytes following the header
+    uint64_t frameStart; //Index of the first frame in the recording
+    uint32_t numFrames;
+    uint32_t reserved;
+    uint64_t reserved2;
+} iqChunkHeader_t;
+
+//Follows the index (one uint64_t file offset per chunk header) at the end of the file.  A recording that was not closed
+//has no index, the chunk headers can be scanned instead
+typedef struct{
+    uint64_t numChunks;
+    uint64_t numFrames;
+    char magic[4]; //IQ_CODEC_INDEX_MAGIC
+    uint32_t reserved;
+} iqIndexTrailer_t;
+
+//Upper bound of iqEncodeChunk's output
+size_t iqMaxEncodedBytes(uint32_t numFrames, int numLanes, int sampleBits);
+
+//Compresses numFrames interleaved frames (int16_t or int8_t components).  Returns the number of bytes written to out
+size_t iqEncodeChunk(const void *samples, uint32_t numFrames, int numLanes, int sampleBits, uint8_t *out);
+
+//Returns false if the compressed data is corrupt (truncated or invalid group headers)
+bool iqDecodeChunk(const uint8_t *in, size_t inBytes, uint32_t numFrames, int numLanes, int sampleBits, void *samples);
+
+#endif //BLADERFTOFIFO_IQCODEC_H
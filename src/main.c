@@ -9,15 +9,20 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <signal.h>
+#include <time.h>
 
 #include <libbladeRF.h>
 
 #include "rxThread.h"
 #include "txThread.h"
-
-#define MAX_SERIAL_NUM_STRLEN (100)
+#include "radioPipeline.h"
+#include "controlSocket.h"
+#include "sessionDaemon.h"
+#include "autotune.h"
+#include "measure.h"
 
 volatile bool stop = false; //Shared variable to indicate that the radio should be stopped.  Modified by signal handler
+volatile sig_atomic_t stageTimingRequested = false; //Set by the SIGUSR1 handler, the report is printed by the main loop
 
 void printHelp(){
     printf("bladeRFToFIFO <-rx rx.pipe> <-tx tx.pipe -txfb tx_feedback.pipe>\n");
@@ -26,6 +31,10 @@ void printHelp(){
     printf("-rx: Path to the Rx Pipe\n");
     printf("-tx: Path to the Tx Pipe\n");
     printf("-txfb: Path to the Tx Feedback Pipe (required if -tx is present)\n");
+    printf("-numChannels: Number of Rx and Tx channels to use (1 for SISO, 2 for 2x2 MIMO).  Default: 1\n");
+    printf("-rx1: Path to the Rx Pipe for channel 1 (required if -numChannels is 2)\n");
+    printf("-tx1: Path to the Tx Pipe for channel 1 (required if -numChannels is 2)\n");
+    printf("-txfb1: Path to the Tx Feedback Pipe for channel 1 (required if -numChannels is 2)\n");
     printf("-blocklen: Block length in samples (for SharedMemoryFIFO interface)\n");
     printf("-fifosize: Size of the FIFO in blocks (for SharedMemoryFIFO interface)\n");
     printf("-txFreq: Carrier Frequency of the Tx (Hz)\n");
@@ -36,10 +45,74 @@ void printHelp(){
     printf("-rxBW: Bandwidth of Rx (Hz)\n");
     printf("-txGain: Gain of the Tx (dB)\n");
     printf("-rxGain: Gain of the Rx (dB)\n");
+    printf("-format: Sample format on the link to the bladeRF: sc16 (SC16_Q11) or sc8 (SC8_Q7, requires libbladeRF >= 2.4).  sc8 halves the USB bandwidth and allows sample rates up to 122.88 MHz.  Default: sc16\n");
     printf("-fullScale: The full scale value of samples transacted over the Shared Memory FIFOs\n");
     printf("-saturate: Indicates that Tx values beyond full scale are saturated\n");
+    printf("-txBurst: Tx burst mode.  Each Tx FIFO block is prefixed with a txBlockHeader_t (see blockHeaders.h) carrying burst flags and a transmit time.  The radio idles between bursts\n");
+    printf("-txBurstLead: Offset (in samples) from when the Tx is started to the burst mode epoch (relative time 0).  Default: 1000000\n");
+    printf("-hop: Comma separated list of frequencies (Hz) to hop between.  A quick tune is computed for each when the board is brought up and the hops are scheduled on the FPGA retune queue at sample timestamps.  The full and quick tune times, hops, and missed hop deadlines are reported\n");
+    printf("-hopDwell: Time (in us) on each frequency.  The hop list is visited in order, starting %d us after the streams start.  0 to hop the Tx on the TX_BLOCK_FLAG_HOP markers of the burst headers instead (-txBurst).  Default: 0\n", HOP_START_LEAD_US);
+    printf("-hopDir: Directions that hop: rx, tx, or both.  The Rx only hops with -hopDwell.  Default: both\n");
+    printf("-configCache: Directory for a cache of the settings applied to each board (<serial>.cache).  Settings unchanged since the last clean exit are not reapplied.  The cache is not saved after runtime changes or hopping\n");
+    printf("-recoveryTimeout: After a stream failure (ex. a USB error), reopen and reconfigure the board for up to this many seconds and resume streaming into the same Shared Memory FIFOs.  The first Rx block after the gap is marked (see -rxBlockHeader).  0 to exit on a stream failure.  Not used while hopping.  Default: %.1f\n", RADIO_DEFAULT_RECOVERY_TIMEOUT);
+    printf("-txUnderflowPolicy: What the Tx does when no Tx FIFO block arrives before the deadline (streaming mode): wait (the DAC underruns), zero (fill the rest of the libbladeRF buffer with zeros and send it), or hold (repeat the last sample).  Underflows are counted in the status report.  Default: wait\n");
+    printf("-txUnderflowDeadline: Time (in us) to wait for a Tx FIFO block before filling with -txUnderflowPolicy zero or hold.  Default: 0 (the duration of one libbladeRF Tx buffer)\n");
+    printf("-txFlushIdle: Time (in us) the Tx FIFO can be idle before a partially filled libbladeRF Tx buffer is padded with zeros and sent (streaming mode).  Default: 0 (disabled, wait for a full buffer)\n");
+    printf("-txLowLatency: Latency-bounded Tx preset: libbladeRF Tx buffers of 2048 samples (8 buffers, 4 transfers) and -txFlushIdle %d.  The Rx buffers are unchanged.  Options given after this override it\n", TX_LOW_LATENCY_FLUSH_IDLE);
+    printf("-rxOverflowPolicy: What the Rx does when the Rx FIFO is full: block (wait for the consumer, libbladeRF drops samples), dropNewest (discard the block that does not fit), or dropOldest (hold blocks locally and overwrite the oldest).  Drops are counted in the status report.  Default: block\n");
+    printf("-consumerTimeout: Consumers of the Rx and Tx feedback FIFOs can exit and reattach while streaming (the FIFO is emptied when a consumer attaches).  While no consumer is attached, Rx blocks are dropped (with any -rxOverflowPolicy) and Tx feedback tokens are discarded.  A consumer that has not read for this many seconds while its FIFO is full is also treated as detached (ex. it crashed).  0 to only detach consumers that exit.  Default: 0\n");
+    printf("-rxOverflowBacklog: Number of blocks held locally with -rxOverflowPolicy dropOldest.  Default: %d\n", RX_DEFAULT_OVERFLOW_BACKLOG);
+    printf("-record: Record the Rx stream to <path>.sigmf-data with SigMF metadata in <path>.sigmf-meta.  Written by a separate thread with large aligned (O_DIRECT) writes.  With -devices, use the record key to give each board its own path\n");
+    printf("-recordFormat: Recorded samples: raw (as received from the bladeRF, before correction), fifo (as written to the Rx FIFOs, interleaved floats), or compressed (raw, losslessly compressed to <path>.bfz by the compression threads.  Decode with bladeRFRecordingDecode).  Default: raw\n");
+    printf("-recordRing: Size (in MiB) of the ring buffering the recording between the Rx thread and the writer.  Samples are dropped (and marked in the metadata) if it fills.  Default: %d\n", RECORD_DEFAULT_RING_MB);
+    printf("-recordThreads: Number of compression threads for -recordFormat compressed.  Default: %d\n", RECORD_DEFAULT_COMPRESS_THREADS);
+    printf("-recordPrealloc: Size (in MiB) to preallocate for the recording (truncated to the recorded size at exit).  0 to disable.  Default: %d\n", RECORD_DEFAULT_PREALLOC_MB);
+    printf("-capture: Keep the last seconds of raw Rx samples in memory and, on a trigger, dump the samples around it to <path>_<n>.sigmf-data (with SigMF metadata).  SIGUSR2 always triggers.  The dump is written by a separate thread while the Rx continues.  With -devices, use the capture key to give each board its own path\n");
+    printf("-capturePre: Seconds kept before the trigger.  Default: %.1f\n", CAPTURE_DEFAULT_PRE_SEC);
+    printf("-capturePost: Seconds captured after the trigger.  Default: %.1f\n", CAPTURE_DEFAULT_POST_SEC);
+    printf("-captureHugePages: Allocate the capture ring from huge pages (see /proc/sys/vm/nr_hugepages).  Falls back to transparent huge pages\n");
+    printf("-captureTriggerShm: Name of a shared memory segment holding a 32 bit trigger counter.  Changing the counter (ex. incrementing it) triggers a capture\n");
+    printf("-captureEnergy: Trigger when the mean power of any Rx channel over the energy window rises above this level (dBFS)\n");
+    printf("-captureEnergyWindow: Length (in samples) of the energy window.  Default: %d\n", CAPTURE_DEFAULT_ENERGY_WINDOW);
+    printf("-rxBlockHeader: Each Rx FIFO block is prefixed with a rxBlockHeader_t (see blockHeaders.h) carrying the sample index and flagging dropped ranges\n");
+    printf("-rxBladeRFBlockLen: Rx Number of samples (across all channels) in each libbladeRF buffer.  Must be a multiple of 1024.  Default: 16384\n");
+    printf("-rxBladeRFNumBuffers: Rx Number of libbladeRF buffers.  Default: 32\n");
+    printf("-rxBladeRFNumTransfers: Rx Number of libbladeRF buffers in flight to the USB stack.  Must be less than the number of buffers.  Default: 16\n");
+    printf("-rxBladeRFTimeout: Rx libbladeRF stream timeout (ms).  0 for no timeout (%d ms while stream failures are recovered, see -recoveryTimeout).  Default: 1000 (Rx), 0 (Tx)\n", RADIO_RECOVERY_STREAM_TIMEOUT);
+    printf("-txBladeRFBlockLen: Tx Number of samples (across all channels) in each libbladeRF buffer.  Must be a multiple of 1024.  Default: 16384\n");
+    printf("-txBladeRFNumBuffers: Tx Number of libbladeRF buffers.  Default: 32\n");
+    printf("-txBladeRFNumTransfers: Tx Number of libbladeRF buffers in flight to the USB stack.  Must be less than the number of buffers.  Default: 16\n");
+    printf("-txBladeRFTimeout: Tx libbladeRF stream timeout (ms).  0 for no timeout (%d ms while stream failures are recovered, see -recoveryTimeout).  Default: 1000 (Rx), 0 (Tx)\n", RADIO_RECOVERY_STREAM_TIMEOUT);
+    printf("-autotune: Before starting, sweep the libbladeRF buffer settings of each board and direction and use the lowest latency setting that runs without drops.  Overrides the settings above\n");
+    printf("-autotuneDuration: Duration (in seconds) of each autotune trial.  Default: %.1f\n", AUTOTUNE_DEFAULT_TRIAL_DURATION);
+    printf("-measure: Loopback measurement mode: rfic (through the RFIC loopback of the bladeRF) or sw (through a software Tx to Rx loop, no bladeRF needed).  A PN sequence is injected into the Tx FIFO and detected in the Rx FIFO by threads standing in for the application.  Reports the host-to-host latency percentiles and the throughput, then exits\n");
+    printf("-measureDuration: Duration (in seconds) of the loopback measurement.  Default: %.1f\n", MEASURE_DEFAULT_DURATION);
+    printf("-measurePeriod: Time (in seconds) between injected sequences.  Must be longer than the latency.  Default: %.1f\n", MEASURE_DEFAULT_PERIOD);
+    printf("-sim: Stream a simulated bladeRF instead of a board (for benchmarking without hardware).  The serial numbers default to sim\n");
+    printf("-simSource: Simulated Rx source: tone, noise, or file.  Default: tone\n");
+    printf("-simToneFreq: Simulated Rx tone frequency (Hz).  Default: 100000\n");
+    printf("-simAmplitude: Simulated Rx tone amplitude relative to full scale.  Default: 0.5\n");
+    printf("-simNoise: Simulated Rx noise standard deviation relative to full scale.  Default: 0.01\n");
+    printf("-simFile: Simulated Rx source file (repeated), in the format given by -replayFormat.  MIMO files are interleaved by channel\n");
+    printf("-simUnthrottled: The simulated bladeRF produces and consumes samples as fast as possible rather than at the sample rate\n");
+    printf("-simOverrunRate: Average number of Rx overruns injected per second of samples.  Default: 0\n");
+    printf("-simOverrunLen: Number of samples (per channel) dropped by each injected Rx overrun.  Default: 4096\n");
+    printf("-simJitter: Maximum random delay (in us) added to each simulated stream call.  Default: 0\n");
+    printf("-simFaultRate: Average number of device failures (ex. USB errors) injected per second of samples.  The streams fail until the device is reopened (see -recoveryTimeout).  Default: 0\n");
+    printf("-replay: Replay an I/Q recording into the Rx FIFOs through the normal Rx conversion and correction instead of a bladeRF.  The Tx FIFOs are optional.  Stops at the end of the recording.  The serial numbers default to replay\n");
+    printf("-replayFormat: Format of the recording: sc16 (raw interleaved SC16_Q11 I/Q), cf32 (raw interleaved float I/Q, full scale 1.0), or sigmf (ci16_le, ci8, or cf32_le SigMF recording, path to the .sigmf-meta or .sigmf-data).  Default: sigmf for .sigmf-meta/.sigmf-data paths, otherwise sc16\n");
+    printf("-replayFast: Replay as fast as possible rather than at -rxSampRate (throughput benchmark of the Rx path)\n");
+    printf("-replayLoop: Repeat the recording rather than stopping at its end\n");
     printf("-txCpu: CPU to run this application on (Tx side)\n");
     printf("-rxCpu: CPU to run this application on (Rx side)\n");
+    printf("-rtPolicy: Scheduling policy of the Rx, Tx, and libbladeRF worker threads: none, fifo (SCHED_FIFO), or rr (SCHED_RR).  Requires CAP_SYS_NICE.  Default: none\n");
+    printf("-rxPriority: Real-time priority of the Rx thread (with -rtPolicy).  Default: %d\n", RT_DEFAULT_PRIORITY);
+    printf("-txPriority: Real-time priority of the Tx thread (with -rtPolicy).  Default: %d\n", RT_DEFAULT_PRIORITY);
+    printf("-rxWorkerCpu: CPU to run the libbladeRF Rx worker thread on.  Default: same as -rxCpu\n");
+    printf("-txWorkerCpu: CPU to run the libbladeRF Tx worker thread on.  Default: same as -txCpu\n");
+    printf("-rxWorkerPriority: Real-time priority of the libbladeRF Rx worker thread (with -rtPolicy).  Default: same as -rxPriority\n");
+    printf("-txWorkerPriority: Real-time priority of the libbladeRF Tx worker thread (with -rtPolicy).  Default: same as -txPriority\n");
+    printf("-mlockall: Lock all current and future memory of the process to avoid page faults\n");
     printf("-txSerialNum: Serial Number of BladeRF Board Used for Tx\n");
     printf("-rxSerialNum: Serial Number of BladeRF Board Used for Tx\n");
     printf("-txDCOffsetI: Measured DC Offset for Tx I Channel (DAC Scale [-2048, 2047])\n");
@@ -50,405 +123,836 @@ void printHelp(){
     printf("-txIQPhase: Measured IQ Phase Imbalance at the Tx (Degree)\n");
     printf("-rxIQGain: Measured IQ Gain Imbalance at the Tx (Ratio)\n");
     printf("-rxIQPhase: Measured IQ Phase Imbalance at the Tx (Degree)\n");
+    printf("-tx1DCOffsetI, -tx1DCOffsetQ, -rx1DCOffsetI, -rx1DCOffsetQ, -tx1IQGain, -tx1IQPhase, -rx1IQGain, -rx1IQPhase: Same as above for channel 1 (when -numChannels is 2)\n");
+    printf("-devices: Path to a device list file describing multiple bladeRF boards to run in this process (replaces -rx, -tx, -txfb, -txSerialNum, -rxSerialNum).  The other arguments set the defaults for each board\n");
+    printf("-statusPeriod: Period (in seconds) to print a status report for all boards.  A final report is always printed.  Default: 0 (disabled)\n");
+    printf("           In a build configured with -DSTAGE_TIMING=ON, SIGUSR1 (and the exit) prints the latency percentiles of each stage of the Rx and Tx threads\n");
+    printf("-statsName: Name of a shared memory segment publishing the live counters of every board (sample rates, FIFO occupancy, time blocked on the FIFOs, libbladeRF call latency, drops, underflows, clipped samples).  Read it with bladeRFStats <name>\n");
+    printf("-trace: Log the lifecycle of each block (device read/submit, conversion, FIFO wait/commit, feedback token, drops, underflows) of every board to a Chrome trace event (JSON) file for Perfetto or chrome://tracing.  Timestamps are CLOCK_MONOTONIC so the trace can be merged with a trace of the FIFO consumer/producer\n");
+    printf("-controlSocket: Path of a UNIX domain socket accepting runtime frequency, gain, bandwidth, DC offset, and IQ changes (one command per line, see controlSocket.h).  Each change is applied at a block boundary and the reply gives the sample index it took effect at.  Rx blocks with -rxBlockHeader are marked at that index\n");
+    printf("-daemon: Path of a UNIX domain socket to serve streaming sessions on (see sessionDaemon.h).  The boards are opened and configured once and stay open, clients start and stop sessions with their own FIFOs and RF parameters.  The FIFOs given on the command line are the session defaults and are not required\n");
     printf("-v: verbose\n");
+    printf("\n");
+    printRadioConfigFileHelp();
 }
 
 void signal_handler(int code){
     stop = true;
 }
 
-void openBladeRF(struct bladerf **dev, char* serialNum){
-    //From BladeRF Boilerplate:
+void capture_signal_handler(int code){
+    captureSignalTrigger();
+}
 
-    struct bladerf_devinfo dev_info;
-    bladerf_init_devinfo(&dev_info);
-    //Can specify the serial number of the bladeRF device here
-    //TODO: Remove Sanity Check
-    if(sizeof(dev_info.serial) != strlen(serialNum)+1){ //Includes Null Char
-        fprintf(stderr, "Invalid Serial Number: %s\n", serialNum);
-        exit(1);
-    }
-    strncpy(dev_info.serial, serialNum, sizeof(dev_info.serial) - 1);
+void stage_timing_signal_handler(int code){
+    stageTimingRequested = true;
+}
 
-    int status = bladerf_open_with_devinfo(dev, &dev_info);
-    if (status != 0) {
-        fprintf(stderr, "Unable to open bladeRF device: %s\n", bladerf_strerror(status));
-        exit(1);
-    }
+void registerSignalHandlers(){
+    signal(SIGABRT, &signal_handler);
+    signal(SIGTERM, &signal_handler);
+    signal(SIGINT, &signal_handler);
+    signal(SIGUSR1, &stage_timing_signal_handler);
+    signal(SIGUSR2, &capture_signal_handler);
 }
 
-void configBladeRFChannel(struct bladerf *dev, bool tx, int chanNum, bladerf_frequency carrierFreqHz, bladerf_bandwidth bandwidthHz, bladerf_sample_rate sampleRateHz, bladerf_gain gainDB, bool verbose){
-    bladerf_channel chan = tx ? BLADERF_CHANNEL_TX(chanNum) : BLADERF_CHANNEL_RX(chanNum);
-    char chanHelpStr[5];
-    snprintf(chanHelpStr, 5, tx ? "Tx%d" : "Rx%d", chanNum);
+int main(int argc, char **argv) {
+    //--- Parse the arguments ---
+    //Settings for the bladeRF board(s).  When -devices is used, these are the defaults for each board in the list
+    radioConfig_t cliConfig;
+    initRadioConfig(&cliConfig);
+
+    char *deviceListPath = NULL;
+    double statusPeriod = 0;
+    char *statsName = NULL;
+    char *tracePath = NULL;
+    char *controlSocketPath = NULL;
+    char *daemonPath = NULL;
+    bool autotune = false;
+    bool lockMemory = false;
+    double autotuneDuration = AUTOTUNE_DEFAULT_TRIAL_DURATION;
+    measureConfig_t measureConfig;
+    initMeasureConfig(&measureConfig);
+    char *replayPath = NULL;
+    bool replayFormatSet = false;
+    bool replayLoop = false;
+
+    bool print = false;
 
-    //According to https://www.nuand.com/bladeRF-doc/libbladeRF/v2.2.1/group___f_n___t_u_n_i_n_g.html#ga4e9b635f18a9531bcd3c6b4d2dd8a4e0
-    //  changing one of them will change the other
-    int status = bladerf_set_frequency(dev, chan, carrierFreqHz);
-    if (status != 0) {
-        fprintf(stderr, "Failed to set %s frequency = %lu: %s\n", chanHelpStr, carrierFreqHz, bladerf_strerror(status));
-        exit(1);
-    }
+    char txSerial[MAX_SERIAL_NUM_STRLEN+1] = "";
+    char rxSerial[MAX_SERIAL_NUM_STRLEN+1] = "";
 
-    bladerf_frequency reportedFreq;
-    status = bladerf_get_frequency(dev, chan, &reportedFreq);
-    if (status != 0) {
-        fprintf(stderr, "Failed to get %s frequency: %s\n", chanHelpStr, bladerf_strerror(status));
-        exit(1);
+    if (argc < 2) {
+        printHelp();
     }
 
-    bladerf_bandwidth actualBW;
-    status = bladerf_set_bandwidth(dev, chan, bandwidthHz, &actualBW);
-    if (status != 0) {
-        fprintf(stderr, "Failed to set %s bandwidth = %u: %s\n", chanHelpStr, bandwidthHz, bladerf_strerror(status));
-        exit(1);
-    }
+    for (int i = 1; i < argc; i++) {
+        //#### Shared Memory FIFO Params
+        if (strcmp("-rx", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    bladerf_sample_rate actualSampRate;
-    status = bladerf_set_sample_rate(dev, chan, sampleRateHz, &actualSampRate);
-    if (status != 0) {
-        fprintf(stderr, "Failed to set %s sample rate = %u: %s\n", chanHelpStr, sampleRateHz, bladerf_strerror(status));
-        exit(1);
-    }
+            if (i < argc) {
+                cliConfig.rxSharedName[0] = argv[i];
+            } else {
+                printf("Missing argument for -rx\n");
+                exit(1);
+            }
+        } else if (strcmp("-tx", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    //Turn AGC Off
-    bladerf_gain_mode gainMode;
-    bladerf_gain_mode reportedGainMode;
-    if(!tx){
-        gainMode = BLADERF_GAIN_MGC;
-        status = bladerf_set_gain_mode(dev, chan, gainMode);
-        if (status != 0) {
-            fprintf(stderr, "Failed to set %s AGC = %s: %s\n", chanHelpStr, bladeRFGainModeToStr(gainMode), bladerf_strerror(status));
-            exit(1);
-        }
+            if (i < argc) {
+                cliConfig.txSharedName[0] = argv[i];
+            } else {
+                printf("Missing argument for -tx\n");
+                exit(1);
+            }
+        } else if (strcmp("-txfb", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-        status = bladerf_get_gain_mode(dev, chan, &reportedGainMode);
-        if (status != 0) {
-            fprintf(stderr, "Failed to get %s gain mode: %s\n", chanHelpStr, bladerf_strerror(status));
-            exit(1);
-        }
-    }
+            if (i < argc) {
+                cliConfig.txFeedbackSharedName[0] = argv[i];
+            } else {
+                printf("Missing argument for -txfb\n");
+                exit(1);
+            }
+        } else if (strcmp("-numChannels", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    status = bladerf_set_gain(dev, chan, gainDB);
-    if (status != 0) {
-        fprintf(stderr, "Failed to set %s gain = %u: %s\n", chanHelpStr, gainDB, bladerf_strerror(status));
-        exit(1);
-    }
+            if (i < argc) {
+                cliConfig.numChannels = strtol(argv[i], NULL, 10);
+                if (cliConfig.numChannels < 1 || cliConfig.numChannels > BLADERF_MAX_CHANNELS) {
+                    printf("-numChannels must be 1 or 2\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -numChannels\n");
+                exit(1);
+            }
+        } else if (strcmp("-rx1", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    bladerf_gain reportedGain;
-    status = bladerf_get_gain(dev, chan, &reportedGain);
-    if (status != 0) {
-        fprintf(stderr, "Failed to get %s gain: %s\n", chanHelpStr, bladerf_strerror(status));
-        exit(1);
-    }
+            if (i < argc) {
+                cliConfig.rxSharedName[1] = argv[i];
+            } else {
+                printf("Missing argument for -rx1\n");
+                exit(1);
+            }
+        } else if (strcmp("-tx1", argv[i]) == 0) {
+            i++; //Get the actual argument
 
+            if (i < argc) {
+                cliConfig.txSharedName[1] = argv[i];
+            } else {
+                printf("Missing argument for -tx1\n");
+                exit(1);
+            }
+        } else if (strcmp("-txfb1", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    if(verbose){
-        printf("[%s] Freq      Requested: %10lu, Reported:  %10lu\n", chanHelpStr, carrierFreqHz, reportedFreq);
-        printf("[%s] BW        Requested: %10u, Currently: %10u\n", chanHelpStr, bandwidthHz, actualBW);
-        printf("[%s] Samp Rate Requested: %10u, Currently: %10u\n", chanHelpStr, sampleRateHz, actualSampRate);
-        if(!tx){
-            printf("[%s] AGC: \n\tRequested %s\n\tReported: %s\n", chanHelpStr, bladeRFGainModeToStr(gainMode), bladeRFGainModeToStr(reportedGainMode));
-        }
-        printf("[%s] Gain      Requested: %10u, Reported:  %10u\n", chanHelpStr, gainDB, reportedGain);
-    }
-}
+            if (i < argc) {
+                cliConfig.txFeedbackSharedName[1] = argv[i];
+            } else {
+                printf("Missing argument for -txfb1\n");
+                exit(1);
+            }
+        } else if (strcmp("-blocklen", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-void setCorrection(struct bladerf *dev, bool tx, int chanNum, bladerf_correction_value dcOff_I, bladerf_correction_value dcOff_Q, bladerf_correction_value iq_phase, bladerf_correction_value iq_gain){
-    bladerf_channel chan = tx ? BLADERF_CHANNEL_TX(chanNum) : BLADERF_CHANNEL_RX(chanNum);
-    char chanHelpStr[5];
-    snprintf(chanHelpStr, 5, tx ? "Tx%d" : "Rx%d", chanNum);
+            if (i < argc) {
+                cliConfig.blockLen = strtol(argv[i], NULL, 10);
+                if (cliConfig.blockLen <= 1) {
+                    printf("-blocklen must be positive\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -blocklen\n");
+                exit(1);
+            }
+        } else if (strcmp("-fifosize", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    int status = bladerf_set_correction(dev, chan, BLADERF_CORR_DCOFF_I, dcOff_I);
-    if (status != 0) {
-        fprintf(stderr, "Failed to set %s DC Offset Correction - I: %s\n", chanHelpStr, bladerf_strerror(status));
-        exit(1);
-    }
+            if (i < argc) {
+                cliConfig.fifoSize = strtol(argv[i], NULL, 10);
+                if (cliConfig.blockLen <= 1) {
+                    printf("-fifosize must be positive\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -fifosize\n");
+                exit(1);
+            }
+        //#### RF Properties
+        } else if (strcmp("-txGain", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    status = bladerf_set_correction(dev, chan, BLADERF_CORR_DCOFF_Q, dcOff_Q);
-    if (status != 0) {
-        fprintf(stderr, "Failed to set %s DC Offset Correction - Q: %s\n", chanHelpStr, bladerf_strerror(status));
-        exit(1);
-    }
+            if (i < argc) {
+                cliConfig.txGain = strtol(argv[i], NULL, 10);
+            } else {
+                printf("Missing argument for -txGain\n");
+                exit(1);
+            }
+        } else if (strcmp("-rxGain", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    status = bladerf_set_correction(dev, chan, BLADERF_CORR_PHASE, iq_phase);
-    if (status != 0) {
-        fprintf(stderr, "Failed to set %s IQ Imballance Correction - Phase: %s\n", chanHelpStr, bladerf_strerror(status));
-        exit(1);
-    }
+            if (i < argc) {
+                cliConfig.rxGain = strtol(argv[i], NULL, 10);
+            } else {
+                printf("Missing argument for -rxGain\n");
+                exit(1);
+            }
+        } else if (strcmp("-txFreq", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    status = bladerf_set_correction(dev, chan, BLADERF_CORR_GAIN, iq_gain);
-    if (status != 0) {
-        fprintf(stderr, "Failed to set %s IQ Imballance Correction - Gain: %s\n", chanHelpStr, bladerf_strerror(status));
-        exit(1);
-    }
+            if (i < argc) {
+                cliConfig.txFreq = strtol(argv[i], NULL, 10);
+                if (cliConfig.txFreq <= 1) {
+                    printf("-txFreq must be positive\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -txFreq\n");
+                exit(1);
+            }
+        } else if (strcmp("-rxFreq", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    printf("[%s] Set DC Offset Correction - I:      %5d\n", chanHelpStr, dcOff_I);
-    printf("[%s] Set DC Offset Correction - Q:      %5d\n", chanHelpStr, dcOff_Q);
-    printf("[%s] Set I/Q Imbal. Correction - Phase: %5d\n", chanHelpStr, iq_phase);
-    printf("[%s] Set I/Q Imbal. Correction - Gain:  %5d\n", chanHelpStr, iq_gain);
-}
+            if (i < argc) {
+                cliConfig.rxFreq = strtol(argv[i], NULL, 10);
+                if (cliConfig.txFreq <= 1) {
+                    printf("-rxFreq must be positive\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -rxFreq\n");
+                exit(1);
+            }
+        } else if (strcmp("-txBW", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-void printCorrection(struct bladerf *dev, bool tx, int chanNum){
-    bladerf_channel chan = tx ? BLADERF_CHANNEL_TX(chanNum) : BLADERF_CHANNEL_RX(chanNum);
-    char chanHelpStr[5];
-    snprintf(chanHelpStr, 5, tx ? "Tx%d" : "Rx%d", chanNum);
+            if (i < argc) {
+                cliConfig.txBW = strtol(argv[i], NULL, 10);
+                if (cliConfig.txBW <= 1) {
+                    printf("-txBW must be positive\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -txBW\n");
+                exit(1);
+            }
+        } else if (strcmp("-rxBW", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    bladerf_correction_value dcOff_I;
-    int status = bladerf_get_correction(dev, chan, BLADERF_CORR_DCOFF_I, &dcOff_I);
-    if (status != 0) {
-        fprintf(stderr, "Failed to get %s DC Offset Correction - I: %s\n", chanHelpStr, bladerf_strerror(status));
-        exit(1);
-    }
+            if (i < argc) {
+                cliConfig.rxBW = strtol(argv[i], NULL, 10);
+                if (cliConfig.rxBW <= 1) {
+                    printf("-rxBW must be positive\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -rxBW\n");
+                exit(1);
+            }
+        } else if (strcmp("-txSampRate", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    bladerf_correction_value dcOff_Q;
-    status = bladerf_get_correction(dev, chan, BLADERF_CORR_DCOFF_Q, &dcOff_Q);
-    if (status != 0) {
-        fprintf(stderr, "Failed to get %s DC Offset Correction - Q: %s\n", chanHelpStr, bladerf_strerror(status));
-        exit(1);
-    }
+            if (i < argc) {
+                cliConfig.txSampRate = strtol(argv[i], NULL, 10);
+                if (cliConfig.txSampRate <= 1) {
+                    printf("-txSampRate must be positive\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -txSampRate\n");
+                exit(1);
+            }
+        } else if (strcmp("-rxSampRate", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    bladerf_correction_value iq_phase;
-    status = bladerf_get_correction(dev, chan, BLADERF_CORR_PHASE, &iq_phase);
-    if (status != 0) {
-        fprintf(stderr, "Failed to get %s IQ Imballance Correction - Phase: %s\n", chanHelpStr, bladerf_strerror(status));
-        exit(1);
-    }
+            if (i < argc) {
+                cliConfig.rxSampRate = strtol(argv[i], NULL, 10);
+                if (cliConfig.rxSampRate <= 1) {
+                    printf("-rxSampRate must be positive\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -rxSampRate\n");
+                exit(1);
+            }
+        } else if (strcmp("-format", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    bladerf_correction_value iq_gain;
-    status = bladerf_get_correction(dev, chan, BLADERF_CORR_GAIN, &iq_gain);
-    if (status != 0) {
-        fprintf(stderr, "Failed to get %s IQ Imballance Correction - Gain: %s\n", chanHelpStr, bladerf_strerror(status));
-        exit(1);
-    }
+            if (i < argc) {
+                if (!parseSampleFormat(argv[i], &cliConfig.sampleFormat)) {
+                    printf("-format must be sc16 or sc8\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -format\n");
+                exit(1);
+            }
+        } else if (strcmp("-fullScale", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    printf("[%s] DC Offset Correction - I:      %5d\n", chanHelpStr, dcOff_I);
-    printf("[%s] DC Offset Correction - Q:      %5d\n", chanHelpStr, dcOff_Q);
-    printf("[%s] I/Q Imbal. Correction - Phase: %5d\n", chanHelpStr, iq_phase);
-    printf("[%s] I/Q Imbal. Correction - Gain:  %5d\n", chanHelpStr, iq_gain);
-}
+            if (i < argc) {
+                cliConfig.fullScaleValue = SAMPLE_STR2_FCTN(argv[i]);
+                if (cliConfig.fullScaleValue <= 0) {
+                    printf("-fullScale must be positive\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -fullScale\n");
+                exit(1);
+            }
+        } else if (strcmp("-saturate", argv[i]) == 0) {
+            cliConfig.saturate = true;
+        } else if (strcmp("-txBurst", argv[i]) == 0) {
+            cliConfig.txBurst = true;
+        } else if (strcmp("-txBurstLead", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-int main(int argc, char **argv) {
-    //--- Parse the arguments ---
-    char *txSharedName = NULL;
-    char *txFeedbackSharedName = NULL;
-    char *rxSharedName = NULL;
+            if (i < argc) {
+                cliConfig.txBurstLead = strtoul(argv[i], NULL, 10);
+            } else {
+                printf("Missing argument for -txBurstLead\n");
+                exit(1);
+            }
+        } else if (strcmp("-hop", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    int32_t blockLen = 1;
-    int32_t fifoSize = 8;
+            if (i < argc) {
+                if (!parseHopFrequencies(argv[i], &cliConfig.hop)) {
+                    printf("-hop must be a comma separated list of up to %d positive frequencies\n", HOP_MAX_FREQS);
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -hop\n");
+                exit(1);
+            }
+        } else if (strcmp("-hopDwell", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    int txCpu = -1;
-    int rxCpu = -1;
+            if (i < argc) {
+                cliConfig.hop.dwell_us = strtod(argv[i], NULL);
+                if (cliConfig.hop.dwell_us < 0) {
+                    printf("-hopDwell must be non-negative\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -hopDwell\n");
+                exit(1);
+            }
+        } else if (strcmp("-hopDir", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    bool print;
+            if (i < argc) {
+                if (!parseHopDirection(argv[i], &cliConfig.hop)) {
+                    printf("-hopDir must be rx, tx, or both\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -hopDir\n");
+                exit(1);
+            }
+        } else if (strcmp("-configCache", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    //RF Params
-    int txGain = 0;
-    int rxGain = 0;
+            if (i < argc) {
+                cliConfig.configCacheDir = argv[i];
+            } else {
+                printf("Missing argument for -configCache\n");
+                exit(1);
+            }
+        } else if (strcmp("-recoveryTimeout", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    unsigned long txFreq = 2400000000;
-    unsigned long rxFreq = 2400000000;
+            if (i < argc) {
+                cliConfig.recoveryTimeoutSec = strtod(argv[i], NULL);
+                if (cliConfig.recoveryTimeoutSec < 0) {
+                    printf("-recoveryTimeout must be non-negative\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -recoveryTimeout\n");
+                exit(1);
+            }
+        } else if (strcmp("-consumerTimeout", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    unsigned int txSampRate = 61440000;
-    unsigned int rxSampRate = 61440000;
+            if (i < argc) {
+                cliConfig.consumerTimeoutSec = strtod(argv[i], NULL);
+                if (cliConfig.consumerTimeoutSec < 0) {
+                    printf("-consumerTimeout must be non-negative\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -consumerTimeout\n");
+                exit(1);
+            }
+        } else if (strcmp("-txUnderflowPolicy", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    unsigned int txBW = 56000000;
-    unsigned int rxBW = 56000000;
+            if (i < argc) {
+                if (!parseTxUnderflowPolicy(argv[i], &cliConfig.txUnderflowPolicy)) {
+                    printf("-txUnderflowPolicy must be wait, zero, or hold\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -txUnderflowPolicy\n");
+                exit(1);
+            }
+        } else if (strcmp("-txUnderflowDeadline", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    SAMPLE_COMPONENT_DATATYPE fullScaleValue = 1;
-    bool saturate = false;
+            if (i < argc) {
+                cliConfig.txUnderflowDeadline_us = strtod(argv[i], NULL);
+                if (cliConfig.txUnderflowDeadline_us < 0) {
+                    printf("-txUnderflowDeadline must be non-negative\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -txUnderflowDeadline\n");
+                exit(1);
+            }
+        } else if (strcmp("-txFlushIdle", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    char txSerial[MAX_SERIAL_NUM_STRLEN+1] = "";
-    char rxSerial[MAX_SERIAL_NUM_STRLEN+1] = "";
+            if (i < argc) {
+                cliConfig.txFlushIdle_us = strtod(argv[i], NULL);
+                if (cliConfig.txFlushIdle_us < 0) {
+                    printf("-txFlushIdle must be non-negative\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -txFlushIdle\n");
+                exit(1);
+            }
+        } else if (strcmp("-txLowLatency", argv[i]) == 0) {
+            applyTxLowLatencyPreset(&cliConfig);
+        } else if (strcmp("-rxOverflowPolicy", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    //I/Q and DC Offset Corrections
-    double txDCOffsetI = 0;
-    double txDCOffsetQ = 0;
-    double rxDCOffsetI = 0;
-    double rxDCOffsetQ = 0;
-    double txIQGain = 1;
-    double txIQPhase_deg = 0;
-    double rxIQGain = 1;
-    double rxIQPhase_deg = 0;
+            if (i < argc) {
+                if (!parseRxOverflowPolicy(argv[i], &cliConfig.rxOverflowPolicy)) {
+                    printf("-rxOverflowPolicy must be block, dropNewest, or dropOldest\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -rxOverflowPolicy\n");
+                exit(1);
+            }
+        } else if (strcmp("-rxOverflowBacklog", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    if (argc < 2) {
-        printHelp();
-    }
+            if (i < argc) {
+                cliConfig.rxOverflowBacklog = strtol(argv[i], NULL, 10);
+                if (cliConfig.rxOverflowBacklog < 1) {
+                    printf("-rxOverflowBacklog must be positive\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -rxOverflowBacklog\n");
+                exit(1);
+            }
+        } else if (strcmp("-record", argv[i]) == 0) {
+            i++; //Get the actual argument
 
-    for (int i = 1; i < argc; i++) {
-        //#### Shared Memory FIFO Params
-        if (strcmp("-rx", argv[i]) == 0) {
+            if (i < argc) {
+                cliConfig.record.path = argv[i];
+            } else {
+                printf("Missing argument for -record\n");
+                exit(1);
+            }
+        } else if (strcmp("-recordFormat", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                if (!parseRecordFormat(argv[i], &cliConfig.record.format)) {
+                    printf("-recordFormat must be raw, fifo, or compressed\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -recordFormat\n");
+                exit(1);
+            }
+        } else if (strcmp("-recordRing", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                long ringMB = strtol(argv[i], NULL, 10);
+                if (ringMB <= 0) {
+                    printf("-recordRing must be positive\n");
+                    exit(1);
+                }
+                cliConfig.record.ringBytes = ((size_t) ringMB)*1024*1024;
+            } else {
+                printf("Missing argument for -recordRing\n");
+                exit(1);
+            }
+        } else if (strcmp("-recordThreads", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                int compressThreads = (int) strtol(argv[i], NULL, 10);
+                if (compressThreads <= 0) {
+                    printf("-recordThreads must be positive\n");
+                    exit(1);
+                }
+                cliConfig.record.compressThreads = compressThreads;
+            } else {
+                printf("Missing argument for -recordThreads\n");
+                exit(1);
+            }
+        } else if (strcmp("-recordPrealloc", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                long preallocMB = strtol(argv[i], NULL, 10);
+                if (preallocMB < 0) {
+                    printf("-recordPrealloc must be non-negative\n");
+                    exit(1);
+                }
+                cliConfig.record.preallocBytes = ((size_t) preallocMB)*1024*1024;
+            } else {
+                printf("Missing argument for -recordPrealloc\n");
+                exit(1);
+            }
+        } else if (strcmp("-capture", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.capture.path = argv[i];
+            } else {
+                printf("Missing argument for -capture\n");
+                exit(1);
+            }
+        } else if (strcmp("-capturePre", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.capture.preSec = strtod(argv[i], NULL);
+                if (cliConfig.capture.preSec < 0) {
+                    printf("-capturePre must be non-negative\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -capturePre\n");
+                exit(1);
+            }
+        } else if (strcmp("-capturePost", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.capture.postSec = strtod(argv[i], NULL);
+                if (cliConfig.capture.postSec < 0) {
+                    printf("-capturePost must be non-negative\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -capturePost\n");
+                exit(1);
+            }
+        } else if (strcmp("-captureHugePages", argv[i]) == 0) {
+            cliConfig.capture.hugePages = true;
+        } else if (strcmp("-captureTriggerShm", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.capture.triggerShmName = argv[i];
+            } else {
+                printf("Missing argument for -captureTriggerShm\n");
+                exit(1);
+            }
+        } else if (strcmp("-captureEnergy", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.capture.energyTrigger = true;
+                cliConfig.capture.energyThreshold_dBFS = strtod(argv[i], NULL);
+            } else {
+                printf("Missing argument for -captureEnergy\n");
+                exit(1);
+            }
+        } else if (strcmp("-captureEnergyWindow", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                long energyWindow = strtol(argv[i], NULL, 10);
+                if (energyWindow <= 0) {
+                    printf("-captureEnergyWindow must be positive\n");
+                    exit(1);
+                }
+                cliConfig.capture.energyWindow = (uint32_t) energyWindow;
+            } else {
+                printf("Missing argument for -captureEnergyWindow\n");
+                exit(1);
+            }
+        } else if (strcmp("-rxBlockHeader", argv[i]) == 0) {
+            cliConfig.rxBlockHeader = true;
+            //#### libbladeRF Buffers
+        } else if (strcmp("-rxBladeRFBlockLen", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.rxBladeRFBlockLen = strtol(argv[i], NULL, 10);
+            } else {
+                printf("Missing argument for -rxBladeRFBlockLen\n");
+                exit(1);
+            }
+        } else if (strcmp("-rxBladeRFNumBuffers", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.rxBladeRFNumBuffers = strtol(argv[i], NULL, 10);
+            } else {
+                printf("Missing argument for -rxBladeRFNumBuffers\n");
+                exit(1);
+            }
+        } else if (strcmp("-rxBladeRFNumTransfers", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.rxBladeRFNumTransfers = strtol(argv[i], NULL, 10);
+            } else {
+                printf("Missing argument for -rxBladeRFNumTransfers\n");
+                exit(1);
+            }
+        } else if (strcmp("-rxBladeRFTimeout", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.rxBladeRFTimeout = strtoul(argv[i], NULL, 10);
+            } else {
+                printf("Missing argument for -rxBladeRFTimeout\n");
+                exit(1);
+            }
+        } else if (strcmp("-txBladeRFBlockLen", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.txBladeRFBlockLen = strtol(argv[i], NULL, 10);
+            } else {
+                printf("Missing argument for -txBladeRFBlockLen\n");
+                exit(1);
+            }
+        } else if (strcmp("-txBladeRFNumBuffers", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.txBladeRFNumBuffers = strtol(argv[i], NULL, 10);
+            } else {
+                printf("Missing argument for -txBladeRFNumBuffers\n");
+                exit(1);
+            }
+        } else if (strcmp("-txBladeRFNumTransfers", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.txBladeRFNumTransfers = strtol(argv[i], NULL, 10);
+            } else {
+                printf("Missing argument for -txBladeRFNumTransfers\n");
+                exit(1);
+            }
+        } else if (strcmp("-txBladeRFTimeout", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.txBladeRFTimeout = strtoul(argv[i], NULL, 10);
+            } else {
+                printf("Missing argument for -txBladeRFTimeout\n");
+                exit(1);
+            }
+        } else if (strcmp("-autotune", argv[i]) == 0) {
+            autotune = true;
+        } else if (strcmp("-autotuneDuration", argv[i]) == 0) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                rxSharedName = argv[i];
+                autotuneDuration = strtod(argv[i], NULL);
+                if (autotuneDuration <= 0) {
+                    printf("-autotuneDuration must be positive\n");
+                    exit(1);
+                }
             } else {
-                printf("Missing argument for -rx\n");
+                printf("Missing argument for -autotuneDuration\n");
                 exit(1);
             }
-        } else if (strcmp("-tx", argv[i]) == 0) {
+            //#### Loopback Measurement
+        } else if (strcmp("-measure", argv[i]) == 0) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                txSharedName = argv[i];
+                if (!parseMeasureMode(argv[i], &measureConfig.mode)) {
+                    printf("-measure must be rfic or sw\n");
+                    exit(1);
+                }
             } else {
-                printf("Missing argument for -tx\n");
+                printf("Missing argument for -measure\n");
                 exit(1);
             }
-        } else if (strcmp("-txfb", argv[i]) == 0) {
+        } else if (strcmp("-measureDuration", argv[i]) == 0) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                txFeedbackSharedName = argv[i];
+                measureConfig.durationSec = strtod(argv[i], NULL);
+                if (measureConfig.durationSec <= 0) {
+                    printf("-measureDuration must be positive\n");
+                    exit(1);
+                }
             } else {
-                printf("Missing argument for -txfb\n");
+                printf("Missing argument for -measureDuration\n");
                 exit(1);
             }
-        } else if (strcmp("-blocklen", argv[i]) == 0) {
+        } else if (strcmp("-measurePeriod", argv[i]) == 0) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                blockLen = strtol(argv[i], NULL, 10);
-                if (blockLen <= 1) {
-                    printf("-blocklen must be positive\n");
+                measureConfig.periodSec = strtod(argv[i], NULL);
+                if (measureConfig.periodSec <= 0) {
+                    printf("-measurePeriod must be positive\n");
                     exit(1);
                 }
             } else {
-                printf("Missing argument for -blocklen\n");
+                printf("Missing argument for -measurePeriod\n");
                 exit(1);
             }
-        } else if (strcmp("-fifosize", argv[i]) == 0) {
+            //#### Simulated bladeRF
+        } else if (strcmp("-replay", argv[i]) == 0) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                fifoSize = strtol(argv[i], NULL, 10);
-                if (blockLen <= 1) {
-                    printf("-fifosize must be positive\n");
+                replayPath = argv[i];
+            } else {
+                printf("Missing argument for -replay\n");
+                exit(1);
+            }
+        } else if (strcmp("-replayFormat", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                if (!parseSimFileFormat(argv[i], &cliConfig.sim.fileFormat)) {
+                    printf("-replayFormat must be sc16, cf32, or sigmf\n");
                     exit(1);
                 }
+                replayFormatSet = true;
             } else {
-                printf("Missing argument for -fifosize\n");
+                printf("Missing argument for -replayFormat\n");
                 exit(1);
             }
-        //#### RF Properties
-        } else if (strcmp("-txGain", argv[i]) == 0) {
+        } else if (strcmp("-replayFast", argv[i]) == 0) {
+            cliConfig.sim.unthrottled = true;
+        } else if (strcmp("-replayLoop", argv[i]) == 0) {
+            replayLoop = true;
+        } else if (strcmp("-sim", argv[i]) == 0) {
+            cliConfig.simulate = true;
+        } else if (strcmp("-simSource", argv[i]) == 0) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                txGain = strtol(argv[i], NULL, 10);
+                if (!parseSimSource(argv[i], &cliConfig.sim.source)) {
+                    printf("-simSource must be tone, noise, or file\n");
+                    exit(1);
+                }
             } else {
-                printf("Missing argument for -txGain\n");
+                printf("Missing argument for -simSource\n");
                 exit(1);
             }
-        } else if (strcmp("-rxGain", argv[i]) == 0) {
+        } else if (strcmp("-simToneFreq", argv[i]) == 0) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                rxGain = strtol(argv[i], NULL, 10);
+                cliConfig.sim.toneFreq = strtod(argv[i], NULL);
             } else {
-                printf("Missing argument for -rxGain\n");
+                printf("Missing argument for -simToneFreq\n");
                 exit(1);
             }
-        } else if (strcmp("-txFreq", argv[i]) == 0) {
+        } else if (strcmp("-simAmplitude", argv[i]) == 0) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                txFreq = strtol(argv[i], NULL, 10);
-                if (txFreq <= 1) {
-                    printf("-txFreq must be positive\n");
-                    exit(1);
-                }
+                cliConfig.sim.amplitude = strtod(argv[i], NULL);
             } else {
-                printf("Missing argument for -txFreq\n");
+                printf("Missing argument for -simAmplitude\n");
                 exit(1);
             }
-        } else if (strcmp("-rxFreq", argv[i]) == 0) {
+        } else if (strcmp("-simNoise", argv[i]) == 0) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                rxFreq = strtol(argv[i], NULL, 10);
-                if (txFreq <= 1) {
-                    printf("-rxFreq must be positive\n");
+                cliConfig.sim.noiseAmplitude = strtod(argv[i], NULL);
+                if (cliConfig.sim.noiseAmplitude < 0) {
+                    printf("-simNoise must be non-negative\n");
                     exit(1);
                 }
             } else {
-                printf("Missing argument for -rxFreq\n");
+                printf("Missing argument for -simNoise\n");
                 exit(1);
             }
-        } else if (strcmp("-txBW", argv[i]) == 0) {
+        } else if (strcmp("-simFile", argv[i]) == 0) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                txBW = strtol(argv[i], NULL, 10);
-                if (txBW <= 1) {
-                    printf("-txBW must be positive\n");
-                    exit(1);
-                }
+                cliConfig.sim.filePath = argv[i];
             } else {
-                printf("Missing argument for -txBW\n");
+                printf("Missing argument for -simFile\n");
                 exit(1);
             }
-        } else if (strcmp("-rxBW", argv[i]) == 0) {
+        } else if (strcmp("-simUnthrottled", argv[i]) == 0) {
+            cliConfig.sim.unthrottled = true;
+        } else if (strcmp("-simOverrunRate", argv[i]) == 0) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                rxBW = strtol(argv[i], NULL, 10);
-                if (rxBW <= 1) {
-                    printf("-rxBW must be positive\n");
+                cliConfig.sim.overrunRate = strtod(argv[i], NULL);
+                if (cliConfig.sim.overrunRate < 0) {
+                    printf("-simOverrunRate must be non-negative\n");
                     exit(1);
                 }
             } else {
-                printf("Missing argument for -rxBW\n");
+                printf("Missing argument for -simOverrunRate\n");
                 exit(1);
             }
-        } else if (strcmp("-txSampRate", argv[i]) == 0) {
+        } else if (strcmp("-simOverrunLen", argv[i]) == 0) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                txSampRate = strtol(argv[i], NULL, 10);
-                if (txSampRate <= 1) {
-                    printf("-txSampRate must be positive\n");
-                    exit(1);
-                }
+                cliConfig.sim.overrunLen = strtoul(argv[i], NULL, 10);
             } else {
-                printf("Missing argument for -txSampRate\n");
+                printf("Missing argument for -simOverrunLen\n");
                 exit(1);
             }
-        } else if (strcmp("-rxSampRate", argv[i]) == 0) {
+        } else if (strcmp("-simJitter", argv[i]) == 0) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                rxSampRate = strtol(argv[i], NULL, 10);
-                if (rxSampRate <= 1) {
-                    printf("-rxSampRate must be positive\n");
+                cliConfig.sim.jitter_us = strtod(argv[i], NULL);
+                if (cliConfig.sim.jitter_us < 0) {
+                    printf("-simJitter must be non-negative\n");
                     exit(1);
                 }
             } else {
-                printf("Missing argument for -rxSampRate\n");
+                printf("Missing argument for -simJitter\n");
                 exit(1);
             }
-        } else if (strcmp("-fullScale", argv[i]) == 0) {
+        } else if (strcmp("-simFaultRate", argv[i]) == 0) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                fullScaleValue = SAMPLE_STR2_FCTN(argv[i]);
-                if (fullScaleValue <= 0) {
-                    printf("-fullScale must be positive\n");
+                cliConfig.sim.faultRate = strtod(argv[i], NULL);
+                if (cliConfig.sim.faultRate < 0) {
+                    printf("-simFaultRate must be non-negative\n");
                     exit(1);
                 }
             } else {
-                printf("Missing argument for -fullScale\n");
+                printf("Missing argument for -simFaultRate\n");
                 exit(1);
             }
-        } else if (strcmp("-saturate", argv[i]) == 0) {
-            saturate = true;
             //#### CPUs
         } else if (strcmp("-txCpu", argv[i]) == 0) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                txCpu = strtol(argv[i], NULL, 10);
-                if (txCpu <= 0) {
+                cliConfig.txCpu = strtol(argv[i], NULL, 10);
+                if (cliConfig.txCpu <= 0) {
                     printf("-txCpu must be non-negative\n");
                     exit(1);
                 }
@@ -460,8 +964,8 @@ int main(int argc, char **argv) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                rxCpu = strtol(argv[i], NULL, 10);
-                if (rxCpu <= 0) {
+                cliConfig.rxCpu = strtol(argv[i], NULL, 10);
+                if (cliConfig.rxCpu <= 0) {
                     printf("-rxCpu must be non-negative\n");
                     exit(1);
                 }
@@ -469,6 +973,83 @@ int main(int argc, char **argv) {
                 printf("Missing argument for -rxCpu\n");
                 exit(1);
             }
+        //#### Real-Time Scheduling
+        } else if (strcmp("-rtPolicy", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                if (!parseRTPolicy(argv[i], &cliConfig.rtPolicy)) {
+                    printf("-rtPolicy must be none, fifo, or rr\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -rtPolicy\n");
+                exit(1);
+            }
+        } else if (strcmp("-rxPriority", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.rxPriority = strtol(argv[i], NULL, 10);
+            } else {
+                printf("Missing argument for -rxPriority\n");
+                exit(1);
+            }
+        } else if (strcmp("-txPriority", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.txPriority = strtol(argv[i], NULL, 10);
+            } else {
+                printf("Missing argument for -txPriority\n");
+                exit(1);
+            }
+        } else if (strcmp("-rxWorkerCpu", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.rxWorkerCpu = strtol(argv[i], NULL, 10);
+                if (cliConfig.rxWorkerCpu < 0) {
+                    printf("-rxWorkerCpu must be non-negative\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -rxWorkerCpu\n");
+                exit(1);
+            }
+        } else if (strcmp("-txWorkerCpu", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.txWorkerCpu = strtol(argv[i], NULL, 10);
+                if (cliConfig.txWorkerCpu < 0) {
+                    printf("-txWorkerCpu must be non-negative\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -txWorkerCpu\n");
+                exit(1);
+            }
+        } else if (strcmp("-rxWorkerPriority", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.rxWorkerPriority = strtol(argv[i], NULL, 10);
+            } else {
+                printf("Missing argument for -rxWorkerPriority\n");
+                exit(1);
+            }
+        } else if (strcmp("-txWorkerPriority", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.txWorkerPriority = strtol(argv[i], NULL, 10);
+            } else {
+                printf("Missing argument for -txWorkerPriority\n");
+                exit(1);
+            }
+        } else if (strcmp("-mlockall", argv[i]) == 0) {
+            lockMemory = true;
         //#### Serial Numbers
         } else if (strcmp("-txSerialNum", argv[i]) == 0) {
             i++; //Get the actual argument
@@ -493,7 +1074,7 @@ int main(int argc, char **argv) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                txDCOffsetI = strtod(argv[i], NULL);
+                cliConfig.txDCOffsetI[0] = strtod(argv[i], NULL);
             } else {
                 printf("Missing argument for -txDCOffsetI\n");
                 exit(1);
@@ -502,7 +1083,7 @@ int main(int argc, char **argv) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                txDCOffsetQ = strtod(argv[i], NULL);
+                cliConfig.txDCOffsetQ[0] = strtod(argv[i], NULL);
             } else {
                 printf("Missing argument for -txDCOffsetQ\n");
                 exit(1);
@@ -511,7 +1092,7 @@ int main(int argc, char **argv) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                rxDCOffsetI = strtod(argv[i], NULL);
+                cliConfig.rxDCOffsetI[0] = strtod(argv[i], NULL);
             } else {
                 printf("Missing argument for -rxDCOffsetI\n");
                 exit(1);
@@ -520,7 +1101,7 @@ int main(int argc, char **argv) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                rxDCOffsetQ = strtod(argv[i], NULL);
+                cliConfig.rxDCOffsetQ[0] = strtod(argv[i], NULL);
             } else {
                 printf("Missing argument for -rxDCOffsetQ\n");
                 exit(1);
@@ -530,7 +1111,7 @@ int main(int argc, char **argv) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                txIQGain = strtod(argv[i], NULL);
+                cliConfig.txIQGain[0] = strtod(argv[i], NULL);
             } else {
                 printf("Missing argument for -txIQGain\n");
                 exit(1);
@@ -539,7 +1120,7 @@ int main(int argc, char **argv) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                txIQPhase_deg = strtod(argv[i], NULL);
+                cliConfig.txIQPhase_deg[0] = strtod(argv[i], NULL);
             } else {
                 printf("Missing argument for -txIQGain\n");
                 exit(1);
@@ -548,7 +1129,7 @@ int main(int argc, char **argv) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                rxIQGain = strtod(argv[i], NULL);
+                cliConfig.rxIQGain[0] = strtod(argv[i], NULL);
             } else {
                 printf("Missing argument for -rxIQGain\n");
                 exit(1);
@@ -557,11 +1138,143 @@ int main(int argc, char **argv) {
             i++; //Get the actual argument
 
             if (i < argc) {
-                rxIQPhase_deg = strtod(argv[i], NULL);
+                cliConfig.rxIQPhase_deg[0] = strtod(argv[i], NULL);
             } else {
                 printf("Missing argument for -rxIQGain\n");
                 exit(1);
             }
+        //#### Channel 1 DC Offset and I/Q Imbalance Properties
+        } else if (strcmp("-tx1DCOffsetI", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.txDCOffsetI[1] = strtod(argv[i], NULL);
+            } else {
+                printf("Missing argument for -tx1DCOffsetI\n");
+                exit(1);
+            }
+        } else if (strcmp("-tx1DCOffsetQ", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.txDCOffsetQ[1] = strtod(argv[i], NULL);
+            } else {
+                printf("Missing argument for -tx1DCOffsetQ\n");
+                exit(1);
+            }
+        } else if (strcmp("-rx1DCOffsetI", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.rxDCOffsetI[1] = strtod(argv[i], NULL);
+            } else {
+                printf("Missing argument for -rx1DCOffsetI\n");
+                exit(1);
+            }
+        } else if (strcmp("-rx1DCOffsetQ", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.rxDCOffsetQ[1] = strtod(argv[i], NULL);
+            } else {
+                printf("Missing argument for -rx1DCOffsetQ\n");
+                exit(1);
+            }
+        } else if (strcmp("-tx1IQGain", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.txIQGain[1] = strtod(argv[i], NULL);
+            } else {
+                printf("Missing argument for -tx1IQGain\n");
+                exit(1);
+            }
+        } else if (strcmp("-tx1IQPhase", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.txIQPhase_deg[1] = strtod(argv[i], NULL);
+            } else {
+                printf("Missing argument for -tx1IQPhase\n");
+                exit(1);
+            }
+        } else if (strcmp("-rx1IQGain", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.rxIQGain[1] = strtod(argv[i], NULL);
+            } else {
+                printf("Missing argument for -rx1IQGain\n");
+                exit(1);
+            }
+        } else if (strcmp("-rx1IQPhase", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                cliConfig.rxIQPhase_deg[1] = strtod(argv[i], NULL);
+            } else {
+                printf("Missing argument for -rx1IQPhase\n");
+                exit(1);
+            }
+        //#### Multiple Devices
+        } else if (strcmp("-devices", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                deviceListPath = argv[i];
+            } else {
+                printf("Missing argument for -devices\n");
+                exit(1);
+            }
+        } else if (strcmp("-statusPeriod", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                statusPeriod = strtod(argv[i], NULL);
+                if (statusPeriod < 0) {
+                    printf("-statusPeriod must be non-negative\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -statusPeriod\n");
+                exit(1);
+            }
+        } else if (strcmp("-statsName", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                statsName = argv[i];
+            } else {
+                printf("Missing argument for -statsName\n");
+                exit(1);
+            }
+        } else if (strcmp("-trace", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                tracePath = argv[i];
+            } else {
+                printf("Missing argument for -trace\n");
+                exit(1);
+            }
+        } else if (strcmp("-controlSocket", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                controlSocketPath = argv[i];
+            } else {
+                printf("Missing argument for -controlSocket\n");
+                exit(1);
+            }
+        } else if (strcmp("-daemon", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                daemonPath = argv[i];
+            } else {
+                printf("Missing argument for -daemon\n");
+                exit(1);
+            }
         } else if (strcmp("-v", argv[i]) == 0) {
             print = true;
         } else {
@@ -569,115 +1282,158 @@ int main(int argc, char **argv) {
         }
     }
 
-    if (txSharedName == NULL || txFeedbackSharedName == NULL || rxSharedName == NULL) {
-        printf("must supply tx, rx, and txfb share names\n");
-        exit(1);
+    //-record defaults to the raw format
+    if(cliConfig.record.path != NULL && cliConfig.record.format == RECORD_NONE){
+        cliConfig.record.format = RECORD_RAW;
     }
 
-    if(strlen(txSerial) == 0 && strlen(rxSerial) != 0){
-        fprintf(stderr, "Rx Serial Specified but Tx Serial Unspecified");
-        exit(1);
+    //Replay is the file source of the simulated bladeRF without looping
+    if(replayPath != NULL){
+        cliConfig.simulate = true;
+        cliConfig.sim.source = SIM_SOURCE_FILE;
+        cliConfig.sim.filePath = replayPath;
+        cliConfig.sim.loop = replayLoop;
     }
-    if(strlen(txSerial) != 0 && strlen(rxSerial) == 0){
-        fprintf(stderr, "Tx Serial Specified but Rx Serial Unspecified");
-        exit(1);
+    if(cliConfig.sim.filePath != NULL && !replayFormatSet){
+        size_t pathLen = strlen(cliConfig.sim.filePath);
+        if(pathLen >= 11 && (strcmp(cliConfig.sim.filePath+pathLen-11, ".sigmf-meta") == 0 || strcmp(cliConfig.sim.filePath+pathLen-11, ".sigmf-data") == 0)){
+            cliConfig.sim.fileFormat = SIM_FILE_SIGMF;
+        }
     }
-    if(strlen(txSerial) == 0 && strlen(rxSerial) == 0){
-        fprintf(stderr, "Tx & Rx Serial Unspecified");
+
+    //The sessions bring their own FIFOs, the modes that run on the FIFOs given at start do not apply
+    if(daemonPath != NULL && (measureConfig.mode != MEASURE_NONE || autotune || replayPath != NULL || tracePath != NULL)){
+        fprintf(stderr, "-daemon cannot be used with -measure, -autotune, -replay, or -trace\n");
         exit(1);
     }
 
+    //The software loop measurement does not use a bladeRF
+    if(measureConfig.mode == MEASURE_SW){
+        if(lockMemory){
+            lockProcessMemory(print);
+        }
+        registerSignalHandlers();
+        runSoftwareLoopMeasurement(&cliConfig, &measureConfig, &stop, print);
+        return 0;
+    }
+    if(measureConfig.mode == MEASURE_RFIC){
+        if(cliConfig.simulate){
+            fprintf(stderr, "-measure rfic requires a bladeRF, use -measure sw without one\n");
+            exit(1);
+        }
+        cliConfig.enableLoopBack = true;
+    }
 
     //### Setup bladeRF
     //For info on how to use libbladeRF see the documentation at https://www.nuand.com/bladeRF-doc/libbladeRF/v2.2.1/
     //The boilerplate for usage is at https://www.nuand.com/bladeRF-doc/libbladeRF/v2.2.1/boilerplate.html
     //Examples for Tx & Rx are at https://www.nuand.com/bladeRF-doc/libbladeRF/v2.2.1/sync_no_meta.html
 
-    printf("Tx BladeRF Serial Num: %s\nRx BladeRF Serial Num: %s\n", txSerial, rxSerial);
+    //Each bladeRF board is a pipeline with its own Rx and/or Tx threads
+    radioPipeline_t *pipelines = NULL;
+    int numPipelines = 0;
 
-    struct bladerf *txDev = NULL;
-    openBladeRF(&txDev, txSerial);
+    if(deviceListPath != NULL){
+        radioConfig_t *deviceConfigs = NULL;
+        numPipelines = parseRadioConfigFile(deviceListPath, &cliConfig, &deviceConfigs, daemonPath == NULL);
+        if(numPipelines == 0){
+            fprintf(stderr, "No devices in device list: %s\n", deviceListPath);
+            exit(1);
+        }
 
-    struct bladerf *rxDev = NULL;
-    if(strcmp(txSerial, rxSerial) == 0){
-        //Tx and Rx board are the same
-        //Do not re-open the board
-        rxDev = txDev;
-    }else{
-        openBladeRF(&rxDev, rxSerial);
-    }
+        pipelines = (radioPipeline_t*) malloc(sizeof(radioPipeline_t)*numPipelines);
+        for(int i = 0; i<numPipelines; i++){
+            pipelines[i].config = deviceConfigs[i];
+        }
+        free(deviceConfigs);
+    }else {
+        for (int chan = 0; chan < cliConfig.numChannels; chan++) {
+            //Replay only needs the Rx FIFOs
+            bool txMissing = cliConfig.txSharedName[chan] == NULL || cliConfig.txFeedbackSharedName[chan] == NULL;
+            bool txPartial = (cliConfig.txSharedName[chan] == NULL) != (cliConfig.txFeedbackSharedName[chan] == NULL);
+            if (daemonPath == NULL && (cliConfig.rxSharedName[chan] == NULL || (replayPath == NULL && txMissing) || txPartial)) {
+                printf("must supply tx, rx, and txfb share names for channel %d\n", chan);
+                exit(1);
+            }
+        }
 
-    //Config bladeRF settings
-    //Will configure Tx0 and Rx 0
-    configBladeRFChannel(txDev, true,  0, txFreq, txBW, txSampRate, txGain, false);
-    configBladeRFChannel(rxDev, false, 0, rxFreq, rxBW, rxSampRate, rxGain, false);
-
-    //Config correction
-    //**** Setting to no correction - doing these corrections myself
-    //Comments from https://nuand.com/libbladeRF-doc/v2.2.1/group___f_n___c_o_r_r.html#ga75dd741fde93fecb4d514a1f9a377344 for convenience
-    bladerf_correction_value txDcOff_I = 0; //Adjusts the in-phase DC offset. Valid values are [-2048, 2048], which are scaled to the available control bits.
-    bladerf_correction_value txDcOff_Q = 0; //Adjusts the quadrature DC offset. Valid values are [-2048, 2048], which are scaled to the available control bits.
-    bladerf_correction_value txIq_phase = 0; //Adjusts phase correction of [-10, 10] degrees, via a provided count value of [-4096, 4096].
-    bladerf_correction_value txIq_gain = 0; //Adjusts gain correction value in [-1.0, 1.0], via provided values in the range of [-4096, 4096].
-    setCorrection(txDev, true, 0, txDcOff_I, txDcOff_Q, txIq_phase, txIq_gain);
-
-    bladerf_correction_value rxDcOff_I = 0; //Adjusts the in-phase DC offset. Valid values are [-2048, 2048], which are scaled to the available control bits.
-    bladerf_correction_value rxDcOff_Q = 0; //Adjusts the quadrature DC offset. Valid values are [-2048, 2048], which are scaled to the available control bits.
-    bladerf_correction_value rxIq_phase = 0; //Adjusts phase correction of [-10, 10] degrees, via a provided count value of [-4096, 4096].
-    bladerf_correction_value rxIq_gain = 0; //Adjusts gain correction value in [-1.0, 1.0], via provided values in the range of [-4096, 4096].
-    setCorrection(rxDev, false, 0, rxDcOff_I, rxDcOff_Q, rxIq_phase, rxIq_gain);
-
-    //Setting libbladerf corrections to no correction - doing these corrections myself
-//    printCorrection(txDev, true, 0);
-//    printCorrection(rxDev, false, 0);
-
-    //**** For Debugging Interface, Can Enable Loopback ****
-    bool enableLoopBack = false;
-    if(enableLoopBack && print){
-        printf("********** RFIC LOOPBACK MODE *********\n");
-    }
+        //The simulated bladeRF does not need a serial number
+        if (cliConfig.simulate && strlen(txSerial) == 0 && strlen(rxSerial) == 0) {
+            snprintf(txSerial, sizeof(txSerial), replayPath != NULL ? "replay" : "sim");
+            snprintf(rxSerial, sizeof(rxSerial), replayPath != NULL ? "replay" : "sim");
+        }
+
+        if (strlen(txSerial) == 0 && strlen(rxSerial) != 0) {
+            fprintf(stderr, "Rx Serial Specified but Tx Serial Unspecified");
+            exit(1);
+        }
+        if (strlen(txSerial) != 0 && strlen(rxSerial) == 0) {
+            fprintf(stderr, "Tx Serial Specified but Rx Serial Unspecified");
+            exit(1);
+        }
+        if (strlen(txSerial) == 0 && strlen(rxSerial) == 0) {
+            fprintf(stderr, "Tx & Rx Serial Unspecified");
+            exit(1);
+        }
 
-    bladerf_loopback loopbackMode = enableLoopBack ? BLADERF_LB_RFIC_BIST : BLADERF_LB_NONE;
+        printf("Tx BladeRF Serial Num: %s\nRx BladeRF Serial Num: %s\n", txSerial, rxSerial);
 
-    int statusLB = bladerf_set_loopback(txDev, loopbackMode);
-    if (statusLB != 0) {
-        fprintf(stderr, "Failed to configure bladeRF Loopback: %s\n",
-                bladerf_strerror(statusLB));
-        exit(1);
+        if (strcmp(txSerial, rxSerial) == 0) {
+            //Tx and Rx board are the same
+            //Do not re-open the board
+            numPipelines = 1;
+            pipelines = (radioPipeline_t*) malloc(sizeof(radioPipeline_t)*numPipelines);
+            pipelines[0].config = cliConfig;
+            snprintf(pipelines[0].config.serial, MAX_SERIAL_NUM_STRLEN, "%s", txSerial);
+        } else {
+            //Separate Tx and Rx boards
+            numPipelines = 2;
+            pipelines = (radioPipeline_t*) malloc(sizeof(radioPipeline_t)*numPipelines);
+            pipelines[0].config = cliConfig;
+            snprintf(pipelines[0].config.serial, MAX_SERIAL_NUM_STRLEN, "%s", txSerial);
+            pipelines[1].config = cliConfig;
+            snprintf(pipelines[1].config.serial, MAX_SERIAL_NUM_STRLEN, "%s", rxSerial);
+            pipelines[0].config.record.format = RECORD_NONE; //Only the Rx is recorded
+            pipelines[0].config.capture.path = NULL;
+            for (int chan = 0; chan < BLADERF_MAX_CHANNELS; chan++) {
+                pipelines[0].config.rxSharedName[chan] = NULL;
+                pipelines[1].config.txSharedName[chan] = NULL;
+                pipelines[1].config.txFeedbackSharedName[chan] = NULL;
+            }
+        }
+    }
+
+    for(int i = 0; i<numPipelines; i++){
+        validateRadioConfig(&pipelines[i].config);
+        //The quick tunes of the hop table are computed for the settings at start
+        if(daemonPath != NULL && pipelines[i].config.hop.numFreqs > 0){
+            fprintf(stderr, "[%s] -daemon cannot be used with frequency hopping\n", pipelines[i].config.serial);
+            exit(1);
+        }
     }
 
-    bladerf_loopback txLoopbackModeReported;
-    statusLB = bladerf_get_loopback(txDev, &txLoopbackModeReported);
-    if (statusLB != 0) {
-        fprintf(stderr, "Failed to get bladeRF Loopback: %s\n",
-                bladerf_strerror(statusLB));
+    if(measureConfig.mode == MEASURE_RFIC && (numPipelines != 1 || !radioConfigRxEnabled(&pipelines[0].config) || !radioConfigTxEnabled(&pipelines[0].config))){
+        fprintf(stderr, "-measure rfic requires a single bladeRF with both Rx and Tx\n");
         exit(1);
     }
 
-    if(print){
-        char* loopbackModeDescr = bladeRFLoopbackModeToStr(txLoopbackModeReported);
-        printf("%s BladeRF Loopback Mode: %s\n", txDev==rxDev ? "Tx/Rx" : "Tx", loopbackModeDescr);
+    //Lock before the FIFOs and buffers are allocated so that they are locked as well (MCL_FUTURE)
+    if(lockMemory){
+        lockProcessMemory(print);
     }
 
-    if(rxDev != txDev){
-        int statusLB = bladerf_set_loopback(rxDev, loopbackMode);
-        if (statusLB != 0) {
-            fprintf(stderr, "Failed to configure bladeRF Loopback: %s\n",
-                    bladerf_strerror(statusLB));
-            exit(1);
-        }
+    //The counters live in the stats segment (shared when -statsName is given)
+    statsSegment_t *statsSegment = openStatsSegment(statsName, numPipelines);
+    if(print && statsName != NULL){
+        printf("Publishing live counters in %s\n", statsName);
+    }
 
-        bladerf_loopback rxLoopbackModeReported;
-        statusLB = bladerf_get_loopback(rxDev, &rxLoopbackModeReported);
-        if (statusLB != 0) {
-            fprintf(stderr, "Failed to get bladeRF Loopback: %s\n",
-                    bladerf_strerror(statusLB));
-            exit(1);
-        }
+    bringUpRadioPipelines(pipelines, numPipelines, statsSegment, daemonPath == NULL, print);
 
-        if(print){
-            char* loopbackModeDescr = bladeRFLoopbackModeToStr(rxLoopbackModeReported);
-            printf("Rx BladeRF Loopback Mode: %s\n", loopbackModeDescr);
+    //The boards are tuned one at a time
+    if(autotune){
+        for(int i = 0; i<numPipelines; i++){
+            autotuneRadioPipeline(&pipelines[i], autotuneDuration, print);
         }
     }
 
@@ -711,146 +1467,100 @@ int main(int argc, char **argv) {
 
     //To avoid the asymmetry of the 2's complement representation, I will map to [-2047, 2047] inclusive
 
-    //When in MIMO mode, the samples from the different channels are interleaved.
-    //TODO: Make args?
-    //int bladeRFBlockLen = 8192;
-    int bladeRFBlockLen = 16384;
-    //int bladeRFNumBuffers = 16;
-    int bladeRFNumBuffers = 32;
-    //int bladeRFNumTransfers = 8;
-    int bladeRFNumTransfers = 16;
+    //With -format sc8, SC8_Q7 is used instead.  The integer range [-128, 128) maps to [-1.0, 1.0) and is mapped to [-127, 127] inclusive.
+    //The DC offset arguments remain in the 12 bit scale and are scaled down in the Rx/Tx threads
 
+    //The default libbladeRF stream buffer settings are in initRadioConfig
+    //When in MIMO mode, the samples from the different channels are interleaved (I0, Q0, I1, Q1, ...).
+    //The bladeRF buffer length is the total number of samples across both channels.
     //Configure before opening threads and enabling Tx or Rx.  Streams need to be configured before any call to sync
 
     // bladerf_log_set_verbosity(BLADERF_LOG_LEVEL_VERBOSE);
     bladerf_log_set_verbosity(BLADERF_LOG_LEVEL_DEBUG);
 
-    signal(SIGABRT, &signal_handler);
-    signal(SIGTERM, &signal_handler);
-    signal(SIGINT, &signal_handler);
+    registerSignalHandlers();
 
-    //Create Thread Args
-    txThreadArgs_t txThreadArgs;
-    txThreadArgs.txSharedName = txSharedName;
-    txThreadArgs.txFeedbackSharedName = txFeedbackSharedName;
-    txThreadArgs.blockLen = blockLen;
-    txThreadArgs.fifoSizeBlocks = fifoSize;
-    txThreadArgs.stop = &stop;
-    txThreadArgs.print = print;
-    txThreadArgs.dev = txDev;
-    txThreadArgs.fullRangeValue = fullScaleValue;
-    txThreadArgs.saturate = saturate;
-    txThreadArgs.bladeRFBlockLen = bladeRFBlockLen;
-    txThreadArgs.bladeRFNumBuffers = bladeRFNumBuffers;
-    txThreadArgs.bladeRFNumTransfers = bladeRFNumTransfers;
-    txThreadArgs.dcOffsetI = txDCOffsetI;
-    txThreadArgs.dcOffsetQ = txDCOffsetQ;
-    txThreadArgs.iqGain = txIQGain;
-    txThreadArgs.iqPhase_deg = txIQPhase_deg;
-
-    rxThreadArgs_t rxThreadArgs;
-    rxThreadArgs.rxSharedName = rxSharedName;
-    rxThreadArgs.blockLen = blockLen;
-    rxThreadArgs.fifoSizeBlocks = fifoSize;
-    rxThreadArgs.stop = &stop;
-    rxThreadArgs.print = print;
-    rxThreadArgs.dev = rxDev;
-    rxThreadArgs.fullRangeValue = fullScaleValue;
-    rxThreadArgs.bladeRFBlockLen = bladeRFBlockLen;
-    rxThreadArgs.bladeRFNumBuffers = bladeRFNumBuffers;
-    rxThreadArgs.bladeRFNumTransfers = bladeRFNumTransfers;
-    rxThreadArgs.dcOffsetI = rxDCOffsetI;
-    rxThreadArgs.dcOffsetQ = rxDCOffsetQ;
-    rxThreadArgs.iqGain = rxIQGain;
-    rxThreadArgs.iqPhase_deg = rxIQPhase_deg;
-
-    //Create Thread
-    cpu_set_t cpuset_tx, cpuset_rx;
-    pthread_t thread_tx, thread_rx;
-    pthread_attr_t attr_tx, attr_rx;
-
-    int status = pthread_attr_init(&attr_tx);
-    if (status != 0) {
-        printf("Could not create Tx pthread attributes ... exiting");
-        exit(1);
-    }
-    status = pthread_attr_init(&attr_rx);
-    if (status != 0) {
-        printf("Could not create Rx pthread attributes ... exiting");
-        exit(1);
+    if(measureConfig.mode == MEASURE_RFIC){
+        runLoopbackMeasurement(&pipelines[0], &measureConfig, &stop, print);
+        closeRadioPipeline(&pipelines[0]);
+        free(pipelines);
+        closeStatsSegment(statsSegment, statsName);
+        return 0;
     }
 
-    //Set Thread CPU
-    if (txCpu >= 0) {
-        CPU_ZERO(&cpuset_tx); //Clear cpuset
-        CPU_SET(txCpu, &cpuset_tx); //Add CPU to cpuset
-        status = pthread_attr_setaffinity_np(&attr_tx, sizeof(cpu_set_t), &cpuset_tx);//Set thread CPU affinity
-        if (status != 0) {
-            printf("Could not set Tx thread core affinity ... exiting");
-            exit(1);
+    //The sessions start the threads
+    if(daemonPath != NULL){
+        controlSocket_t *controlSocket = controlSocketPath != NULL ? controlSocketOpen(controlSocketPath, pipelines, numPipelines, print) : NULL;
+        runSessionDaemon(daemonPath, pipelines, numPipelines, &stop, statusPeriod, print);
+        if(controlSocket != NULL){
+            controlSocketClose(controlSocket);
         }
-
-        //The worker threads in libbladeRF should inherit the affinity mask of this thread
-        // "A new thread created by pthread_create(3) inherits a copy of its creator's CPU affinity mask." (https://linux.die.net/man/3/pthread_setaffinity_np)
-        //Will not set it to use a real time scheduler, especially SCHED_FIFO as that could potentially
-        //cause things to block
-
-        //Note that the worker thread is created in the call to sync_worker_init in src/streaming/sync_worker.c and
-        //no thread attributes are supplied to the call to pthread_create (NULL passed).  This should create the thread
-        //with the default attributes which I think should include the inherited affinity mask
-        // "If attr is NULL, then the thread is created with default attributes" (https://linux.die.net/man/3/pthread_create)
-
-        //Because of this, we don't need to
-    }
-    if (rxCpu >= 0) {
-        CPU_ZERO(&cpuset_tx); //Clear cpuset
-        CPU_SET(rxCpu, &cpuset_rx); //Add CPU to cpuset
-        status = pthread_attr_setaffinity_np(&attr_rx, sizeof(cpu_set_t), &cpuset_rx);//Set thread CPU affinity
-        if (status != 0) {
-            printf("Could not set Rx thread core affinity ... exiting");
-            exit(1);
+        for(int i = 0; i<numPipelines; i++){
+            closeRadioPipeline(&pipelines[i]);
         }
+        free(pipelines);
+        closeStatsSegment(statsSegment, statsName);
+        return 0;
     }
 
     //Start Threads
-    status = pthread_create(&thread_tx, &attr_tx, txThread, &txThreadArgs);
-    if (status != 0) {
-        printf("Could not create Tx thread ... exiting");
-        errno = status;
-        perror(NULL);
-        exit(1);
+    eventTrace_t *trace = tracePath != NULL ? eventTraceOpen(tracePath, print) : NULL;
+    for(int i = 0; i<numPipelines; i++){
+        pipelines[i].trace = trace;
+        startRadioPipeline(&pipelines[i], &stop, print);
     }
-    status = pthread_create(&thread_rx, &attr_rx, rxThread, &rxThreadArgs);
-    if (status != 0) {
-        printf("Could not create Rx thread ... exiting");
-        errno = status;
-        perror(NULL);
-        exit(1);
+    controlSocket_t *controlSocket = controlSocketPath != NULL ? controlSocketOpen(controlSocketPath, pipelines, numPipelines, print) : NULL;
+
+    //Wait for threads to exit, printing the status report periodically
+    uint64_t *prevSamples = (uint64_t*) calloc(2*numPipelines, sizeof(uint64_t));
+    struct timespec startTime, lastReportTime, currentTime;
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    lastReportTime = startTime;
+
+    bool allDone = false;
+    while(!allDone){
+        allDone = true;
+        for(int i = 0; i<numPipelines; i++){
+            allDone &= pollRadioPipeline(&pipelines[i]);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &currentTime);
+        double sinceLastReport = difftimespec(&currentTime, &lastReportTime);
+        if(statusPeriod > 0 && sinceLastReport >= statusPeriod){
+            reportRadioPipelineStatus(pipelines, numPipelines, prevSamples, sinceLastReport);
+            lastReportTime = currentTime;
+        }
+        if(stageTimingRequested){
+            stageTimingRequested = false;
+            reportRadioPipelineStageTiming(pipelines, numPipelines);
+        }
+
+        if(!allDone) {
+            usleep(100000);
+        }
     }
 
-    //Wait for threads to exit
-    void *res;
-    status = pthread_join(thread_tx, &res);
-    if (status != 0) {
-        printf("Could not join Tx thread ... exiting");
-        errno = status;
-        perror(NULL);
-        exit(1);
+    //Final report (rates are averaged over the whole run)
+    for(int i = 0; i<2*numPipelines; i++){
+        prevSamples[i] = 0;
     }
-    status = pthread_join(thread_rx, &res);
-    if (status != 0) {
-        printf("Could not join Rx thread ... exiting");
-        errno = status;
-        perror(NULL);
-        exit(1);
+    clock_gettime(CLOCK_MONOTONIC, &currentTime);
+    reportRadioPipelineStatus(pipelines, numPipelines, prevSamples, difftimespec(&currentTime, &startTime));
+    free(prevSamples);
+#ifdef STAGE_TIMING
+    reportRadioPipelineStageTiming(pipelines, numPipelines);
+#endif
+
+    if(controlSocket != NULL){
+        controlSocketClose(controlSocket);
     }
-
-    pthread_attr_destroy(&attr_tx);
-    pthread_attr_destroy(&attr_rx);
-
-    bladerf_close(txDev);
-    if(rxDev != txDev) {
-        bladerf_close(rxDev);
+    for(int i = 0; i<numPipelines; i++){
+        closeRadioPipeline(&pipelines[i]);
+    }
+    free(pipelines);
+    closeStatsSegment(statsSegment, statsName);
+    if(trace != NULL){
+        eventTraceClose(trace);
     }
 
     return 0;
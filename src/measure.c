@@ -0,0 +1,565 @@
+//
+// Loopback latency and throughput measurement.  Threads standing in for the external application inject a known PN
+// sequence into the Tx FIFOs and detect it in the Rx FIFOs.  The loop is either the RFIC loopback of a bladeRF
+// (BLADERF_LB_RFIC_BIST) or a software Tx to Rx loop that does not need a radio.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+
+#include "depends/BerkeleySharedMemoryFIFO.h"
+#include "measure.h"
+#include "helpers.h"
+#include "blockHeaders.h"
+
+#define MEASURE_SEQUENCE_LFSR_BITS (10)
+#define MEASURE_SEQUENCE_LEN ((1 << MEASURE_SEQUENCE_LFSR_BITS) - 1) //Maximal length sequence
+#define MEASURE_SEQUENCE_AMPLITUDE (0.5) //Relative to full scale, leaves headroom for the Tx corrections
+#define MEASURE_SEARCH_MARGIN (32) //Samples searched on each side of the energy trigger
+#define MEASURE_CAPTURE_LEN (MEASURE_SEQUENCE_LEN + 2*MEASURE_SEARCH_MARGIN)
+#define MEASURE_TRIGGER_RATIO (100.0) //Power above the noise floor (20 dB) that triggers a correlation
+#define MEASURE_MIN_TRIGGER (1e-6) //Minimum trigger power relative to full scale power
+#define MEASURE_DETECT_THRESHOLD (0.5) //Normalized correlation (1 is a perfect match) required for a detection
+#define MEASURE_WARMUP (0.5) //Seconds before sequences are injected
+
+typedef struct{
+    radioConfig_t *config;
+    volatile bool *stop; //Stops the measurement threads (after the radio or software loop has stopped)
+    atomic_bool recording; //Set by the main thread for the measurement window
+    double periodSec;
+
+    SAMPLE_COMPONENT_DATATYPE sequence[MEASURE_SEQUENCE_LEN]; //+/-1
+
+    //Written by the Tx measurement thread, read by the Rx measurement thread
+    int maxInjections;
+    struct timespec *injectTime;
+    atomic_int numInjected;
+
+    //Counted while recording (per channel)
+    atomic_uint_fast64_t txSamples;
+    atomic_uint_fast64_t rxSamples;
+
+    //Owned by the Rx measurement thread until it is joined
+    double *latencySec;
+    int numDetected;
+    int numFalseTriggers;
+    int numAmbiguous;
+} measureState_t;
+
+typedef struct{
+    radioConfig_t *config;
+    volatile bool *stop;
+} softwareLoopArgs_t;
+
+bool parseMeasureMode(char *str, measureMode_t *mode){
+    if(strcmp(str, "rfic") == 0){
+        *mode = MEASURE_RFIC;
+    }else if(strcmp(str, "sw") == 0){
+        *mode = MEASURE_SW;
+    }else{
+        return false;
+    }
+    return true;
+}
+
+void initMeasureConfig(measureConfig_t *measureConfig){
+    measureConfig->mode = MEASURE_NONE;
+    measureConfig->durationSec = MEASURE_DEFAULT_DURATION;
+    measureConfig->periodSec = MEASURE_DEFAULT_PERIOD;
+}
+
+//BPSK maximal length sequence from a Fibonacci LFSR (x^10 + x^7 + 1)
+static void generateSequence(SAMPLE_COMPONENT_DATATYPE *sequence){
+    uint32_t lfsr = 1;
+    for(int i = 0; i<MEASURE_SEQUENCE_LEN; i++){
+        sequence[i] = (lfsr & 1) ? 1 : -1;
+        uint32_t bit = (lfsr ^ (lfsr >> 3)) & 1;
+        lfsr = (lfsr >> 1) | (bit << (MEASURE_SEQUENCE_LFSR_BITS-1));
+    }
+}
+
+static void initMeasureState(measureState_t *state, radioConfig_t *config, measureConfig_t *measureConfig, volatile bool *measureStop){
+    state->config = config;
+    state->stop = measureStop;
+    atomic_init(&state->recording, false);
+    state->periodSec = measureConfig->periodSec;
+    generateSequence(state->sequence);
+
+    state->maxInjections = (int) (measureConfig->durationSec/measureConfig->periodSec) + 2;
+    state->injectTime = (struct timespec*) malloc(sizeof(struct timespec)*state->maxInjections);
+    atomic_init(&state->numInjected, 0);
+    atomic_init(&state->txSamples, 0);
+    atomic_init(&state->rxSamples, 0);
+
+    state->latencySec = (double*) malloc(sizeof(double)*state->maxInjections);
+    state->numDetected = 0;
+    state->numFalseTriggers = 0;
+    state->numAmbiguous = 0;
+}
+
+static void freeMeasureState(measureState_t *state){
+    free(state->injectTime);
+    free(state->latencySec);
+}
+
+//Stands in for the producer of the Tx FIFOs.  Keeps the Tx FIFOs full (returned feedback tokens are credits for more
+//blocks).  The blocks are zero except for a sequence at the start of a channel 0 block every period.
+static void* measureTxThread(void *uncastArgs){
+    measureState_t *state = (measureState_t*) uncastArgs;
+    radioConfig_t *config = state->config;
+    int numChannels = config->numChannels;
+    int32_t blockLen = config->blockLen;
+    size_t fifoBlockSizeBytes = SAMPLE_SIZE*blockLen;
+    size_t txfbBlockSizeBytes = sizeof(FEEDBACK_DATATYPE);
+    SAMPLE_COMPONENT_DATATYPE amplitude = config->fullScaleValue*MEASURE_SEQUENCE_AMPLITUDE;
+
+    //Open the Tx FIFOs (producer) before the feedback FIFOs (consumer), the opposite of the Tx thread
+    sharedMemoryFIFO_t txFifo[BLADERF_MAX_CHANNELS];
+    sharedMemoryFIFO_t txfbFifo[BLADERF_MAX_CHANNELS];
+    for(int chan = 0; chan<numChannels; chan++) {
+        initSharedMemoryFIFO(&txFifo[chan]);
+        producerOpenInitFIFO(config->txSharedName[chan], fifoBlockSizeBytes*config->fifoSize, &txFifo[chan]);
+    }
+    for(int chan = 0; chan<numChannels; chan++) {
+        initSharedMemoryFIFO(&txfbFifo[chan]);
+        consumerOpenFIFOBlock(config->txFeedbackSharedName[chan], txfbBlockSizeBytes*config->fifoSize, &txfbFifo[chan]);
+    }
+
+    SAMPLE_COMPONENT_DATATYPE *block = (SAMPLE_COMPONENT_DATATYPE*) vitis_aligned_alloc(MEM_ALIGNMENT, fifoBlockSizeBytes);
+    SAMPLE_COMPONENT_DATATYPE *zeroBlock = (SAMPLE_COMPONENT_DATATYPE*) vitis_aligned_alloc(MEM_ALIGNMENT, fifoBlockSizeBytes);
+    memset(zeroBlock, 0, fifoBlockSizeBytes);
+    SAMPLE_COMPONENT_DATATYPE *block_re = block;
+
+    int credits = config->fifoSize;
+    int seqPos = -1; //Position in the sequence being injected (the sequence may span blocks), -1 when idle
+    int numInjected = 0;
+    struct timespec lastInjectTime, now;
+    while(!(*state->stop)){
+        //Collect the returned tokens
+        bool tokensReady = true;
+        while(tokensReady){
+            for(int chan = 0; chan<numChannels && tokensReady; chan++) {
+                tokensReady = hasDataForReading(txfbBlockSizeBytes, &txfbFifo[chan]);
+            }
+            if(tokensReady){
+                FEEDBACK_DATATYPE tokens[BLADERF_MAX_CHANNELS];
+                for(int chan = 0; chan<numChannels; chan++) {
+                    readFifo(&tokens[chan], txfbBlockSizeBytes, 1, &txfbFifo[chan]);
+                }
+                credits += tokens[0];
+            }
+        }
+        if(credits <= 0){
+            continue;
+        }
+
+        memset(block, 0, fifoBlockSizeBytes);
+        bool recording = atomic_load_explicit(&state->recording, memory_order_acquire);
+        bool injectStart = false;
+        if(seqPos < 0 && recording && numInjected < state->maxInjections){
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if(numInjected == 0 || difftimespec(&now, &lastInjectTime) >= state->periodSec){
+                injectStart = true;
+                seqPos = 0;
+            }
+        }
+        if(seqPos >= 0){
+            int numToCopy = MEASURE_SEQUENCE_LEN - seqPos < blockLen ? MEASURE_SEQUENCE_LEN - seqPos : blockLen;
+            for(int i = 0; i<numToCopy; i++){
+                block_re[i] = amplitude*state->sequence[seqPos+i];
+            }
+            seqPos += numToCopy;
+            if(seqPos >= MEASURE_SEQUENCE_LEN){
+                seqPos = -1;
+            }
+        }
+
+        for(int chan = 0; chan<numChannels; chan++) {
+            writeFifo(chan == 0 ? block : zeroBlock, fifoBlockSizeBytes, 1, &txFifo[chan]);
+        }
+        credits--;
+
+        if(injectStart){
+            //The sequence has been handed to the bladeRF side
+            clock_gettime(CLOCK_MONOTONIC, &lastInjectTime);
+            state->injectTime[numInjected] = lastInjectTime;
+            numInjected++;
+            atomic_store_explicit(&state->numInjected, numInjected, memory_order_release);
+        }
+        if(recording){
+            atomic_fetch_add_explicit(&state->txSamples, blockLen, memory_order_relaxed);
+        }
+    }
+
+    free(block);
+    free(zeroBlock);
+    return NULL;
+}
+
+//Returns the normalized correlation (1 is a perfect match) of the best alignment of the sequence in the capture
+static double correlateSequence(measureState_t *state, SAMPLE_COMPONENT_DATATYPE *capture_re, SAMPLE_COMPONENT_DATATYPE *capture_im){
+    double bestScore = 0;
+    for(int lag = 0; lag<=MEASURE_CAPTURE_LEN-MEASURE_SEQUENCE_LEN; lag++){
+        double accRe = 0;
+        double accIm = 0;
+        double energy = 0;
+        for(int i = 0; i<MEASURE_SEQUENCE_LEN; i++){
+            SAMPLE_COMPONENT_DATATYPE re = capture_re[lag+i];
+            SAMPLE_COMPONENT_DATATYPE im = capture_im[lag+i];
+            accRe += re*state->sequence[i];
+            accIm += im*state->sequence[i];
+            energy += re*re + im*im;
+        }
+        if(energy > 0){
+            //The gain and phase of the loop are unknown, compare the magnitude
+            double score = (accRe*accRe + accIm*accIm)/(energy*MEASURE_SEQUENCE_LEN);
+            if(score > bestScore){
+                bestScore = score;
+            }
+        }
+    }
+    return bestScore;
+}
+
+static void recordDetection(measureState_t *state, struct timespec *detectTime, int *lastMatched){
+    //The detection belongs to the last sequence injected before it was received.  This requires the latency to be less
+    //than the injection period
+    int numInjected = atomic_load_explicit(&state->numInjected, memory_order_acquire);
+    int match = -1;
+    for(int i = numInjected-1; i>=0; i--){
+        if(difftimespec(detectTime, &state->injectTime[i]) >= 0){
+            match = i;
+            break;
+        }
+    }
+    if(match < 0){
+        //Detected before anything was injected
+        state->numFalseTriggers++;
+        return;
+    }
+    if(match == *lastMatched){
+        state->numAmbiguous++;
+        return;
+    }
+    *lastMatched = match;
+    state->latencySec[state->numDetected] = difftimespec(detectTime, &state->injectTime[match]);
+    state->numDetected++;
+}
+
+//Stands in for the consumer of the Rx FIFOs.  Channel 0 is searched for the sequence: an energy trigger (relative to a
+//running noise floor) captures a window which is correlated with the sequence.
+static void* measureRxThread(void *uncastArgs){
+    measureState_t *state = (measureState_t*) uncastArgs;
+    radioConfig_t *config = state->config;
+    int numChannels = config->numChannels;
+    int32_t blockLen = config->blockLen;
+    size_t headerBytes = config->rxBlockHeader ? sizeof(rxBlockHeader_t) : 0;
+    size_t fifoBlockSizeBytes = headerBytes + SAMPLE_SIZE*blockLen;
+    double fullScalePower = (double) config->fullScaleValue*config->fullScaleValue;
+
+    sharedMemoryFIFO_t rxFifo[BLADERF_MAX_CHANNELS];
+    char *blockBuffer[BLADERF_MAX_CHANNELS];
+    for(int chan = 0; chan<numChannels; chan++) {
+        initSharedMemoryFIFO(&rxFifo[chan]);
+        consumerOpenFIFOBlock(config->rxSharedName[chan], fifoBlockSizeBytes*config->fifoSize, &rxFifo[chan]);
+        blockBuffer[chan] = (char*) vitis_aligned_alloc(MEM_ALIGNMENT, fifoBlockSizeBytes);
+    }
+
+    SAMPLE_COMPONENT_DATATYPE capture_re[MEASURE_CAPTURE_LEN];
+    SAMPLE_COMPONENT_DATATYPE capture_im[MEASURE_CAPTURE_LEN];
+    int captured = -1; //Samples in the capture, -1 when searching
+    struct timespec triggerTime; //When the block holding the start of the capture was read
+    double noiseFloor = 0;
+    int lastMatched = -1;
+
+    while(!(*state->stop)){
+        bool ready = true;
+        for(int chan = 0; chan<numChannels && ready; chan++) {
+            ready = hasDataForReading(fifoBlockSizeBytes, &rxFifo[chan]);
+        }
+        if(!ready){
+            continue;
+        }
+        for(int chan = 0; chan<numChannels; chan++) {
+            readFifo(blockBuffer[chan], fifoBlockSizeBytes, 1, &rxFifo[chan]);
+        }
+        struct timespec readTime;
+        clock_gettime(CLOCK_MONOTONIC, &readTime);
+        if(atomic_load_explicit(&state->recording, memory_order_acquire)){
+            atomic_fetch_add_explicit(&state->rxSamples, blockLen, memory_order_relaxed);
+        }
+
+        SAMPLE_COMPONENT_DATATYPE *block_re = (SAMPLE_COMPONENT_DATATYPE*) (blockBuffer[0] + headerBytes);
+        SAMPLE_COMPONENT_DATATYPE *block_im = block_re + blockLen;
+        int pos = 0;
+        while(pos < blockLen){
+            if(captured < 0){
+                //Search for the start of a sequence
+                double threshold = fmax(noiseFloor*MEASURE_TRIGGER_RATIO, fullScalePower*MEASURE_MIN_TRIGGER);
+                int trigger = -1;
+                double blockPower = 0;
+                for(int i = pos; i<blockLen; i++){
+                    double power = block_re[i]*block_re[i] + block_im[i]*block_im[i];
+                    if(power > threshold){
+                        trigger = i;
+                        break;
+                    }
+                    blockPower += power;
+                }
+                if(trigger < 0){
+                    if(pos == 0){
+                        noiseFloor = 0.9*noiseFloor + 0.1*blockPower/blockLen;
+                    }
+                    break;
+                }
+                pos = trigger - MEASURE_SEARCH_MARGIN > pos ? trigger - MEASURE_SEARCH_MARGIN : pos;
+                captured = 0;
+                triggerTime = readTime;
+            }
+
+            int numToCapture = MEASURE_CAPTURE_LEN - captured < blockLen - pos ? MEASURE_CAPTURE_LEN - captured : blockLen - pos;
+            memcpy(capture_re + captured, block_re + pos, numToCapture*sizeof(SAMPLE_COMPONENT_DATATYPE));
+            memcpy(capture_im + captured, block_im + pos, numToCapture*sizeof(SAMPLE_COMPONENT_DATATYPE));
+            captured += numToCapture;
+            pos += numToCapture;
+
+            if(captured == MEASURE_CAPTURE_LEN){
+                if(correlateSequence(state, capture_re, capture_im) >= MEASURE_DETECT_THRESHOLD){
+                    recordDetection(state, &triggerTime, &lastMatched);
+                }else{
+                    state->numFalseTriggers++;
+                }
+                captured = -1;
+            }
+        }
+    }
+
+    for(int chan = 0; chan<numChannels; chan++) {
+        free(blockBuffer[chan]);
+    }
+    return NULL;
+}
+
+//Copies each Tx FIFO block to the Rx FIFO of the same channel and returns a feedback token, in place of the Rx and Tx
+//threads and the radio
+static void* softwareLoopThread(void *uncastArgs){
+    softwareLoopArgs_t *args = (softwareLoopArgs_t*) uncastArgs;
+    radioConfig_t *config = args->config;
+    int numChannels = config->numChannels;
+    int32_t blockLen = config->blockLen;
+    size_t txBlockSizeBytes = SAMPLE_SIZE*blockLen;
+    size_t headerBytes = config->rxBlockHeader ? sizeof(rxBlockHeader_t) : 0;
+    size_t rxBlockSizeBytes = headerBytes + txBlockSizeBytes;
+    size_t txfbBlockSizeBytes = sizeof(FEEDBACK_DATATYPE);
+
+    //Same order as the Rx and Tx threads
+    sharedMemoryFIFO_t txFifo[BLADERF_MAX_CHANNELS];
+    sharedMemoryFIFO_t txfbFifo[BLADERF_MAX_CHANNELS];
+    sharedMemoryFIFO_t rxFifo[BLADERF_MAX_CHANNELS];
+    for(int chan = 0; chan<numChannels; chan++) {
+        initSharedMemoryFIFO(&txfbFifo[chan]);
+        producerOpenInitFIFO(config->txFeedbackSharedName[chan], txfbBlockSizeBytes*config->fifoSize, &txfbFifo[chan]);
+        initSharedMemoryFIFO(&rxFifo[chan]);
+        producerOpenInitFIFO(config->rxSharedName[chan], rxBlockSizeBytes*config->fifoSize, &rxFifo[chan]);
+    }
+    for(int chan = 0; chan<numChannels; chan++) {
+        initSharedMemoryFIFO(&txFifo[chan]);
+        consumerOpenFIFOBlock(config->txSharedName[chan], txBlockSizeBytes*config->fifoSize, &txFifo[chan]);
+    }
+
+    char *blockBuffer[BLADERF_MAX_CHANNELS];
+    for(int chan = 0; chan<numChannels; chan++) {
+        blockBuffer[chan] = (char*) vitis_aligned_alloc(MEM_ALIGNMENT, rxBlockSizeBytes);
+        memset(blockBuffer[chan], 0, rxBlockSizeBytes);
+    }
+
+    uint64_t sampleIndex = 0;
+    while(!(*args->stop)){
+        bool ready = true;
+        for(int chan = 0; chan<numChannels && ready; chan++) {
+            ready = hasDataForReading(txBlockSizeBytes, &txFifo[chan]);
+        }
+        if(!ready){
+            continue;
+        }
+
+        FEEDBACK_DATATYPE tokensReturned = 1;
+        for(int chan = 0; chan<numChannels; chan++) {
+            readFifo(blockBuffer[chan] + headerBytes, txBlockSizeBytes, 1, &txFifo[chan]);
+            writeFifo(&tokensReturned, txfbBlockSizeBytes, 1, &txfbFifo[chan]);
+        }
+        for(int chan = 0; chan<numChannels; chan++) {
+            if(headerBytes > 0){
+                ((rxBlockHeader_t*) blockBuffer[chan])->sampleIndex = sampleIndex;
+            }
+            writeFifo(blockBuffer[chan], rxBlockSizeBytes, 1, &rxFifo[chan]);
+        }
+        sampleIndex += blockLen;
+    }
+
+    for(int chan = 0; chan<numChannels; chan++) {
+        free(blockBuffer[chan]);
+    }
+    return NULL;
+}
+
+static void startMeasureThread(pthread_t *thread, void *(*threadFctn)(void *), void *args, char *label){
+    int status = pthread_create(thread, NULL, threadFctn, args);
+    if(status != 0){
+        printf("Could not create %s measurement thread ... exiting\n", label);
+        exit(1);
+    }
+}
+
+static void joinMeasureThread(pthread_t thread, char *label){
+    void *res;
+    int status = pthread_join(thread, &res);
+    if(status != 0){
+        printf("Could not join %s measurement thread ... exiting\n", label);
+        exit(1);
+    }
+}
+
+static void validateMeasureConfig(radioConfig_t *config, measureConfig_t *measureConfig){
+    for(int chan = 0; chan<config->numChannels; chan++) {
+        if(config->rxSharedName[chan] == NULL || config->txSharedName[chan] == NULL || config->txFeedbackSharedName[chan] == NULL){
+            fprintf(stderr, "The loopback measurement requires rx, tx, and txfb FIFOs for channel %d\n", chan);
+            exit(1);
+        }
+    }
+    if(config->txBurst){
+        fprintf(stderr, "The loopback measurement does not support Tx burst mode\n");
+        exit(1);
+    }
+    if(measureConfig->durationSec <= 0 || measureConfig->periodSec <= 0){
+        fprintf(stderr, "The measurement duration and period must be positive\n");
+        exit(1);
+    }
+}
+
+//Waits for the warmup, then records for the measurement duration.  Returns the length of the measurement window
+static double runMeasurementWindow(measureState_t *state, measureConfig_t *measureConfig, volatile bool *stop){
+    struct timespec startTime, currentTime;
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    do{
+        usleep(10000);
+        clock_gettime(CLOCK_MONOTONIC, &currentTime);
+    }while(!(*stop) && difftimespec(&currentTime, &startTime) < MEASURE_WARMUP);
+
+    atomic_store_explicit(&state->recording, true, memory_order_release);
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    do{
+        usleep(10000);
+        clock_gettime(CLOCK_MONOTONIC, &currentTime);
+    }while(!(*stop) && difftimespec(&currentTime, &startTime) < measureConfig->durationSec);
+    atomic_store_explicit(&state->recording, false, memory_order_release);
+
+    return difftimespec(&currentTime, &startTime);
+}
+
+static int compareDouble(const void *a, const void *b){
+    double aVal = *((const double*) a);
+    double bVal = *((const double*) b);
+    return (aVal > bVal) - (aVal < bVal);
+}
+
+//Nearest rank percentile of a sorted array
+static double percentile(double *sorted, int len, double p){
+    int idx = (int) ceil(p*len) - 1;
+    if(idx < 0){
+        idx = 0;
+    }
+    return sorted[idx];
+}
+
+static void reportMeasurement(measureState_t *state, char *modeStr, double windowSec){
+    int numInjected = atomic_load_explicit(&state->numInjected, memory_order_acquire);
+    printf("---- Loopback Measurement (%s) ----\n", modeStr);
+    printf("Sequences Injected: %d, Detected: %d, False Triggers: %d\n", numInjected, state->numDetected, state->numFalseTriggers);
+    if(state->numAmbiguous > 0){
+        printf("Warning: %d detections could not be matched to a sequence, the latency may be longer than -measurePeriod\n", state->numAmbiguous);
+    }
+
+    if(state->numDetected > 0){
+        qsort(state->latencySec, state->numDetected, sizeof(double), compareDouble);
+        printf("Host-to-Host Latency (us): Min: %.1f, P50: %.1f, P90: %.1f, P99: %.1f, Max: %.1f\n",
+               state->latencySec[0]*1e6,
+               percentile(state->latencySec, state->numDetected, 0.5)*1e6,
+               percentile(state->latencySec, state->numDetected, 0.9)*1e6,
+               percentile(state->latencySec, state->numDetected, 0.99)*1e6,
+               state->latencySec[state->numDetected-1]*1e6);
+    }else{
+        printf("Warning: No sequences were detected\n");
+    }
+
+    uint64_t txSamples = atomic_load_explicit(&state->txSamples, memory_order_relaxed);
+    uint64_t rxSamples = atomic_load_explicit(&state->rxSamples, memory_order_relaxed);
+    printf("Throughput (per channel) over %.2f s: Tx: %.3f MS/s, Rx: %.3f MS/s\n", windowSec,
+           txSamples/windowSec/1e6, rxSamples/windowSec/1e6);
+}
+
+void runLoopbackMeasurement(radioPipeline_t *pipeline, measureConfig_t *measureConfig, volatile bool *stop, bool print){
+    radioConfig_t *config = &pipeline->config;
+    validateMeasureConfig(config, measureConfig);
+
+    volatile bool measureStop = false;
+    measureState_t state;
+    initMeasureState(&state, config, measureConfig, &measureStop);
+
+    pthread_t txThreadHandle, rxThreadHandle;
+    startMeasureThread(&txThreadHandle, measureTxThread, &state, "Tx");
+    startMeasureThread(&rxThreadHandle, measureRxThread, &state, "Rx");
+    startRadioPipeline(pipeline, stop, print);
+
+    double windowSec = runMeasurementWindow(&state, measureConfig, stop);
+
+    //The measurement threads keep the FIFOs moving until the Rx and Tx threads have stopped
+    *stop = true;
+    while(!pollRadioPipeline(pipeline)){
+        usleep(10000);
+    }
+    measureStop = true;
+    joinMeasureThread(txThreadHandle, "Tx");
+    joinMeasureThread(rxThreadHandle, "Rx");
+
+    reportMeasurement(&state, "RFIC Loopback", windowSec);
+    freeMeasureState(&state);
+}
+
+void runSoftwareLoopMeasurement(radioConfig_t *config, measureConfig_t *measureConfig, volatile bool *stop, bool print){
+    validateMeasureConfig(config, measureConfig);
+    if(print){
+        printf("Measuring through a software loop (no bladeRF)\n");
+    }
+
+    volatile bool measureStop = false;
+    measureState_t state;
+    initMeasureState(&state, config, measureConfig, &measureStop);
+
+    softwareLoopArgs_t loopArgs;
+    loopArgs.config = config;
+    loopArgs.stop = stop;
+
+    pthread_t loopThreadHandle, txThreadHandle, rxThreadHandle;
+    startMeasureThread(&loopThreadHandle, softwareLoopThread, &loopArgs, "Loop");
+    startMeasureThread(&txThreadHandle, measureTxThread, &state, "Tx");
+    startMeasureThread(&rxThreadHandle, measureRxThread, &state, "Rx");
+
+    double windowSec = runMeasurementWindow(&state, measureConfig, stop);
+
+    *stop = true;
+    joinMeasureThread(loopThreadHandle, "Loop");
+    measureStop = true;
+    joinMeasureThread(txThreadHandle, "Tx");
+    joinMeasureThread(rxThreadHandle, "Rx");
+
+    reportMeasurement(&state, "Software Loop", windowSec);
+    freeMeasureState(&state);
+}
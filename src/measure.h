@@ -0,0 +1,41 @@
+//
+// Loopback latency and throughput measurement.  Threads standing in for the external application inject a known PN
+// sequence into the Tx FIFOs and detect it in the Rx FIFOs.  The loop is either the RFIC loopback of a bladeRF
+// (BLADERF_LB_RFIC_BIST) or a software Tx to Rx loop that does not need a radio.
+//
+
+#ifndef BLADERFTOFIFO_MEASURE_H
+#define BLADERFTOFIFO_MEASURE_H
+
+#include <stdbool.h>
+
+#include "radioPipeline.h"
+
+#define MEASURE_DEFAULT_DURATION (10.0) //Seconds
+#define MEASURE_DEFAULT_PERIOD (0.1) //Seconds between injected sequences
+
+typedef enum{
+    MEASURE_NONE = 0,
+    MEASURE_RFIC = 1, //Through the RFIC loopback of the bladeRF
+    MEASURE_SW = 2    //Through a software loop from the Tx FIFOs to the Rx FIFOs (no bladeRF)
+} measureMode_t;
+
+typedef struct{
+    measureMode_t mode;
+    double durationSec;
+    double periodSec;
+} measureConfig_t;
+
+//Returns false if the string is not a known mode ("rfic" or "sw")
+bool parseMeasureMode(char *str, measureMode_t *mode);
+
+void initMeasureConfig(measureConfig_t *measureConfig);
+
+//Runs the measurement on a pipeline that has been brought up with the RFIC loopback enabled.  Starts and stops the
+//pipeline.  The measurement ends early if stop is set.
+void runLoopbackMeasurement(radioPipeline_t *pipeline, measureConfig_t *measureConfig, volatile bool *stop, bool print);
+
+//Runs the measurement through a software loop that copies each Tx FIFO block to the Rx FIFO of the same channel
+void runSoftwareLoopMeasurement(radioConfig_t *config, measureConfig_t *measureConfig, volatile bool *stop, bool print);
+
+#endif //BLADERFTOFIFO_MEASURE_H
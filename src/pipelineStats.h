@@ -0,0 +1,136 @@
+//
+// Counters updated by the Rx and Tx threads and read by the status report and, through the stats segment
+// (statsSegment.h), by other processes
+//
+
+#ifndef BLADERFTOFIFO_PIPELINESTATS_H
+#define BLADERFTOFIFO_PIPELINESTATS_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+
+//The counters are only written by the owning thread.  Relaxed atomics are used so that the reader sees untorn values
+//without adding fences to the hot loop.  Each direction's counters start on their own cache line so that the Rx and Tx
+//threads do not contend.
+typedef struct{
+    _Alignas(64) atomic_uint_fast64_t samplesTransferred; //Samples (per channel) moved between the bladeRF and the Shared Memory FIFOs
+    atomic_uint_fast64_t blocksTransferred;  //Shared Memory FIFO blocks (per channel) moved
+    atomic_uint_fast64_t samplesDropped;     //Samples (per channel) discarded because the Shared Memory FIFO was full
+    atomic_uint_fast64_t blocksDropped;      //Shared Memory FIFO blocks (per channel) discarded
+    atomic_uint_fast64_t underflows;         //Times the Shared Memory FIFO producer missed the deadline
+    atomic_uint_fast64_t samplesInserted;    //Samples (per channel) inserted by the radio while the producer was late
+    atomic_uint_fast64_t flushes;            //Partially filled bladeRF buffers sent because the Shared Memory FIFO was idle
+    atomic_uint_fast64_t samplesPadded;      //Samples (per channel) of padding added to those buffers
+    atomic_uint_fast64_t samplesClipped;     //I or Q components at (Rx) or beyond (Tx) the full range of the bladeRF
+    atomic_uint_fast64_t fifoWaitNs;         //Time spent in the blocking Shared Memory FIFO call (writeFifo for the Rx, readFifo for the Tx)
+    atomic_uint_fast64_t fifoOccupancyBytes; //Shared Memory FIFO (channel 0) occupancy, sampled after each block
+    atomic_uint_fast64_t fifoSizeBytes;
+    atomic_uint_fast64_t syncCalls;          //bladerf_sync_rx/bladerf_sync_tx calls
+    atomic_uint_fast64_t syncNs;             //Time spent in those calls
+    atomic_uint_fast64_t syncMaxNs;          //Longest of those calls
+    atomic_uint_fast64_t hops;               //Frequency hops (hopper.h)
+    atomic_uint_fast64_t hopsMissed;         //Hops whose time had passed when they were scheduled
+    atomic_uint_fast64_t retuneMaxNs;        //Longest bladerf_schedule_retune call
+    atomic_uint_fast64_t recoveries;         //Streams restarted after the device was reopened (radioDeviceRecover)
+    atomic_uint_fast64_t recoveryNs;         //Time from the failed stream call to the restarted stream
+    atomic_uint_fast64_t recoveryMaxNs;      //Longest of those outages
+} pipelineStats_t;
+
+static inline void initPipelineStats(pipelineStats_t *stats){
+    atomic_init(&stats->samplesTransferred, 0);
+    atomic_init(&stats->blocksTransferred, 0);
+    atomic_init(&stats->samplesDropped, 0);
+    atomic_init(&stats->blocksDropped, 0);
+    atomic_init(&stats->underflows, 0);
+    atomic_init(&stats->samplesInserted, 0);
+    atomic_init(&stats->flushes, 0);
+    atomic_init(&stats->samplesPadded, 0);
+    atomic_init(&stats->samplesClipped, 0);
+    atomic_init(&stats->fifoWaitNs, 0);
+    atomic_init(&stats->fifoOccupancyBytes, 0);
+    atomic_init(&stats->fifoSizeBytes, 0);
+    atomic_init(&stats->syncCalls, 0);
+    atomic_init(&stats->syncNs, 0);
+    atomic_init(&stats->syncMaxNs, 0);
+    atomic_init(&stats->hops, 0);
+    atomic_init(&stats->hopsMissed, 0);
+    atomic_init(&stats->retuneMaxNs, 0);
+    atomic_init(&stats->recoveries, 0);
+    atomic_init(&stats->recoveryNs, 0);
+    atomic_init(&stats->recoveryMaxNs, 0);
+}
+
+static inline uint64_t pipelineStatsNow(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t) now.tv_sec)*1000000000 + (uint64_t) now.tv_nsec;
+}
+
+static inline void pipelineStatsAddBlock(pipelineStats_t *stats, uint64_t samples){
+    atomic_store_explicit(&stats->samplesTransferred, atomic_load_explicit(&stats->samplesTransferred, memory_order_relaxed) + samples, memory_order_relaxed);
+    atomic_store_explicit(&stats->blocksTransferred, atomic_load_explicit(&stats->blocksTransferred, memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+static inline void pipelineStatsDropBlock(pipelineStats_t *stats, uint64_t samples){
+    atomic_store_explicit(&stats->samplesDropped, atomic_load_explicit(&stats->samplesDropped, memory_order_relaxed) + samples, memory_order_relaxed);
+    atomic_store_explicit(&stats->blocksDropped, atomic_load_explicit(&stats->blocksDropped, memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+static inline void pipelineStatsUnderflow(pipelineStats_t *stats){
+    atomic_store_explicit(&stats->underflows, atomic_load_explicit(&stats->underflows, memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+static inline void pipelineStatsInsertSamples(pipelineStats_t *stats, uint64_t samples){
+    atomic_store_explicit(&stats->samplesInserted, atomic_load_explicit(&stats->samplesInserted, memory_order_relaxed) + samples, memory_order_relaxed);
+}
+
+static inline void pipelineStatsFlush(pipelineStats_t *stats, uint64_t paddingSamples){
+    atomic_store_explicit(&stats->flushes, atomic_load_explicit(&stats->flushes, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_store_explicit(&stats->samplesPadded, atomic_load_explicit(&stats->samplesPadded, memory_order_relaxed) + paddingSamples, memory_order_relaxed);
+}
+
+static inline void pipelineStatsClipped(pipelineStats_t *stats, uint64_t components){
+    if(components > 0){
+        atomic_store_explicit(&stats->samplesClipped, atomic_load_explicit(&stats->samplesClipped, memory_order_relaxed) + components, memory_order_relaxed);
+    }
+}
+
+static inline void pipelineStatsFifoWait(pipelineStats_t *stats, uint64_t startNs, uint64_t endNs){
+    atomic_store_explicit(&stats->fifoWaitNs, atomic_load_explicit(&stats->fifoWaitNs, memory_order_relaxed) + (endNs - startNs), memory_order_relaxed);
+}
+
+static inline void pipelineStatsFifoOccupancy(pipelineStats_t *stats, uint64_t occupancyBytes){
+    atomic_store_explicit(&stats->fifoOccupancyBytes, occupancyBytes, memory_order_relaxed);
+}
+
+static inline void pipelineStatsSyncCall(pipelineStats_t *stats, uint64_t startNs, uint64_t endNs){
+    uint64_t callNs = endNs - startNs;
+    atomic_store_explicit(&stats->syncCalls, atomic_load_explicit(&stats->syncCalls, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_store_explicit(&stats->syncNs, atomic_load_explicit(&stats->syncNs, memory_order_relaxed) + callNs, memory_order_relaxed);
+    if(callNs > atomic_load_explicit(&stats->syncMaxNs, memory_order_relaxed)){
+        atomic_store_explicit(&stats->syncMaxNs, callNs, memory_order_relaxed);
+    }
+}
+
+//The hop counters are written by the thread driving the hops (the hop schedule thread or the Tx thread)
+static inline void pipelineStatsHop(pipelineStats_t *stats, uint64_t retuneNs){
+    atomic_store_explicit(&stats->hops, atomic_load_explicit(&stats->hops, memory_order_relaxed) + 1, memory_order_relaxed);
+    if(retuneNs > atomic_load_explicit(&stats->retuneMaxNs, memory_order_relaxed)){
+        atomic_store_explicit(&stats->retuneMaxNs, retuneNs, memory_order_relaxed);
+    }
+}
+
+static inline void pipelineStatsHopMissed(pipelineStats_t *stats){
+    atomic_store_explicit(&stats->hopsMissed, atomic_load_explicit(&stats->hopsMissed, memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+static inline void pipelineStatsRecovery(pipelineStats_t *stats, uint64_t outageNs){
+    atomic_store_explicit(&stats->recoveries, atomic_load_explicit(&stats->recoveries, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_store_explicit(&stats->recoveryNs, atomic_load_explicit(&stats->recoveryNs, memory_order_relaxed) + outageNs, memory_order_relaxed);
+    if(outageNs > atomic_load_explicit(&stats->recoveryMaxNs, memory_order_relaxed)){
+        atomic_store_explicit(&stats->recoveryMaxNs, outageNs, memory_order_relaxed);
+    }
+}
+
+#endif //BLADERFTOFIFO_PIPELINESTATS_H
@@ -0,0 +1,303 @@
+//
+// Dispatches the sync interface to libbladeRF or the simulated bladeRF
+//
+
+#define _GNU_SOURCE //pthread_rwlockattr_setkind_np
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "radioDevice.h"
+#include "helpers.h"
+
+void initRadioDevice(radioDevice_t *device){
+    device->type = RADIO_DEVICE_BLADERF;
+    device->dev = NULL;
+    device->sim = NULL;
+    device->rxStats = NULL;
+    device->txStats = NULL;
+    device->reopen = NULL;
+    device->reopenArgs = NULL;
+    device->label = NULL;
+    device->recoveryTimeoutSec = 0;
+    device->generation = 0;
+    device->rxStreamGeneration = 0;
+    device->txStreamGeneration = 0;
+
+    //The stream calls take the read lock continuously, the writer is preferred so that a recovery is not starved
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&device->lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+    pthread_mutex_init(&device->recoverLock, NULL);
+}
+
+void radioDeviceSetRecovery(radioDevice_t *device, radioDeviceReopen_t reopen, void *args, double timeoutSec, char *label){
+    device->reopen = reopen;
+    device->reopenArgs = args;
+    device->recoveryTimeoutSec = timeoutSec;
+    device->label = label;
+}
+
+//Closes the handle without taking the lock
+static void radioDeviceCloseHandle(radioDevice_t *device, char *label, bool print){
+    if(device->type == RADIO_DEVICE_SIM){
+        if(device->sim != NULL){
+            simClose(device->sim, label, print);
+            device->sim = NULL;
+        }
+    }else if(device->dev != NULL){
+        bladerf_close(device->dev);
+        device->dev = NULL;
+    }
+}
+
+bool radioDeviceRecover(radioDevice_t *device, bool tx, radioDeviceStartStream_t startStream, void *startArgs,
+                        volatile bool *stop, bool print){
+    if(device->reopen == NULL){
+        return false;
+    }
+    char *dirStr = tx ? "Tx" : "Rx";
+
+    pthread_mutex_lock(&device->recoverLock);
+    struct timespec startTime, now;
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    bool started = false;
+    while(!(*stop)){
+        uint64_t streamGeneration = tx ? device->txStreamGeneration : device->rxStreamGeneration;
+        if(streamGeneration == device->generation){
+            //The first direction to fail reopens the device.  Waits for the other direction to leave its device call
+            pthread_rwlock_wrlock(&device->lock);
+            if(print){
+                printf("[%s] %s stream failed, reopening the device\n", device->label, dirStr);
+            }
+            //The streams (and the libbladeRF worker threads) go with the old handle
+            radioDeviceCloseHandle(device, device->label, false);
+
+            struct timespec openStartTime;
+            clock_gettime(CLOCK_MONOTONIC, &openStartTime);
+            bool opened = false;
+            while(!opened && !(*stop)){
+                opened = device->reopen(device, device->reopenArgs);
+                if(opened){
+                    break;
+                }
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                if(difftimespec(&now, &startTime) >= device->recoveryTimeoutSec){
+                    break;
+                }
+                usleep(RADIO_DEVICE_RECOVERY_RETRY_MS*1000);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            device->generation++;
+            pthread_rwlock_unlock(&device->lock);
+
+            if(!opened){
+                if(!(*stop)){
+                    fprintf(stderr, "[%s] Unable to reopen the device within %.1f s\n", device->label, device->recoveryTimeoutSec);
+                }
+                break;
+            }
+            if(print){
+                printf("[%s] Reopened the device in %.1f ms\n", device->label, difftimespec(&now, &openStartTime)*1e3);
+            }
+        }else if(!radioDeviceIsOpen(device)){
+            //The other direction could not reopen it
+            break;
+        }
+
+        //The stream configuration records the generation, a failure here reopens the device again
+        started = startStream(startArgs);
+        if(started){
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if(difftimespec(&now, &startTime) >= device->recoveryTimeoutSec){
+            fprintf(stderr, "[%s] Unable to restart the %s stream within %.1f s\n", device->label, dirStr, device->recoveryTimeoutSec);
+            break;
+        }
+        usleep(RADIO_DEVICE_RECOVERY_RETRY_MS*1000);
+    }
+    pthread_mutex_unlock(&device->recoverLock);
+    return started;
+}
+
+bool radioDeviceIsOpen(radioDevice_t *device){
+    return device->type == RADIO_DEVICE_SIM ? device->sim != NULL : device->dev != NULL;
+}
+
+int radioDeviceSyncConfig(radioDevice_t *device, bladerf_channel_layout layout, bladerf_format format,
+                          unsigned int numBuffers, unsigned int bufferSize, unsigned int numTransfers, unsigned int timeout_ms,
+                          int workerCpu, rtPolicy_t policy, int workerPriority, char *label){
+    pthread_rwlock_rdlock(&device->lock);
+    int status;
+    if(!radioDeviceIsOpen(device)){
+        status = BLADERF_ERR_NODEV;
+    }else if(device->type == RADIO_DEVICE_SIM){
+        status = simSyncConfig(device->sim, layout, format, numBuffers, bufferSize, numTransfers, timeout_ms);
+    }else{
+        status = placedBladeRFSyncConfig(device->dev, layout, format, numBuffers, bufferSize, numTransfers, timeout_ms,
+                                         workerCpu, policy, workerPriority, label);
+    }
+    //Only written by the thread of the direction
+    if(layout == BLADERF_TX_X1 || layout == BLADERF_TX_X2){
+        device->txStreamGeneration = device->generation;
+    }else{
+        device->rxStreamGeneration = device->generation;
+    }
+    pthread_rwlock_unlock(&device->lock);
+    return status;
+}
+
+int radioDeviceEnableModule(radioDevice_t *device, bladerf_channel ch, bool enable){
+    pthread_rwlock_rdlock(&device->lock);
+    int status;
+    if(!radioDeviceIsOpen(device)){
+        status = BLADERF_ERR_NODEV;
+    }else if(device->type == RADIO_DEVICE_SIM){
+        status = simEnableModule(device->sim, ch, enable);
+    }else{
+        status = bladerf_enable_module(device->dev, ch, enable);
+    }
+    pthread_rwlock_unlock(&device->lock);
+    return status;
+}
+
+int radioDeviceSyncRx(radioDevice_t *device, void *samples, unsigned int numSamples, struct bladerf_metadata *meta, unsigned int timeout_ms){
+    pthread_rwlock_rdlock(&device->lock);
+    if(device->rxStreamGeneration != device->generation){
+        pthread_rwlock_unlock(&device->lock);
+        return RADIO_DEVICE_REOPENED;
+    }
+    uint64_t startNs = device->rxStats != NULL ? pipelineStatsNow() : 0;
+    int status;
+    if(device->type == RADIO_DEVICE_SIM){
+        status = simSyncRx(device->sim, samples, numSamples, meta, timeout_ms);
+    }else{
+        status = bladerf_sync_rx(device->dev, samples, numSamples, meta, timeout_ms);
+    }
+    if(device->rxStats != NULL){
+        pipelineStatsSyncCall(device->rxStats, startNs, pipelineStatsNow());
+    }
+    pthread_rwlock_unlock(&device->lock);
+    return status;
+}
+
+int radioDeviceSyncTx(radioDevice_t *device, const void *samples, unsigned int numSamples, struct bladerf_metadata *meta, unsigned int timeout_ms){
+    pthread_rwlock_rdlock(&device->lock);
+    if(device->txStreamGeneration != device->generation){
+        pthread_rwlock_unlock(&device->lock);
+        return RADIO_DEVICE_REOPENED;
+    }
+    uint64_t startNs = device->txStats != NULL ? pipelineStatsNow() : 0;
+    int status;
+    if(device->type == RADIO_DEVICE_SIM){
+        status = simSyncTx(device->sim, samples, numSamples, meta, timeout_ms);
+    }else{
+        status = bladerf_sync_tx(device->dev, samples, numSamples, meta, timeout_ms);
+    }
+    if(device->txStats != NULL){
+        pipelineStatsSyncCall(device->txStats, startNs, pipelineStatsNow());
+    }
+    pthread_rwlock_unlock(&device->lock);
+    return status;
+}
+
+int radioDeviceSetFrequency(radioDevice_t *device, bladerf_channel ch, bladerf_frequency frequency){
+    if(device->type == RADIO_DEVICE_SIM){
+        return 0;
+    }
+    pthread_rwlock_rdlock(&device->lock);
+    int status = device->dev != NULL ? bladerf_set_frequency(device->dev, ch, frequency) : BLADERF_ERR_NODEV;
+    pthread_rwlock_unlock(&device->lock);
+    return status;
+}
+
+int radioDeviceSetGain(radioDevice_t *device, bladerf_channel ch, bladerf_gain gain){
+    if(device->type == RADIO_DEVICE_SIM){
+        return 0;
+    }
+    pthread_rwlock_rdlock(&device->lock);
+    int status = device->dev != NULL ? bladerf_set_gain(device->dev, ch, gain) : BLADERF_ERR_NODEV;
+    pthread_rwlock_unlock(&device->lock);
+    return status;
+}
+
+int radioDeviceSetBandwidth(radioDevice_t *device, bladerf_channel ch, bladerf_bandwidth bandwidth){
+    if(device->type == RADIO_DEVICE_SIM){
+        return 0;
+    }
+    bladerf_bandwidth actual;
+    pthread_rwlock_rdlock(&device->lock);
+    int status = device->dev != NULL ? bladerf_set_bandwidth(device->dev, ch, bandwidth, &actual) : BLADERF_ERR_NODEV;
+    pthread_rwlock_unlock(&device->lock);
+    return status;
+}
+
+int radioDeviceGetQuickTune(radioDevice_t *device, bladerf_channel ch, struct bladerf_quick_tune *quickTune){
+    if(device->type == RADIO_DEVICE_SIM){
+        memset(quickTune, 0, sizeof(struct bladerf_quick_tune));
+        return 0;
+    }
+    pthread_rwlock_rdlock(&device->lock);
+    int status = device->dev != NULL ? bladerf_get_quick_tune(device->dev, ch, quickTune) : BLADERF_ERR_NODEV;
+    pthread_rwlock_unlock(&device->lock);
+    return status;
+}
+
+int radioDeviceScheduleRetune(radioDevice_t *device, bladerf_channel ch, bladerf_timestamp timestamp,
+                              bladerf_frequency frequency, struct bladerf_quick_tune *quickTune){
+    if(device->type == RADIO_DEVICE_SIM){
+        return 0;
+    }
+    pthread_rwlock_rdlock(&device->lock);
+    int status = device->dev != NULL ? bladerf_schedule_retune(device->dev, ch, timestamp, frequency, quickTune) : BLADERF_ERR_NODEV;
+    pthread_rwlock_unlock(&device->lock);
+    return status;
+}
+
+int radioDeviceCancelScheduledRetunes(radioDevice_t *device, bladerf_channel ch){
+    if(device->type == RADIO_DEVICE_SIM){
+        return 0;
+    }
+    pthread_rwlock_rdlock(&device->lock);
+    int status = device->dev != NULL ? bladerf_cancel_scheduled_retunes(device->dev, ch) : BLADERF_ERR_NODEV;
+    pthread_rwlock_unlock(&device->lock);
+    return status;
+}
+
+int radioDeviceGetTimestamp(radioDevice_t *device, bladerf_direction dir, bladerf_timestamp *timestamp){
+    pthread_rwlock_rdlock(&device->lock);
+    int status;
+    if(!radioDeviceIsOpen(device)){
+        status = BLADERF_ERR_NODEV;
+    }else if(device->type == RADIO_DEVICE_SIM){
+        status = simGetTimestamp(device->sim, dir, timestamp);
+    }else{
+        status = bladerf_get_timestamp(device->dev, dir, timestamp);
+    }
+    pthread_rwlock_unlock(&device->lock);
+    return status;
+}
+
+void radioDeviceReportChannelState(radioDevice_t *device, bool tx, int chanNum){
+    pthread_rwlock_rdlock(&device->lock);
+    if(device->type == RADIO_DEVICE_SIM){
+        if(device->sim != NULL){
+            simReportChannelState(device->sim, tx, chanNum);
+        }
+    }else if(device->dev != NULL){
+        reportBladeRFChannelState(device->dev, tx, chanNum);
+    }
+    pthread_rwlock_unlock(&device->lock);
+}
+
+void radioDeviceClose(radioDevice_t *device, char *label, bool print){
+    pthread_rwlock_wrlock(&device->lock);
+    radioDeviceCloseHandle(device, label, print);
+    pthread_rwlock_unlock(&device->lock);
+}
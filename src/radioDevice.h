@@ -0,0 +1,112 @@
+//
+// The device streamed by a radio pipeline: a bladeRF board (libbladeRF) or a simulated bladeRF (simDevice.h).  The
+// calls mirror the libbladeRF sync interface and return libbladeRF status codes.
+//
+// After a stream failure (ex. a USB error), the Rx or Tx thread can reopen the device (radioDeviceRecover) without the
+// pipeline being torn down.  The device calls hold a read lock and the reopen holds the write lock so that the thread
+// of the other direction is not in a call while the handle is replaced.  Its stream was lost with the old handle:
+// its next stream call returns RADIO_DEVICE_REOPENED and it configures its stream again.
+//
+
+#ifndef BLADERFTOFIFO_RADIODEVICE_H
+#define BLADERFTOFIFO_RADIODEVICE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include <libbladeRF.h>
+
+#include "rtPolicy.h"
+#include "simDevice.h"
+#include "pipelineStats.h"
+
+#define RADIO_DEVICE_END_OF_STREAM (SIM_END_OF_FILE) //Returned by radioDeviceSyncRx when a replayed recording ends
+#define RADIO_DEVICE_REOPENED (2) //Returned by the stream calls when the device was reopened since the stream was configured
+#define RADIO_DEVICE_RECOVERY_RETRY_MS (100) //Between attempts to reopen the device
+
+typedef enum{
+    RADIO_DEVICE_BLADERF = 0,
+    RADIO_DEVICE_SIM = 1
+} radioDeviceType_t;
+
+typedef struct radioDevice_s radioDevice_t;
+
+//Opens the device again and applies the settings (the old handle is already closed).  Called with the device locked so
+//it should use libbladeRF (or the simulated device) directly rather than the radioDevice calls.  Returns false if the
+//device cannot be opened (yet)
+typedef bool (*radioDeviceReopen_t)(radioDevice_t *device, void *args);
+
+struct radioDevice_s{
+    radioDeviceType_t type;
+    struct bladerf *dev; //RADIO_DEVICE_BLADERF
+    simDevice_t *sim;    //RADIO_DEVICE_SIM
+    pipelineStats_t *rxStats; //The latency of the sync calls is counted here (NULL to not count)
+    pipelineStats_t *txStats;
+
+    //Recovery (see radioDeviceSetRecovery)
+    radioDeviceReopen_t reopen; //NULL if a failed stream is not recovered
+    void *reopenArgs;
+    char *label; //For the recovery messages
+    double recoveryTimeoutSec;
+    pthread_rwlock_t lock; //Read: device calls, write: reopening the device
+    pthread_mutex_t recoverLock; //Serializes the recoveries of the Rx and Tx threads
+    uint64_t generation; //Incremented when the device is reopened
+    uint64_t rxStreamGeneration; //generation when each stream was configured
+    uint64_t txStreamGeneration;
+};
+
+//Not yet opened
+void initRadioDevice(radioDevice_t *device);
+
+//Enables radioDeviceRecover.  The device is reopened with reopen, retrying every RADIO_DEVICE_RECOVERY_RETRY_MS for up
+//to timeoutSec
+void radioDeviceSetRecovery(radioDevice_t *device, radioDeviceReopen_t reopen, void *args, double timeoutSec, char *label);
+
+//Configures and enables the stream of the Rx or Tx thread.  Returns false if it could not be started
+typedef bool (*radioDeviceStartStream_t)(void *args);
+
+//Called by the Rx or Tx thread after a failed stream call.  Reopens the device unless it was already reopened since the
+//stream of the thread was configured (by the thread of the other direction), then restarts the stream with
+//startStream.  If the stream cannot be started on the reopened device, the device is reopened again until the timeout.
+//Returns true if the stream was restarted.  Returns false if recovery is not enabled, the stream could not be restarted
+//before the timeout, or stop was set
+bool radioDeviceRecover(radioDevice_t *device, bool tx, radioDeviceStartStream_t startStream, void *startArgs,
+                        volatile bool *stop, bool print);
+
+bool radioDeviceIsOpen(radioDevice_t *device);
+
+//See placedBladeRFSyncConfig.  The simulated device has no worker thread to place
+int radioDeviceSyncConfig(radioDevice_t *device, bladerf_channel_layout layout, bladerf_format format,
+                          unsigned int numBuffers, unsigned int bufferSize, unsigned int numTransfers, unsigned int timeout_ms,
+                          int workerCpu, rtPolicy_t policy, int workerPriority, char *label);
+
+int radioDeviceEnableModule(radioDevice_t *device, bladerf_channel ch, bool enable);
+
+int radioDeviceSyncRx(radioDevice_t *device, void *samples, unsigned int numSamples, struct bladerf_metadata *meta, unsigned int timeout_ms);
+
+int radioDeviceSyncTx(radioDevice_t *device, const void *samples, unsigned int numSamples, struct bladerf_metadata *meta, unsigned int timeout_ms);
+
+//Runtime changes (see controlMailbox.h).  The simulated device ignores RF parameters
+int radioDeviceSetFrequency(radioDevice_t *device, bladerf_channel ch, bladerf_frequency frequency);
+
+int radioDeviceSetGain(radioDevice_t *device, bladerf_channel ch, bladerf_gain gain);
+
+int radioDeviceSetBandwidth(radioDevice_t *device, bladerf_channel ch, bladerf_bandwidth bandwidth);
+
+//Frequency hopping (see hopper.h).  The simulated device returns an empty quick tune and ignores the retunes
+int radioDeviceGetQuickTune(radioDevice_t *device, bladerf_channel ch, struct bladerf_quick_tune *quickTune);
+
+int radioDeviceScheduleRetune(radioDevice_t *device, bladerf_channel ch, bladerf_timestamp timestamp,
+                              bladerf_frequency frequency, struct bladerf_quick_tune *quickTune);
+
+int radioDeviceCancelScheduledRetunes(radioDevice_t *device, bladerf_channel ch);
+
+int radioDeviceGetTimestamp(radioDevice_t *device, bladerf_direction dir, bladerf_timestamp *timestamp);
+
+void radioDeviceReportChannelState(radioDevice_t *device, bool tx, int chanNum);
+
+//No-op if the device is not open
+void radioDeviceClose(radioDevice_t *device, char *label, bool print);
+
+#endif //BLADERFTOFIFO_RADIODEVICE_H
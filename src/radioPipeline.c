@@ -0,0 +1,1393 @@
+//
+// A radio pipeline is a single bladeRF board with its Rx and/or Tx threads and Shared Memory FIFOs
+//
+
+#define _GNU_SOURCE //Need extra functions from sched.h to set thread affinity and pthread_tryjoin_np
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sched.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "radioPipeline.h"
+#include "bladeRFConfig.h"
+
+void initRadioConfig(radioConfig_t *config){
+    config->serial[0] = '\0';
+
+    config->numChannels = 1;
+    for(int chan = 0; chan<BLADERF_MAX_CHANNELS; chan++){
+        config->rxSharedName[chan] = NULL;
+        config->txSharedName[chan] = NULL;
+        config->txFeedbackSharedName[chan] = NULL;
+
+        config->txDCOffsetI[chan] = 0;
+        config->txDCOffsetQ[chan] = 0;
+        config->rxDCOffsetI[chan] = 0;
+        config->rxDCOffsetQ[chan] = 0;
+        config->txIQGain[chan] = 1;
+        config->txIQPhase_deg[chan] = 0;
+        config->rxIQGain[chan] = 1;
+        config->rxIQPhase_deg[chan] = 0;
+    }
+    config->blockLen = 1;
+    config->fifoSize = 8;
+
+    config->txCpu = -1;
+    config->rxCpu = -1;
+
+    config->rtPolicy = RT_POLICY_NONE;
+    config->txPriority = RT_DEFAULT_PRIORITY;
+    config->rxPriority = RT_DEFAULT_PRIORITY;
+    config->txWorkerCpu = -1;
+    config->rxWorkerCpu = -1;
+    config->txWorkerPriority = -1;
+    config->rxWorkerPriority = -1;
+
+    config->txGain = 0;
+    config->rxGain = 0;
+    config->txFreq = 2400000000;
+    config->rxFreq = 2400000000;
+    config->txSampRate = 61440000;
+    config->rxSampRate = 61440000;
+    config->txBW = 56000000;
+    config->rxBW = 56000000;
+    //**** For Debugging Interface, Can Enable Loopback ****
+    config->enableLoopBack = false;
+    config->configCacheDir = NULL;
+    config->recoveryTimeoutSec = RADIO_DEFAULT_RECOVERY_TIMEOUT;
+    config->consumerTimeoutSec = 0;
+
+    config->sampleFormat = SAMPLE_FORMAT_SC16_Q11;
+    config->fullScaleValue = 1;
+    config->saturate = false;
+
+    config->txBurst = false;
+    config->txBurstLead = 1000000;
+
+    config->rxOverflowPolicy = RX_OVERFLOW_BLOCK;
+    config->rxOverflowBacklog = RX_DEFAULT_OVERFLOW_BACKLOG;
+    config->rxBlockHeader = false;
+
+    initRecordConfig(&config->record);
+    initCaptureConfig(&config->capture);
+    initHopConfig(&config->hop);
+
+    config->txUnderflowPolicy = TX_UNDERFLOW_WAIT;
+    config->txUnderflowDeadline_us = 0;
+    config->txFlushIdle_us = 0;
+
+    //int bladeRFBlockLen = 8192;
+    config->rxBladeRFBlockLen = 16384;
+    config->txBladeRFBlockLen = 16384;
+    //int bladeRFNumBuffers = 16;
+    config->rxBladeRFNumBuffers = 32;
+    config->txBladeRFNumBuffers = 32;
+    //int bladeRFNumTransfers = 8;
+    config->rxBladeRFNumTransfers = 16;
+    config->txBladeRFNumTransfers = 16;
+    config->rxBladeRFTimeout = 1000;
+    config->txBladeRFTimeout = 0;
+
+    config->simulate = false;
+    initSimConfig(&config->sim);
+}
+
+void applyTxLowLatencyPreset(radioConfig_t *config){
+    //libbladeRF buffers need to be a multiple of 1024 samples.  2048 samples keeps 1024 samples per channel in MIMO mode
+    config->txBladeRFBlockLen = 2048;
+    config->txBladeRFNumBuffers = 8;
+    config->txBladeRFNumTransfers = 4;
+    config->txFlushIdle_us = TX_LOW_LATENCY_FLUSH_IDLE;
+}
+
+bool radioConfigRxEnabled(radioConfig_t *config){
+    return config->rxSharedName[0] != NULL;
+}
+
+bool radioConfigTxEnabled(radioConfig_t *config){
+    return config->txSharedName[0] != NULL || config->txFeedbackSharedName[0] != NULL;
+}
+
+void printRadioConfigFileHelp(){
+    printf("Device list file format (-devices):\n");
+    printf("  One bladeRF board per line as whitespace separated key=value pairs.  Lines starting with # are ignored.\n");
+    printf("  Unspecified settings default to the values given on the command line.\n");
+    printf("  Keys: serial (required), rx, tx, txfb, rx1, tx1, txfb1, numChannels, blocklen, fifosize, format,\n");
+    printf("        cpu (Rx and Tx), rxCpu, txCpu, rtPolicy, rxPriority, txPriority, rxWorkerCpu, txWorkerCpu, rxWorkerPriority, txWorkerPriority,\n");
+    printf("        rxFreq, txFreq, rxSampRate, txSampRate, rxBW, txBW, rxGain, txGain,\n");
+    printf("        rxDCOffsetI, rxDCOffsetQ, txDCOffsetI, txDCOffsetQ, rxIQGain, rxIQPhase, txIQGain, txIQPhase,\n");
+    printf("        rx1DCOffsetI, rx1DCOffsetQ, tx1DCOffsetI, tx1DCOffsetQ, rx1IQGain, rx1IQPhase, tx1IQGain, tx1IQPhase (channel 1),\n");
+    printf("        rxOverflowPolicy, rxOverflowBacklog, txUnderflowPolicy, txUnderflowDeadline, txFlushIdle, record, capture,\n");
+    printf("        hop, hopDwell, hopDir, configCache, recoveryTimeout, consumerTimeout,\n");
+    printf("        rxBladeRFBlockLen, rxBladeRFNumBuffers, rxBladeRFNumTransfers, rxBladeRFTimeout,\n");
+    printf("        txBladeRFBlockLen, txBladeRFNumBuffers, txBladeRFNumTransfers, txBladeRFTimeout\n");
+    printf("  The Rx is enabled if rx is given.  The Tx is enabled if tx or txfb is given, both are then required for each channel.\n");
+    printf("  Example: serial=0123456789abcdef0123456789abcdef rx=rx0 tx=tx0 txfb=txfb0 rxFreq=2400000000 cpu=2\n");
+}
+
+bool parseRadioConfigCount(char *str, int32_t *count){
+    char *end;
+    errno = 0;
+    long val = strtol(str, &end, 10);
+    if(end == str || *end != '\0' || errno != 0 || val < 1 || val > INT32_MAX){
+        return false;
+    }
+    *count = (int32_t) val;
+    return true;
+}
+
+static void validateBladeRFStreamConfig(char *serial, char *dirStr, int blockLen, int numBuffers, int numTransfers, int numChannels){
+    if(blockLen <= 0 || blockLen % 1024 != 0){
+        fprintf(stderr, "[%s] %s bladeRF block length (%d) must be a positive multiple of 1024\n", serial, dirStr, blockLen);
+        exit(1);
+    }
+    if(blockLen % numChannels != 0){
+        fprintf(stderr, "[%s] %s bladeRF block length (%d) must be a multiple of the number of channels\n", serial, dirStr, blockLen);
+        exit(1);
+    }
+    if(numTransfers <= 0 || numBuffers <= numTransfers){
+        fprintf(stderr, "[%s] %s bladeRF number of transfers (%d) must be positive and less than the number of buffers (%d)\n", serial, dirStr, numTransfers, numBuffers);
+        exit(1);
+    }
+}
+
+void validateRadioConfig(radioConfig_t *config){
+    validateBladeRFStreamConfig(config->serial, "Rx", config->rxBladeRFBlockLen, config->rxBladeRFNumBuffers, config->rxBladeRFNumTransfers, config->numChannels);
+    validateBladeRFStreamConfig(config->serial, "Tx", config->txBladeRFBlockLen, config->txBladeRFNumBuffers, config->txBladeRFNumTransfers, config->numChannels);
+    if(config->rxOverflowPolicy != RX_OVERFLOW_BLOCK && !config->rxBlockHeader){
+        printf("[%s] Warning: Rx drops are counted but not flagged to the consumer without -rxBlockHeader\n", config->serial);
+    }
+    if((config->txUnderflowPolicy != TX_UNDERFLOW_WAIT || config->txFlushIdle_us > 0) && config->txBurst){
+        printf("[%s] Warning: The Tx underflow policy and flush are not used in burst mode (each block is sent on its own)\n", config->serial);
+    }
+    if(config->record.format != RECORD_NONE && config->record.path == NULL){
+        fprintf(stderr, "[%s] The recording needs a path (-record or the record key)\n", config->serial);
+        exit(1);
+    }
+    if(config->record.format != RECORD_NONE && !radioConfigRxEnabled(config)){
+        printf("[%s] Warning: Only the Rx is recorded, nothing will be recorded\n", config->serial);
+    }
+    if(config->capture.path != NULL && !radioConfigRxEnabled(config)){
+        printf("[%s] Warning: Only the Rx is captured, nothing will be captured\n", config->serial);
+    }
+    if(config->hop.numFreqs > 0 && config->hop.dwell_us <= 0){
+        if(config->hop.tx && (!radioConfigTxEnabled(config) || !config->txBurst)){
+            fprintf(stderr, "[%s] Hopping on the Tx block markers (-hopDwell 0) requires the Tx in burst mode (-txBurst)\n", config->serial);
+            exit(1);
+        }
+        if(config->hop.rx && radioConfigRxEnabled(config)){
+            printf("[%s] Warning: The Rx only hops on a schedule (-hopDwell), the Rx will not hop\n", config->serial);
+        }
+    }
+    if(config->simulate && config->enableLoopBack){
+        fprintf(stderr, "[%s] The simulated bladeRF does not support loopback\n", config->serial);
+        exit(1);
+    }
+    if(config->simulate && config->sim.source == SIM_SOURCE_FILE && config->sim.filePath == NULL){
+        fprintf(stderr, "[%s] The simulated file source requires -simFile\n", config->serial);
+        exit(1);
+    }
+}
+
+static void parseRadioConfigEntry(char *path, int lineNum, char *key, char *val, radioConfig_t *config){
+    if(strcmp(key, "serial") == 0){
+        if(strlen(val) > MAX_SERIAL_NUM_STRLEN){
+            fprintf(stderr, "%s:%d: serial number too long\n", path, lineNum);
+            exit(1);
+        }
+        strncpy(config->serial, val, MAX_SERIAL_NUM_STRLEN);
+    }else if(strcmp(key, "rx") == 0){
+        config->rxSharedName[0] = strdup(val);
+    }else if(strcmp(key, "tx") == 0){
+        config->txSharedName[0] = strdup(val);
+    }else if(strcmp(key, "txfb") == 0){
+        config->txFeedbackSharedName[0] = strdup(val);
+    }else if(strcmp(key, "rx1") == 0){
+        config->rxSharedName[1] = strdup(val);
+    }else if(strcmp(key, "tx1") == 0){
+        config->txSharedName[1] = strdup(val);
+    }else if(strcmp(key, "txfb1") == 0){
+        config->txFeedbackSharedName[1] = strdup(val);
+    }else if(strcmp(key, "numChannels") == 0){
+        config->numChannels = strtol(val, NULL, 10);
+        if(config->numChannels < 1 || config->numChannels > BLADERF_MAX_CHANNELS){
+            fprintf(stderr, "%s:%d: numChannels must be 1 or 2\n", path, lineNum);
+            exit(1);
+        }
+    }else if(strcmp(key, "format") == 0){
+        if(!parseSampleFormat(val, &config->sampleFormat)){
+            fprintf(stderr, "%s:%d: format must be sc16 or sc8\n", path, lineNum);
+            exit(1);
+        }
+    }else if(strcmp(key, "blocklen") == 0){
+        if(!parseRadioConfigCount(val, &config->blockLen)){
+            fprintf(stderr, "%s:%d: blocklen must be a positive integer\n", path, lineNum);
+            exit(1);
+        }
+    }else if(strcmp(key, "fifosize") == 0){
+        if(!parseRadioConfigCount(val, &config->fifoSize)){
+            fprintf(stderr, "%s:%d: fifosize must be a positive integer\n", path, lineNum);
+            exit(1);
+        }
+    }else if(strcmp(key, "cpu") == 0){
+        config->rxCpu = strtol(val, NULL, 10);
+        config->txCpu = config->rxCpu;
+    }else if(strcmp(key, "rxCpu") == 0){
+        config->rxCpu = strtol(val, NULL, 10);
+    }else if(strcmp(key, "txCpu") == 0){
+        config->txCpu = strtol(val, NULL, 10);
+    }else if(strcmp(key, "rxOverflowPolicy") == 0){
+        if(!parseRxOverflowPolicy(val, &config->rxOverflowPolicy)){
+            fprintf(stderr, "%s:%d: rxOverflowPolicy must be block, dropNewest, or dropOldest\n", path, lineNum);
+            exit(1);
+        }
+    }else if(strcmp(key, "rxOverflowBacklog") == 0){
+        config->rxOverflowBacklog = strtol(val, NULL, 10);
+        if(config->rxOverflowBacklog < 1){
+            fprintf(stderr, "%s:%d: rxOverflowBacklog must be positive\n", path, lineNum);
+            exit(1);
+        }
+    }else if(strcmp(key, "txUnderflowPolicy") == 0){
+        if(!parseTxUnderflowPolicy(val, &config->txUnderflowPolicy)){
+            fprintf(stderr, "%s:%d: txUnderflowPolicy must be wait, zero, or hold\n", path, lineNum);
+            exit(1);
+        }
+    }else if(strcmp(key, "txUnderflowDeadline") == 0){
+        config->txUnderflowDeadline_us = strtod(val, NULL);
+        if(config->txUnderflowDeadline_us < 0){
+            fprintf(stderr, "%s:%d: txUnderflowDeadline must be non-negative\n", path, lineNum);
+            exit(1);
+        }
+    }else if(strcmp(key, "record") == 0){
+        config->record.path = strdup(val);
+        if(config->record.format == RECORD_NONE){
+            config->record.format = RECORD_RAW;
+        }
+    }else if(strcmp(key, "capture") == 0){
+        config->capture.path = strdup(val);
+    }else if(strcmp(key, "hop") == 0){
+        if(!parseHopFrequencies(val, &config->hop)){
+            fprintf(stderr, "%s:%d: hop must be a comma separated list of up to %d positive frequencies\n", path, lineNum, HOP_MAX_FREQS);
+            exit(1);
+        }
+    }else if(strcmp(key, "hopDwell") == 0){
+        config->hop.dwell_us = strtod(val, NULL);
+        if(config->hop.dwell_us < 0){
+            fprintf(stderr, "%s:%d: hopDwell must be non-negative\n", path, lineNum);
+            exit(1);
+        }
+    }else if(strcmp(key, "hopDir") == 0){
+        if(!parseHopDirection(val, &config->hop)){
+            fprintf(stderr, "%s:%d: hopDir must be rx, tx, or both\n", path, lineNum);
+            exit(1);
+        }
+    }else if(strcmp(key, "configCache") == 0){
+        config->configCacheDir = strdup(val);
+    }else if(strcmp(key, "recoveryTimeout") == 0){
+        config->recoveryTimeoutSec = strtod(val, NULL);
+        if(config->recoveryTimeoutSec < 0){
+            fprintf(stderr, "%s:%d: recoveryTimeout must be non-negative\n", path, lineNum);
+            exit(1);
+        }
+    }else if(strcmp(key, "consumerTimeout") == 0){
+        config->consumerTimeoutSec = strtod(val, NULL);
+        if(config->consumerTimeoutSec < 0){
+            fprintf(stderr, "%s:%d: consumerTimeout must be non-negative\n", path, lineNum);
+            exit(1);
+        }
+    }else if(strcmp(key, "txFlushIdle") == 0){
+        config->txFlushIdle_us = strtod(val, NULL);
+        if(config->txFlushIdle_us < 0){
+            fprintf(stderr, "%s:%d: txFlushIdle must be non-negative\n", path, lineNum);
+            exit(1);
+        }
+    }else if(strcmp(key, "rtPolicy") == 0){
+        if(!parseRTPolicy(val, &config->rtPolicy)){
+            fprintf(stderr, "%s:%d: rtPolicy must be none, fifo, or rr\n", path, lineNum);
+            exit(1);
+        }
+    }else if(strcmp(key, "rxPriority") == 0){
+        config->rxPriority = strtol(val, NULL, 10);
+    }else if(strcmp(key, "txPriority") == 0){
+        config->txPriority = strtol(val, NULL, 10);
+    }else if(strcmp(key, "rxWorkerCpu") == 0){
+        config->rxWorkerCpu = strtol(val, NULL, 10);
+    }else if(strcmp(key, "txWorkerCpu") == 0){
+        config->txWorkerCpu = strtol(val, NULL, 10);
+    }else if(strcmp(key, "rxWorkerPriority") == 0){
+        config->rxWorkerPriority = strtol(val, NULL, 10);
+    }else if(strcmp(key, "txWorkerPriority") == 0){
+        config->txWorkerPriority = strtol(val, NULL, 10);
+    }else if(strcmp(key, "rxFreq") == 0){
+        config->rxFreq = strtoul(val, NULL, 10);
+    }else if(strcmp(key, "txFreq") == 0){
+        config->txFreq = strtoul(val, NULL, 10);
+    }else if(strcmp(key, "rxSampRate") == 0){
+        config->rxSampRate = strtoul(val, NULL, 10);
+    }else if(strcmp(key, "txSampRate") == 0){
+        config->txSampRate = strtoul(val, NULL, 10);
+    }else if(strcmp(key, "rxBW") == 0){
+        config->rxBW = strtoul(val, NULL, 10);
+    }else if(strcmp(key, "txBW") == 0){
+        config->txBW = strtoul(val, NULL, 10);
+    }else if(strcmp(key, "rxGain") == 0){
+        config->rxGain = strtol(val, NULL, 10);
+    }else if(strcmp(key, "txGain") == 0){
+        config->txGain = strtol(val, NULL, 10);
+    }else if(strcmp(key, "rxDCOffsetI") == 0){
+        config->rxDCOffsetI[0] = strtod(val, NULL);
+    }else if(strcmp(key, "rxDCOffsetQ") == 0){
+        config->rxDCOffsetQ[0] = strtod(val, NULL);
+    }else if(strcmp(key, "txDCOffsetI") == 0){
+        config->txDCOffsetI[0] = strtod(val, NULL);
+    }else if(strcmp(key, "txDCOffsetQ") == 0){
+        config->txDCOffsetQ[0] = strtod(val, NULL);
+    }else if(strcmp(key, "rxIQGain") == 0){
+        config->rxIQGain[0] = strtod(val, NULL);
+    }else if(strcmp(key, "rxIQPhase") == 0){
+        config->rxIQPhase_deg[0] = strtod(val, NULL);
+    }else if(strcmp(key, "txIQGain") == 0){
+        config->txIQGain[0] = strtod(val, NULL);
+    }else if(strcmp(key, "txIQPhase") == 0){
+        config->txIQPhase_deg[0] = strtod(val, NULL);
+    }else if(strcmp(key, "rx1DCOffsetI") == 0){
+        config->rxDCOffsetI[1] = strtod(val, NULL);
+    }else if(strcmp(key, "rx1DCOffsetQ") == 0){
+        config->rxDCOffsetQ[1] = strtod(val, NULL);
+    }else if(strcmp(key, "tx1DCOffsetI") == 0){
+        config->txDCOffsetI[1] = strtod(val, NULL);
+    }else if(strcmp(key, "tx1DCOffsetQ") == 0){
+        config->txDCOffsetQ[1] = strtod(val, NULL);
+    }else if(strcmp(key, "rx1IQGain") == 0){
+        config->rxIQGain[1] = strtod(val, NULL);
+    }else if(strcmp(key, "rx1IQPhase") == 0){
+        config->rxIQPhase_deg[1] = strtod(val, NULL);
+    }else if(strcmp(key, "tx1IQGain") == 0){
+        config->txIQGain[1] = strtod(val, NULL);
+    }else if(strcmp(key, "tx1IQPhase") == 0){
+        config->txIQPhase_deg[1] = strtod(val, NULL);
+    }else if(strcmp(key, "rxBladeRFBlockLen") == 0){
+        config->rxBladeRFBlockLen = strtol(val, NULL, 10);
+    }else if(strcmp(key, "rxBladeRFNumBuffers") == 0){
+        config->rxBladeRFNumBuffers = strtol(val, NULL, 10);
+    }else if(strcmp(key, "rxBladeRFNumTransfers") == 0){
+        config->rxBladeRFNumTransfers = strtol(val, NULL, 10);
+    }else if(strcmp(key, "rxBladeRFTimeout") == 0){
+        config->rxBladeRFTimeout = strtoul(val, NULL, 10);
+    }else if(strcmp(key, "txBladeRFBlockLen") == 0){
+        config->txBladeRFBlockLen = strtol(val, NULL, 10);
+    }else if(strcmp(key, "txBladeRFNumBuffers") == 0){
+        config->txBladeRFNumBuffers = strtol(val, NULL, 10);
+    }else if(strcmp(key, "txBladeRFNumTransfers") == 0){
+        config->txBladeRFNumTransfers = strtol(val, NULL, 10);
+    }else if(strcmp(key, "txBladeRFTimeout") == 0){
+        config->txBladeRFTimeout = strtoul(val, NULL, 10);
+    }else{
+        fprintf(stderr, "%s:%d: unknown key: %s\n", path, lineNum, key);
+        exit(1);
+    }
+}
+
+int parseRadioConfigFile(char *path, radioConfig_t *defaults, radioConfig_t **configs, bool requireFifos){
+    FILE *file = fopen(path, "r");
+    if(file == NULL){
+        fprintf(stderr, "Unable to open device list: %s\n", path);
+        perror(NULL);
+        exit(1);
+    }
+
+    int numConfigs = 0;
+    int allocatedConfigs = 4;
+    *configs = (radioConfig_t*) malloc(sizeof(radioConfig_t)*allocatedConfigs);
+
+    char *line = NULL;
+    size_t lineAllocLen = 0;
+    int lineNum = 0;
+    while(getline(&line, &lineAllocLen, file) != -1){
+        lineNum++;
+
+        //Remove comments
+        char *comment = strchr(line, '#');
+        if(comment != NULL){
+            *comment = '\0';
+        }
+
+        char *savePtr = NULL;
+        char *token = strtok_r(line, " \t\r\n", &savePtr);
+        if(token == NULL){
+            //Empty line
+            continue;
+        }
+
+        if(numConfigs >= allocatedConfigs){
+            allocatedConfigs *= 2;
+            *configs = (radioConfig_t*) realloc(*configs, sizeof(radioConfig_t)*allocatedConfigs);
+        }
+        radioConfig_t *config = &((*configs)[numConfigs]);
+        *config = *defaults;
+        //FIFO names are never inherited from the defaults, otherwise multiple boards would share the same FIFOs
+        for(int chan = 0; chan<BLADERF_MAX_CHANNELS; chan++){
+            config->rxSharedName[chan] = NULL;
+            config->txSharedName[chan] = NULL;
+            config->txFeedbackSharedName[chan] = NULL;
+        }
+        config->serial[0] = '\0';
+
+        while(token != NULL){
+            char *eq = strchr(token, '=');
+            if(eq == NULL){
+                fprintf(stderr, "%s:%d: expected key=value, got: %s\n", path, lineNum, token);
+                exit(1);
+            }
+            *eq = '\0';
+            parseRadioConfigEntry(path, lineNum, token, eq+1, config);
+            token = strtok_r(NULL, " \t\r\n", &savePtr);
+        }
+
+        if(strlen(config->serial) == 0){
+            fprintf(stderr, "%s:%d: serial unspecified\n", path, lineNum);
+            exit(1);
+        }
+        if(requireFifos && !radioConfigRxEnabled(config) && !radioConfigTxEnabled(config)){
+            fprintf(stderr, "%s:%d: neither Rx nor Tx FIFOs specified\n", path, lineNum);
+            exit(1);
+        }
+        for(int chan = 0; chan<config->numChannels; chan++){
+            if(radioConfigRxEnabled(config) && config->rxSharedName[chan] == NULL){
+                fprintf(stderr, "%s:%d: Rx FIFO unspecified for channel %d\n", path, lineNum, chan);
+                exit(1);
+            }
+            if(radioConfigTxEnabled(config) && (config->txSharedName[chan] == NULL || config->txFeedbackSharedName[chan] == NULL)){
+                fprintf(stderr, "%s:%d: Tx and Tx feedback FIFOs must both be specified for channel %d\n", path, lineNum, chan);
+                exit(1);
+            }
+        }
+
+        numConfigs++;
+    }
+
+    free(line);
+    fclose(file);
+
+    for(int i = 0; i<numConfigs; i++){
+        for(int j = i+1; j<numConfigs; j++){
+            if(strcmp((*configs)[i].serial, (*configs)[j].serial) == 0){
+                fprintf(stderr, "%s: bladeRF %s is listed more than once\n", path, (*configs)[i].serial);
+                exit(1);
+            }
+        }
+    }
+
+    return numConfigs;
+}
+
+static void setLoopback(struct bladerf *dev, char *serial, bool enableLoopBack, configCache_t *cache, bool print){
+    if(enableLoopBack && print){
+        printf("********** RFIC LOOPBACK MODE *********\n");
+    }
+
+    bladerf_loopback loopbackMode = enableLoopBack ? BLADERF_LB_RFIC_BIST : BLADERF_LB_NONE;
+
+    bladerf_loopback loopbackModeReported = loopbackMode;
+    if(cache == NULL || !cache->loopbackValid || cache->loopback != loopbackMode){
+        int statusLB = bladerf_set_loopback(dev, loopbackMode);
+        if (statusLB != 0) {
+            fprintf(stderr, "Failed to configure bladeRF Loopback: %s\n",
+                    bladerf_strerror(statusLB));
+            exit(1);
+        }
+
+        statusLB = bladerf_get_loopback(dev, &loopbackModeReported);
+        if (statusLB != 0) {
+            fprintf(stderr, "Failed to get bladeRF Loopback: %s\n",
+                    bladerf_strerror(statusLB));
+            exit(1);
+        }
+    }
+    if(cache != NULL){
+        cache->loopbackValid = true;
+        cache->loopback = loopbackMode;
+    }
+
+    if(print){
+        char* loopbackModeDescr = bladeRFLoopbackModeToStr(loopbackModeReported);
+        printf("[%s] BladeRF Loopback Mode: %s\n", serial, loopbackModeDescr);
+    }
+}
+
+//Loads the configuration cache of the board and checks that the board still has the cached frequency of a channel (it
+//may have been power cycled or configured by another program since)
+static bool loadRadioPipelineCache(radioPipeline_t *pipeline){
+    radioConfig_t *config = &pipeline->config;
+    if(!configCacheLoad(config->configCacheDir, config->serial, &pipeline->cache)){
+        return false;
+    }
+
+    //Checks the first cached channel
+    bladerf_channel chan = 0;
+    cachedChannelConfig_t *cached = NULL;
+    for(int i = 0; i<2*BLADERF_MAX_CHANNELS && cached == NULL; i++){
+        cachedChannelConfig_t *entry = i%2 == 0 ? &pipeline->cache.rx[i/2] : &pipeline->cache.tx[i/2];
+        if(entry->valid){
+            cached = entry;
+            chan = i%2 == 0 ? BLADERF_CHANNEL_RX(i/2) : BLADERF_CHANNEL_TX(i/2);
+        }
+    }
+    if(cached == NULL){
+        return true;
+    }
+
+    bladerf_frequency freq;
+    int status = bladerf_get_frequency(pipeline->device.dev, chan, &freq);
+    if(status != 0 || freq != cached->freq){
+        if(pipeline->print){
+            printf("[%s] The board does not match the configuration cache, configuring every setting\n", config->serial);
+        }
+        initConfigCache(&pipeline->cache);
+        return false;
+    }
+    return true;
+}
+
+//Sample rates above 61.44 MSPS are only possible with the 8 bit format and the oversample feature (libbladeRF >= 2.4)
+static bool radioConfigNeedsOversample(radioConfig_t *config, bool rxEnabled, bool txEnabled){
+    return config->sampleFormat == SAMPLE_FORMAT_SC8_Q7 &&
+           ((txEnabled && config->txSampRate > BLADERF_MAX_SAMP_RATE_SC16) || (rxEnabled && config->rxSampRate > BLADERF_MAX_SAMP_RATE_SC16));
+}
+
+static bool radioPipelineNeedsOversample(radioPipeline_t *pipeline){
+    return radioConfigNeedsOversample(&pipeline->config, pipeline->rxEnabled, pipeline->txEnabled);
+}
+
+//Config correction
+static void clearBladeRFCorrections(radioPipeline_t *pipeline, struct bladerf *dev, configCache_t *cache){
+    //**** Setting to no correction - doing these corrections myself
+    //Comments from https://nuand.com/libbladeRF-doc/v2.2.1/group___f_n___c_o_r_r.html#ga75dd741fde93fecb4d514a1f9a377344 for convenience
+    bladerf_correction_value dcOff_I = 0; //Adjusts the in-phase DC offset. Valid values are [-2048, 2048], which are scaled to the available control bits.
+    bladerf_correction_value dcOff_Q = 0; //Adjusts the quadrature DC offset. Valid values are [-2048, 2048], which are scaled to the available control bits.
+    bladerf_correction_value iq_phase = 0; //Adjusts phase correction of [-10, 10] degrees, via a provided count value of [-4096, 4096].
+    bladerf_correction_value iq_gain = 0; //Adjusts gain correction value in [-1.0, 1.0], via provided values in the range of [-4096, 4096].
+    for(int chan = 0; chan<pipeline->config.numChannels; chan++) {
+        if(pipeline->txEnabled) {
+            if(cache == NULL || !cache->tx[chan].correctionsCleared){
+                setCorrection(dev, true, chan, dcOff_I, dcOff_Q, iq_phase, iq_gain);
+            }
+            if(cache != NULL){
+                cache->tx[chan].correctionsCleared = true;
+            }
+        }
+        if(pipeline->rxEnabled) {
+            if(cache == NULL || !cache->rx[chan].correctionsCleared){
+                setCorrection(dev, false, chan, dcOff_I, dcOff_Q, iq_phase, iq_gain);
+            }
+            if(cache != NULL){
+                cache->rx[chan].correctionsCleared = true;
+            }
+        }
+    }
+}
+
+//Precomputes the quick tunes once the channels are configured
+static void openRadioPipelineHopper(radioPipeline_t *pipeline){
+    radioConfig_t *config = &pipeline->config;
+    if(config->hop.numFreqs > 0){
+        pipeline->hopper = hopperOpen(&config->hop, &pipeline->device, config->numChannels, pipeline->rxEnabled, pipeline->txEnabled,
+                                      config->rxSampRate, config->txSampRate, config->rxFreq, config->txFreq, config->serial, pipeline->print);
+        //The quick tunes retune the channels
+        pipeline->cacheValid = false;
+    }
+}
+
+//Opens the board and configures the channels for the enabled directions
+static void* bringUpRadioPipeline(void *uncastArgs){
+    radioPipeline_t *pipeline = (radioPipeline_t*) uncastArgs;
+    radioConfig_t *config = &pipeline->config;
+    bringUpTiming_t *timing = &pipeline->bringUpTiming;
+    struct timespec startTime, stepStartTime, stepEndTime;
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+
+    pipeline->rxEnabled = radioConfigRxEnabled(config);
+    pipeline->txEnabled = radioConfigTxEnabled(config);
+    pipeline->oversample = !config->simulate && radioPipelineNeedsOversample(pipeline);
+
+    if(config->simulate){
+        pipeline->device.type = RADIO_DEVICE_SIM;
+        pipeline->device.sim = simOpen(&config->sim, config->rxSampRate, config->txSampRate);
+        clock_gettime(CLOCK_MONOTONIC, &stepEndTime);
+        timing->open = difftimespec(&stepEndTime, &startTime);
+        stepStartTime = stepEndTime;
+        openRadioPipelineHopper(pipeline);
+        clock_gettime(CLOCK_MONOTONIC, &stepEndTime);
+        timing->hopTable = difftimespec(&stepEndTime, &stepStartTime);
+        timing->total = difftimespec(&stepEndTime, &startTime);
+        return NULL;
+    }
+
+    pipeline->device.type = RADIO_DEVICE_BLADERF;
+    openBladeRF(&pipeline->device.dev, config->serial);
+
+    //The cache is only used (and saved) with -configCache
+    configCache_t *cache = NULL;
+    if(config->configCacheDir != NULL){
+        cache = &pipeline->cache;
+        pipeline->cacheValid = true;
+        if(loadRadioPipelineCache(pipeline) && pipeline->print){
+            printf("[%s] Loaded the configuration cache from %s\n", config->serial, config->configCacheDir);
+        }
+    }
+
+    //The feature needs to be enabled before the sample rate is set
+    if(pipeline->oversample){
+        int status = bladerf_enable_feature(pipeline->device.dev, BLADERF_FEATURE_OVERSAMPLE, true);
+        if (status != 0) {
+            fprintf(stderr, "[%s] Failed to enable bladeRF oversample feature: %s\n", config->serial, bladerf_strerror(status));
+            exit(1);
+        }
+        if(pipeline->print){
+            printf("[%s] BladeRF Oversample Feature Enabled\n", config->serial);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stepEndTime);
+    timing->open = difftimespec(&stepEndTime, &startTime);
+    stepStartTime = stepEndTime;
+
+    //Config bladeRF settings
+    //Will configure Tx0 and Rx 0 (and Tx1 and Rx1 in MIMO mode)
+    for(int chan = 0; chan<config->numChannels; chan++) {
+        if(pipeline->txEnabled) {
+            timing->channelStepsCached += configBladeRFChannel(pipeline->device.dev, true, chan, config->txFreq, config->txBW, config->txSampRate, config->txGain,
+                                                               cache != NULL ? &cache->tx[chan] : NULL, false);
+            timing->channelSteps += 4;
+        }
+        if(pipeline->rxEnabled) {
+            timing->channelStepsCached += configBladeRFChannel(pipeline->device.dev, false, chan, config->rxFreq, config->rxBW, config->rxSampRate, config->rxGain,
+                                                               cache != NULL ? &cache->rx[chan] : NULL, false);
+            timing->channelSteps += 4;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stepEndTime);
+    timing->channels = difftimespec(&stepEndTime, &stepStartTime);
+    stepStartTime = stepEndTime;
+
+    clearBladeRFCorrections(pipeline, pipeline->device.dev, cache);
+    clock_gettime(CLOCK_MONOTONIC, &stepEndTime);
+    timing->corrections = difftimespec(&stepEndTime, &stepStartTime);
+    stepStartTime = stepEndTime;
+
+    //Setting libbladerf corrections to no correction - doing these corrections myself
+//    printCorrection(pipeline->device.dev, true, 0);
+//    printCorrection(pipeline->device.dev, false, 0);
+
+    setLoopback(pipeline->device.dev, config->serial, config->enableLoopBack, cache, pipeline->print);
+    clock_gettime(CLOCK_MONOTONIC, &stepEndTime);
+    timing->loopback = difftimespec(&stepEndTime, &stepStartTime);
+    stepStartTime = stepEndTime;
+
+    openRadioPipelineHopper(pipeline);
+    clock_gettime(CLOCK_MONOTONIC, &stepEndTime);
+    timing->hopTable = difftimespec(&stepEndTime, &stepStartTime);
+    timing->total = difftimespec(&stepEndTime, &startTime);
+
+    return NULL;
+}
+
+//Creates the producer side of the Rx and Tx feedback FIFOs of every pipeline while the boards are configured so that the
+//consumers can attach before the streams start
+typedef struct{
+    radioPipeline_t *pipelines;
+    int numPipelines;
+} fifoCreateArgs_t;
+
+//Moves the calling thread to cpu (if pinned) so that the FIFO pages prefaulted by producerOpenInitFIFO are placed on the
+//NUMA node of the Rx/Tx thread that uses them (first touch, see prefaultBuffer)
+static void placeFifoCreation(int cpu, char *serial, char *label){
+    if(cpu < 0){
+        return;
+    }
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    int status = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    if(status != 0){
+        fprintf(stderr, "[%s] Warning: Could not move the %s FIFO creation to CPU %d: %s\n", serial, label, cpu, strerror(status));
+    }
+}
+
+//Creates the producer FIFOs of the enabled directions on the CPUs of the Rx/Tx threads.  The affinity of the calling
+//thread is restored afterwards
+static void openRadioPipelineFifos(radioPipeline_t *pipeline){
+    radioConfig_t *config = &pipeline->config;
+    struct timespec startTime, endTime;
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    cpu_set_t savedCpuset;
+    int status = pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &savedCpuset);
+    if(status != 0){
+        fprintf(stderr, "Could not get the FIFO creation thread core affinity: %s\n", strerror(status));
+        exit(1);
+    }
+
+    //Initialize Producer FIFOs first to avoid deadlock
+    if(radioConfigRxEnabled(config)){
+        placeFifoCreation(config->rxCpu, config->serial, "Rx");
+        for(int chan = 0; chan<config->numChannels; chan++){
+            initSharedMemoryFIFO(&pipeline->rxFifos[chan]);
+            producerOpenInitFIFO(config->rxSharedName[chan], rxFifoBlockSizeBytes(config->blockLen, config->rxBlockHeader)*config->fifoSize,
+                                 &pipeline->rxFifos[chan]);
+            pipeline->rxFifos[chan].consumerTimeoutSec = config->consumerTimeoutSec;
+        }
+    }
+    if(radioConfigTxEnabled(config)){
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &savedCpuset);
+        placeFifoCreation(config->txCpu, config->serial, "Tx feedback");
+        for(int chan = 0; chan<config->numChannels; chan++){
+            initSharedMemoryFIFO(&pipeline->txFeedbackFifos[chan]);
+            producerOpenInitFIFO(config->txFeedbackSharedName[chan], txFeedbackFifoSizeBytes(config->fifoSize),
+                                 &pipeline->txFeedbackFifos[chan]);
+            pipeline->txFeedbackFifos[chan].consumerTimeoutSec = config->consumerTimeoutSec;
+        }
+    }
+
+    status = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &savedCpuset);
+    if(status != 0){
+        fprintf(stderr, "Could not restore the FIFO creation thread core affinity: %s\n", strerror(status));
+        exit(1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &endTime);
+    pipeline->bringUpTiming.fifos = difftimespec(&endTime, &startTime);
+}
+
+static void* createRadioPipelineFifos(void *uncastArgs){
+    fifoCreateArgs_t *args = (fifoCreateArgs_t*) uncastArgs;
+    for(int i = 0; i<args->numPipelines; i++){
+        openRadioPipelineFifos(&args->pipelines[i]);
+    }
+    return NULL;
+}
+
+//Warns if multiple threads are pinned to the same CPU or if a pinned CPU is not isolated
+static void checkCpuAssignments(radioPipeline_t *pipelines, int numPipelines){
+    for(int i = 0; i<numPipelines*2; i++){
+        radioPipeline_t *pipelineA = &pipelines[i/2];
+        bool enabledA = i%2 == 0 ? pipelineA->rxEnabled : pipelineA->txEnabled;
+        int cpuA = i%2 == 0 ? pipelineA->config.rxCpu : pipelineA->config.txCpu;
+        int workerCpuA = i%2 == 0 ? pipelineA->config.rxWorkerCpu : pipelineA->config.txWorkerCpu;
+        if(!enabledA){
+            continue;
+        }
+
+        char label[MAX_SERIAL_NUM_STRLEN+32];
+        snprintf(label, sizeof(label), "[%s] %s libbladeRF worker", pipelineA->config.serial, i%2 == 0 ? "Rx" : "Tx");
+        checkCpuIsolation(workerCpuA, label);
+        if(cpuA < 0){
+            continue;
+        }
+        snprintf(label, sizeof(label), "[%s] %s", pipelineA->config.serial, i%2 == 0 ? "Rx" : "Tx");
+        checkCpuIsolation(cpuA, label);
+
+        for(int j = i+1; j<numPipelines*2; j++){
+            radioPipeline_t *pipelineB = &pipelines[j/2];
+            bool enabledB = j%2 == 0 ? pipelineB->rxEnabled : pipelineB->txEnabled;
+            int cpuB = j%2 == 0 ? pipelineB->config.rxCpu : pipelineB->config.txCpu;
+            if(enabledB && cpuA == cpuB){
+                printf("Warning: [%s] %s and [%s] %s are both pinned to CPU %d\n",
+                       pipelineA->config.serial, i%2 == 0 ? "Rx" : "Tx",
+                       pipelineB->config.serial, j%2 == 0 ? "Rx" : "Tx", cpuA);
+            }
+        }
+    }
+}
+
+void bringUpRadioPipelines(radioPipeline_t *pipelines, int numPipelines, statsSegment_t *stats, bool createFifos, bool print){
+    //Opening and configuring a board is dominated by USB round trips and RFIC settling.  Bring up the boards in parallel
+    struct timespec startTime, endTime;
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    pthread_t *threads = (pthread_t*) malloc(sizeof(pthread_t)*numPipelines);
+    for(int i = 0; i<numPipelines; i++){
+        initRadioDevice(&pipelines[i].device);
+        initConfigCache(&pipelines[i].cache);
+        pipelines[i].cacheValid = false;
+        memset(&pipelines[i].bringUpTiming, 0, sizeof(bringUpTiming_t));
+        pipelines[i].recorder = NULL;
+        pipelines[i].capture = NULL;
+        pipelines[i].hopper = NULL;
+        pipelines[i].rxTiming = NULL;
+        pipelines[i].trace = NULL;
+        pipelines[i].txTiming = NULL;
+        pipelines[i].print = print;
+        pipelines[i].rxRunning = false;
+        pipelines[i].txRunning = false;
+        initControlMailbox(&pipelines[i].rxControl);
+        initControlMailbox(&pipelines[i].txControl);
+        radioConfig_t *config = &pipelines[i].config;
+        statsPipeline_t *pipelineStats = &stats->pipelines[i];
+        pipelines[i].statsEntry = pipelineStats;
+        snprintf(pipelineStats->serial, STATS_SERIAL_STRLEN, "%s", config->serial);
+        pipelineStats->rxEnabled = radioConfigRxEnabled(config);
+        pipelineStats->txEnabled = radioConfigTxEnabled(config);
+        pipelineStats->numChannels = (uint32_t) config->numChannels;
+        pipelineStats->blockLen = (uint32_t) config->blockLen;
+        pipelineStats->rxSampRate = config->rxSampRate;
+        pipelineStats->txSampRate = config->txSampRate;
+        pipelines[i].rxStats = &pipelineStats->rx;
+        pipelines[i].txStats = &pipelineStats->tx;
+    }
+
+    //Creating the producer FIFOs does not involve the boards, so it is overlapped with the board configuration
+    fifoCreateArgs_t fifoArgs;
+    fifoArgs.pipelines = pipelines;
+    fifoArgs.numPipelines = createFifos ? numPipelines : 0;
+    pthread_t fifoThread;
+    int status = pthread_create(&fifoThread, NULL, createRadioPipelineFifos, &fifoArgs);
+    if (status != 0) {
+        printf("Could not create FIFO creation thread ... exiting");
+        errno = status;
+        perror(NULL);
+        exit(1);
+    }
+
+    for(int i = 0; i<numPipelines; i++){
+        if(print){
+            printf("[%s] Opening %s\n", pipelines[i].config.serial, pipelines[i].config.simulate ? "Simulated BladeRF" : "BladeRF");
+        }
+
+        status = pthread_create(&threads[i], NULL, bringUpRadioPipeline, &pipelines[i]);
+        if (status != 0) {
+            printf("Could not create bring-up thread ... exiting");
+            errno = status;
+            perror(NULL);
+            exit(1);
+        }
+    }
+
+    for(int i = 0; i<numPipelines; i++){
+        status = pthread_join(threads[i], NULL);
+        if (status != 0) {
+            printf("Could not join bring-up thread ... exiting");
+            errno = status;
+            perror(NULL);
+            exit(1);
+        }
+    }
+    free(threads);
+    status = pthread_join(fifoThread, NULL);
+    if (status != 0) {
+        printf("Could not join FIFO creation thread ... exiting");
+        errno = status;
+        perror(NULL);
+        exit(1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &endTime);
+
+    if(print){
+        for(int i = 0; i<numPipelines; i++){
+            bringUpTiming_t *timing = &pipelines[i].bringUpTiming;
+            printf("[%s] Bring-up: %.1f ms (Open %.1f, Channels %.1f with %d of %d steps cached, Corrections %.1f, Loopback %.1f, Hop Table %.1f), FIFOs %.1f ms\n",
+                   pipelines[i].config.serial, timing->total*1e3, timing->open*1e3, timing->channels*1e3, timing->channelStepsCached,
+                   timing->channelSteps, timing->corrections*1e3, timing->loopback*1e3, timing->hopTable*1e3, timing->fifos*1e3);
+        }
+        printf("Brought up %d BladeRF%s in %.1f ms\n", numPipelines, numPipelines == 1 ? "" : "s", difftimespec(&endTime, &startTime)*1e3);
+    }
+
+    checkCpuAssignments(pipelines, numPipelines);
+}
+
+static void startPinnedThread(pthread_t *thread, void *(*threadFctn)(void *), void *args, int cpu, rtPolicy_t rtPolicy, int priority, char *label){
+    cpu_set_t cpuset;
+    pthread_attr_t attr;
+
+    int status = pthread_attr_init(&attr);
+    if (status != 0) {
+        printf("Could not create %s pthread attributes ... exiting", label);
+        exit(1);
+    }
+
+    //Set Thread CPU
+    if (cpu >= 0) {
+        CPU_ZERO(&cpuset); //Clear cpuset
+        CPU_SET(cpu, &cpuset); //Add CPU to cpuset
+        status = pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuset);//Set thread CPU affinity
+        if (status != 0) {
+            printf("Could not set %s thread core affinity ... exiting", label);
+            exit(1);
+        }
+
+        //The worker threads in libbladeRF should inherit the affinity mask of this thread
+        // "A new thread created by pthread_create(3) inherits a copy of its creator's CPU affinity mask." (https://linux.die.net/man/3/pthread_setaffinity_np)
+        //By default, will not set it to use a real time scheduler, especially SCHED_FIFO as that could potentially
+        //cause things to block.  A real time policy can be opted into with -rtPolicy (see below)
+
+        //Note that the worker thread is created in the call to sync_worker_init in src/streaming/sync_worker.c and
+        //no thread attributes are supplied to the call to pthread_create (NULL passed).  This should create the thread
+        //with the default attributes which I think should include the inherited affinity mask
+        // "If attr is NULL, then the thread is created with default attributes" (https://linux.die.net/man/3/pthread_create)
+
+        //Because of this, we don't need to
+        //The worker can be placed on a different CPU with -rxWorkerCpu/-txWorkerCpu (see placedBladeRFSyncConfig)
+    }
+
+    //Set Thread Scheduling Policy (opt-in)
+    setThreadAttrRTPolicy(&attr, rtPolicy, priority, label);
+
+    status = pthread_create(thread, &attr, threadFctn, args);
+    if (status == EPERM) {
+        printf("Could not create %s thread with %s policy, CAP_SYS_NICE (or an rtprio limit) is required ... exiting\n", label, rtPolicyToStr(rtPolicy));
+        exit(1);
+    }
+    if (status != 0) {
+        printf("Could not create %s thread ... exiting", label);
+        errno = status;
+        perror(NULL);
+        exit(1);
+    }
+
+    pthread_attr_destroy(&attr);
+}
+
+//The RF param as last changed at runtime (control socket), otherwise as configured
+static double radioPipelineRF(controlMailbox_t *control, controlParam_t param, double configured){
+    double value;
+    return controlMailboxLastRF(control, param, &value) ? value : configured;
+}
+
+//Opens the board again after a stream failure and applies the settings (see radioDeviceRecover).  The device is locked
+//so libbladeRF is called directly.  Configuration failures once the board is open still exit
+static bool reopenRadioPipelineDevice(radioDevice_t *device, void *args){
+    radioPipeline_t *pipeline = (radioPipeline_t*) args;
+    radioConfig_t *config = &pipeline->config;
+    if(config->simulate){
+        device->sim = simOpen(&config->sim, config->rxSampRate, config->txSampRate);
+        return true;
+    }
+
+    if(tryOpenBladeRF(&device->dev, config->serial) != 0){
+        return false;
+    }
+    if(pipeline->oversample){
+        int status = bladerf_enable_feature(device->dev, BLADERF_FEATURE_OVERSAMPLE, true);
+        if (status != 0) {
+            fprintf(stderr, "[%s] Failed to enable bladeRF oversample feature: %s\n", config->serial, bladerf_strerror(status));
+            exit(1);
+        }
+    }
+    for(int chan = 0; chan<config->numChannels; chan++) {
+        if(pipeline->txEnabled) {
+            configBladeRFChannel(device->dev, true, chan,
+                                 (bladerf_frequency) radioPipelineRF(&pipeline->txControl, CONTROL_FREQUENCY, config->txFreq),
+                                 (bladerf_bandwidth) radioPipelineRF(&pipeline->txControl, CONTROL_BANDWIDTH, config->txBW),
+                                 config->txSampRate,
+                                 (bladerf_gain) radioPipelineRF(&pipeline->txControl, CONTROL_GAIN, config->txGain), NULL, false);
+        }
+        if(pipeline->rxEnabled) {
+            configBladeRFChannel(device->dev, false, chan,
+                                 (bladerf_frequency) radioPipelineRF(&pipeline->rxControl, CONTROL_FREQUENCY, config->rxFreq),
+                                 (bladerf_bandwidth) radioPipelineRF(&pipeline->rxControl, CONTROL_BANDWIDTH, config->rxBW),
+                                 config->rxSampRate,
+                                 (bladerf_gain) radioPipelineRF(&pipeline->rxControl, CONTROL_GAIN, config->rxGain), NULL, false);
+        }
+    }
+    clearBladeRFCorrections(pipeline, device->dev, NULL);
+    setLoopback(device->dev, config->serial, config->enableLoopBack, NULL, false);
+    return true;
+}
+
+void startRadioPipeline(radioPipeline_t *pipeline, volatile bool *stop, bool print){
+    radioConfig_t *config = &pipeline->config;
+
+    //Only the streams of the Rx and Tx threads are counted (not autotune or measurement trials)
+    pipeline->device.rxStats = pipeline->rxStats;
+    pipeline->device.txStats = pipeline->txStats;
+
+    //The quick tunes of the hop table would need to be recomputed on the reopened board
+    if(config->recoveryTimeoutSec > 0 && pipeline->hopper == NULL){
+        radioDeviceSetRecovery(&pipeline->device, reopenRadioPipelineDevice, pipeline, config->recoveryTimeoutSec, config->serial);
+        //A stream call holds the device read lock: one that never times out would keep the other direction from reopening
+        //the device (and a stuck stream would never be seen as a failure)
+        if(config->rxBladeRFTimeout == 0){
+            config->rxBladeRFTimeout = RADIO_RECOVERY_STREAM_TIMEOUT;
+            if(print){
+                printf("[%s] Using a %d ms Rx stream timeout since stream failures are recovered\n", config->serial, RADIO_RECOVERY_STREAM_TIMEOUT);
+            }
+        }
+        if(config->txBladeRFTimeout == 0){
+            config->txBladeRFTimeout = RADIO_RECOVERY_STREAM_TIMEOUT;
+            if(print){
+                printf("[%s] Using a %d ms Tx stream timeout since stream failures are recovered\n", config->serial, RADIO_RECOVERY_STREAM_TIMEOUT);
+            }
+        }
+    }else if(config->recoveryTimeoutSec > 0 && print){
+        printf("[%s] Stream failures are not recovered while hopping\n", config->serial);
+    }
+
+    //Create Thread Args
+    txThreadArgs_t *txThreadArgs = &pipeline->txThreadArgs;
+    txThreadArgs->numChannels = config->numChannels;
+    txThreadArgs->blockLen = config->blockLen;
+    txThreadArgs->fifoSizeBlocks = config->fifoSize;
+    txThreadArgs->stop = stop;
+    txThreadArgs->print = print;
+    txThreadArgs->device = &pipeline->device;
+    txThreadArgs->sampleFormat = config->sampleFormat;
+    txThreadArgs->fullRangeValue = config->fullScaleValue;
+    txThreadArgs->saturate = config->saturate;
+    txThreadArgs->bladeRFBlockLen = config->txBladeRFBlockLen;
+    txThreadArgs->bladeRFNumBuffers = config->txBladeRFNumBuffers;
+    txThreadArgs->bladeRFNumTransfers = config->txBladeRFNumTransfers;
+    txThreadArgs->bladeRFTimeout = config->txBladeRFTimeout;
+    txThreadArgs->sampRate = config->txSampRate;
+    txThreadArgs->rtPolicy = config->rtPolicy;
+    txThreadArgs->workerCpu = config->txWorkerCpu;
+    txThreadArgs->workerPriority = config->txWorkerPriority;
+    txThreadArgs->burstMode = config->txBurst;
+    txThreadArgs->burstLeadSamples = config->txBurstLead;
+    txThreadArgs->stats = pipeline->txStats;
+    if(pipeline->txEnabled){
+        pipeline->txTiming = stageTimingCreate("Tx", true);
+    }
+    txThreadArgs->timing = pipeline->txTiming;
+    txThreadArgs->trace = NULL;
+    if(pipeline->txEnabled && pipeline->trace != NULL){
+        char trackName[MAX_SERIAL_NUM_STRLEN+8];
+        snprintf(trackName, sizeof(trackName), "%s Tx", config->serial);
+        txThreadArgs->trace = eventTraceAddBuffer(pipeline->trace, trackName);
+    }
+    txThreadArgs->control = &pipeline->txControl;
+    txThreadArgs->hopper = pipeline->hopper != NULL && hopperTxMarkers(pipeline->hopper) ? pipeline->hopper : NULL;
+    txThreadArgs->underflowPolicy = config->txUnderflowPolicy;
+    if(config->txUnderflowDeadline_us > 0){
+        txThreadArgs->underflowDeadlineSec = config->txUnderflowDeadline_us*1e-6;
+    }else{
+        //The time it takes to transmit one libbladeRF buffer
+        txThreadArgs->underflowDeadlineSec = (double) (config->txBladeRFBlockLen/config->numChannels)/config->txSampRate;
+    }
+    txThreadArgs->flushIdleSec = config->txFlushIdle_us*1e-6;
+    txThreadArgs->feedbackFifos = pipeline->txFeedbackFifos;
+    for(int chan = 0; chan<BLADERF_MAX_CHANNELS; chan++) {
+        txThreadArgs->txSharedName[chan] = config->txSharedName[chan];
+        txThreadArgs->txFeedbackSharedName[chan] = config->txFeedbackSharedName[chan];
+        txThreadArgs->dcOffsetI[chan] = config->txDCOffsetI[chan];
+        txThreadArgs->dcOffsetQ[chan] = config->txDCOffsetQ[chan];
+        txThreadArgs->iqGain[chan] = config->txIQGain[chan];
+        txThreadArgs->iqPhase_deg[chan] = config->txIQPhase_deg[chan];
+    }
+
+    rxThreadArgs_t *rxThreadArgs = &pipeline->rxThreadArgs;
+    rxThreadArgs->numChannels = config->numChannels;
+    rxThreadArgs->blockLen = config->blockLen;
+    rxThreadArgs->fifoSizeBlocks = config->fifoSize;
+    rxThreadArgs->stop = stop;
+    rxThreadArgs->print = print;
+    rxThreadArgs->device = &pipeline->device;
+    rxThreadArgs->sampleFormat = config->sampleFormat;
+    rxThreadArgs->fullRangeValue = config->fullScaleValue;
+    rxThreadArgs->bladeRFBlockLen = config->rxBladeRFBlockLen;
+    rxThreadArgs->bladeRFNumBuffers = config->rxBladeRFNumBuffers;
+    rxThreadArgs->bladeRFNumTransfers = config->rxBladeRFNumTransfers;
+    rxThreadArgs->bladeRFTimeout = config->rxBladeRFTimeout;
+    rxThreadArgs->sampRate = config->rxSampRate;
+    rxThreadArgs->rtPolicy = config->rtPolicy;
+    rxThreadArgs->workerCpu = config->rxWorkerCpu;
+    rxThreadArgs->workerPriority = config->rxWorkerPriority;
+    rxThreadArgs->stats = pipeline->rxStats;
+    if(pipeline->rxEnabled){
+        pipeline->rxTiming = stageTimingCreate("Rx", false);
+    }
+    rxThreadArgs->timing = pipeline->rxTiming;
+    rxThreadArgs->trace = NULL;
+    if(pipeline->rxEnabled && pipeline->trace != NULL){
+        char trackName[MAX_SERIAL_NUM_STRLEN+8];
+        snprintf(trackName, sizeof(trackName), "%s Rx", config->serial);
+        rxThreadArgs->trace = eventTraceAddBuffer(pipeline->trace, trackName);
+    }
+    rxThreadArgs->control = &pipeline->rxControl;
+    rxThreadArgs->overflowPolicy = config->rxOverflowPolicy;
+    rxThreadArgs->overflowBacklogBlocks = config->rxOverflowBacklog;
+    rxThreadArgs->blockHeader = config->rxBlockHeader;
+    rxThreadArgs->fifos = pipeline->rxFifos;
+    if(pipeline->rxEnabled && config->record.format != RECORD_NONE){
+        pipeline->recorder = recorderOpen(&config->record, config->numChannels, config->sampleFormat, config->rxSampRate,
+                                          config->rxFreq, config->serial, print);
+    }
+    rxThreadArgs->recorder = pipeline->recorder;
+    rxThreadArgs->recordFormat = pipeline->recorder != NULL ? config->record.format : RECORD_NONE;
+    if(pipeline->rxEnabled && config->capture.path != NULL){
+        pipeline->capture = captureOpen(&config->capture, config->numChannels, config->sampleFormat, config->rxSampRate,
+                                        config->rxFreq, config->serial, print);
+    }
+    rxThreadArgs->capture = pipeline->capture;
+    for(int chan = 0; chan<BLADERF_MAX_CHANNELS; chan++) {
+        rxThreadArgs->rxSharedName[chan] = config->rxSharedName[chan];
+        rxThreadArgs->dcOffsetI[chan] = config->rxDCOffsetI[chan];
+        rxThreadArgs->dcOffsetQ[chan] = config->rxDCOffsetQ[chan];
+        rxThreadArgs->iqGain[chan] = config->rxIQGain[chan];
+        rxThreadArgs->iqPhase_deg[chan] = config->rxIQPhase_deg[chan];
+    }
+
+    //Start Threads
+    if(pipeline->txEnabled) {
+        startPinnedThread(&pipeline->txThreadHandle, txThread, txThreadArgs, config->txCpu, config->rtPolicy, config->txPriority, "Tx");
+        pipeline->txRunning = true;
+    }else{
+        controlMailboxClose(&pipeline->txControl);
+    }
+    if(pipeline->rxEnabled) {
+        startPinnedThread(&pipeline->rxThreadHandle, rxThread, rxThreadArgs, config->rxCpu, config->rtPolicy, config->rxPriority, "Rx");
+        pipeline->rxRunning = true;
+    }else{
+        controlMailboxClose(&pipeline->rxControl);
+    }
+    if(pipeline->hopper != NULL){
+        hopperStart(pipeline->hopper, pipeline->rxStats, pipeline->txStats, stop);
+    }
+}
+
+bool pollRadioPipeline(radioPipeline_t *pipeline){
+    void *res;
+    if(pipeline->txRunning){
+        int status = pthread_tryjoin_np(pipeline->txThreadHandle, &res);
+        if(status == 0){
+            pipeline->txRunning = false;
+            controlMailboxClose(&pipeline->txControl);
+        }else if(status != EBUSY){
+            printf("Could not join Tx thread ... exiting");
+            errno = status;
+            perror(NULL);
+            exit(1);
+        }
+    }
+    if(pipeline->rxRunning){
+        int status = pthread_tryjoin_np(pipeline->rxThreadHandle, &res);
+        if(status == 0){
+            pipeline->rxRunning = false;
+            controlMailboxClose(&pipeline->rxControl);
+        }else if(status != EBUSY){
+            printf("Could not join Rx thread ... exiting");
+            errno = status;
+            perror(NULL);
+            exit(1);
+        }
+    }
+
+    return !pipeline->txRunning && !pipeline->rxRunning;
+}
+
+//Frees what startRadioPipeline created.  The threads have been joined
+static void releaseRadioPipelineThreads(radioPipeline_t *pipeline){
+    //The Rx thread has stopped writing to the recording and the capture ring
+    if(pipeline->recorder != NULL){
+        recorderClose(pipeline->recorder);
+        pipeline->recorder = NULL;
+    }
+    if(pipeline->capture != NULL){
+        captureClose(pipeline->capture);
+        pipeline->capture = NULL;
+    }
+    stageTimingFree(pipeline->rxTiming);
+    stageTimingFree(pipeline->txTiming);
+    pipeline->rxTiming = NULL;
+    pipeline->txTiming = NULL;
+}
+
+void closeRadioPipeline(radioPipeline_t *pipeline){
+    releaseRadioPipelineThreads(pipeline);
+    if(pipeline->hopper != NULL){
+        hopperClose(pipeline->hopper);
+        pipeline->hopper = NULL;
+    }
+    //Only saved if the board still has the settings applied at bring-up
+    bool rfChanged = controlMailboxRFChanged(&pipeline->rxControl) || controlMailboxRFChanged(&pipeline->txControl);
+    if(pipeline->config.configCacheDir != NULL && pipeline->cacheValid && !rfChanged){
+        configCacheSave(pipeline->config.configCacheDir, pipeline->config.serial, &pipeline->cache);
+    }
+    radioDeviceClose(&pipeline->device, pipeline->config.serial, pipeline->print);
+}
+
+bool startRadioPipelineSession(radioPipeline_t *pipeline, radioConfig_t *session, volatile bool *stop, char *err, size_t errLen){
+    bool rxEnabled = radioConfigRxEnabled(session);
+    bool txEnabled = radioConfigTxEnabled(session);
+
+    //A stream failure the previous session could not recover from (see radioDeviceRecover) left the board closed
+    if(!radioDeviceIsOpen(&pipeline->device)){
+        if(!reopenRadioPipelineDevice(&pipeline->device, pipeline)){
+            snprintf(err, errLen, "unable to reopen the board");
+            return false;
+        }
+        initConfigCache(&pipeline->cache);
+    }
+
+    //Check the settings before changing anything (configuring the board exits on a rejected setting)
+    if(!session->simulate){
+        if(radioConfigNeedsOversample(session, rxEnabled, txEnabled) != pipeline->oversample){
+            snprintf(err, errLen, "sample rates above %d require -format sc8 and are set when the daemon starts",
+                     BLADERF_MAX_SAMP_RATE_SC16);
+            return false;
+        }
+        for(int chan = 0; chan<session->numChannels; chan++) {
+            if(txEnabled && !checkBladeRFChannelRanges(pipeline->device.dev, true, chan, session->txFreq, session->txBW,
+                                                       session->txSampRate, session->txGain, err, errLen)){
+                return false;
+            }
+            if(rxEnabled && !checkBladeRFChannelRanges(pipeline->device.dev, false, chan, session->rxFreq, session->rxBW,
+                                                       session->rxSampRate, session->rxGain, err, errLen)){
+                return false;
+            }
+        }
+    }
+
+    radioConfig_t *config = &pipeline->config;
+    bringUpTiming_t *timing = &pipeline->bringUpTiming;
+    memset(timing, 0, sizeof(bringUpTiming_t));
+    struct timespec startTime, endTime;
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    *config = *session;
+    pipeline->rxEnabled = rxEnabled;
+    pipeline->txEnabled = txEnabled;
+
+    //No threads are using the device between sessions
+    if(config->simulate){
+        //The simulated board takes the sample rates when it is opened
+        simClose(pipeline->device.sim, config->serial, false);
+        pipeline->device.sim = simOpen(&config->sim, config->rxSampRate, config->txSampRate);
+    }else{
+        //The board has been held open since the last session, so the cache is current (it is cleared at the end of a
+        //session with runtime changes)
+        configCache_t *cache = &pipeline->cache;
+        for(int chan = 0; chan<config->numChannels; chan++) {
+            if(txEnabled) {
+                timing->channelStepsCached += configBladeRFChannel(pipeline->device.dev, true, chan, config->txFreq, config->txBW, config->txSampRate, config->txGain,
+                                                                   &cache->tx[chan], false);
+                timing->channelSteps += 4;
+            }
+            if(rxEnabled) {
+                timing->channelStepsCached += configBladeRFChannel(pipeline->device.dev, false, chan, config->rxFreq, config->rxBW, config->rxSampRate, config->rxGain,
+                                                                   &cache->rx[chan], false);
+                timing->channelSteps += 4;
+            }
+        }
+        clearBladeRFCorrections(pipeline, pipeline->device.dev, cache);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &endTime);
+    timing->channels = difftimespec(&endTime, &startTime);
+
+    statsPipeline_t *entry = pipeline->statsEntry;
+    entry->rxEnabled = rxEnabled;
+    entry->txEnabled = txEnabled;
+    entry->numChannels = (uint32_t) config->numChannels;
+    entry->blockLen = (uint32_t) config->blockLen;
+    entry->rxSampRate = config->rxSampRate;
+    entry->txSampRate = config->txSampRate;
+
+    controlMailboxReopen(&pipeline->rxControl);
+    controlMailboxReopen(&pipeline->txControl);
+    openRadioPipelineFifos(pipeline);
+    startRadioPipeline(pipeline, stop, pipeline->print);
+    clock_gettime(CLOCK_MONOTONIC, &endTime);
+    timing->total = difftimespec(&endTime, &startTime);
+    return true;
+}
+
+void detachRadioPipelineConsumers(radioPipeline_t *pipeline){
+    for(int chan = 0; chan<pipeline->config.numChannels; chan++) {
+        if(pipeline->rxEnabled){
+            producerDetachConsumer(&pipeline->rxFifos[chan]);
+        }
+        if(pipeline->txEnabled){
+            producerDetachConsumer(&pipeline->txFeedbackFifos[chan]);
+        }
+    }
+}
+
+void endRadioPipelineSession(radioPipeline_t *pipeline){
+    releaseRadioPipelineThreads(pipeline);
+    for(int chan = 0; chan<pipeline->config.numChannels; chan++) {
+        if(pipeline->rxEnabled){
+            cleanupProducer(&pipeline->rxFifos[chan]);
+        }
+        if(pipeline->txEnabled){
+            cleanupProducer(&pipeline->txFeedbackFifos[chan]);
+        }
+    }
+    //The board no longer has the settings in the cache
+    if(controlMailboxRFChanged(&pipeline->rxControl) || controlMailboxRFChanged(&pipeline->txControl)){
+        initConfigCache(&pipeline->cache);
+    }
+}
+
+void reportRadioPipelineStageTiming(radioPipeline_t *pipelines, int numPipelines){
+#ifdef STAGE_TIMING
+    printf("---- Stage Timing (%d BladeRF%s) ----\n", numPipelines, numPipelines == 1 ? "" : "s");
+    for(int i = 0; i<numPipelines; i++){
+        stageTimingReport(pipelines[i].rxTiming, pipelines[i].config.serial);
+        stageTimingReport(pipelines[i].txTiming, pipelines[i].config.serial);
+    }
+#else
+    (void) pipelines;
+    (void) numPipelines;
+    printf("Stage timing is not built in (configure with -DSTAGE_TIMING=ON)\n");
+#endif
+}
+
+void reportRadioPipelineStatus(radioPipeline_t *pipelines, int numPipelines, uint64_t *prevSamples, double intervalSec){
+    printf("---- Status (%d BladeRF%s) ----\n", numPipelines, numPipelines == 1 ? "" : "s");
+    for(int i = 0; i<numPipelines; i++){
+        radioPipeline_t *pipeline = &pipelines[i];
+        uint64_t rxSamples = atomic_load_explicit(&pipeline->rxStats->samplesTransferred, memory_order_relaxed);
+        uint64_t txSamples = atomic_load_explicit(&pipeline->txStats->samplesTransferred, memory_order_relaxed);
+        double rxRate = (rxSamples - prevSamples[2*i  ])/intervalSec/1e6;
+        double txRate = (txSamples - prevSamples[2*i+1])/intervalSec/1e6;
+        prevSamples[2*i  ] = rxSamples;
+        prevSamples[2*i+1] = txSamples;
+
+        printf("[%s]", pipeline->config.serial);
+        if(pipeline->rxEnabled){
+            printf(" Rx: %8.3f MS/s, %12lu Samples (%s)", rxRate, rxSamples,
+                   pipeline->rxRunning ? "Running" : "Stopped");
+            //Blocks are also dropped while no consumer is attached (with any overflow policy)
+            uint64_t rxDropped = atomic_load_explicit(&pipeline->rxStats->samplesDropped, memory_order_relaxed);
+            if(pipeline->config.rxOverflowPolicy != RX_OVERFLOW_BLOCK || rxDropped > 0){
+                printf(" Dropped: %lu Samples (%lu Blocks)", rxDropped,
+                       atomic_load_explicit(&pipeline->rxStats->blocksDropped, memory_order_relaxed));
+            }
+            uint64_t rxClipped = atomic_load_explicit(&pipeline->rxStats->samplesClipped, memory_order_relaxed);
+            if(rxClipped > 0){
+                printf(" Clipped: %lu", rxClipped);
+            }
+            uint64_t rxHops = atomic_load_explicit(&pipeline->rxStats->hops, memory_order_relaxed);
+            if(rxHops > 0){
+                printf(" Hops: %lu (Missed %lu)", rxHops, atomic_load_explicit(&pipeline->rxStats->hopsMissed, memory_order_relaxed));
+            }
+            uint64_t rxRecoveries = atomic_load_explicit(&pipeline->rxStats->recoveries, memory_order_relaxed);
+            if(rxRecoveries > 0){
+                printf(" Recoveries: %lu (Max %.1f ms)", rxRecoveries, atomic_load_explicit(&pipeline->rxStats->recoveryMaxNs, memory_order_relaxed)/1e6);
+            }
+        }
+        if(pipeline->txEnabled){
+            printf(" Tx: %8.3f MS/s, %12lu Samples (%s)", txRate, txSamples,
+                   pipeline->txRunning ? "Running" : "Stopped");
+            if(pipeline->config.txUnderflowPolicy != TX_UNDERFLOW_WAIT){
+                printf(" Underflows: %lu (%lu Samples Inserted)",
+                       atomic_load_explicit(&pipeline->txStats->underflows, memory_order_relaxed),
+                       atomic_load_explicit(&pipeline->txStats->samplesInserted, memory_order_relaxed));
+            }
+            if(pipeline->config.txFlushIdle_us > 0){
+                printf(" Flushes: %lu", atomic_load_explicit(&pipeline->txStats->flushes, memory_order_relaxed));
+            }
+            uint64_t txClipped = atomic_load_explicit(&pipeline->txStats->samplesClipped, memory_order_relaxed);
+            if(txClipped > 0){
+                printf(" Clipped: %lu", txClipped);
+            }
+            uint64_t txHops = atomic_load_explicit(&pipeline->txStats->hops, memory_order_relaxed);
+            if(txHops > 0){
+                printf(" Hops: %lu (Missed %lu)", txHops, atomic_load_explicit(&pipeline->txStats->hopsMissed, memory_order_relaxed));
+            }
+            uint64_t txRecoveries = atomic_load_explicit(&pipeline->txStats->recoveries, memory_order_relaxed);
+            if(txRecoveries > 0){
+                printf(" Recoveries: %lu (Max %.1f ms)", txRecoveries, atomic_load_explicit(&pipeline->txStats->recoveryMaxNs, memory_order_relaxed)/1e6);
+            }
+        }
+        printf("\n");
+    }
+}
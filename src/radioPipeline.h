@@ -0,0 +1,243 @@
+//
+// A radio pipeline is a single bladeRF board with its Rx and/or Tx threads and Shared Memory FIFOs
+//
+
+#ifndef BLADERFTOFIFO_RADIOPIPELINE_H
+#define BLADERFTOFIFO_RADIOPIPELINE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include <libbladeRF.h>
+
+#include "helpers.h"
+#include "pipelineStats.h"
+#include "statsSegment.h"
+#include "rtPolicy.h"
+#include "radioDevice.h"
+#include "simDevice.h"
+#include "recorder.h"
+#include "capture.h"
+#include "hopper.h"
+#include "eventTrace.h"
+#include "controlMailbox.h"
+#include "configCache.h"
+#include "rxThread.h"
+#include "txThread.h"
+
+#define MAX_SERIAL_NUM_STRLEN (100)
+#define TX_LOW_LATENCY_FLUSH_IDLE (50) //us
+#define RADIO_DEFAULT_RECOVERY_TIMEOUT (10.0) //s
+#define RADIO_RECOVERY_STREAM_TIMEOUT (1000) //ms, replaces a stream timeout of 0 (none) while recovery is enabled
+
+//Settings for a single bladeRF board.
+//The Rx direction is enabled when rxSharedName is supplied and the Tx direction is enabled when txSharedName and
+//txFeedbackSharedName are supplied.
+typedef struct{
+    char serial[MAX_SERIAL_NUM_STRLEN+1];
+
+    //Shared Memory FIFO Params (per channel)
+    int numChannels;
+    char *rxSharedName[BLADERF_MAX_CHANNELS];
+    char *txSharedName[BLADERF_MAX_CHANNELS];
+    char *txFeedbackSharedName[BLADERF_MAX_CHANNELS];
+    int32_t blockLen;
+    int32_t fifoSize;
+
+    int txCpu;
+    int rxCpu;
+
+    //Real-time scheduling (opt-in)
+    rtPolicy_t rtPolicy;
+    int txPriority;
+    int rxPriority;
+    //The libbladeRF worker threads (one per direction) can be placed on their own CPUs and priorities (-1 to inherit from the Rx/Tx thread)
+    int txWorkerCpu;
+    int rxWorkerCpu;
+    int txWorkerPriority;
+    int rxWorkerPriority;
+
+    //RF Params
+    int txGain;
+    int rxGain;
+    unsigned long txFreq;
+    unsigned long rxFreq;
+    unsigned int txSampRate;
+    unsigned int rxSampRate;
+    unsigned int txBW;
+    unsigned int rxBW;
+    bool enableLoopBack;
+
+    sampleFormat_t sampleFormat;
+    SAMPLE_COMPONENT_DATATYPE fullScaleValue;
+    bool saturate;
+
+    bool txBurst;
+    unsigned long txBurstLead;
+
+    //Behavior when the Rx FIFO consumer falls behind
+    rxOverflowPolicy_t rxOverflowPolicy;
+    int rxOverflowBacklog; //Blocks held locally with dropOldest
+    bool rxBlockHeader;
+
+    //Disk recording of the Rx stream
+    recordConfig_t record;
+
+    //Pre-trigger capture of the Rx stream
+    captureConfig_t capture;
+
+    //Frequency hopping
+    hopConfig_t hop;
+
+    //Behavior when the Tx FIFO producer misses its deadline (streaming mode)
+    txUnderflowPolicy_t txUnderflowPolicy;
+    double txUnderflowDeadline_us; //0 for the duration of one libbladeRF Tx buffer
+    double txFlushIdle_us; //Pad and send a partial libbladeRF Tx buffer after the Tx FIFO is idle this long (0 to disable)
+
+    //libbladeRF stream buffers (per direction)
+    //The block length is in samples (across all channels) and needs to be a multiple of 1024.
+    //The number of transfers needs to be less than the number of buffers.
+    int rxBladeRFBlockLen;
+    int rxBladeRFNumBuffers;
+    int rxBladeRFNumTransfers;
+    unsigned int rxBladeRFTimeout; //Stream timeout (ms)
+    int txBladeRFBlockLen;
+    int txBladeRFNumBuffers;
+    int txBladeRFNumTransfers;
+    unsigned int txBladeRFTimeout; //Stream timeout (ms), 0 for no timeout (see RADIO_RECOVERY_STREAM_TIMEOUT)
+
+    //I/Q and DC Offset Corrections (per channel)
+    double txDCOffsetI[BLADERF_MAX_CHANNELS];
+    double txDCOffsetQ[BLADERF_MAX_CHANNELS];
+    double rxDCOffsetI[BLADERF_MAX_CHANNELS];
+    double rxDCOffsetQ[BLADERF_MAX_CHANNELS];
+    double txIQGain[BLADERF_MAX_CHANNELS];
+    double txIQPhase_deg[BLADERF_MAX_CHANNELS];
+    double rxIQGain[BLADERF_MAX_CHANNELS];
+    double rxIQPhase_deg[BLADERF_MAX_CHANNELS];
+
+    //Directory of the configuration cache (NULL to always configure every setting), see configCache.h
+    char *configCacheDir;
+
+    //After a stream failure (ex. a USB error), try to reopen the board for this long (0 to stop the pipeline instead).
+    //See radioDeviceRecover
+    double recoveryTimeoutSec;
+
+    //A Rx/Tx feedback FIFO consumer that has not read for this long while the FIFO is full is treated as detached (0 to
+    //only detach consumers that exit).  See producerConsumerAttached
+    double consumerTimeoutSec;
+
+    //Stream a simulated bladeRF instead of a board (the RF params other than the sample rates are ignored)
+    bool simulate;
+    simConfig_t sim;
+} radioConfig_t;
+
+//Where the bring-up time went (seconds)
+typedef struct{
+    double open;
+    double channels;
+    int channelSteps; //Set/get steps of the channel configuration
+    int channelStepsCached; //Skipped because the configuration cache showed they were already applied
+    double corrections;
+    double loopback;
+    double hopTable;
+    double total;
+    double fifos; //Creating the producer FIFOs (overlapped with the board configuration)
+} bringUpTiming_t;
+
+typedef struct{
+    radioConfig_t config;
+    radioDevice_t device;
+    recorder_t *recorder; //Rx recording tap (NULL if not recording)
+    capture_t *capture; //Rx pre-trigger capture (NULL if not capturing)
+    hopper_t *hopper; //Frequency hopping (NULL if not hopping)
+    eventTrace_t *trace; //Block lifecycle tracing, shared by the pipelines (NULL if not tracing).  Set before starting
+    configCache_t cache; //Settings applied to the board (saved at a clean exit if the board still has them)
+    bool cacheValid; //False once the settings are changed at runtime (control socket, hopping)
+    bringUpTiming_t bringUpTiming;
+    bool oversample; //The oversample feature was enabled at bring-up
+    statsPipeline_t *statsEntry; //Description of the board in the stats segment
+    bool print;
+    bool rxEnabled;
+    bool txEnabled;
+
+    rxThreadArgs_t rxThreadArgs;
+    txThreadArgs_t txThreadArgs;
+    pipelineStats_t *rxStats; //In the stats segment
+    pipelineStats_t *txStats;
+    stageTiming_t *rxTiming; //NULL when built without STAGE_TIMING
+    stageTiming_t *txTiming;
+    controlMailbox_t rxControl; //Runtime changes from the control socket (closed once the thread exits)
+    controlMailbox_t txControl;
+
+    //Producer side of the Rx and Tx feedback FIFOs (created during bring-up)
+    sharedMemoryFIFO_t rxFifos[BLADERF_MAX_CHANNELS];
+    sharedMemoryFIFO_t txFeedbackFifos[BLADERF_MAX_CHANNELS];
+
+    pthread_t rxThreadHandle;
+    pthread_t txThreadHandle;
+    bool rxRunning; //Thread started and not yet joined
+    bool txRunning;
+} radioPipeline_t;
+
+//Sets the default settings
+void initRadioConfig(radioConfig_t *config);
+
+//Latency-bounded Tx: small libbladeRF Tx buffers and a partial buffer flush (-txLowLatency).  The Rx is unchanged.
+void applyTxLowLatencyPreset(radioConfig_t *config);
+
+bool radioConfigRxEnabled(radioConfig_t *config);
+
+//True if either Tx FIFO is given.  Both are then required (a half-specified Tx is rejected, not disabled)
+bool radioConfigTxEnabled(radioConfig_t *config);
+
+//Parses a device list file.  Each non-empty line (that does not start with #) describes one bladeRF board as a list of
+//key=value pairs separated by whitespace.  Unspecified settings are taken from defaults.  Returns the number of devices
+//and allocates the array of configurations.  The FIFOs may be omitted if requireFifos is false (-daemon)
+int parseRadioConfigFile(char *path, radioConfig_t *defaults, radioConfig_t **configs, bool requireFifos);
+
+void printRadioConfigFileHelp();
+
+//Parses a block length (in samples) or FIFO size (in blocks), which must be a positive integer.  Returns false if str is
+//not one
+bool parseRadioConfigCount(char *str, int32_t *count);
+
+//Checks the settings which cannot be checked as they are parsed.  Exits with an error message if invalid.
+void validateRadioConfig(radioConfig_t *config);
+
+//Opens and configures the bladeRF boards of each pipeline.  The boards are brought up in parallel while the producer
+//FIFOs are created (unless createFifos is false, see startRadioPipelineSession).  The counters of pipeline i are in
+//stats->pipelines[i]
+void bringUpRadioPipelines(radioPipeline_t *pipelines, int numPipelines, statsSegment_t *stats, bool createFifos, bool print);
+
+//Starts the Rx and Tx threads of the pipeline (pinned to the configured CPUs)
+void startRadioPipeline(radioPipeline_t *pipeline, volatile bool *stop, bool print);
+
+//Joins the threads of the pipeline that have exited.  Returns true once all threads of the pipeline have been joined.
+bool pollRadioPipeline(radioPipeline_t *pipeline);
+
+//Saves the configuration cache (if enabled and the board still has the configured settings) and closes the board
+void closeRadioPipeline(radioPipeline_t *pipeline);
+
+//---- Sessions (-daemon) ----
+//The board stays open between sessions.  A session replaces the settings of the pipeline with session (which owns the
+//FIFO names until endRadioPipelineSession), applies the channel settings that differ from the previous session, creates
+//the producer FIFOs, and starts the threads.  Returns false with a message in err (and nothing changed) if the session
+//has settings the board does not support.  The time it took is in bringUpTiming
+bool startRadioPipelineSession(radioPipeline_t *pipeline, radioConfig_t *session, volatile bool *stop, char *err, size_t errLen);
+
+//Releases threads waiting for a FIFO consumer to join or to make room.  Call after setting the stop flag of the session
+void detachRadioPipelineConsumers(radioPipeline_t *pipeline);
+
+//Frees what the session created and removes its producer FIFOs.  Call once pollRadioPipeline returns true
+void endRadioPipelineSession(radioPipeline_t *pipeline);
+
+//Prints one line per pipeline with the rates since the last report.  prevSamples should have 2 entries (Rx, Tx) per pipeline
+//and is updated by the call.
+void reportRadioPipelineStatus(radioPipeline_t *pipelines, int numPipelines, uint64_t *prevSamples, double intervalSec);
+
+//Prints the latency percentiles of each stage of the Rx and Tx threads (see stageTiming.h)
+void reportRadioPipelineStageTiming(radioPipeline_t *pipelines, int numPipelines);
+
+#endif //BLADERFTOFIFO_RADIOPIPELINE_H
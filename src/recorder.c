@@ -0,0 +1,519 @@
+//
+// Disk recording tap for the Rx stream
+//
+
+#define _GNU_SOURCE //O_DIRECT and fallocate
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "recorder.h"
+#include "iqCodec.h"
+
+#define RECORD_CHUNK_BYTES (4*1024*1024) //Size of each write.  A multiple of the O_DIRECT alignment and of every frame size
+#define RECORD_DIRECT_ALIGNMENT (4096)
+#define RECORD_MAX_CAPTURES (4096) //SigMF capture segments (one per discontinuity)
+#define RECORD_WRITER_POLL_US (1000)
+#define RECORD_COMPRESS_TURN_POLL_US (100)
+
+typedef struct{
+    uint64_t sampleStart; //Index in the recording
+    uint64_t globalIndex; //Index in the stream
+} recordCapture_t;
+
+struct recorder_s{
+    recordFormat_t format;
+    char *dataPath;
+    char *metaPath;
+    char *label;
+    bool print;
+    int numChannels;
+    sampleFormat_t sampleFormat;
+    unsigned int sampRate;
+    unsigned long freq;
+    size_t frameBytes; //One sample of every channel
+    struct timespec startTime;
+    char startDatetime[32];
+
+    int fd;
+    bool direct;
+
+    //Ring (head and tail count bytes since the start of the recording)
+    uint8_t *ring;
+    size_t ringBytes;
+    _Atomic uint64_t head; //Written by the Rx thread
+    _Atomic uint64_t tail; //Written by the writer thread
+    atomic_bool stopWriter;
+    atomic_bool writeFailed;
+    pthread_t writerThread;
+
+    //RECORD_COMPRESSED: the workers claim whole ring chunks, compress them in parallel, and take turns (in chunk order)
+    //appending them to the stage, which is written in aligned chunks
+    int numWorkers;
+    pthread_t *workerThreads;
+    size_t maxEncodedBytes; //A compressed chunk, including its header
+    _Atomic uint64_t nextChunk; //Next ring chunk to claim
+    _Atomic uint64_t chunksAppended; //The worker holding this chunk appends next
+    uint8_t *stage;
+    size_t stageLen;
+    uint64_t stageOffset; //File offset of the start of the stage
+    uint64_t *chunkOffsets; //Index of the chunk headers
+    size_t numChunks;
+    size_t chunkOffsetsCapacity;
+
+    //Rx thread only (until the writer is stopped)
+    uint64_t expectedIndex;
+    bool started;
+    recordCapture_t captures[RECORD_MAX_CAPTURES];
+    int numCaptures;
+    uint64_t uncapturedDiscontinuities;
+    uint64_t samplesDropped;
+    uint64_t samplesRecorded;
+};
+
+bool parseRecordFormat(char *str, recordFormat_t *format){
+    if(strcmp(str, "raw") == 0){
+        *format = RECORD_RAW;
+    }else if(strcmp(str, "fifo") == 0){
+        *format = RECORD_FIFO;
+    }else if(strcmp(str, "compressed") == 0){
+        *format = RECORD_COMPRESSED;
+    }else{
+        return false;
+    }
+    return true;
+}
+
+void initRecordConfig(recordConfig_t *config){
+    config->format = RECORD_NONE;
+    config->path = NULL;
+    config->ringBytes = ((size_t) RECORD_DEFAULT_RING_MB)*1024*1024;
+    config->preallocBytes = ((size_t) RECORD_DEFAULT_PREALLOC_MB)*1024*1024;
+    config->compressThreads = RECORD_DEFAULT_COMPRESS_THREADS;
+}
+
+static char* recordSigMFDatatype(recorder_t *recorder){
+    if(recorder->format == RECORD_FIFO){
+        return "cf32_le";
+    }
+    return recorder->sampleFormat == SAMPLE_FORMAT_SC8_Q7 ? "ci8" : "ci16_le";
+}
+
+static void* recorderWriterThread(void *uncastArgs){
+    recorder_t *recorder = (recorder_t*) uncastArgs;
+    uint64_t tail = atomic_load_explicit(&recorder->tail, memory_order_relaxed);
+
+    //Only whole chunks are written here.  Since the ring is a multiple of the chunk size, chunks never wrap
+    while(true){
+        uint64_t head = atomic_load_explicit(&recorder->head, memory_order_acquire);
+        if(head - tail < RECORD_CHUNK_BYTES){
+            if(atomic_load_explicit(&recorder->stopWriter, memory_order_acquire)){
+                break;
+            }
+            usleep(RECORD_WRITER_POLL_US);
+            continue;
+        }
+
+        ssize_t written = pwrite(recorder->fd, recorder->ring + tail%recorder->ringBytes, RECORD_CHUNK_BYTES, (off_t) tail);
+        if(written != RECORD_CHUNK_BYTES){
+            fprintf(stderr, "[%s] Recording write failed: %s\n", recorder->label, written < 0 ? strerror(errno) : "short write");
+            atomic_store_explicit(&recorder->writeFailed, true, memory_order_release);
+            break;
+        }
+        tail += RECORD_CHUNK_BYTES;
+        atomic_store_explicit(&recorder->tail, tail, memory_order_release);
+    }
+
+    return NULL;
+}
+
+//Only called by the worker whose turn it is (or after the workers have stopped).  Writes the stage whenever it fills
+static bool recorderAppend(recorder_t *recorder, const void *data, size_t bytes){
+    const uint8_t *src = (const uint8_t*) data;
+    while(bytes > 0){
+        size_t room = RECORD_CHUNK_BYTES - recorder->stageLen;
+        size_t copyBytes = bytes < room ? bytes : room;
+        memcpy(recorder->stage + recorder->stageLen, src, copyBytes);
+        recorder->stageLen += copyBytes;
+        src += copyBytes;
+        bytes -= copyBytes;
+
+        if(recorder->stageLen == RECORD_CHUNK_BYTES){
+            ssize_t written = pwrite(recorder->fd, recorder->stage, RECORD_CHUNK_BYTES, (off_t) recorder->stageOffset);
+            if(written != RECORD_CHUNK_BYTES){
+                fprintf(stderr, "[%s] Recording write failed: %s\n", recorder->label, written < 0 ? strerror(errno) : "short write");
+                return false;
+            }
+            recorder->stageOffset += RECORD_CHUNK_BYTES;
+            recorder->stageLen = 0;
+        }
+    }
+    return true;
+}
+
+static bool recorderAppendChunk(recorder_t *recorder, const uint8_t *chunk, size_t bytes){
+    if(recorder->numChunks == recorder->chunkOffsetsCapacity){
+        size_t capacity = recorder->chunkOffsetsCapacity*2;
+        uint64_t *offsets = (uint64_t*) realloc(recorder->chunkOffsets, capacity*sizeof(uint64_t));
+        if(offsets == NULL){
+            fprintf(stderr, "[%s] Unable to grow the recording index\n", recorder->label);
+            return false;
+        }
+        recorder->chunkOffsets = offsets;
+        recorder->chunkOffsetsCapacity = capacity;
+    }
+    recorder->chunkOffsets[recorder->numChunks++] = recorder->stageOffset + recorder->stageLen;
+    return recorderAppend(recorder, chunk, bytes);
+}
+
+static void* recorderCompressThread(void *uncastArgs){
+    recorder_t *recorder = (recorder_t*) uncastArgs;
+    int numLanes = 2*recorder->numChannels;
+    int sampleBits = recorder->sampleFormat == SAMPLE_FORMAT_SC8_Q7 ? 8 : 16;
+    uint8_t *encoded = (uint8_t*) malloc(recorder->maxEncodedBytes);
+    iqChunkHeader_t *header = (iqChunkHeader_t*) encoded;
+
+    while(!atomic_load_explicit(&recorder->writeFailed, memory_order_acquire)){
+        //Claim the next chunk once it is full (or, when stopping, the remainder).  Chunks never wrap around the ring
+        uint64_t chunk = atomic_load_explicit(&recorder->nextChunk, memory_order_relaxed);
+        bool stop = atomic_load_explicit(&recorder->stopWriter, memory_order_acquire);
+        uint64_t head = atomic_load_explicit(&recorder->head, memory_order_acquire);
+        uint64_t chunkStart = chunk*RECORD_CHUNK_BYTES;
+        size_t bytes;
+        if(head >= chunkStart + RECORD_CHUNK_BYTES){
+            bytes = RECORD_CHUNK_BYTES;
+        }else if(stop && head > chunkStart){
+            bytes = head - chunkStart;
+        }else if(stop){
+            break;
+        }else{
+            usleep(RECORD_WRITER_POLL_US);
+            continue;
+        }
+        if(!atomic_compare_exchange_weak_explicit(&recorder->nextChunk, &chunk, chunk+1, memory_order_relaxed, memory_order_relaxed)){
+            continue;
+        }
+
+        memset(header, 0, sizeof(iqChunkHeader_t));
+        memcpy(header->magic, IQ_CODEC_CHUNK_MAGIC, sizeof(header->magic));
+        header->frameStart = chunkStart/recorder->frameBytes;
+        header->numFrames = (uint32_t) (bytes/recorder->frameBytes);
+        header->payloadBytes = (uint32_t) iqEncodeChunk(recorder->ring + chunkStart%recorder->ringBytes, header->numFrames,
+                                                        numLanes, sampleBits, encoded + sizeof(iqChunkHeader_t));
+
+        while(atomic_load_explicit(&recorder->chunksAppended, memory_order_acquire) != chunk){
+            if(atomic_load_explicit(&recorder->writeFailed, memory_order_acquire)){
+                free(encoded);
+                return NULL;
+            }
+            usleep(RECORD_COMPRESS_TURN_POLL_US);
+        }
+        if(recorderAppendChunk(recorder, encoded, sizeof(iqChunkHeader_t) + header->payloadBytes)){
+            atomic_store_explicit(&recorder->tail, chunkStart + bytes, memory_order_release);
+        }else{
+            atomic_store_explicit(&recorder->writeFailed, true, memory_order_release);
+        }
+        atomic_store_explicit(&recorder->chunksAppended, chunk+1, memory_order_release);
+    }
+
+    free(encoded);
+    return NULL;
+}
+
+recorder_t* recorderOpen(recordConfig_t *config, int numChannels, sampleFormat_t sampleFormat, unsigned int sampRate,
+                         unsigned long freq, char *label, bool print){
+    recorder_t *recorder = (recorder_t*) calloc(1, sizeof(recorder_t));
+    recorder->format = config->format;
+    recorder->label = label;
+    recorder->print = print;
+    recorder->numChannels = numChannels;
+    recorder->sampleFormat = sampleFormat;
+    recorder->sampRate = sampRate;
+    recorder->freq = freq;
+    recorder->frameBytes = numChannels*(config->format == RECORD_FIFO ? SAMPLE_SIZE : bladeRFSampleSize(sampleFormat));
+
+    size_t pathLen = strlen(config->path);
+    recorder->dataPath = (char*) malloc(pathLen+strlen(".sigmf-data")+1);
+    sprintf(recorder->dataPath, config->format == RECORD_COMPRESSED ? "%s.bfz" : "%s.sigmf-data", config->path);
+    recorder->metaPath = (char*) malloc(pathLen+strlen(".sigmf-meta")+1);
+    sprintf(recorder->metaPath, "%s.sigmf-meta", config->path);
+
+    //O_DIRECT bypasses the page cache so that a long recording does not evict everything else.  Not all file systems
+    //support it (ex. tmpfs)
+    recorder->direct = true;
+    recorder->fd = open(recorder->dataPath, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+    if(recorder->fd < 0 && errno == EINVAL){
+        recorder->direct = false;
+        recorder->fd = open(recorder->dataPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    if(recorder->fd < 0){
+        fprintf(stderr, "[%s] Unable to create recording %s: %s\n", label, recorder->dataPath, strerror(errno));
+        exit(1);
+    }
+    if(!recorder->direct){
+        printf("[%s] Warning: O_DIRECT is not supported for %s, recording through the page cache\n", label, recorder->dataPath);
+    }
+    if(config->preallocBytes > 0 && fallocate(recorder->fd, 0, 0, (off_t) config->preallocBytes) != 0){
+        printf("[%s] Warning: Unable to preallocate the recording: %s\n", label, strerror(errno));
+    }
+
+    recorder->ringBytes = (config->ringBytes + RECORD_CHUNK_BYTES - 1) / RECORD_CHUNK_BYTES * RECORD_CHUNK_BYTES;
+    if(recorder->ringBytes < 2*RECORD_CHUNK_BYTES){
+        recorder->ringBytes = 2*RECORD_CHUNK_BYTES;
+    }
+    recorder->ring = (uint8_t*) vitis_aligned_alloc(RECORD_DIRECT_ALIGNMENT, recorder->ringBytes);
+    if(!prefaultBuffer(recorder->ring, recorder->ringBytes)){
+        printf("[%s] Warning: Unable to lock the recording ring in memory\n", label);
+    }
+    atomic_init(&recorder->head, 0);
+    atomic_init(&recorder->tail, 0);
+    atomic_init(&recorder->stopWriter, false);
+    atomic_init(&recorder->writeFailed, false);
+
+    clock_gettime(CLOCK_MONOTONIC, &recorder->startTime);
+    time_t now = time(NULL);
+    struct tm nowUTC;
+    gmtime_r(&now, &nowUTC);
+    strftime(recorder->startDatetime, sizeof(recorder->startDatetime), "%Y-%m-%dT%H:%M:%SZ", &nowUTC);
+
+    if(config->format == RECORD_COMPRESSED){
+        int sampleBits = sampleFormat == SAMPLE_FORMAT_SC8_Q7 ? 8 : 16;
+        recorder->maxEncodedBytes = sizeof(iqChunkHeader_t) +
+                iqMaxEncodedBytes((uint32_t) (RECORD_CHUNK_BYTES/recorder->frameBytes), 2*numChannels, sampleBits);
+        recorder->stage = (uint8_t*) vitis_aligned_alloc(RECORD_DIRECT_ALIGNMENT, RECORD_CHUNK_BYTES);
+        recorder->chunkOffsetsCapacity = 1024;
+        recorder->chunkOffsets = (uint64_t*) malloc(recorder->chunkOffsetsCapacity*sizeof(uint64_t));
+        atomic_init(&recorder->nextChunk, 0);
+        atomic_init(&recorder->chunksAppended, 0);
+
+        iqFileHeader_t fileHeader;
+        memset(&fileHeader, 0, sizeof(fileHeader));
+        memcpy(fileHeader.magic, IQ_CODEC_FILE_MAGIC, sizeof(fileHeader.magic));
+        fileHeader.version = IQ_CODEC_VERSION;
+        fileHeader.numLanes = (uint8_t) (2*numChannels);
+        fileHeader.sampleBits = (uint8_t) sampleBits;
+        fileHeader.chunkFrames = (uint32_t) (RECORD_CHUNK_BYTES/recorder->frameBytes);
+        recorderAppend(recorder, &fileHeader, sizeof(fileHeader));
+
+        recorder->numWorkers = config->compressThreads;
+        recorder->workerThreads = (pthread_t*) malloc(recorder->numWorkers*sizeof(pthread_t));
+        for(int i = 0; i<recorder->numWorkers; i++){
+            int status = pthread_create(&recorder->workerThreads[i], NULL, recorderCompressThread, recorder);
+            if (status != 0) {
+                printf("Could not create recording compression thread ... exiting");
+                errno = status;
+                perror(NULL);
+                exit(1);
+            }
+        }
+    }else{
+        int status = pthread_create(&recorder->writerThread, NULL, recorderWriterThread, recorder);
+        if (status != 0) {
+            printf("Could not create recording writer thread ... exiting");
+            errno = status;
+            perror(NULL);
+            exit(1);
+        }
+    }
+
+    if(print){
+        char *formatName = config->format == RECORD_FIFO ? "fifo" : config->format == RECORD_COMPRESSED ? "compressed" : "raw";
+        printf("[%s] Recording Rx (%s) to %s\n", label, formatName, recorder->dataPath);
+    }
+    return recorder;
+}
+
+//Reserves room for the samples in the ring.  Returns false (and counts the drop) if the ring is full
+static bool recorderReserve(recorder_t *recorder, size_t bytes, uint32_t sampsPerChan, uint64_t sampleIndex, uint64_t *head){
+    *head = atomic_load_explicit(&recorder->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&recorder->tail, memory_order_acquire);
+    if(recorder->ringBytes - (*head - tail) < bytes){
+        recorder->samplesDropped += sampsPerChan;
+        return false;
+    }
+
+    //A new capture segment starts at each discontinuity
+    if(!recorder->started || sampleIndex != recorder->expectedIndex){
+        if(recorder->numCaptures < RECORD_MAX_CAPTURES){
+            recorder->captures[recorder->numCaptures].sampleStart = recorder->samplesRecorded;
+            recorder->captures[recorder->numCaptures].globalIndex = sampleIndex;
+            recorder->numCaptures++;
+        }else{
+            recorder->uncapturedDiscontinuities++;
+        }
+        recorder->started = true;
+    }
+    recorder->expectedIndex = sampleIndex + sampsPerChan;
+    recorder->samplesRecorded += sampsPerChan;
+    return true;
+}
+
+void recorderWriteRaw(recorder_t *recorder, const void *samples, uint32_t sampsPerChan, uint64_t sampleIndex){
+    size_t bytes = recorder->frameBytes*sampsPerChan;
+    uint64_t head;
+    if(!recorderReserve(recorder, bytes, sampsPerChan, sampleIndex, &head)){
+        return;
+    }
+
+    size_t pos = head%recorder->ringBytes;
+    size_t firstBytes = recorder->ringBytes - pos < bytes ? recorder->ringBytes - pos : bytes;
+    memcpy(recorder->ring + pos, samples, firstBytes);
+    memcpy(recorder->ring, (const uint8_t*) samples + firstBytes, bytes - firstBytes);
+
+    atomic_store_explicit(&recorder->head, head + bytes, memory_order_release);
+}
+
+void recorderWriteFifoBlock(recorder_t *recorder, SAMPLE_COMPONENT_DATATYPE **re, SAMPLE_COMPONENT_DATATYPE **im,
+                            uint32_t sampsPerChan, uint64_t sampleIndex){
+    size_t bytes = recorder->frameBytes*sampsPerChan;
+    uint64_t head;
+    if(!recorderReserve(recorder, bytes, sampsPerChan, sampleIndex, &head)){
+        return;
+    }
+
+    //The ring is a multiple of the frame size so a frame never wraps
+    size_t pos = head%recorder->ringBytes;
+    int numChannels = recorder->numChannels;
+    for(uint32_t i = 0; i<sampsPerChan; i++){
+        SAMPLE_COMPONENT_DATATYPE *frame = (SAMPLE_COMPONENT_DATATYPE*) (recorder->ring + pos);
+        for(int chan = 0; chan<numChannels; chan++){
+            frame[2*chan] = re[chan][i];
+            frame[2*chan+1] = im[chan][i];
+        }
+        pos += recorder->frameBytes;
+        if(pos == recorder->ringBytes){
+            pos = 0;
+        }
+    }
+
+    atomic_store_explicit(&recorder->head, head + bytes, memory_order_release);
+}
+
+static void writeRecordMeta(recorder_t *recorder){
+    FILE *meta = fopen(recorder->metaPath, "w");
+    if(meta == NULL){
+        fprintf(stderr, "[%s] Unable to create recording metadata %s: %s\n", recorder->label, recorder->metaPath, strerror(errno));
+        return;
+    }
+
+    fprintf(meta, "{\n");
+    fprintf(meta, "    \"global\": {\n");
+    fprintf(meta, "        \"core:datatype\": \"%s\",\n", recordSigMFDatatype(recorder));
+    fprintf(meta, "        \"core:sample_rate\": %u,\n", recorder->sampRate);
+    fprintf(meta, "        \"core:num_channels\": %d,\n", recorder->numChannels);
+    fprintf(meta, "        \"core:version\": \"1.0.0\",\n");
+    fprintf(meta, "        \"core:recorder\": \"bladeRFToFIFO\",\n");
+    fprintf(meta, "        \"core:hw\": \"bladeRF %s\",\n", recorder->label);
+    fprintf(meta, "        \"core:description\": \"%s samples%s.  %lu samples (per channel) were dropped by the recorder\"\n",
+            recorder->format == RECORD_FIFO ? "Rx FIFO (corrected, scaled)" : "Raw bladeRF",
+            recorder->format == RECORD_COMPRESSED ? ", compressed (decode the .bfz recording with bladeRFRecordingDecode)" : "",
+            recorder->samplesDropped);
+    fprintf(meta, "    },\n");
+    fprintf(meta, "    \"captures\": [\n");
+    for(int i = 0; i<recorder->numCaptures; i++){
+        fprintf(meta, "        {\"core:sample_start\": %lu, \"core:global_index\": %lu, \"core:frequency\": %lu",
+                recorder->captures[i].sampleStart, recorder->captures[i].globalIndex, recorder->freq);
+        if(i == 0){
+            fprintf(meta, ", \"core:datetime\": \"%s\"", recorder->startDatetime);
+        }
+        fprintf(meta, "}%s\n", i+1 < recorder->numCaptures ? "," : "");
+    }
+    fprintf(meta, "    ],\n");
+    fprintf(meta, "    \"annotations\": []\n");
+    fprintf(meta, "}\n");
+    fclose(meta);
+}
+
+//Appends the index and writes the rest of the stage.  Returns the length of the compressed recording
+static uint64_t recorderFinishCompressed(recorder_t *recorder, bool *failed){
+    if(!*failed){
+        iqIndexTrailer_t trailer;
+        memset(&trailer, 0, sizeof(trailer));
+        trailer.numChunks = recorder->numChunks;
+        trailer.numFrames = atomic_load_explicit(&recorder->tail, memory_order_acquire)/recorder->frameBytes;
+        memcpy(trailer.magic, IQ_CODEC_INDEX_MAGIC, sizeof(trailer.magic));
+        *failed = !recorderAppend(recorder, recorder->chunkOffsets, recorder->numChunks*sizeof(uint64_t)) ||
+                  !recorderAppend(recorder, &trailer, sizeof(trailer));
+    }
+
+    //Whatever was compressed is kept on failure, the chunks can be found without the index
+    size_t paddedBytes = (recorder->stageLen + RECORD_DIRECT_ALIGNMENT - 1) / RECORD_DIRECT_ALIGNMENT * RECORD_DIRECT_ALIGNMENT;
+    memset(recorder->stage + recorder->stageLen, 0, paddedBytes - recorder->stageLen);
+    if(paddedBytes > 0 && pwrite(recorder->fd, recorder->stage, paddedBytes, (off_t) recorder->stageOffset) != (ssize_t) paddedBytes){
+        fprintf(stderr, "[%s] Recording write failed: %s\n", recorder->label, strerror(errno));
+        *failed = true;
+        return recorder->stageOffset;
+    }
+    return recorder->stageOffset + recorder->stageLen;
+}
+
+void recorderClose(recorder_t *recorder){
+    atomic_store_explicit(&recorder->stopWriter, true, memory_order_release);
+    if(recorder->format == RECORD_COMPRESSED){
+        for(int i = 0; i<recorder->numWorkers; i++){
+            pthread_join(recorder->workerThreads[i], NULL);
+        }
+    }else{
+        pthread_join(recorder->writerThread, NULL);
+    }
+
+    uint64_t head = atomic_load_explicit(&recorder->head, memory_order_acquire);
+    uint64_t tail = atomic_load_explicit(&recorder->tail, memory_order_acquire);
+    bool failed = atomic_load_explicit(&recorder->writeFailed, memory_order_acquire);
+    uint64_t fileBytes = tail;
+    if(recorder->format == RECORD_COMPRESSED){
+        fileBytes = recorderFinishCompressed(recorder, &failed);
+    }else if(!failed && head > tail){
+        //The remainder is less than a chunk.  O_DIRECT writes need to be a multiple of the alignment: pad the write and
+        //truncate the padding below.  The remainder does not wrap since the writer stops on a chunk boundary
+        size_t remainder = head - tail;
+        size_t paddedBytes = (remainder + RECORD_DIRECT_ALIGNMENT - 1) / RECORD_DIRECT_ALIGNMENT * RECORD_DIRECT_ALIGNMENT;
+        uint8_t *tailChunk = recorder->ring + tail%recorder->ringBytes;
+        memset(tailChunk + remainder, 0, paddedBytes - remainder);
+        if(pwrite(recorder->fd, tailChunk, paddedBytes, (off_t) tail) != (ssize_t) paddedBytes){
+            fprintf(stderr, "[%s] Recording write failed: %s\n", recorder->label, strerror(errno));
+            failed = true;
+        }else{
+            tail = head;
+            fileBytes = tail;
+        }
+    }
+    //Removes the padding and the unused preallocation
+    if(ftruncate(recorder->fd, (off_t) fileBytes) != 0){
+        fprintf(stderr, "[%s] Unable to truncate recording: %s\n", recorder->label, strerror(errno));
+    }
+    close(recorder->fd);
+
+    writeRecordMeta(recorder);
+
+    if(recorder->print){
+        struct timespec endTime;
+        clock_gettime(CLOCK_MONOTONIC, &endTime);
+        double durationSec = difftimespec(&endTime, &recorder->startTime);
+        printf("[%s] Recorded %lu Samples (%.1f MB, %.1f MB/s) to %s, Dropped %lu Samples, %d Discontinuities%s\n", recorder->label,
+               recorder->samplesRecorded - (head - tail)/recorder->frameBytes, tail/1e6, tail/1e6/durationSec, recorder->dataPath,
+               recorder->samplesDropped, recorder->numCaptures > 0 ? recorder->numCaptures-1 : 0, failed ? " (Write Failed)" : "");
+        if(recorder->format == RECORD_COMPRESSED && fileBytes > 0){
+            printf("[%s] Compressed to %.1f MB (%.2fx, %lu Chunks, %d Threads)\n", recorder->label, fileBytes/1e6,
+                   ((double) tail)/fileBytes, recorder->numChunks, recorder->numWorkers);
+        }
+    }
+    if(recorder->uncapturedDiscontinuities > 0){
+        printf("[%s] Warning: %lu discontinuities are not marked in the recording metadata\n", recorder->label, recorder->uncapturedDiscontinuities);
+    }
+
+    free(recorder->ring);
+    free(recorder->stage);
+    free(recorder->chunkOffsets);
+    free(recorder->workerThreads);
+    free(recorder->dataPath);
+    free(recorder->metaPath);
+    free(recorder);
+}
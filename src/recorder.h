@@ -0,0 +1,61 @@
+//
+// Disk recording tap for the Rx stream.  The Rx thread copies samples into a lock-free single producer, single consumer
+// ring and a writer thread writes the ring to disk in large aligned chunks (O_DIRECT when the file system supports it).
+// The recording is a SigMF recording (<path>.sigmf-data and <path>.sigmf-meta).  Compressed recordings are written to
+// <path>.bfz (see iqCodec.h) by a pool of compression threads instead, and decoded to <path>.sigmf-data by
+// bladeRFRecordingDecode.
+//
+
+#ifndef BLADERFTOFIFO_RECORDER_H
+#define BLADERFTOFIFO_RECORDER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "helpers.h"
+#include "sampleConversion.h"
+
+#define RECORD_DEFAULT_RING_MB (256)
+#define RECORD_DEFAULT_PREALLOC_MB (1024)
+#define RECORD_DEFAULT_COMPRESS_THREADS (2)
+
+typedef enum{
+    RECORD_NONE = 0,
+    RECORD_RAW = 1, //Samples as received from the bladeRF (SC16_Q11 or SC8_Q7), before correction
+    RECORD_FIFO = 2, //Samples as written to the Rx FIFOs (after correction and scaling), as interleaved floats
+    RECORD_COMPRESSED = 3 //Raw samples, losslessly compressed
+} recordFormat_t;
+
+typedef struct{
+    recordFormat_t format;
+    char *path; //Without the .sigmf-data/.sigmf-meta extension
+    size_t ringBytes;
+    size_t preallocBytes; //The data file is preallocated (and truncated when closed) to avoid allocating blocks while recording
+    int compressThreads; //RECORD_COMPRESSED
+} recordConfig_t;
+
+typedef struct recorder_s recorder_t;
+
+//Returns false if the string is not a known format ("raw", "fifo", or "compressed")
+bool parseRecordFormat(char *str, recordFormat_t *format);
+
+void initRecordConfig(recordConfig_t *config);
+
+//Creates the data file and starts the writer (or compression) threads.  Exits if the file cannot be created
+recorder_t* recorderOpen(recordConfig_t *config, int numChannels, sampleFormat_t sampleFormat, unsigned int sampRate,
+                         unsigned long freq, char *label, bool print);
+
+//Rx thread (RECORD_RAW and RECORD_COMPRESSED): MIMO samples are interleaved by channel (as received from the bladeRF).  sampleIndex is the stream index
+//(per channel) of the first sample, used to mark discontinuities.  The samples are dropped (and counted) if the ring is
+//full, the Rx thread is never stalled.
+void recorderWriteRaw(recorder_t *recorder, const void *samples, uint32_t sampsPerChan, uint64_t sampleIndex);
+
+//Rx thread (RECORD_FIFO): One FIFO block per channel
+void recorderWriteFifoBlock(recorder_t *recorder, SAMPLE_COMPONENT_DATATYPE **re, SAMPLE_COMPONENT_DATATYPE **im,
+                            uint32_t sampsPerChan, uint64_t sampleIndex);
+
+//Writes the remainder of the ring and the SigMF metadata.  Call after the Rx thread has stopped
+void recorderClose(recorder_t *recorder);
+
+#endif //BLADERFTOFIFO_RECORDER_H
@@ -0,0 +1,324 @@
+//
+// Decodes a compressed recording (<path>.bfz, see iqCodec.h) to a SigMF data file.  Chunks are decoded in parallel and
+// only the chunks overlapping the requested range are read.
+//
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "iqCodec.h"
+
+#define DECODE_DEFAULT_THREADS (4)
+
+typedef struct{
+    const uint8_t *file;
+    size_t fileBytes;
+    iqFileHeader_t header;
+    size_t frameBytes;
+    uint64_t *chunkOffsets;
+    size_t numChunks;
+    uint64_t startFrame;
+    uint64_t endFrame;
+    int outFd;
+    _Atomic size_t nextChunk;
+    atomic_bool failed;
+} decodeJob_t;
+
+void printHelp(){
+    printf("bladeRFRecordingDecode <recording.bfz>\n");
+    printf("\n");
+    printf("Optional Arguments:\n");
+    printf("-o: Path of the decoded recording.  Default: the recording with .bfz replaced by .sigmf-data (matching the SigMF metadata written with it)\n");
+    printf("-threads: Number of decoding threads.  Default: %d\n", DECODE_DEFAULT_THREADS);
+    printf("-start: First sample (per channel) to decode.  The SigMF metadata describes the whole recording.  Default: 0\n");
+    printf("-count: Number of samples (per channel) to decode.  Default: to the end of the recording\n");
+    printf("-v: Verbose\n");
+}
+
+//Uses the index at the end of the recording.  A recording that was not closed has no index: its chunk headers are scanned
+static bool loadChunkIndex(decodeJob_t *job, bool print){
+    iqIndexTrailer_t trailer;
+    if(job->fileBytes >= sizeof(iqFileHeader_t) + sizeof(trailer)){
+        memcpy(&trailer, job->file + job->fileBytes - sizeof(trailer), sizeof(trailer));
+        size_t indexBytes = trailer.numChunks*sizeof(uint64_t);
+        if(memcmp(trailer.magic, IQ_CODEC_INDEX_MAGIC, sizeof(trailer.magic)) == 0 &&
+           trailer.numChunks <= (job->fileBytes - sizeof(iqFileHeader_t) - sizeof(trailer))/sizeof(uint64_t)){
+            job->numChunks = trailer.numChunks;
+            job->chunkOffsets = (uint64_t*) malloc(indexBytes + 1);
+            memcpy(job->chunkOffsets, job->file + job->fileBytes - sizeof(trailer) - indexBytes, indexBytes);
+            return true;
+        }
+    }
+
+    if(print){
+        printf("Warning: The recording has no index (it was not closed), scanning the chunks\n");
+    }
+    size_t capacity = 1024;
+    job->chunkOffsets = (uint64_t*) malloc(capacity*sizeof(uint64_t));
+    job->numChunks = 0;
+    size_t offset = sizeof(iqFileHeader_t);
+    while(offset + sizeof(iqChunkHeader_t) <= job->fileBytes){
+        iqChunkHeader_t chunkHeader;
+        memcpy(&chunkHeader, job->file + offset, sizeof(chunkHeader));
+        if(memcmp(chunkHeader.magic, IQ_CODEC_CHUNK_MAGIC, sizeof(chunkHeader.magic)) != 0 ||
+           chunkHeader.payloadBytes > job->fileBytes - offset - sizeof(chunkHeader)){
+            break;
+        }
+        if(job->numChunks == capacity){
+            capacity *= 2;
+            job->chunkOffsets = (uint64_t*) realloc(job->chunkOffsets, capacity*sizeof(uint64_t));
+        }
+        job->chunkOffsets[job->numChunks++] = offset;
+        offset += sizeof(chunkHeader) + chunkHeader.payloadBytes;
+    }
+    return job->numChunks > 0;
+}
+
+static bool readChunkHeader(decodeJob_t *job, size_t chunk, iqChunkHeader_t *chunkHeader){
+    uint64_t offset = job->chunkOffsets[chunk];
+    if(offset + sizeof(iqChunkHeader_t) > job->fileBytes){
+        return false;
+    }
+    memcpy(chunkHeader, job->file + offset, sizeof(iqChunkHeader_t));
+    return memcmp(chunkHeader->magic, IQ_CODEC_CHUNK_MAGIC, sizeof(chunkHeader->magic)) == 0 &&
+           chunkHeader->payloadBytes <= job->fileBytes - offset - sizeof(iqChunkHeader_t) &&
+           chunkHeader->numFrames <= job->header.chunkFrames;
+}
+
+static void* decodeThread(void *uncastArgs){
+    decodeJob_t *job = (decodeJob_t*) uncastArgs;
+    uint8_t *samples = (uint8_t*) malloc(job->header.chunkFrames*job->frameBytes);
+
+    while(!atomic_load(&job->failed)){
+        size_t chunk = atomic_fetch_add(&job->nextChunk, 1);
+        if(chunk >= job->numChunks){
+            break;
+        }
+
+        iqChunkHeader_t chunkHeader;
+        if(!readChunkHeader(job, chunk, &chunkHeader)){
+            fprintf(stderr, "Chunk %lu has an invalid header\n", chunk);
+            atomic_store(&job->failed, true);
+            break;
+        }
+        uint64_t chunkEnd = chunkHeader.frameStart + chunkHeader.numFrames;
+        if(chunkEnd <= job->startFrame || chunkHeader.frameStart >= job->endFrame){
+            continue;
+        }
+
+        const uint8_t *payload = job->file + job->chunkOffsets[chunk] + sizeof(iqChunkHeader_t);
+        if(!iqDecodeChunk(payload, chunkHeader.payloadBytes, chunkHeader.numFrames, job->header.numLanes,
+                          job->header.sampleBits, samples)){
+            fprintf(stderr, "Chunk %lu is corrupt\n", chunk);
+            atomic_store(&job->failed, true);
+            break;
+        }
+
+        //Only the part of the chunk in the requested range is written
+        uint64_t firstFrame = chunkHeader.frameStart > job->startFrame ? chunkHeader.frameStart : job->startFrame;
+        uint64_t lastFrame = chunkEnd < job->endFrame ? chunkEnd : job->endFrame;
+        size_t bytes = (lastFrame - firstFrame)*job->frameBytes;
+        const uint8_t *src = samples + (firstFrame - chunkHeader.frameStart)*job->frameBytes;
+        if(pwrite(job->outFd, src, bytes, (off_t) ((firstFrame - job->startFrame)*job->frameBytes)) != (ssize_t) bytes){
+            fprintf(stderr, "Unable to write the decoded recording: %s\n", strerror(errno));
+            atomic_store(&job->failed, true);
+            break;
+        }
+    }
+
+    free(samples);
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    char *inPath = NULL;
+    char *outPath = NULL;
+    int numThreads = DECODE_DEFAULT_THREADS;
+    uint64_t startFrame = 0;
+    uint64_t count = UINT64_MAX;
+    bool print = false;
+
+    if (argc < 2) {
+        printHelp();
+        exit(1);
+    }
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp("-o", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                outPath = argv[i];
+            } else {
+                printf("Missing argument for -o\n");
+                exit(1);
+            }
+        } else if (strcmp("-threads", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                numThreads = (int) strtol(argv[i], NULL, 10);
+                if (numThreads <= 0) {
+                    printf("-threads must be positive\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -threads\n");
+                exit(1);
+            }
+        } else if (strcmp("-start", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                startFrame = strtoull(argv[i], NULL, 10);
+            } else {
+                printf("Missing argument for -start\n");
+                exit(1);
+            }
+        } else if (strcmp("-count", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                count = strtoull(argv[i], NULL, 10);
+            } else {
+                printf("Missing argument for -count\n");
+                exit(1);
+            }
+        } else if (strcmp("-v", argv[i]) == 0) {
+            print = true;
+        } else if (strcmp("-h", argv[i]) == 0 || strcmp("--help", argv[i]) == 0) {
+            printHelp();
+            exit(0);
+        } else if (inPath == NULL && argv[i][0] != '-') {
+            inPath = argv[i];
+        } else {
+            printf("Unknown CLI option: %s\n", argv[i]);
+            exit(1);
+        }
+    }
+
+    if (inPath == NULL) {
+        printf("The recording to decode is required\n");
+        exit(1);
+    }
+    char *defaultOutPath = NULL;
+    if (outPath == NULL) {
+        size_t baseLen = strlen(inPath);
+        if (baseLen > 4 && strcmp(inPath + baseLen - 4, ".bfz") == 0) {
+            baseLen -= 4;
+        }
+        defaultOutPath = (char*) malloc(baseLen + strlen(".sigmf-data") + 1);
+        sprintf(defaultOutPath, "%.*s.sigmf-data", (int) baseLen, inPath);
+        outPath = defaultOutPath;
+    }
+
+    //--- Map the recording ---
+    decodeJob_t job;
+    memset(&job, 0, sizeof(job));
+    int inFd = open(inPath, O_RDONLY);
+    struct stat inStat;
+    if (inFd < 0 || fstat(inFd, &inStat) != 0) {
+        fprintf(stderr, "Unable to open %s: %s\n", inPath, strerror(errno));
+        exit(1);
+    }
+    job.fileBytes = (size_t) inStat.st_size;
+    if (job.fileBytes < sizeof(iqFileHeader_t)) {
+        fprintf(stderr, "%s is not a compressed recording\n", inPath);
+        exit(1);
+    }
+    job.file = (const uint8_t*) mmap(NULL, job.fileBytes, PROT_READ, MAP_SHARED, inFd, 0);
+    if (job.file == MAP_FAILED) {
+        fprintf(stderr, "Unable to map %s: %s\n", inPath, strerror(errno));
+        exit(1);
+    }
+    close(inFd);
+
+    memcpy(&job.header, job.file, sizeof(job.header));
+    if (memcmp(job.header.magic, IQ_CODEC_FILE_MAGIC, sizeof(job.header.magic)) != 0) {
+        fprintf(stderr, "%s is not a compressed recording\n", inPath);
+        exit(1);
+    }
+    if (job.header.version != IQ_CODEC_VERSION || (job.header.sampleBits != 8 && job.header.sampleBits != 16) ||
+        job.header.numLanes == 0 || job.header.numLanes > IQ_CODEC_MAX_LANES) {
+        fprintf(stderr, "%s has an unsupported version (%u) or format\n", inPath, job.header.version);
+        exit(1);
+    }
+    job.frameBytes = job.header.numLanes*job.header.sampleBits/8;
+
+    if (!loadChunkIndex(&job, print)) {
+        fprintf(stderr, "%s has no chunks\n", inPath);
+        exit(1);
+    }
+    iqChunkHeader_t lastChunk;
+    if (!readChunkHeader(&job, job.numChunks-1, &lastChunk)) {
+        fprintf(stderr, "%s has an invalid index\n", inPath);
+        exit(1);
+    }
+    uint64_t numFrames = lastChunk.frameStart + lastChunk.numFrames;
+    if (startFrame > numFrames) {
+        startFrame = numFrames;
+    }
+    job.startFrame = startFrame;
+    job.endFrame = count < numFrames - startFrame ? startFrame + count : numFrames;
+
+    //--- Decode ---
+    job.outFd = open(outPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (job.outFd < 0) {
+        fprintf(stderr, "Unable to create %s: %s\n", outPath, strerror(errno));
+        exit(1);
+    }
+    if (ftruncate(job.outFd, (off_t) ((job.endFrame - job.startFrame)*job.frameBytes)) != 0) {
+        fprintf(stderr, "Unable to size %s: %s\n", outPath, strerror(errno));
+        exit(1);
+    }
+    madvise((void*) job.file, job.fileBytes, MADV_SEQUENTIAL);
+    atomic_init(&job.nextChunk, 0);
+    atomic_init(&job.failed, false);
+
+    struct timespec startTime;
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    pthread_t *threads = (pthread_t*) malloc(numThreads*sizeof(pthread_t));
+    for (int i = 0; i < numThreads; i++) {
+        int status = pthread_create(&threads[i], NULL, decodeThread, &job);
+        if (status != 0) {
+            printf("Could not create decoding thread ... exiting");
+            errno = status;
+            perror(NULL);
+            exit(1);
+        }
+    }
+    for (int i = 0; i < numThreads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    struct timespec endTime;
+    clock_gettime(CLOCK_MONOTONIC, &endTime);
+    close(job.outFd);
+
+    if (atomic_load(&job.failed)) {
+        fprintf(stderr, "Decoding %s failed\n", inPath);
+        exit(1);
+    }
+    if (print) {
+        double durationSec = (endTime.tv_sec - startTime.tv_sec) + (endTime.tv_nsec - startTime.tv_nsec)*1e-9;
+        uint64_t decodedFrames = job.endFrame - job.startFrame;
+        printf("Decoded %lu Samples (%.1f MB from %.1f MB, %lu Chunks) to %s in %.3f s (%.1f MS/s)\n", decodedFrames,
+               decodedFrames*job.frameBytes/1e6, job.fileBytes/1e6, job.numChunks, outPath, durationSec,
+               decodedFrames/durationSec/1e6);
+    }
+
+    free(threads);
+    free(job.chunkOffsets);
+    free(defaultOutPath);
+    munmap((void*) job.file, job.fileBytes);
+    return 0;
+}
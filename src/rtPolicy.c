@@ -0,0 +1,238 @@
+//
+// Real-time scheduling, memory locking, and thread placement helpers
+//
+
+#define _GNU_SOURCE //Need extra functions from sched.h to set thread affinity
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include "rtPolicy.h"
+
+typedef struct{
+    bool affinityChanged;
+    cpu_set_t cpuset;
+    bool schedChanged;
+    int policy;
+    struct sched_param param;
+} threadPlacement_t;
+
+bool parseRTPolicy(char *str, rtPolicy_t *policy){
+    if(strcmp(str, "none") == 0){
+        *policy = RT_POLICY_NONE;
+    }else if(strcmp(str, "fifo") == 0){
+        *policy = RT_POLICY_FIFO;
+    }else if(strcmp(str, "rr") == 0){
+        *policy = RT_POLICY_RR;
+    }else{
+        return false;
+    }
+    return true;
+}
+
+char* rtPolicyToStr(rtPolicy_t policy){
+    switch(policy){
+        case RT_POLICY_NONE:
+            return "SCHED_OTHER";
+        case RT_POLICY_FIFO:
+            return "SCHED_FIFO";
+        case RT_POLICY_RR:
+            return "SCHED_RR";
+        default:
+            return "Unknown";
+    }
+}
+
+static int rtPolicyToSched(rtPolicy_t policy){
+    switch(policy){
+        case RT_POLICY_FIFO:
+            return SCHED_FIFO;
+        case RT_POLICY_RR:
+            return SCHED_RR;
+        default:
+            return SCHED_OTHER;
+    }
+}
+
+static void checkPriority(int schedPolicy, int priority, char *label){
+    int minPriority = sched_get_priority_min(schedPolicy);
+    int maxPriority = sched_get_priority_max(schedPolicy);
+    if(priority < minPriority || priority > maxPriority){
+        fprintf(stderr, "%s priority %d is outside of the range [%d, %d]\n", label, priority, minPriority, maxPriority);
+        exit(1);
+    }
+}
+
+void setThreadAttrRTPolicy(pthread_attr_t *attr, rtPolicy_t policy, int priority, char *label){
+    if(policy == RT_POLICY_NONE){
+        return;
+    }
+
+    int schedPolicy = rtPolicyToSched(policy);
+    checkPriority(schedPolicy, priority, label);
+
+    //Threads inherit the scheduling policy of the creator by default, need to explicitly set it
+    int status = pthread_attr_setinheritsched(attr, PTHREAD_EXPLICIT_SCHED);
+    if (status != 0) {
+        printf("Could not set %s thread to explicit scheduling ... exiting", label);
+        exit(1);
+    }
+    status = pthread_attr_setschedpolicy(attr, schedPolicy);
+    if (status != 0) {
+        printf("Could not set %s thread policy to %s ... exiting", label, rtPolicyToStr(policy));
+        exit(1);
+    }
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = priority;
+    status = pthread_attr_setschedparam(attr, &param);
+    if (status != 0) {
+        printf("Could not set %s thread priority to %d ... exiting", label, priority);
+        exit(1);
+    }
+}
+
+static void beginWorkerPlacement(threadPlacement_t *saved, int workerCpu, rtPolicy_t policy, int workerPriority, char *label){
+    saved->affinityChanged = false;
+    saved->schedChanged = false;
+    pthread_t self = pthread_self();
+
+    if(workerCpu >= 0){
+        int status = pthread_getaffinity_np(self, sizeof(cpu_set_t), &saved->cpuset);
+        if (status != 0) {
+            fprintf(stderr, "Could not get %s thread core affinity: %s\n", label, strerror(status));
+            exit(1);
+        }
+
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(workerCpu, &cpuset);
+        status = pthread_setaffinity_np(self, sizeof(cpu_set_t), &cpuset);
+        if (status != 0) {
+            fprintf(stderr, "Could not set %s libbladeRF worker core affinity to CPU %d: %s\n", label, workerCpu, strerror(status));
+            exit(1);
+        }
+        saved->affinityChanged = true;
+    }
+
+    if(policy != RT_POLICY_NONE && workerPriority >= 0){
+        int status = pthread_getschedparam(self, &saved->policy, &saved->param);
+        if (status != 0) {
+            fprintf(stderr, "Could not get %s thread scheduling policy: %s\n", label, strerror(status));
+            exit(1);
+        }
+
+        int schedPolicy = rtPolicyToSched(policy);
+        checkPriority(schedPolicy, workerPriority, label);
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = workerPriority;
+        status = pthread_setschedparam(self, schedPolicy, &param);
+        if (status != 0) {
+            fprintf(stderr, "Could not set %s libbladeRF worker priority to %d: %s\n", label, workerPriority, strerror(status));
+            exit(1);
+        }
+        saved->schedChanged = true;
+    }
+}
+
+static void endWorkerPlacement(threadPlacement_t *saved, char *label){
+    pthread_t self = pthread_self();
+
+    if(saved->schedChanged){
+        int status = pthread_setschedparam(self, saved->policy, &saved->param);
+        if (status != 0) {
+            fprintf(stderr, "Could not restore %s thread scheduling policy: %s\n", label, strerror(status));
+            exit(1);
+        }
+    }
+
+    if(saved->affinityChanged){
+        int status = pthread_setaffinity_np(self, sizeof(cpu_set_t), &saved->cpuset);
+        if (status != 0) {
+            fprintf(stderr, "Could not restore %s thread core affinity: %s\n", label, strerror(status));
+            exit(1);
+        }
+    }
+}
+
+int placedBladeRFSyncConfig(struct bladerf *dev, bladerf_channel_layout layout, bladerf_format format,
+                            unsigned int numBuffers, unsigned int bufferSize, unsigned int numTransfers, unsigned int timeout_ms,
+                            int workerCpu, rtPolicy_t policy, int workerPriority, char *label){
+    threadPlacement_t saved;
+    beginWorkerPlacement(&saved, workerCpu, policy, workerPriority, label);
+    int status = bladerf_sync_config(dev, layout, format, numBuffers, bufferSize, numTransfers, timeout_ms);
+    endWorkerPlacement(&saved, label);
+    return status;
+}
+
+void lockProcessMemory(bool print){
+    //Avoid page faults in the Rx/Tx threads (including pages allocated after this call)
+    if(mlockall(MCL_CURRENT | MCL_FUTURE) != 0){
+        fprintf(stderr, "Unable to lock memory (mlockall): %s\n", strerror(errno));
+        fprintf(stderr, "The memlock limit (ulimit -l) may need to be raised\n");
+        exit(1);
+    }
+    if(print){
+        printf("Locked process memory\n");
+    }
+}
+
+//Parses a CPU list from sysfs (ex. "2-5,7").  Returns false if the file cannot be read.
+static bool readSysCpuList(char *path, cpu_set_t *cpuset){
+    CPU_ZERO(cpuset);
+
+    FILE *file = fopen(path, "r");
+    if(file == NULL){
+        return false;
+    }
+
+    char buffer[1024];
+    if(fgets(buffer, sizeof(buffer), file) == NULL){
+        //Empty, no CPUs
+        fclose(file);
+        return true;
+    }
+    fclose(file);
+
+    char *savePtr = NULL;
+    char *token = strtok_r(buffer, ",\n", &savePtr);
+    while(token != NULL){
+        char *end;
+        long first = strtol(token, &end, 10);
+        long last = first;
+        if(*end == '-'){
+            last = strtol(end+1, NULL, 10);
+        }
+        for(long cpu = first; cpu<=last && cpu < CPU_SETSIZE; cpu++){
+            CPU_SET(cpu, cpuset);
+        }
+        token = strtok_r(NULL, ",\n", &savePtr);
+    }
+
+    return true;
+}
+
+void checkCpuIsolation(int cpu, char *label){
+    if(cpu < 0){
+        return;
+    }
+
+    cpu_set_t isolated;
+    cpu_set_t nohzFull;
+    bool isolatedKnown = readSysCpuList("/sys/devices/system/cpu/isolated", &isolated);
+    bool nohzFullKnown = readSysCpuList("/sys/devices/system/cpu/nohz_full", &nohzFull);
+
+    if(!isolatedKnown && !nohzFullKnown){
+        return;
+    }
+
+    bool isIsolated = isolatedKnown && CPU_ISSET(cpu, &isolated);
+    bool isNohzFull = nohzFullKnown && CPU_ISSET(cpu, &nohzFull);
+    if(!isIsolated && !isNohzFull){
+        printf("Warning: %s is pinned to CPU %d which is neither isolated (isolcpus) nor nohz_full.  Other tasks and timer ticks may cause jitter\n", label, cpu);
+    }
+}
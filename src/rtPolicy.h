@@ -0,0 +1,44 @@
+//
+// Real-time scheduling, memory locking, and thread placement helpers
+//
+
+#ifndef BLADERFTOFIFO_RTPOLICY_H
+#define BLADERFTOFIFO_RTPOLICY_H
+
+#include <stdbool.h>
+#include <pthread.h>
+
+#include <libbladeRF.h>
+
+#define RT_DEFAULT_PRIORITY (50)
+
+typedef enum{
+    RT_POLICY_NONE = 0, //SCHED_OTHER (default)
+    RT_POLICY_FIFO = 1, //SCHED_FIFO
+    RT_POLICY_RR = 2    //SCHED_RR
+} rtPolicy_t;
+
+//Returns false if the string is not a known policy ("none", "fifo", or "rr")
+bool parseRTPolicy(char *str, rtPolicy_t *policy);
+
+char* rtPolicyToStr(rtPolicy_t policy);
+
+//Sets the scheduling policy and priority in the attributes of a thread to be created.  No-op for RT_POLICY_NONE
+void setThreadAttrRTPolicy(pthread_attr_t *attr, rtPolicy_t policy, int priority, char *label);
+
+//The libbladeRF worker thread is created inside of bladerf_sync_config by the calling thread with default attributes,
+//so it inherits the affinity and scheduling policy of the caller.  This temporarily moves the calling thread so that the
+//worker is placed on its own CPU (and priority), calls bladerf_sync_config, and then restores the calling thread.
+//workerCpu < 0 inherits the CPU of the calling thread.  workerPriority < 0 inherits the priority of the calling thread.
+//Returns the status of bladerf_sync_config
+int placedBladeRFSyncConfig(struct bladerf *dev, bladerf_channel_layout layout, bladerf_format format,
+                            unsigned int numBuffers, unsigned int bufferSize, unsigned int numTransfers, unsigned int timeout_ms,
+                            int workerCpu, rtPolicy_t policy, int workerPriority, char *label);
+
+//Locks the current and future pages of the process in memory (mlockall)
+void lockProcessMemory(bool print);
+
+//Warns if the CPU is neither isolated (isolcpus) nor nohz_full
+void checkCpuIsolation(int cpu, char *label);
+
+#endif //BLADERFTOFIFO_RTPOLICY_H
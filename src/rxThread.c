@@ -5,57 +5,244 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <sys/mman.h>
 #include <stdatomic.h>
+#include <time.h>
 
 #include <libbladeRF.h>
 
 #include "depends/BerkeleySharedMemoryFIFO.h"
 #include "rxThread.h"
+#include "sampleConversion.h"
+#include "rtPolicy.h"
+#include "startupTrace.h"
+#include "blockHeaders.h"
 
-// #define WRITE_RX_CSV
+bool parseRxOverflowPolicy(char *str, rxOverflowPolicy_t *policy){
+    if(strcmp(str, "block") == 0){
+        *policy = RX_OVERFLOW_BLOCK;
+    }else if(strcmp(str, "dropNewest") == 0){
+        *policy = RX_OVERFLOW_DROP_NEWEST;
+    }else if(strcmp(str, "dropOldest") == 0){
+        *policy = RX_OVERFLOW_DROP_OLDEST;
+    }else{
+        return false;
+    }
+    return true;
+}
+
+char* rxOverflowPolicyToStr(rxOverflowPolicy_t policy){
+    switch(policy){
+        case RX_OVERFLOW_BLOCK:
+            return "block";
+        case RX_OVERFLOW_DROP_NEWEST:
+            return "dropNewest";
+        case RX_OVERFLOW_DROP_OLDEST:
+            return "dropOldest";
+        default:
+            return "Unknown";
+    }
+}
+
+//Completed FIFO blocks waiting to be written to the Shared Memory FIFOs.  The block after the last completed block is
+//the one being filled.  With RX_OVERFLOW_BLOCK and RX_OVERFLOW_DROP_NEWEST, there is a single block which is written
+//(or dropped) as soon as it is completed.
+typedef struct{
+    char *blocks[BLADERF_MAX_CHANNELS]; //numBlocks FIFO blocks (header, re, im) per channel
+    size_t strideBytes;
+    size_t headerBytes;
+    int32_t numBlocks;
+    int32_t head;  //Oldest completed block
+    int32_t count; //Number of completed blocks
+    uint64_t *sampleIndex; //Index of the first sample in each block
+    uint32_t *configSeq; //Number of runtime changes applied before each block
+    uint32_t writtenConfigSeq; //configSeq of the last block written to the FIFOs
+    uint64_t droppedSamples; //Dropped since the last block written to the FIFOs
+    bool recovered; //The device was reopened since the last block written to the FIFOs
+} rxStaging_t;
+
+static char* rxStagingBlock(rxStaging_t *staging, int chan, int32_t block){
+    return staging->blocks[chan] + staging->strideBytes*block;
+}
+
+static int32_t rxStagingFillBlock(rxStaging_t *staging){
+    return (staging->head + staging->count) % staging->numBlocks;
+}
+
+//The channels are written (or dropped) together so that they stay aligned
+static bool rxFifosHaveRoom(sharedMemoryFIFO_t *rxFifo, int numChannels, size_t fifoBlockSizeBytes){
+    for(int chan = 0; chan<numChannels; chan++) {
+        if(!hasRoomForWriting(fifoBlockSizeBytes, &rxFifo[chan])){
+            return false;
+        }
+    }
+    return true;
+}
+
+//False once a consumer has exited or timed out (see producerConsumerAttached).  Blocks are dropped rather than waiting
+//for a consumer to reattach
+static bool rxFifosAttached(sharedMemoryFIFO_t *rxFifo, int numChannels){
+    for(int chan = 0; chan<numChannels; chan++) {
+        if(!producerConsumerAttached(&rxFifo[chan])){
+            return false;
+        }
+    }
+    return true;
+}
+
+static void rxDropBlock(rxStaging_t *staging, int32_t block, int32_t blockLen, pipelineStats_t *stats, traceBuffer_t *trace){
+    staging->droppedSamples += blockLen;
+    pipelineStatsDropBlock(stats, blockLen);
+    traceInstant(trace, TRACE_RX_DROP, staging->sampleIndex[block]);
+}
+
+//Waits until every channel has room for the block.  Returns false if a consumer detached first
+static bool rxWaitForRoom(sharedMemoryFIFO_t *rxFifo, int numChannels, size_t fifoBlockSizeBytes){
+    int spins = 0;
+    while(!rxFifosHaveRoom(rxFifo, numChannels, fifoBlockSizeBytes)){
+        if(spins++ % CONSUMER_TIMEOUT_CHECK_SPINS == 0 && !rxFifosAttached(rxFifo, numChannels)){
+            return false;
+        }
+    }
+    return rxFifosAttached(rxFifo, numChannels);
+}
+
+//The block is written to every channel or to none of them (so that the channels stay aligned).  Returns false if a
+//consumer detached while waiting for room (the block is counted as dropped)
+static bool rxWriteStagedBlock(rxStaging_t *staging, int32_t block, sharedMemoryFIFO_t *rxFifo, int numChannels,
+                               size_t fifoBlockSizeBytes, int32_t blockLen, pipelineStats_t *stats, traceBuffer_t *trace){
+    uint64_t waitStart = pipelineStatsNow();
+    bool written = rxWaitForRoom(rxFifo, numChannels, fifoBlockSizeBytes);
+    for(int chan = 0; chan<numChannels && written; chan++) {
+        char *fifoBlock = rxStagingBlock(staging, chan, block);
+        if(staging->headerBytes > 0){
+            rxBlockHeader_t *header = (rxBlockHeader_t*) fifoBlock;
+            header->sampleIndex = staging->sampleIndex[block];
+            header->droppedSamples = staging->droppedSamples;
+            header->flags = staging->droppedSamples > 0 ? RX_BLOCK_FLAG_DISCONTINUITY : 0;
+            if(staging->configSeq[block] != staging->writtenConfigSeq){
+                header->flags |= RX_BLOCK_FLAG_CONFIG_CHANGE;
+            }
+            if(staging->recovered){
+                header->flags |= RX_BLOCK_FLAG_RECOVERED;
+            }
+            header->configSeq = staging->configSeq[block];
+        }
+        //There is room, so this only fails if the consumer detached since the check (its FIFO is reset when it reattaches)
+        if(writeFifo(fifoBlock, fifoBlockSizeBytes, 1, &rxFifo[chan]) == 0){
+            written = false;
+        }
+    }
+    uint64_t waitEnd = pipelineStatsNow();
+    pipelineStatsFifoWait(stats, waitStart, waitEnd);
+    if(!written){
+        rxDropBlock(staging, block, blockLen, stats, trace);
+        return false;
+    }
+    pipelineStatsFifoOccupancy(stats, (uint64_t) atomic_load(rxFifo[0].fifoCount));
+    if(trace != NULL){
+        traceLog(trace, TRACE_FIFO_COMMIT, waitStart, waitEnd, staging->sampleIndex[block]);
+    }
+    staging->droppedSamples = 0;
+    staging->recovered = false;
+    staging->writtenConfigSeq = staging->configSeq[block];
+    pipelineStatsAddBlock(stats, blockLen);
+    return true;
+}
+
+//Writes completed blocks (oldest first) until the FIFOs are full
+static void rxDrainStaging(rxStaging_t *staging, sharedMemoryFIFO_t *rxFifo, int numChannels,
+                           size_t fifoBlockSizeBytes, int32_t blockLen, pipelineStats_t *stats, traceBuffer_t *trace){
+    while(staging->count > 0 && rxFifosHaveRoom(rxFifo, numChannels, fifoBlockSizeBytes)){
+        rxWriteStagedBlock(staging, staging->head, rxFifo, numChannels, fifoBlockSizeBytes, blockLen, stats, trace);
+        staging->head = (staging->head + 1) % staging->numBlocks;
+        staging->count--;
+    }
+}
+
+size_t rxFifoBlockSizeBytes(int32_t blockLen, bool blockHeader){
+    return (blockHeader ? sizeof(rxBlockHeader_t) : 0) + SAMPLE_SIZE*blockLen;
+}
+
+//Configures the stream (the libbladeRF worker thread is created here) and enables the channels (see
+//radioDeviceStartStream_t)
+static bool rxStartStream(void *uncastArgs){
+    rxThreadArgs_t *args = (rxThreadArgs_t*) uncastArgs;
+    radioDevice_t *device = args->device;
+    int numChannels = args->numChannels;
+    bladerf_channel_layout layout = numChannels == 2 ? BLADERF_RX_X2 : BLADERF_RX_X1;
+    int status = radioDeviceSyncConfig(device, layout, bladeRFFormat(args->sampleFormat, false),
+                                       args->bladeRFNumBuffers, args->bladeRFBlockLen, args->bladeRFNumTransfers, args->bladeRFTimeout,
+                                       args->workerCpu, args->rtPolicy, args->workerPriority, "Rx");
+    if (status != 0) {
+        fprintf(stderr, "Failed to configure bladeRF Rx: %s\n",
+                bladerf_strerror(status));
+        return false;
+    }
+
+    //Start Rx
+    for(int chan = 0; chan<numChannels; chan++) {
+        status = radioDeviceEnableModule(device, BLADERF_CHANNEL_RX(chan), true);
+        if (status != 0) {
+            fprintf(stderr, "Failed to enable bladeRF Rx%d: %s\n", chan, bladerf_strerror(status));
+            return false;
+        }
+    }
+    return true;
+}
 
 void* rxThread(void* uncastArgs){
     rxThreadArgs_t* args = (rxThreadArgs_t*) uncastArgs;
-    char *rxSharedName = args->rxSharedName;
+    startupTrace_t startupTrace;
+    startupTraceInit(&startupTrace);
+    int numChannels = args->numChannels;
 
     int32_t blockLen = args->blockLen;
     int32_t fifoSizeBlocks = args->fifoSizeBlocks;
     bool print = args->print;
 
     volatile bool *stop = args->stop;
+    pipelineStats_t *stats = args->stats;
+#ifdef STAGE_TIMING
+    stageTiming_t *timing = args->timing; //Only used by the STAGE_TIMING_* macros
+#endif
+    traceBuffer_t *trace = args->trace;
 
-    struct bladerf *dev = args->dev;
+    radioDevice_t *device = args->device;
+    sampleFormat_t sampleFormat = args->sampleFormat;
     SAMPLE_COMPONENT_DATATYPE fullRangeValue = args->fullRangeValue;
     uint32_t bladeRFBlockLen = args->bladeRFBlockLen;
-    uint32_t bladeRFNumBuffers = args->bladeRFNumBuffers;
-    uint32_t bladeRFNumTransfers = args->bladeRFNumTransfers;
 
-    SAMPLE_COMPONENT_DATATYPE scaleFactor = (SAMPLE_COMPONENT_DATATYPE) fullRangeValue / BLADERF_FULL_RANGE_VALUE;
+    //In MIMO mode, the bladeRF buffer contains the interleaved samples from each channel
+    uint32_t bladeRFSampsPerChan = bladeRFBlockLen/numChannels;
+
+    size_t bladeRFSampleBytes = bladeRFSampleSize(sampleFormat);
+    SAMPLE_COMPONENT_DATATYPE scaleFactor = (SAMPLE_COMPONENT_DATATYPE) fullRangeValue / bladeRFFullRangeValue(sampleFormat);
+    //The DC offsets are given in the 12 bit ADC scale
+    double dcOffsetScale = (double) bladeRFFullRangeValue(sampleFormat) / BLADERF_FULL_RANGE_VALUE;
 
     //Get the correction parameters
-    //Scale down to a float
-    SAMPLE_COMPONENT_DATATYPE dc_I = (SAMPLE_COMPONENT_DATATYPE) args->dcOffsetI;
-    SAMPLE_COMPONENT_DATATYPE dc_Q = (SAMPLE_COMPONENT_DATATYPE) args->dcOffsetQ;
-    double iq_A_dbl, iq_C_dbl, iq_D_dbl;
-    getIQImbalCorrections(args->iqGain, args->iqPhase_deg, &iq_A_dbl, &iq_C_dbl, &iq_D_dbl);
-    SAMPLE_COMPONENT_DATATYPE iq_A = (SAMPLE_COMPONENT_DATATYPE) iq_A_dbl;
-    SAMPLE_COMPONENT_DATATYPE iq_C = (SAMPLE_COMPONENT_DATATYPE) iq_C_dbl;
-    SAMPLE_COMPONENT_DATATYPE iq_D = (SAMPLE_COMPONENT_DATATYPE) iq_D_dbl;
-    printf("Rx: DC Offset (I, Q)=(%5.2f, %5.2f), I/Q Imbalance (Gain, Phase.deg)=(%5.3f, %5.3f), Correction (A, C, D)=(%5.2f, %5.2f, %5.2f)\n", dc_I, dc_Q, args->iqGain, args->iqPhase_deg, iq_A, iq_C, iq_D);
-	
-    #ifdef WRITE_RX_CSV
-        printf("Writing to ./bladeRF_rx.csv\n");
-        FILE *rxCSV = fopen("./bladeRF_rx.csv", "w");
-        fprintf(rxCSV, "re,im\n");
-    #endif
-	
-    //---- Constants for opening FIFOs ----
-    sharedMemoryFIFO_t rxFifo;
+    iqCorrection_t corrections[BLADERF_MAX_CHANNELS];
+    for(int chan = 0; chan<numChannels; chan++) {
+        initIQCorrection(&corrections[chan], args->dcOffsetI[chan]*dcOffsetScale, args->dcOffsetQ[chan]*dcOffsetScale, args->iqGain[chan], args->iqPhase_deg[chan]);
+        char label[8];
+        snprintf(label, 8, "Rx%d", chan);
+        printIQCorrection(label, &corrections[chan], args->iqGain[chan], args->iqPhase_deg[chan]);
+    }
+
+    //The recording tap only copies samples into the recorder's ring, a separate thread writes them to disk
+    recorder_t *recorder = args->recorder;
+    recordFormat_t recordFormat = args->recordFormat;
+    capture_t *capture = args->capture;
+    controlMailbox_t *control = args->control;
 
-    initSharedMemoryFIFO(&rxFifo);
+    //---- Constants for opening FIFOs ----
+    sharedMemoryFIFO_t rxFifo[BLADERF_MAX_CHANNELS];
 
-    size_t fifoBufferBlockSizeBytes = SAMPLE_SIZE*blockLen;
+    //With -rxBlockHeader, each block is prefixed with a rxBlockHeader_t
+    size_t fifoBlockHeaderSizeBytes = args->blockHeader ? sizeof(rxBlockHeader_t) : 0;
+    size_t fifoBufferBlockSizeBytes = rxFifoBlockSizeBytes(blockLen, args->blockHeader);
     size_t fifoBufferSizeBytes = fifoBufferBlockSizeBytes*fifoSizeBlocks;
 
     // printf("FIFO Block Size (Samples): %d\n", blockLen);
@@ -63,128 +250,328 @@ void* rxThread(void* uncastArgs){
     // printf("FIFO Buffer Size (Samples): %d\n", fifoSizeBlocks);
     // printf("FIFO Buffer Size (Bytes): %d\n", fifoBufferSizeBytes);
 
-    //Initialize Producer FIFOs first to avoid deadlock
-    producerOpenInitFIFO(rxSharedName, fifoBufferSizeBytes, &rxFifo);
+    //The producer FIFOs were created during bring-up (overlapped with the board configuration)
+    for(int chan = 0; chan<numChannels; chan++) {
+        rxFifo[chan] = args->fifos[chan];
+    }
+    atomic_store_explicit(&stats->fifoSizeBytes, fifoBufferSizeBytes, memory_order_relaxed);
+
+    rxOverflowPolicy_t overflowPolicy = args->overflowPolicy;
+    if(overflowPolicy != RX_OVERFLOW_BLOCK){
+        //The FIFOs are only checked (not waited on) once streaming, wait for the consumers before starting the Rx so
+        //that blocks are not dropped while the consumers start
+        if(print){
+            printf("Rx waiting for the consumer to open the Shared Memory FIFO\n");
+        }
+        for(int chan = 0; chan<numChannels; chan++) {
+            producerWaitForConsumer(&rxFifo[chan]);
+        }
+    }
 
     //Allocate Buffers
-    SAMPLE_COMPONENT_DATATYPE* sharedMemFIFOSampBuffer = (SAMPLE_COMPONENT_DATATYPE*) vitis_aligned_alloc(MEM_ALIGNMENT, fifoBufferBlockSizeBytes);
+    //Samples are converted directly into the staging blocks
+    rxStaging_t staging;
+    staging.numBlocks = overflowPolicy == RX_OVERFLOW_DROP_OLDEST ? args->overflowBacklogBlocks : 1;
+    staging.headerBytes = fifoBlockHeaderSizeBytes;
+    staging.strideBytes = (fifoBufferBlockSizeBytes + MEM_ALIGNMENT - 1) / MEM_ALIGNMENT * MEM_ALIGNMENT;
+    staging.head = 0;
+    staging.count = 0;
+    staging.droppedSamples = 0;
+    staging.recovered = false;
+    bool consumersAttached = true;
+    staging.sampleIndex = (uint64_t*) malloc(sizeof(uint64_t)*staging.numBlocks);
+    staging.configSeq = (uint32_t*) calloc(staging.numBlocks, sizeof(uint32_t));
+    staging.writtenConfigSeq = 0;
+    for(int chan = 0; chan<numChannels; chan++) {
+        staging.blocks[chan] = (char*) vitis_aligned_alloc(MEM_ALIGNMENT, staging.strideBytes*staging.numBlocks);
+        //The header is zero except for the fields set when the block is written
+        memset(staging.blocks[chan], 0, staging.strideBytes*staging.numBlocks);
+    }
+    SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_re[BLADERF_MAX_CHANNELS];
+    SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_im[BLADERF_MAX_CHANNELS];
+    for(int chan = 0; chan<numChannels; chan++) {
+        SAMPLE_COMPONENT_DATATYPE *sharedMemFIFOSampBuffer = (SAMPLE_COMPONENT_DATATYPE*) (rxStagingBlock(&staging, chan, 0) + fifoBlockHeaderSizeBytes);
+        sharedMemFIFO_re[chan] = sharedMemFIFOSampBuffer;
+        sharedMemFIFO_im[chan] = sharedMemFIFOSampBuffer+blockLen;
+    }
     //While this array can be of "any reasonable size" according to https://www.nuand.com/bladeRF-doc/libbladeRF/v2.2.1/sync_no_meta.html,
     //will keep it the same as the requested bladeRF buffer lengths at the underlying bladeRF buffer length has to be filled in order to send samples down to the FPGA
-    //The elements are complex 16 bit numbers (32 bits total)
-    int16_t* bladeRFSampBuffer = (int16_t*) vitis_aligned_alloc(MEM_ALIGNMENT, sizeof(int16_t)*2*bladeRFBlockLen);
+    //The elements are complex 16 bit numbers (32 bits total) for SC16_Q11 or complex 8 bit numbers (16 bits total) for SC8_Q7
+    void* bladeRFSampBuffer = vitis_aligned_alloc(MEM_ALIGNMENT, bladeRFSampleBytes*bladeRFBlockLen);
 
-    SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_re = sharedMemFIFOSampBuffer;
-    SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_im = sharedMemFIFOSampBuffer+blockLen;
+    //In MIMO mode, the bladeRF buffer is deinterleaved into a buffer per channel before conversion
+    void* bladeRFChanSampBuffer[BLADERF_MAX_CHANNELS];
+    if(numChannels == 1){
+        bladeRFChanSampBuffer[0] = bladeRFSampBuffer;
+    }else{
+        for(int chan = 0; chan<numChannels; chan++) {
+            bladeRFChanSampBuffer[chan] = vitis_aligned_alloc(MEM_ALIGNMENT, bladeRFSampleBytes*bladeRFSampsPerChan);
+        }
+    }
 
-    int status = bladerf_sync_config(dev, BLADERF_RX_X1, BLADERF_FORMAT_SC16_Q11,
-                                     bladeRFNumBuffers, bladeRFBlockLen, bladeRFNumTransfers,
-                                     1000);
-    if (status != 0) {
-        fprintf(stderr, "Failed to configure bladeRF Rx: %s\n",
-                bladerf_strerror(status));
-        exit(1);
+    //Prefault and lock the working buffers from this (pinned) thread so that they are local to it and the first blocks
+    //do not incur page faults
+    bool buffersLocked = prefaultBuffer(bladeRFSampBuffer, bladeRFSampleBytes*bladeRFBlockLen);
+    for(int chan = 0; chan<numChannels; chan++) {
+        buffersLocked &= prefaultBuffer(staging.blocks[chan], staging.strideBytes*staging.numBlocks);
+        if(numChannels > 1) {
+            buffersLocked &= prefaultBuffer(bladeRFChanSampBuffer[chan], bladeRFSampleBytes*bladeRFSampsPerChan);
+        }
+    }
+    if(!buffersLocked){
+        printf("Warning: Unable to lock Rx buffers in memory\n");
     }
 
-    //Start Rx
-    status = bladerf_enable_module(dev, BLADERF_RX, true);
-    if (status != 0) {
-        fprintf(stderr, "Failed to enable bladeRF Rx: %s\n", bladerf_strerror(status));
+    if(!rxStartStream(args)){
         return NULL;
     }
-    
+    int status;
+
+    startupTraceSetupDone(&startupTrace);
+
     if(print){
         printf("Configured Rx\n");
-        reportBladeRFChannelState(dev, false, 0);
+        for(int chan = 0; chan<numChannels; chan++) {
+            radioDeviceReportChannelState(device, false, chan);
+        }
     }
     //Main Loop
 
     //Get a block of samples from the bladeRF.  Process them by copying them to the shared memory buffer.  Write
     //to the FIFO as the buffer fills.  Do this until the bladeRF block is processed.  Save any remaining samples in the
     //shared memory buffer.
+    //In MIMO mode, each channel has its own FIFO.  The channels are processed in lockstep.
+    //With a policy other than RX_OVERFLOW_BLOCK, blocks that do not fit in the FIFOs are dropped rather than stalling
+    //the Rx.  Completed blocks are staged and written when the FIFOs have room.
     int sharedMemPos = 0;
+    uint64_t sampleIndex = 0;
+    uint64_t bladeRFSampleIndex = 0;
+    uint32_t configSeq = 0;
     while(!(*stop)){
         #ifdef DEBUG
         printf("About to read Rx samples from BladeRf\n");
         #endif
         //Get samples from bladeRF
-        status = bladerf_sync_rx(dev, bladeRFSampBuffer, bladeRFBlockLen, NULL, 0);
+        STAGE_TIMING_START(syncStart);
+        uint64_t readStart = traceNow(trace);
+        uint64_t readStartNs = pipelineStatsNow();
+        status = radioDeviceSyncRx(device, bladeRFSampBuffer, bladeRFBlockLen, NULL, 0);
+        traceSpan(trace, TRACE_DEVICE_READ, readStart, bladeRFSampleIndex);
+        STAGE_TIMING_END(timing, RX_STAGE_SYNC, syncStart);
+        if (status == RADIO_DEVICE_END_OF_STREAM) {
+            printf("Rx replay reached the end of the recording\n");
+            break;
+        }
         if (status != 0) {
-            fprintf(stderr, "Failed bladeRF Rx: %s\n",
-                    bladerf_strerror(status));
-            return NULL;
+            //RADIO_DEVICE_REOPENED: the Tx already reopened the device after a failure
+            if(status != RADIO_DEVICE_REOPENED){
+                fprintf(stderr, "Failed bladeRF Rx: %s\n",
+                        bladerf_strerror(status));
+            }
+            //The stream failed (ex. a USB error).  Reopen the device and restart the stream, the FIFOs stay open
+            if(!radioDeviceRecover(device, false, rxStartStream, args, stop, print)){
+                return NULL;
+            }
+
+            //Blocks held while the FIFOs were full are delivered if they fit, the block being filled is discarded
+            rxDrainStaging(&staging, rxFifo, numChannels, fifoBufferBlockSizeBytes, blockLen, stats, trace);
+            while(staging.count > 0){
+                rxDropBlock(&staging, staging.head, blockLen, stats, trace);
+                staging.head = (staging.head + 1) % staging.numBlocks;
+                staging.count--;
+            }
+            int32_t fillBlock = rxStagingFillBlock(&staging);
+            for(int chan = 0; chan<numChannels; chan++) {
+                SAMPLE_COMPONENT_DATATYPE *sharedMemFIFOSampBuffer = (SAMPLE_COMPONENT_DATATYPE*) (rxStagingBlock(&staging, chan, fillBlock) + fifoBlockHeaderSizeBytes);
+                sharedMemFIFO_re[chan] = sharedMemFIFOSampBuffer;
+                sharedMemFIFO_im[chan] = sharedMemFIFOSampBuffer+blockLen;
+            }
+
+            //The samples captured during the outage are lost.  The count is estimated from the time since the failed
+            //call was issued so that the sample index keeps tracking the time
+            uint64_t outageNs = pipelineStatsNow() - readStartNs;
+            uint64_t outageSamples = (uint64_t) (outageNs*1e-9*args->sampRate);
+            staging.droppedSamples += sharedMemPos + outageSamples;
+            staging.recovered = true;
+            sampleIndex += sharedMemPos + outageSamples;
+            bladeRFSampleIndex += outageSamples;
+            sharedMemPos = 0;
+            pipelineStatsRecovery(stats, outageNs);
+            if(print){
+                printf("Rx restarted after %.1f ms (%lu samples lost)\n", outageNs/1e6, staging.droppedSamples);
+            }
+            continue;
         }
         #ifdef DEBUG
         printf("Read Rx samples from BladeRf\n");
         #endif
+        STAGE_TIMING_START(tapsStart);
+        if(recordFormat == RECORD_RAW || recordFormat == RECORD_COMPRESSED){
+            recorderWriteRaw(recorder, bladeRFSampBuffer, bladeRFSampsPerChan, bladeRFSampleIndex);
+        }
+        if(capture != NULL){
+            captureWriteRaw(capture, bladeRFSampBuffer, bladeRFSampsPerChan, bladeRFSampleIndex);
+        }
+        STAGE_TIMING_END(timing, RX_STAGE_TAPS, tapsStart);
+        bladeRFSampleIndex += bladeRFSampsPerChan;
+        struct timespec processingStart;
+        if(print && startupTraceActive(&startupTrace)){
+            clock_gettime(CLOCK_MONOTONIC, &processingStart);
+        }
+
+        if(staging.count > 0){
+            //Catch up on blocks held while the FIFOs were full
+            STAGE_TIMING_START(drainStart);
+            rxDrainStaging(&staging, rxFifo, numChannels, fifoBufferBlockSizeBytes, blockLen, stats, trace);
+            STAGE_TIMING_END(timing, RX_STAGE_FIFO, drainStart);
+        }
+
+        //The conversion of the bladeRF buffer is recorded as one stage (excluding the FIFO handoffs it is split by)
+        STAGE_TIMING_DECLARE(convertTicks);
+        STAGE_TIMING_START(deinterleaveStart);
+        if(numChannels == 2){
+            deinterleaveX2(sampleFormat, bladeRFSampBuffer, bladeRFChanSampBuffer[0], bladeRFChanSampBuffer[1], bladeRFSampsPerChan);
+        }
+        STAGE_TIMING_ADD(convertTicks, deinterleaveStart);
 
         int bladeRFBufferPos = 0;
-        while(bladeRFBufferPos < bladeRFBlockLen) {
+        while(bladeRFBufferPos < bladeRFSampsPerChan) {
             //Find the number of samples to handle
-            int remainingSamplesBladeRFToProcess = bladeRFBlockLen - bladeRFBufferPos;
+            int remainingSamplesBladeRFToProcess = bladeRFSampsPerChan - bladeRFBufferPos;
             int remainingSharedMemorySpace = blockLen - sharedMemPos;
             int numToProcess = remainingSamplesBladeRFToProcess < remainingSharedMemorySpace ? remainingSamplesBladeRFToProcess : remainingSharedMemorySpace;
             #ifdef DEBUG
             printf("Rx Samples Being Processed: %d\n", numToProcess);
             #endif
 
-            SAMPLE_COMPONENT_DATATYPE dcCorrectScaled_re[numToProcess];
-            SAMPLE_COMPONENT_DATATYPE dcCorrectScaled_im[numToProcess];
-            for(int i = 0; i<numToProcess; i++){
-                dcCorrectScaled_re[i] = (((SAMPLE_COMPONENT_DATATYPE) bladeRFSampBuffer[2 * (bladeRFBufferPos + i)    ]) - dc_I) * scaleFactor;
-                dcCorrectScaled_im[i] = (((SAMPLE_COMPONENT_DATATYPE) bladeRFSampBuffer[2 * (bladeRFBufferPos + i) + 1]) - dc_Q) * scaleFactor;
-            }
-
-            //IQ Correct & copy to shared memory buffer
-            for(int i = 0; i<numToProcess; i++){
-                // printf("Rx: %5d, %5d\n", bladeRFSampBuffer[2 * (bladeRFBufferPos+i)    ], bladeRFSampBuffer[2 * (bladeRFBufferPos+i) + 1]);
-                sharedMemFIFO_re[sharedMemPos+i] = iq_A*dcCorrectScaled_re[i];
-                sharedMemFIFO_im[sharedMemPos+i] = iq_C*dcCorrectScaled_re[i] + iq_D*dcCorrectScaled_im[i];
-                // printf("Rx: %15.10f, %15.10f\n", sharedMemFIFO_re[sharedMemPos+i], sharedMemFIFO_im[sharedMemPos+i]);
+            //DC Correct, Scale, IQ Correct & copy to shared memory buffer
+            STAGE_TIMING_START(convertStart);
+            uint64_t convertTraceStart = traceNow(trace);
+            for(int chan = 0; chan<numChannels; chan++) {
+                int clipped = convertRxBladeRFSamples(sampleFormat, bladeRFChanSampBuffer[chan], bladeRFBufferPos,
+                                                      sharedMemFIFO_re[chan] + sharedMemPos, sharedMemFIFO_im[chan] + sharedMemPos,
+                                                      numToProcess, scaleFactor, &corrections[chan]);
+                pipelineStatsClipped(stats, (uint64_t) clipped);
             }
+            STAGE_TIMING_ADD(convertTicks, convertStart);
+            traceSpan(trace, TRACE_CONVERT, convertTraceStart, sampleIndex);
 
             sharedMemPos += numToProcess;
             bladeRFBufferPos += numToProcess;
 
             if(sharedMemPos >= blockLen) {
-                //Write samples to rx pipe (ok to block)
-                // printf("About to write samples to rx FIFO\n");
+                //Blocks are recorded whether or not they fit in the FIFOs
+                if(recordFormat == RECORD_FIFO){
+                    recorderWriteFifoBlock(recorder, sharedMemFIFO_re, sharedMemFIFO_im, blockLen, sampleIndex);
+                }
+
+                int32_t completedBlock = rxStagingFillBlock(&staging);
+                staging.sampleIndex[completedBlock] = sampleIndex;
+                staging.configSeq[completedBlock] = configSeq;
+                sampleIndex += blockLen;
+
                 #ifdef DEBUG
                 printf("Sending Rx samples to Shared Memory FIFO\n");
                 #endif
-                writeFifo(sharedMemFIFOSampBuffer, fifoBufferBlockSizeBytes, 1, &rxFifo);
-                sharedMemPos = 0;
+                STAGE_TIMING_START(handoffStart);
+                switch(overflowPolicy){
+                    case RX_OVERFLOW_DROP_NEWEST:
+                        if(rxFifosHaveRoom(rxFifo, numChannels, fifoBufferBlockSizeBytes)){
+                            rxWriteStagedBlock(&staging, completedBlock, rxFifo, numChannels, fifoBufferBlockSizeBytes, blockLen, stats, trace);
+                        }else{
+                            rxDropBlock(&staging, completedBlock, blockLen, stats, trace);
+                        }
+                        break;
+                    case RX_OVERFLOW_DROP_OLDEST:
+                        staging.count++;
+                        rxDrainStaging(&staging, rxFifo, numChannels, fifoBufferBlockSizeBytes, blockLen, stats, trace);
+                        if(staging.count == staging.numBlocks){
+                            //No free block to fill next, overwrite the oldest
+                            rxDropBlock(&staging, staging.head, blockLen, stats, trace);
+                            staging.head = (staging.head + 1) % staging.numBlocks;
+                            staging.count--;
+                        }
+                        break;
+                    default:
+                        //Write samples to rx pipe (ok to block unless the consumer has detached)
+                        if(rxFifosAttached(rxFifo, numChannels)){
+                            rxWriteStagedBlock(&staging, completedBlock, rxFifo, numChannels, fifoBufferBlockSizeBytes, blockLen, stats, trace);
+                        }else{
+                            rxDropBlock(&staging, completedBlock, blockLen, stats, trace);
+                        }
+                        break;
+                }
+                STAGE_TIMING_END(timing, RX_STAGE_FIFO, handoffStart);
+                if(print){
+                    bool attached = rxFifosAttached(rxFifo, numChannels);
+                    if(attached != consumersAttached){
+                        printf(attached ? "Rx consumer attached\n" : "Rx consumer detached, dropping blocks until it reattaches\n");
+                        consumersAttached = attached;
+                    }
+                }
                 #ifdef DEBUG
                 printf("Sent Rx samples to Shared Memory FIFO\n");
                 #endif
 
-                #ifdef WRITE_RX_CSV
-                //Write to CSV too
-                for(int i = 0; i<blockLen; i++){
-                    fprintf(rxCSV, "%f,%f\n", sharedMemFIFO_re[i], sharedMemFIFO_im[i]);
+                int32_t fillBlock = rxStagingFillBlock(&staging);
+                for(int chan = 0; chan<numChannels; chan++) {
+                    SAMPLE_COMPONENT_DATATYPE *sharedMemFIFOSampBuffer = (SAMPLE_COMPONENT_DATATYPE*) (rxStagingBlock(&staging, chan, fillBlock) + fifoBlockHeaderSizeBytes);
+                    sharedMemFIFO_re[chan] = sharedMemFIFOSampBuffer;
+                    sharedMemFIFO_im[chan] = sharedMemFIFOSampBuffer+blockLen;
+                }
+                sharedMemPos = 0;
+
+                if(controlMailboxPending(control)){
+                    //The next block is the first with the change applied
+                    if(controlMailboxApply(control, sampleIndex, device, false, numChannels, corrections, dcOffsetScale,
+                                           args->dcOffsetI, args->dcOffsetQ, args->iqGain, args->iqPhase_deg) == 0){
+                        configSeq++;
+                    }
                 }
-                #endif
             }
         }
 
         //Done processing bladeRF buffer
+        STAGE_TIMING_RECORD(timing, RX_STAGE_CONVERT, convertTicks);
+        if(print && startupTraceActive(&startupTrace)){
+            struct timespec processingEnd;
+            clock_gettime(CLOCK_MONOTONIC, &processingEnd);
+            startupTraceBuffer(&startupTrace, difftimespec(&processingEnd, &processingStart));
+            if(!startupTraceActive(&startupTrace)){
+                startupTraceReport(&startupTrace, "Rx");
+            }
+        }
     }
 
     //Stop Rx
-    status = bladerf_enable_module(dev, BLADERF_RX, false);
-    if (status != 0) {
-        fprintf(stderr, "Failed to stop bladeRF Rx: %s\n", bladerf_strerror(status));
-        return NULL;
+    for(int chan = 0; chan<numChannels; chan++) {
+        status = radioDeviceEnableModule(device, BLADERF_CHANNEL_RX(chan), false);
+        if (status != 0) {
+            fprintf(stderr, "Failed to stop bladeRF Rx%d: %s\n", chan, bladerf_strerror(status));
+            return NULL;
+        }
     }
     if(print){
+        startupTraceReport(&startupTrace, "Rx");
+        //Blocks are also dropped while no consumer is attached (with any overflow policy)
+        uint64_t samplesDropped = atomic_load_explicit(&stats->samplesDropped, memory_order_relaxed);
+        if(overflowPolicy != RX_OVERFLOW_BLOCK || samplesDropped > 0){
+            printf("Rx Dropped %lu Samples (%lu Blocks) with the %s overflow policy or while no consumer was attached\n",
+                   samplesDropped, atomic_load_explicit(&stats->blocksDropped, memory_order_relaxed),
+                   rxOverflowPolicyToStr(overflowPolicy));
+        }
         printf("BladeRF Rx Stopped");
     }
 
-    #ifdef WRITE_RX_CSV
-    fclose(rxCSV);
-    #endif
-
-    free(sharedMemFIFOSampBuffer);
+    for(int chan = 0; chan<numChannels; chan++) {
+        free(staging.blocks[chan]);
+        if(numChannels > 1) {
+            free(bladeRFChanSampBuffer[chan]);
+        }
+    }
     free(bladeRFSampBuffer);
+    free(staging.sampleIndex);
+    free(staging.configSeq);
 
     return NULL;
-}
\ No newline at end of file
+}
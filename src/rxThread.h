@@ -9,28 +9,77 @@
 #include <stdbool.h>
 
 #include "helpers.h"
+#include "pipelineStats.h"
+#include "stageTiming.h"
+#include "eventTrace.h"
+#include "sampleConversion.h"
+#include "rtPolicy.h"
+#include "radioDevice.h"
+#include "recorder.h"
+#include "capture.h"
+#include "controlMailbox.h"
+#include "depends/BerkeleySharedMemoryFIFO.h"
+
+//What the Rx thread does when the Shared Memory FIFO is full
+typedef enum{
+    RX_OVERFLOW_BLOCK = 0,       //Wait for the consumer (stalls bladerf_sync_rx, libbladeRF drops samples silently)
+    RX_OVERFLOW_DROP_NEWEST = 1, //Discard the block that does not fit
+    RX_OVERFLOW_DROP_OLDEST = 2  //Hold blocks in a local backlog, overwriting the oldest when the backlog is full
+} rxOverflowPolicy_t;
+
+#define RX_DEFAULT_OVERFLOW_BACKLOG (4) //Blocks
+
+//Returns false if the string is not a known policy ("block", "dropNewest", or "dropOldest")
+bool parseRxOverflowPolicy(char *str, rxOverflowPolicy_t *policy);
+
+char* rxOverflowPolicyToStr(rxOverflowPolicy_t policy);
+
+//Size of one block in the Rx FIFO (with the rxBlockHeader_t if enabled)
+size_t rxFifoBlockSizeBytes(int32_t blockLen, bool blockHeader);
 
 typedef struct{
-    char *rxSharedName;
+    char *rxSharedName[BLADERF_MAX_CHANNELS]; //One FIFO per channel
+    sharedMemoryFIFO_t *fifos; //Producer side of the FIFOs, created during bring-up (see rxFifoBlockSizeBytes)
+    int numChannels; //1 for SISO (BLADERF_RX_X1), 2 for MIMO (BLADERF_RX_X2)
 
     int32_t blockLen;
     int32_t fifoSizeBlocks;
 
     volatile bool *stop; //Used to stop ADC/DAC in the event that the program is signaled (for orderly shutdown)
     bool print;
+    pipelineStats_t *stats; //Counters for the status report
+    stageTiming_t *timing; //Per-stage latency histograms (NULL when built without STAGE_TIMING)
+    traceBuffer_t *trace; //Block lifecycle events (NULL if not tracing)
+
+    rxOverflowPolicy_t overflowPolicy;
+    int32_t overflowBacklogBlocks; //Number of blocks held locally with RX_OVERFLOW_DROP_OLDEST
+    bool blockHeader; //Each block in the Rx FIFO is prefixed with a rxBlockHeader_t
+
+    recorder_t *recorder; //Disk recording tap (NULL if not recording)
+    recordFormat_t recordFormat;
+    capture_t *capture; //Pre-trigger capture ring (NULL if not capturing)
+    controlMailbox_t *control; //Runtime changes from the control socket (NULL if there is none)
 
     //BladeRFParams
-    struct bladerf *dev;
-    SAMPLE_COMPONENT_DATATYPE fullRangeValue; //Will scale this to be 2047
+    radioDevice_t *device; //bladeRF board or simulated bladeRF
+    sampleFormat_t sampleFormat; //Format of the samples on the link to the bladeRF (SC16_Q11 or SC8_Q7)
+    SAMPLE_COMPONENT_DATATYPE fullRangeValue; //Will scale this to be the full range of the sample format (2047 for SC16_Q11, 127 for SC8_Q7)
     uint32_t bladeRFBlockLen; //Needs to be a multiple of 1024, example gives 8192
     uint32_t bladeRFNumBuffers; //Example gives 16
     uint32_t bladeRFNumTransfers;
+    uint32_t bladeRFTimeout; //Stream timeout (ms)
+    uint32_t sampRate; //Used to estimate the samples lost while the device is reopened (radioDeviceRecover)
+    //Placement of the libbladeRF worker thread (created by bladerf_sync_config)
+    rtPolicy_t rtPolicy;
+    int workerCpu; //-1 to inherit from this thread
+    int workerPriority; //-1 to inherit from this thread
 
-    //Impairments
-    double dcOffsetI;
-    double dcOffsetQ;
-    double iqGain;
-    double iqPhase_deg;
+    //Impairments (per channel)
+    //The DC offsets are in the 12 bit ADC/DAC scale regardless of the sample format
+    double dcOffsetI[BLADERF_MAX_CHANNELS];
+    double dcOffsetQ[BLADERF_MAX_CHANNELS];
+    double iqGain[BLADERF_MAX_CHANNELS];
+    double iqPhase_deg[BLADERF_MAX_CHANNELS];
 } rxThreadArgs_t;
 
 void* rxThread(void* uncastArgs);
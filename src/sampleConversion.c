@@ -0,0 +1,267 @@
+//
+// Conversion kernels between the bladeRF sample format and the Shared Memory FIFO sample format
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "sampleConversion.h"
+
+//The kernels are written as a series of simple loops over local arrays so that they can be auto-vectorized
+
+void initIQCorrection(iqCorrection_t *corr, double dcOffsetI, double dcOffsetQ, double iqGain, double iqPhase_deg){
+    //Scale down to a float
+    corr->dc_I = (SAMPLE_COMPONENT_DATATYPE) dcOffsetI;
+    corr->dc_Q = (SAMPLE_COMPONENT_DATATYPE) dcOffsetQ;
+    double iq_A_dbl, iq_C_dbl, iq_D_dbl;
+    getIQImbalCorrections(iqGain, iqPhase_deg, &iq_A_dbl, &iq_C_dbl, &iq_D_dbl);
+    corr->iq_A = (SAMPLE_COMPONENT_DATATYPE) iq_A_dbl;
+    corr->iq_C = (SAMPLE_COMPONENT_DATATYPE) iq_C_dbl;
+    corr->iq_D = (SAMPLE_COMPONENT_DATATYPE) iq_D_dbl;
+}
+
+void printIQCorrection(char *label, iqCorrection_t *corr, double iqGain, double iqPhase_deg){
+    printf("%s: DC Offset (I, Q)=(%5.2f, %5.2f), I/Q Imbalance (Gain, Phase.deg)=(%5.3f, %5.3f), Correction (A, C, D)=(%5.2f, %5.2f, %5.2f)\n",
+           label, corr->dc_I, corr->dc_Q, iqGain, iqPhase_deg, corr->iq_A, corr->iq_C, corr->iq_D);
+}
+
+bool parseSampleFormat(char *str, sampleFormat_t *format){
+    if(strcmp(str, "sc16") == 0){
+        *format = SAMPLE_FORMAT_SC16_Q11;
+    }else if(strcmp(str, "sc8") == 0){
+        *format = SAMPLE_FORMAT_SC8_Q7;
+    }else{
+        return false;
+    }
+    return true;
+}
+
+char* sampleFormatToStr(sampleFormat_t format){
+    switch(format){
+        case SAMPLE_FORMAT_SC16_Q11:
+            return "SC16_Q11";
+        case SAMPLE_FORMAT_SC8_Q7:
+            return "SC8_Q7";
+        default:
+            return "Unknown";
+    }
+}
+
+size_t bladeRFSampleSize(sampleFormat_t format){
+    return format == SAMPLE_FORMAT_SC8_Q7 ? sizeof(int8_t)*2 : sizeof(int16_t)*2;
+}
+
+int bladeRFFullRangeValue(sampleFormat_t format){
+    return format == SAMPLE_FORMAT_SC8_Q7 ? BLADERF_FULL_RANGE_VALUE_SC8 : BLADERF_FULL_RANGE_VALUE;
+}
+
+bladerf_format bladeRFFormat(sampleFormat_t format, bool meta){
+    if(format == SAMPLE_FORMAT_SC8_Q7){
+        return meta ? BLADERF_FORMAT_SC8_Q7_META : BLADERF_FORMAT_SC8_Q7;
+    }
+    return meta ? BLADERF_FORMAT_SC16_Q11_META : BLADERF_FORMAT_SC16_Q11;
+}
+
+//IQ Correct & copy to shared memory buffer
+static void correctRxSamples(const SAMPLE_COMPONENT_DATATYPE *dcCorrectScaled_re, const SAMPLE_COMPONENT_DATATYPE *dcCorrectScaled_im,
+                             SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_re, SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_im,
+                             int numToProcess, const iqCorrection_t *corr){
+    SAMPLE_COMPONENT_DATATYPE iq_A = corr->iq_A;
+    SAMPLE_COMPONENT_DATATYPE iq_C = corr->iq_C;
+    SAMPLE_COMPONENT_DATATYPE iq_D = corr->iq_D;
+
+    for(int i = 0; i<numToProcess; i++){
+        sharedMemFIFO_re[i] = iq_A*dcCorrectScaled_re[i];
+        sharedMemFIFO_im[i] = iq_C*dcCorrectScaled_re[i] + iq_D*dcCorrectScaled_im[i];
+        // printf("Rx: %15.10f, %15.10f\n", sharedMemFIFO_re[i], sharedMemFIFO_im[i]);
+    }
+}
+
+//Counts the components at (or beyond) full scale
+static int countClippedSC16(const int16_t *bladeRFSampBuffer, int numComponents, int16_t fullRange){
+    int clipped = 0;
+    for(int i = 0; i<numComponents; i++){
+        clipped += (bladeRFSampBuffer[i] >= fullRange) | (bladeRFSampBuffer[i] <= -fullRange);
+    }
+    return clipped;
+}
+
+static int countClippedSC8(const int8_t *bladeRFSampBuffer, int numComponents, int8_t fullRange){
+    int clipped = 0;
+    for(int i = 0; i<numComponents; i++){
+        clipped += (bladeRFSampBuffer[i] >= fullRange) | (bladeRFSampBuffer[i] <= -fullRange);
+    }
+    return clipped;
+}
+
+int convertRxSamples(const int16_t *bladeRFSampBuffer, SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_re, SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_im,
+                     int numToProcess, SAMPLE_COMPONENT_DATATYPE scaleFactor, const iqCorrection_t *corr){
+    SAMPLE_COMPONENT_DATATYPE dc_I = corr->dc_I;
+    SAMPLE_COMPONENT_DATATYPE dc_Q = corr->dc_Q;
+
+    SAMPLE_COMPONENT_DATATYPE dcCorrectScaled_re[numToProcess];
+    SAMPLE_COMPONENT_DATATYPE dcCorrectScaled_im[numToProcess];
+    for(int i = 0; i<numToProcess; i++){
+        // printf("Rx: %5d, %5d\n", bladeRFSampBuffer[2 * i    ], bladeRFSampBuffer[2 * i + 1]);
+        dcCorrectScaled_re[i] = (((SAMPLE_COMPONENT_DATATYPE) bladeRFSampBuffer[2 * i    ]) - dc_I) * scaleFactor;
+        dcCorrectScaled_im[i] = (((SAMPLE_COMPONENT_DATATYPE) bladeRFSampBuffer[2 * i + 1]) - dc_Q) * scaleFactor;
+    }
+
+    correctRxSamples(dcCorrectScaled_re, dcCorrectScaled_im, sharedMemFIFO_re, sharedMemFIFO_im, numToProcess, corr);
+    return countClippedSC16(bladeRFSampBuffer, 2*numToProcess, BLADERF_FULL_RANGE_VALUE);
+}
+
+int convertRxSamplesSC8(const int8_t *bladeRFSampBuffer, SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_re, SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_im,
+                        int numToProcess, SAMPLE_COMPONENT_DATATYPE scaleFactor, const iqCorrection_t *corr){
+    SAMPLE_COMPONENT_DATATYPE dc_I = corr->dc_I;
+    SAMPLE_COMPONENT_DATATYPE dc_Q = corr->dc_Q;
+
+    SAMPLE_COMPONENT_DATATYPE dcCorrectScaled_re[numToProcess];
+    SAMPLE_COMPONENT_DATATYPE dcCorrectScaled_im[numToProcess];
+    for(int i = 0; i<numToProcess; i++){
+        dcCorrectScaled_re[i] = (((SAMPLE_COMPONENT_DATATYPE) bladeRFSampBuffer[2 * i    ]) - dc_I) * scaleFactor;
+        dcCorrectScaled_im[i] = (((SAMPLE_COMPONENT_DATATYPE) bladeRFSampBuffer[2 * i + 1]) - dc_Q) * scaleFactor;
+    }
+
+    correctRxSamples(dcCorrectScaled_re, dcCorrectScaled_im, sharedMemFIFO_re, sharedMemFIFO_im, numToProcess, corr);
+    return countClippedSC8(bladeRFSampBuffer, 2*numToProcess, BLADERF_FULL_RANGE_VALUE_SC8);
+}
+
+//Predistorts for I/Q imbalance, scales, subtracts the DC offset, rounds, and (optionally) saturates to [-fullRange, fullRange]
+//The narrowing to the bladeRF sample type is done by the caller.  Returns the number of components beyond full scale
+static int scaleTxSamples(const SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_re, const SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_im,
+                           int32_t *scaled_re, int32_t *scaled_im, int numToProcess, SAMPLE_COMPONENT_DATATYPE scaleFactor,
+                           const iqCorrection_t *corr, bool saturate, int32_t fullRange){
+    SAMPLE_COMPONENT_DATATYPE dc_I = corr->dc_I;
+    SAMPLE_COMPONENT_DATATYPE dc_Q = corr->dc_Q;
+    SAMPLE_COMPONENT_DATATYPE iq_A = corr->iq_A;
+    SAMPLE_COMPONENT_DATATYPE iq_C = corr->iq_C;
+    SAMPLE_COMPONENT_DATATYPE iq_D = corr->iq_D;
+
+    //Predistort Here for I/Q Imbalance
+    SAMPLE_COMPONENT_DATATYPE iqPredistort_re[numToProcess];
+    SAMPLE_COMPONENT_DATATYPE iqPredistort_im[numToProcess];
+    for (int i = 0; i < numToProcess; i++) {
+        iqPredistort_re[i] = iq_A*sharedMemFIFO_re[i];
+        iqPredistort_im[i] = iq_C*sharedMemFIFO_re[i] + iq_D*sharedMemFIFO_im[i];
+    }
+
+    //Scale and Subtract DC Offset, then Round
+    for (int i = 0; i < numToProcess; i++) {
+        scaled_re[i] = (int32_t) SAMPLE_ROUND_FCTN(iqPredistort_re[i] * scaleFactor - dc_I);
+        scaled_im[i] = (int32_t) SAMPLE_ROUND_FCTN(iqPredistort_im[i] * scaleFactor - dc_Q);
+    }
+
+    int clipped = 0;
+    for (int i = 0; i < numToProcess; i++) {
+        clipped += (scaled_re[i] > fullRange) | (scaled_re[i] < -fullRange);
+        clipped += (scaled_im[i] > fullRange) | (scaled_im[i] < -fullRange);
+    }
+
+    if (saturate) {
+        for (int i = 0; i < numToProcess; i++) {
+            scaled_re[i] = scaled_re[i] > fullRange ? fullRange : (scaled_re[i] < -fullRange ? -fullRange : scaled_re[i]);
+            scaled_im[i] = scaled_im[i] > fullRange ? fullRange : (scaled_im[i] < -fullRange ? -fullRange : scaled_im[i]);
+        }
+    }
+    return clipped;
+}
+
+int convertTxSamples(const SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_re, const SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_im, int16_t *bladeRFSampBuffer,
+                     int numToProcess, SAMPLE_COMPONENT_DATATYPE scaleFactor, const iqCorrection_t *corr, bool saturate){
+    int32_t scaled_re[numToProcess];
+    int32_t scaled_im[numToProcess];
+    int clipped = scaleTxSamples(sharedMemFIFO_re, sharedMemFIFO_im, scaled_re, scaled_im, numToProcess, scaleFactor, corr, saturate, BLADERF_FULL_RANGE_VALUE);
+
+    //Copy to bladeRF buffer and perform interleave
+    for (int i = 0; i < numToProcess; i++) {
+        bladeRFSampBuffer[2 * i    ] = (int16_t) scaled_re[i];
+        bladeRFSampBuffer[2 * i + 1] = (int16_t) scaled_im[i];
+        // printf("Tx: %5d, %5d\n", bladeRFSampBuffer[2 * i    ], bladeRFSampBuffer[2 * i + 1]);
+    }
+    return clipped;
+}
+
+int convertTxSamplesSC8(const SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_re, const SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_im, int8_t *bladeRFSampBuffer,
+                        int numToProcess, SAMPLE_COMPONENT_DATATYPE scaleFactor, const iqCorrection_t *corr, bool saturate){
+    int32_t scaled_re[numToProcess];
+    int32_t scaled_im[numToProcess];
+    int clipped = scaleTxSamples(sharedMemFIFO_re, sharedMemFIFO_im, scaled_re, scaled_im, numToProcess, scaleFactor, corr, saturate, BLADERF_FULL_RANGE_VALUE_SC8);
+
+    for (int i = 0; i < numToProcess; i++) {
+        bladeRFSampBuffer[2 * i    ] = (int8_t) scaled_re[i];
+        bladeRFSampBuffer[2 * i + 1] = (int8_t) scaled_im[i];
+    }
+    return clipped;
+}
+
+void deinterleaveSC16X2(const int16_t *src, int16_t *dstCh0, int16_t *dstCh1, int numSampsPerChan){
+    for(int i = 0; i<numSampsPerChan; i++){
+        dstCh0[2 * i    ] = src[4 * i    ];
+        dstCh0[2 * i + 1] = src[4 * i + 1];
+        dstCh1[2 * i    ] = src[4 * i + 2];
+        dstCh1[2 * i + 1] = src[4 * i + 3];
+    }
+}
+
+void interleaveSC16X2(const int16_t *srcCh0, const int16_t *srcCh1, int16_t *dst, int numSampsPerChan){
+    for(int i = 0; i<numSampsPerChan; i++){
+        dst[4 * i    ] = srcCh0[2 * i    ];
+        dst[4 * i + 1] = srcCh0[2 * i + 1];
+        dst[4 * i + 2] = srcCh1[2 * i    ];
+        dst[4 * i + 3] = srcCh1[2 * i + 1];
+    }
+}
+
+void deinterleaveSC8X2(const int8_t *src, int8_t *dstCh0, int8_t *dstCh1, int numSampsPerChan){
+    for(int i = 0; i<numSampsPerChan; i++){
+        dstCh0[2 * i    ] = src[4 * i    ];
+        dstCh0[2 * i + 1] = src[4 * i + 1];
+        dstCh1[2 * i    ] = src[4 * i + 2];
+        dstCh1[2 * i + 1] = src[4 * i + 3];
+    }
+}
+
+void interleaveSC8X2(const int8_t *srcCh0, const int8_t *srcCh1, int8_t *dst, int numSampsPerChan){
+    for(int i = 0; i<numSampsPerChan; i++){
+        dst[4 * i    ] = srcCh0[2 * i    ];
+        dst[4 * i + 1] = srcCh0[2 * i + 1];
+        dst[4 * i + 2] = srcCh1[2 * i    ];
+        dst[4 * i + 3] = srcCh1[2 * i + 1];
+    }
+}
+
+int convertRxBladeRFSamples(sampleFormat_t format, const void *bladeRFSampBuffer, int sampOffset, SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_re, SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_im,
+                            int numToProcess, SAMPLE_COMPONENT_DATATYPE scaleFactor, const iqCorrection_t *corr){
+    if(format == SAMPLE_FORMAT_SC8_Q7){
+        return convertRxSamplesSC8(((const int8_t*) bladeRFSampBuffer) + 2*sampOffset, sharedMemFIFO_re, sharedMemFIFO_im, numToProcess, scaleFactor, corr);
+    }else{
+        return convertRxSamples(((const int16_t*) bladeRFSampBuffer) + 2*sampOffset, sharedMemFIFO_re, sharedMemFIFO_im, numToProcess, scaleFactor, corr);
+    }
+}
+
+int convertTxBladeRFSamples(sampleFormat_t format, const SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_re, const SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_im, void *bladeRFSampBuffer, int sampOffset,
+                            int numToProcess, SAMPLE_COMPONENT_DATATYPE scaleFactor, const iqCorrection_t *corr, bool saturate){
+    if(format == SAMPLE_FORMAT_SC8_Q7){
+        return convertTxSamplesSC8(sharedMemFIFO_re, sharedMemFIFO_im, ((int8_t*) bladeRFSampBuffer) + 2*sampOffset, numToProcess, scaleFactor, corr, saturate);
+    }else{
+        return convertTxSamples(sharedMemFIFO_re, sharedMemFIFO_im, ((int16_t*) bladeRFSampBuffer) + 2*sampOffset, numToProcess, scaleFactor, corr, saturate);
+    }
+}
+
+void deinterleaveX2(sampleFormat_t format, const void *src, void *dstCh0, void *dstCh1, int numSampsPerChan){
+    if(format == SAMPLE_FORMAT_SC8_Q7){
+        deinterleaveSC8X2((const int8_t*) src, (int8_t*) dstCh0, (int8_t*) dstCh1, numSampsPerChan);
+    }else{
+        deinterleaveSC16X2((const int16_t*) src, (int16_t*) dstCh0, (int16_t*) dstCh1, numSampsPerChan);
+    }
+}
+
+void interleaveX2(sampleFormat_t format, const void *srcCh0, const void *srcCh1, void *dst, int sampOffset, int numSampsPerChan){
+    //sampOffset is in samples per channel
+    if(format == SAMPLE_FORMAT_SC8_Q7){
+        interleaveSC8X2((const int8_t*) srcCh0, (const int8_t*) srcCh1, ((int8_t*) dst) + 4*sampOffset, numSampsPerChan);
+    }else{
+        interleaveSC16X2((const int16_t*) srcCh0, (const int16_t*) srcCh1, ((int16_t*) dst) + 4*sampOffset, numSampsPerChan);
+    }
+}
@@ -0,0 +1,87 @@
+//
+// Conversion kernels between the bladeRF sample format and the Shared Memory FIFO sample format
+//
+
+#ifndef BLADERFTOFIFO_SAMPLECONVERSION_H
+#define BLADERFTOFIFO_SAMPLECONVERSION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <libbladeRF.h>
+
+#include "helpers.h"
+
+//Sample format used on the link to the bladeRF
+typedef enum{
+    SAMPLE_FORMAT_SC16_Q11 = 0, //12 bit I/Q in 16 bit containers (4 bytes per complex sample).  Native format of the AD9361
+    SAMPLE_FORMAT_SC8_Q7 = 1    //8 bit I/Q (2 bytes per complex sample).  Requires libbladeRF >= 2.4.  Halves the USB bandwidth
+} sampleFormat_t;
+
+//Returns false if the string is not a known format ("sc16" or "sc8")
+bool parseSampleFormat(char *str, sampleFormat_t *format);
+
+char* sampleFormatToStr(sampleFormat_t format);
+
+//Bytes per complex sample in the bladeRF buffer
+size_t bladeRFSampleSize(sampleFormat_t format);
+
+//The maximum magnitude of a sample component in the bladeRF buffer
+int bladeRFFullRangeValue(sampleFormat_t format);
+
+bladerf_format bladeRFFormat(sampleFormat_t format, bool meta);
+
+//DC offset and I/Q imbalance correction for a single channel
+typedef struct{
+    SAMPLE_COMPONENT_DATATYPE dc_I; //DC offset (ADC/DAC scale)
+    SAMPLE_COMPONENT_DATATYPE dc_Q;
+    SAMPLE_COMPONENT_DATATYPE iq_A; //I/Q imbalance correction (see getIQImbalCorrections)
+    SAMPLE_COMPONENT_DATATYPE iq_C;
+    SAMPLE_COMPONENT_DATATYPE iq_D;
+} iqCorrection_t;
+
+void initIQCorrection(iqCorrection_t *corr, double dcOffsetI, double dcOffsetQ, double iqGain, double iqPhase_deg);
+
+void printIQCorrection(char *label, iqCorrection_t *corr, double iqGain, double iqPhase_deg);
+
+//Removes the DC offset, scales, and corrects I/Q imbalance for numToProcess interleaved SC16_Q11 samples.
+//The result is written in the Shared Memory FIFO format (separate re and im arrays).
+//Returns the number of clipped components (at full scale)
+int convertRxSamples(const int16_t *bladeRFSampBuffer, SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_re, SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_im,
+                     int numToProcess, SAMPLE_COMPONENT_DATATYPE scaleFactor, const iqCorrection_t *corr);
+
+//Predistorts for I/Q imbalance, scales, and adds the DC offset correction to numToProcess samples from the Shared Memory FIFO
+//format.  The result is written as interleaved SC16_Q11 samples.
+//Returns the number of components beyond full scale (saturated or wrapped depending on saturate)
+int convertTxSamples(const SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_re, const SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_im, int16_t *bladeRFSampBuffer,
+                     int numToProcess, SAMPLE_COMPONENT_DATATYPE scaleFactor, const iqCorrection_t *corr, bool saturate);
+
+//SC8_Q7 versions of the above
+int convertRxSamplesSC8(const int8_t *bladeRFSampBuffer, SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_re, SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_im,
+                        int numToProcess, SAMPLE_COMPONENT_DATATYPE scaleFactor, const iqCorrection_t *corr);
+
+int convertTxSamplesSC8(const SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_re, const SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_im, int8_t *bladeRFSampBuffer,
+                        int numToProcess, SAMPLE_COMPONENT_DATATYPE scaleFactor, const iqCorrection_t *corr, bool saturate);
+
+//In the MIMO layouts (BLADERF_RX_X2, BLADERF_TX_X2), the samples of the 2 channels are interleaved (I0, Q0, I1, Q1, ...)
+//These split/merge the stream into per-channel SC16_Q11 buffers with the same layout as the SISO stream.
+void deinterleaveSC16X2(const int16_t *src, int16_t *dstCh0, int16_t *dstCh1, int numSampsPerChan);
+
+void interleaveSC16X2(const int16_t *srcCh0, const int16_t *srcCh1, int16_t *dst, int numSampsPerChan);
+
+void deinterleaveSC8X2(const int8_t *src, int8_t *dstCh0, int8_t *dstCh1, int numSampsPerChan);
+
+void interleaveSC8X2(const int8_t *srcCh0, const int8_t *srcCh1, int8_t *dst, int numSampsPerChan);
+
+//Dispatch on the sample format.  The bladeRF buffers are in the given format and sampOffset is in complex samples
+int convertRxBladeRFSamples(sampleFormat_t format, const void *bladeRFSampBuffer, int sampOffset, SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_re, SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_im,
+                            int numToProcess, SAMPLE_COMPONENT_DATATYPE scaleFactor, const iqCorrection_t *corr);
+
+int convertTxBladeRFSamples(sampleFormat_t format, const SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_re, const SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_im, void *bladeRFSampBuffer, int sampOffset,
+                            int numToProcess, SAMPLE_COMPONENT_DATATYPE scaleFactor, const iqCorrection_t *corr, bool saturate);
+
+void deinterleaveX2(sampleFormat_t format, const void *src, void *dstCh0, void *dstCh1, int numSampsPerChan);
+
+void interleaveX2(sampleFormat_t format, const void *srcCh0, const void *srcCh1, void *dst, int sampOffset, int numSampsPerChan);
+
+#endif //BLADERFTOFIFO_SAMPLECONVERSION_H
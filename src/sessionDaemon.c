@@ -0,0 +1,563 @@
+//
+// Daemon mode: streaming sessions on boards that stay open
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "sessionDaemon.h"
+#include "helpers.h"
+
+#define SESSION_DAEMON_LINE_LEN (1024)
+#define SESSION_DAEMON_MAX_TOKENS (32)
+#define SESSION_DAEMON_POLL_MS (100)
+
+typedef enum{
+    SESSION_IDLE = 0,
+    SESSION_RUNNING = 1,
+    SESSION_STOPPING = 2 //Stop requested, the threads have not exited yet
+} sessionState_t;
+
+typedef struct{
+    radioPipeline_t *pipeline;
+    radioConfig_t defaults; //Settings from the command line or device list
+    sessionState_t state;
+    volatile bool stop; //Stops the threads of the session
+    uint64_t numSessions;
+    uint64_t rxSamplesStart; //Counters when the session started
+    uint64_t txSamplesStart;
+    uint64_t rxSamples; //Of the current (or last) session
+    uint64_t txSamples;
+    struct timespec stopTime;
+    int replyFd; //Client waiting for the stop reply (-1 if none)
+} sessionBoard_t;
+
+typedef struct{
+    int fd; //-1 if unused
+    char line[SESSION_DAEMON_LINE_LEN];
+    size_t lineLen;
+} sessionClient_t;
+
+typedef struct{
+    int listenFd;
+    sessionBoard_t *boards;
+    int numBoards;
+    volatile bool *stop;
+    bool print;
+    sessionClient_t clients[SESSION_DAEMON_MAX_CLIENTS];
+} sessionDaemon_t;
+
+static char* sessionStateToStr(sessionState_t state){
+    switch(state){
+        case SESSION_IDLE:
+            return "idle";
+        case SESSION_RUNNING:
+            return "running";
+        case SESSION_STOPPING:
+            return "stopping";
+        default:
+            return "unknown";
+    }
+}
+
+static void sessionReply(int fd, const char *fmt, ...){
+    char reply[SESSION_DAEMON_LINE_LEN];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(reply, sizeof(reply), fmt, args);
+    va_end(args);
+    if(len < 0){
+        return;
+    }
+    if(len >= (int) sizeof(reply)){
+        len = sizeof(reply) - 1;
+    }
+    //A client that does not read its replies is not waited for
+    ssize_t written = send(fd, reply, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+    (void) written;
+}
+
+static bool sessionParseNumber(char *str, double *val){
+    char *end;
+    *val = strtod(str, &end);
+    return end != str && *end == '\0';
+}
+
+//Returns false with a message in err if the key is not a session key or the value is invalid
+static bool sessionParseEntry(char *key, char *val, radioConfig_t *config, char *err, size_t errLen){
+    char **name = NULL;
+    if(strcmp(key, "rx") == 0){
+        name = &config->rxSharedName[0];
+    }else if(strcmp(key, "tx") == 0){
+        name = &config->txSharedName[0];
+    }else if(strcmp(key, "txfb") == 0){
+        name = &config->txFeedbackSharedName[0];
+    }else if(strcmp(key, "rx1") == 0){
+        name = &config->rxSharedName[1];
+    }else if(strcmp(key, "tx1") == 0){
+        name = &config->txSharedName[1];
+    }else if(strcmp(key, "txfb1") == 0){
+        name = &config->txFeedbackSharedName[1];
+    }
+    if(name != NULL){
+        //Copied once the session is accepted
+        *name = val;
+        return true;
+    }
+
+    if(strcmp(key, "rxOverflowPolicy") == 0){
+        if(!parseRxOverflowPolicy(val, &config->rxOverflowPolicy)){
+            snprintf(err, errLen, "rxOverflowPolicy must be block, dropNewest, or dropOldest");
+            return false;
+        }
+        return true;
+    }
+
+    if(strcmp(key, "blocklen") == 0 || strcmp(key, "fifosize") == 0){
+        if(!parseRadioConfigCount(val, key[0] == 'b' ? &config->blockLen : &config->fifoSize)){
+            snprintf(err, errLen, "%s must be a positive integer", key);
+            return false;
+        }
+        return true;
+    }
+
+    double num;
+    if(!sessionParseNumber(val, &num)){
+        snprintf(err, errLen, "%s must be a number", key);
+        return false;
+    }
+    if(strcmp(key, "numChannels") == 0){
+        config->numChannels = (int) num;
+        if(num != 1 && num != 2){
+            snprintf(err, errLen, "numChannels must be 1 or 2");
+            return false;
+        }
+    }else if(strcmp(key, "rxBlockHeader") == 0){
+        config->rxBlockHeader = num != 0;
+    }else if(strcmp(key, "rxGain") == 0){
+        config->rxGain = (int) num;
+    }else if(strcmp(key, "txGain") == 0){
+        config->txGain = (int) num;
+    }else{
+        //The frequencies, sample rates, and bandwidths (checked against the ranges of the board when the session starts)
+        if(num <= 0){
+            snprintf(err, errLen, "%s must be positive", key);
+            return false;
+        }
+        if(strcmp(key, "rxFreq") == 0){
+            config->rxFreq = (unsigned long) num;
+        }else if(strcmp(key, "txFreq") == 0){
+            config->txFreq = (unsigned long) num;
+        }else if(strcmp(key, "rxSampRate") == 0){
+            config->rxSampRate = (unsigned int) num;
+        }else if(strcmp(key, "txSampRate") == 0){
+            config->txSampRate = (unsigned int) num;
+        }else if(strcmp(key, "rxBW") == 0){
+            config->rxBW = (unsigned int) num;
+        }else if(strcmp(key, "txBW") == 0){
+            config->txBW = (unsigned int) num;
+        }else{
+            snprintf(err, errLen, "%s is not a session key", key);
+            return false;
+        }
+    }
+    return true;
+}
+
+//The FIFO names of a session are owned by the session
+static void sessionCopyNames(radioConfig_t *config){
+    for(int chan = 0; chan<BLADERF_MAX_CHANNELS; chan++){
+        config->rxSharedName[chan] = config->rxSharedName[chan] != NULL ? strdup(config->rxSharedName[chan]) : NULL;
+        config->txSharedName[chan] = config->txSharedName[chan] != NULL ? strdup(config->txSharedName[chan]) : NULL;
+        config->txFeedbackSharedName[chan] = config->txFeedbackSharedName[chan] != NULL ? strdup(config->txFeedbackSharedName[chan]) : NULL;
+    }
+}
+
+static void sessionFreeNames(radioConfig_t *config){
+    for(int chan = 0; chan<BLADERF_MAX_CHANNELS; chan++){
+        free(config->rxSharedName[chan]);
+        free(config->txSharedName[chan]);
+        free(config->txFeedbackSharedName[chan]);
+        config->rxSharedName[chan] = NULL;
+        config->txSharedName[chan] = NULL;
+        config->txFeedbackSharedName[chan] = NULL;
+    }
+}
+
+static bool sessionParse(char **pairs, int numPairs, radioConfig_t *session, char *err, size_t errLen){
+    bool fifosGiven = false;
+    for(int i = 0; i<numPairs; i++){
+        fifosGiven |= strncmp(pairs[i], "rx", 2) == 0 && (pairs[i][2] == '=' || strncmp(pairs[i]+2, "1=", 2) == 0);
+        fifosGiven |= strncmp(pairs[i], "tx", 2) == 0 && (pairs[i][2] == '=' || strncmp(pairs[i]+2, "1=", 2) == 0 ||
+                                                         strncmp(pairs[i]+2, "fb=", 3) == 0 || strncmp(pairs[i]+2, "fb1=", 4) == 0);
+    }
+    //The FIFOs from the command line are replaced as a set, otherwise a session could mix its FIFOs with the defaults
+    if(fifosGiven){
+        for(int chan = 0; chan<BLADERF_MAX_CHANNELS; chan++){
+            session->rxSharedName[chan] = NULL;
+            session->txSharedName[chan] = NULL;
+            session->txFeedbackSharedName[chan] = NULL;
+        }
+    }
+
+    for(int i = 0; i<numPairs; i++){
+        char *eq = strchr(pairs[i], '=');
+        if(eq == NULL){
+            snprintf(err, errLen, "expected key=value, got %s", pairs[i]);
+            return false;
+        }
+        *eq = '\0';
+        if(!sessionParseEntry(pairs[i], eq+1, session, err, errLen)){
+            return false;
+        }
+    }
+
+    if(!radioConfigRxEnabled(session) && !radioConfigTxEnabled(session)){
+        snprintf(err, errLen, "neither Rx nor Tx FIFOs specified");
+        return false;
+    }
+    for(int chan = 0; chan<session->numChannels; chan++){
+        if(radioConfigRxEnabled(session) && session->rxSharedName[chan] == NULL){
+            snprintf(err, errLen, "Rx FIFO unspecified for channel %d", chan);
+            return false;
+        }
+        if(radioConfigTxEnabled(session) && (session->txSharedName[chan] == NULL || session->txFeedbackSharedName[chan] == NULL)){
+            snprintf(err, errLen, "Tx and Tx feedback FIFOs must both be specified for channel %d", chan);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void sessionCounters(sessionBoard_t *board, uint64_t *rxSamples, uint64_t *txSamples){
+    *rxSamples = atomic_load_explicit(&board->pipeline->rxStats->samplesTransferred, memory_order_relaxed);
+    *txSamples = atomic_load_explicit(&board->pipeline->txStats->samplesTransferred, memory_order_relaxed);
+}
+
+static void sessionStart(sessionDaemon_t *daemon, int fd, sessionBoard_t *board, char **pairs, int numPairs){
+    char *serial = board->defaults.serial;
+    if(board->state != SESSION_IDLE){
+        sessionReply(fd, "error %s is busy (session %s)\n", serial, sessionStateToStr(board->state));
+        return;
+    }
+
+    char err[SESSION_DAEMON_LINE_LEN/2];
+    radioConfig_t session = board->defaults;
+    if(!sessionParse(pairs, numPairs, &session, err, sizeof(err))){
+        sessionReply(fd, "error %s\n", err);
+        return;
+    }
+    sessionCopyNames(&session);
+
+    board->stop = false;
+    if(!startRadioPipelineSession(board->pipeline, &session, &board->stop, err, sizeof(err))){
+        sessionFreeNames(&session);
+        sessionReply(fd, "error %s %s\n", serial, err);
+        return;
+    }
+    board->state = SESSION_RUNNING;
+    board->numSessions++;
+    sessionCounters(board, &board->rxSamplesStart, &board->txSamplesStart);
+
+    bringUpTiming_t *timing = &board->pipeline->bringUpTiming;
+    sessionReply(fd, "ok %s started %.3f %d %d\n", serial, timing->total*1e3, timing->channelStepsCached, timing->channelSteps);
+    if(daemon->print){
+        printf("[%s] Session %lu started in %.1f ms (Channels %.1f ms with %d of %d steps cached, FIFOs %.1f ms)\n", serial,
+               board->numSessions, timing->total*1e3, timing->channels*1e3, timing->channelStepsCached, timing->channelSteps,
+               timing->fifos*1e3);
+    }
+}
+
+static void sessionStop(sessionBoard_t *board){
+    board->stop = true;
+    detachRadioPipelineConsumers(board->pipeline);
+    board->state = SESSION_STOPPING;
+    clock_gettime(CLOCK_MONOTONIC, &board->stopTime);
+}
+
+//Ends the sessions whose threads have exited
+static void sessionPollBoards(sessionDaemon_t *daemon){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    for(int i = 0; i<daemon->numBoards; i++){
+        sessionBoard_t *board = &daemon->boards[i];
+        if(board->state == SESSION_IDLE){
+            continue;
+        }
+        char *serial = board->defaults.serial;
+        if(pollRadioPipeline(board->pipeline)){
+            sessionCounters(board, &board->rxSamples, &board->txSamples);
+            board->rxSamples -= board->rxSamplesStart;
+            board->txSamples -= board->txSamplesStart;
+            endRadioPipelineSession(board->pipeline);
+            sessionFreeNames(&board->pipeline->config);
+            if(board->replyFd >= 0){
+                sessionReply(board->replyFd, "ok %s stopped %lu %lu\n", serial, board->rxSamples, board->txSamples);
+                board->replyFd = -1;
+            }
+            if(daemon->print){
+                printf("[%s] Session %lu %s (Rx %lu Samples, Tx %lu Samples)\n", serial, board->numSessions,
+                       board->state == SESSION_RUNNING ? "ended, the threads exited" : "stopped", board->rxSamples, board->txSamples);
+            }
+            board->state = SESSION_IDLE;
+        }else if(board->state == SESSION_STOPPING && board->replyFd >= 0 &&
+                 difftimespec(&now, &board->stopTime) >= SESSION_DAEMON_STOP_TIMEOUT_SEC){
+            sessionReply(board->replyFd, "error %s is still stopping, the threads have not exited\n", serial);
+            board->replyFd = -1;
+        }
+    }
+}
+
+static void sessionStatus(sessionDaemon_t *daemon, int fd){
+    for(int i = 0; i<daemon->numBoards; i++){
+        sessionBoard_t *board = &daemon->boards[i];
+        uint64_t rxSamples = board->rxSamples;
+        uint64_t txSamples = board->txSamples;
+        if(board->state != SESSION_IDLE){
+            sessionCounters(board, &rxSamples, &txSamples);
+            rxSamples -= board->rxSamplesStart;
+            txSamples -= board->txSamplesStart;
+        }
+        sessionReply(fd, "session %s %s %lu %lu %lu\n", board->defaults.serial, sessionStateToStr(board->state),
+                     board->numSessions, rxSamples, txSamples);
+    }
+}
+
+static void sessionCommand(sessionDaemon_t *daemon, int fd, char *line){
+    char *tokens[SESSION_DAEMON_MAX_TOKENS];
+    int numTokens = 0;
+    char *savePtr;
+    for(char *token = strtok_r(line, " \t\r", &savePtr); token != NULL; token = strtok_r(NULL, " \t\r", &savePtr)){
+        if(numTokens == SESSION_DAEMON_MAX_TOKENS){
+            sessionReply(fd, "error too many arguments (max %d)\n", SESSION_DAEMON_MAX_TOKENS-2);
+            return;
+        }
+        tokens[numTokens++] = token;
+    }
+    if(numTokens == 0){
+        return;
+    }
+    if(strcmp(tokens[0], "status") == 0){
+        sessionStatus(daemon, fd);
+        return;
+    }
+    if(strcmp(tokens[0], "shutdown") == 0){
+        sessionReply(fd, "ok shutdown\n");
+        *(daemon->stop) = true;
+        return;
+    }
+    bool start = strcmp(tokens[0], "start") == 0;
+    if(!start && strcmp(tokens[0], "stop") != 0){
+        sessionReply(fd, "error unknown command %s (start, stop, status, shutdown)\n", tokens[0]);
+        return;
+    }
+
+    //The serial number is optional with a single board
+    int tok = 1;
+    sessionBoard_t *board = NULL;
+    if(numTokens > 1 && strchr(tokens[1], '=') == NULL){
+        for(int i = 0; i<daemon->numBoards; i++){
+            if(strcmp(tokens[1], daemon->boards[i].defaults.serial) == 0){
+                board = &daemon->boards[i];
+            }
+        }
+        if(board == NULL){
+            sessionReply(fd, "error unknown board %s\n", tokens[1]);
+            return;
+        }
+        tok++;
+    }else if(daemon->numBoards == 1){
+        board = &daemon->boards[0];
+    }else{
+        sessionReply(fd, "error the serial number is required with multiple boards\n");
+        return;
+    }
+
+    if(start){
+        sessionStart(daemon, fd, board, &tokens[tok], numTokens - tok);
+    }else if(board->state == SESSION_IDLE){
+        sessionReply(fd, "error %s has no session\n", board->defaults.serial);
+    }else if(board->state == SESSION_STOPPING){
+        sessionReply(fd, "error %s is already stopping\n", board->defaults.serial);
+    }else{
+        sessionStop(board);
+        //Replied once the threads exit (see sessionPollBoards)
+        board->replyFd = fd;
+    }
+}
+
+//Returns false once the client has disconnected
+static bool sessionReadClient(sessionDaemon_t *daemon, sessionClient_t *client){
+    char buf[SESSION_DAEMON_LINE_LEN];
+    ssize_t bytesRead = recv(client->fd, buf, sizeof(buf), 0);
+    if(bytesRead <= 0){
+        return bytesRead < 0 && (errno == EAGAIN || errno == EINTR);
+    }
+    for(ssize_t i = 0; i<bytesRead; i++){
+        if(buf[i] == '\n'){
+            client->line[client->lineLen] = '\0';
+            sessionCommand(daemon, client->fd, client->line);
+            client->lineLen = 0;
+        }else if(client->lineLen < SESSION_DAEMON_LINE_LEN-1){
+            client->line[client->lineLen++] = buf[i];
+        }
+    }
+    return true;
+}
+
+static void sessionCloseClient(sessionDaemon_t *daemon, sessionClient_t *client){
+    for(int i = 0; i<daemon->numBoards; i++){
+        if(daemon->boards[i].replyFd == client->fd){
+            daemon->boards[i].replyFd = -1;
+        }
+    }
+    close(client->fd);
+    client->fd = -1;
+}
+
+static void sessionServeClients(sessionDaemon_t *daemon){
+    struct pollfd fds[SESSION_DAEMON_MAX_CLIENTS+1];
+    fds[0].fd = daemon->listenFd;
+    fds[0].events = POLLIN;
+    for(int i = 0; i<SESSION_DAEMON_MAX_CLIENTS; i++){
+        fds[i+1].fd = daemon->clients[i].fd; //Negative fds are ignored by poll
+        fds[i+1].events = POLLIN;
+        fds[i+1].revents = 0;
+    }
+    int ready = poll(fds, SESSION_DAEMON_MAX_CLIENTS+1, SESSION_DAEMON_POLL_MS);
+    if(ready <= 0){
+        return;
+    }
+
+    for(int i = 0; i<SESSION_DAEMON_MAX_CLIENTS; i++){
+        sessionClient_t *client = &daemon->clients[i];
+        if(client->fd >= 0 && (fds[i+1].revents & (POLLIN | POLLHUP | POLLERR))){
+            if(!sessionReadClient(daemon, client)){
+                sessionCloseClient(daemon, client);
+            }
+        }
+    }
+
+    if(fds[0].revents & POLLIN){
+        int fd = accept(daemon->listenFd, NULL, NULL);
+        if(fd < 0){
+            return;
+        }
+        int slot = -1;
+        for(int i = 0; i<SESSION_DAEMON_MAX_CLIENTS && slot < 0; i++){
+            if(daemon->clients[i].fd < 0){
+                slot = i;
+            }
+        }
+        if(slot < 0){
+            sessionReply(fd, "error too many clients (max %d)\n", SESSION_DAEMON_MAX_CLIENTS);
+            close(fd);
+            return;
+        }
+        daemon->clients[slot].fd = fd;
+        daemon->clients[slot].lineLen = 0;
+    }
+}
+
+static int openSessionSocket(char *path){
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(strlen(path) >= sizeof(addr.sun_path)){
+        fprintf(stderr, "Daemon socket path is too long (max %lu characters): %s\n", sizeof(addr.sun_path)-1, path);
+        exit(1);
+    }
+    strcpy(addr.sun_path, path);
+
+    //A socket left by a previous run that did not exit cleanly
+    unlink(path);
+    int listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(listenFd < 0 || bind(listenFd, (struct sockaddr*) &addr, sizeof(addr)) != 0 ||
+       listen(listenFd, SESSION_DAEMON_MAX_CLIENTS) != 0){
+        fprintf(stderr, "Unable to create the daemon socket %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+    return listenFd;
+}
+
+void runSessionDaemon(char *path, radioPipeline_t *pipelines, int numPipelines, volatile bool *stop, double statusPeriod, bool print){
+    sessionDaemon_t daemon;
+    daemon.stop = stop;
+    daemon.print = print;
+    daemon.numBoards = numPipelines;
+    daemon.boards = (sessionBoard_t*) calloc(numPipelines, sizeof(sessionBoard_t));
+    for(int i = 0; i<numPipelines; i++){
+        sessionBoard_t *board = &daemon.boards[i];
+        board->pipeline = &pipelines[i];
+        board->defaults = pipelines[i].config;
+        board->state = SESSION_IDLE;
+        board->replyFd = -1;
+        //Runtime changes (-controlSocket) are refused until a session starts
+        controlMailboxClose(&pipelines[i].rxControl);
+        controlMailboxClose(&pipelines[i].txControl);
+        //The FIFOs are set by each session
+        for(int chan = 0; chan<BLADERF_MAX_CHANNELS; chan++){
+            pipelines[i].config.rxSharedName[chan] = NULL;
+            pipelines[i].config.txSharedName[chan] = NULL;
+            pipelines[i].config.txFeedbackSharedName[chan] = NULL;
+        }
+    }
+    for(int i = 0; i<SESSION_DAEMON_MAX_CLIENTS; i++){
+        daemon.clients[i].fd = -1;
+    }
+    daemon.listenFd = openSessionSocket(path);
+    if(print){
+        printf("Listening for sessions on %s\n", path);
+    }
+
+    uint64_t *prevSamples = (uint64_t*) calloc(2*numPipelines, sizeof(uint64_t));
+    struct timespec lastReportTime, currentTime;
+    clock_gettime(CLOCK_MONOTONIC, &lastReportTime);
+    while(!(*stop)){
+        sessionServeClients(&daemon);
+        sessionPollBoards(&daemon);
+
+        clock_gettime(CLOCK_MONOTONIC, &currentTime);
+        double sinceLastReport = difftimespec(&currentTime, &lastReportTime);
+        if(statusPeriod > 0 && sinceLastReport >= statusPeriod){
+            reportRadioPipelineStatus(pipelines, numPipelines, prevSamples, sinceLastReport);
+            lastReportTime = currentTime;
+        }
+    }
+    free(prevSamples);
+
+    //Stop the running sessions
+    bool allIdle = false;
+    for(int i = 0; i<numPipelines; i++){
+        if(daemon.boards[i].state == SESSION_RUNNING){
+            sessionStop(&daemon.boards[i]);
+        }
+    }
+    while(!allIdle){
+        sessionPollBoards(&daemon);
+        allIdle = true;
+        for(int i = 0; i<numPipelines; i++){
+            allIdle &= daemon.boards[i].state == SESSION_IDLE;
+        }
+        if(!allIdle){
+            usleep(SESSION_DAEMON_POLL_MS*1000);
+        }
+    }
+
+    for(int i = 0; i<SESSION_DAEMON_MAX_CLIENTS; i++){
+        if(daemon.clients[i].fd >= 0){
+            close(daemon.clients[i].fd);
+        }
+    }
+    close(daemon.listenFd);
+    unlink(path);
+    free(daemon.boards);
+}
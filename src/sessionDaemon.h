@@ -0,0 +1,41 @@
+//
+// Daemon mode (-daemon): the boards are opened and configured once and stay open.  Clients start and stop streaming
+// sessions through a UNIX domain socket, each with its own FIFOs and RF parameters.  Only the channel settings that
+// differ from the previous session are applied to the board (see configBladeRFChannel), so a session starts without
+// opening the board or checking the FPGA.
+//
+// Each line sent to the socket is a command.  The serial number may be omitted when there is a single board:
+//     start [<serial>] <key>=<value> ...
+//     stop [<serial>]
+//     status
+//     shutdown
+// The session keys are rx, tx, txfb, rx1, tx1, txfb1, numChannels, blocklen, fifosize, rxFreq, txFreq, rxSampRate,
+// txSampRate, rxBW, txBW, rxGain, txGain, rxOverflowPolicy, and rxBlockHeader (0 or 1).  Unspecified settings are taken
+// from the command line (or the device list).  The FIFOs given on the command line are only used if the session does not
+// give any.  The replies are:
+//     ok <serial> started <ms to configure the board and create the FIFOs> <channel steps skipped> <channel steps>
+//     ok <serial> stopped <Rx samples> <Tx samples>   (of the session)
+//     error <message>
+// A session also ends when its threads exit on their own (ex. the Tx FIFO producer exited).  If the threads of a stopped
+// session have not exited after SESSION_DAEMON_STOP_TIMEOUT_SEC (ex. stuck in a libbladeRF call), the reply is an error
+// and the board is busy until they exit.  status replies with one line per board:
+//     session <serial> <idle|running|stopping> <sessions started> <Rx samples> <Tx samples>
+// Runtime changes to a running session are made through -controlSocket.
+//
+
+#ifndef BLADERFTOFIFO_SESSIONDAEMON_H
+#define BLADERFTOFIFO_SESSIONDAEMON_H
+
+#include <stdbool.h>
+
+#include "radioPipeline.h"
+
+#define SESSION_DAEMON_MAX_CLIENTS (8)
+#define SESSION_DAEMON_STOP_TIMEOUT_SEC (2.0) //Time the threads of a stopped session are given to exit before replying
+
+//Serves sessions on the brought-up pipelines (see bringUpRadioPipelines) until *stop is set or a client sends shutdown,
+//printing the status report every statusPeriod seconds (0 to disable).  The running sessions are stopped before
+//returning.  Exits if the socket cannot be created
+void runSessionDaemon(char *path, radioPipeline_t *pipelines, int numPipelines, volatile bool *stop, double statusPeriod, bool print);
+
+#endif //BLADERFTOFIFO_SESSIONDAEMON_H
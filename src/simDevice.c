@@ -0,0 +1,685 @@
+//
+// Simulated bladeRF.  Each direction has a sample clock that starts when the device is opened.  The Rx produces
+// samples as the clock passes them and the Tx holds at most the libbladeRF stream buffers ahead of the clock, so both
+// directions block like the real sync interface.  Overruns occur when the Rx falls more than the stream buffers behind
+// the clock (or are injected at random), and underruns when the Tx falls behind the clock.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdatomic.h>
+
+#include "simDevice.h"
+#include "helpers.h"
+
+#define SIM_DEFAULT_TONE_FREQ (100000.0)
+#define SIM_DEFAULT_AMPLITUDE (0.5)
+#define SIM_DEFAULT_NOISE (0.01)
+#define SIM_DEFAULT_OVERRUN_LEN (4096)
+#define SIM_FILE_READAHEAD_BYTES (16*1024*1024) //Window of the file requested ahead of the read position
+#define SIM_SIGMF_META_MAX_BYTES (1024*1024)
+
+//The samples of a mapped file
+typedef enum{
+    SIM_SAMPLE_CI16 = 0, //SC16_Q11
+    SIM_SAMPLE_CF32 = 1, //Full scale is 1.0
+    SIM_SAMPLE_CI8 = 2 //SC8_Q7 (the 8 MSBs of the 12 bit samples), as recorded from an SC8_Q7 stream
+} simFileSample_t;
+
+typedef struct{
+    bool configured;
+    bool enabled[BLADERF_MAX_CHANNELS];
+    bool started; //Rx: stream running, Tx: samples queued (streaming or in a burst)
+    bladerf_format format;
+    int numChannels;
+    unsigned int sampRate;
+    uint64_t bufferedSamples; //Per channel samples held by the libbladeRF stream buffers
+    unsigned int timeout_ms; //Stream timeout used when a call passes 0, 0 for no timeout
+
+    uint64_t sampleCount; //Rx: timestamp of the next sample to be returned, Tx: timestamp after the last queued sample
+    uint64_t queueStart; //Tx: timestamp of the first sample of the current burst (or since the last underrun)
+    uint64_t rngState;
+
+    //Events
+    uint64_t injectedOverruns;
+    uint64_t emulatedOverruns;
+    uint64_t samplesDropped;
+    uint64_t underruns;
+    uint64_t latePasts; //Tx bursts rejected with BLADERF_ERR_TIME_PAST
+} simDirection_t;
+
+struct simDevice_s{
+    simConfig_t config;
+    struct timespec epoch; //Timestamp 0 of both directions
+
+    simDirection_t rx;
+    simDirection_t tx;
+    atomic_bool failed; //An injected failure, set by either direction
+
+    //Tone
+    double phasorRe[BLADERF_MAX_CHANNELS];
+    double phasorIm[BLADERF_MAX_CHANNELS];
+    double stepRe;
+    double stepIm;
+
+    //File (mapped)
+    uint8_t *fileMap;
+    size_t fileMapBytes;
+    simFileSample_t fileSample;
+    size_t fileLen; //Samples (across all channels)
+    size_t filePos;
+    size_t fileAdvisedBytes; //The file has been requested (MADV_WILLNEED) up to here
+};
+
+bool parseSimSource(char *str, simSource_t *source){
+    if(strcasecmp(str, "tone") == 0){
+        *source = SIM_SOURCE_TONE;
+    }else if(strcasecmp(str, "noise") == 0){
+        *source = SIM_SOURCE_NOISE;
+    }else if(strcasecmp(str, "file") == 0){
+        *source = SIM_SOURCE_FILE;
+    }else{
+        return false;
+    }
+    return true;
+}
+
+bool parseSimFileFormat(char *str, simFileFormat_t *format){
+    if(strcasecmp(str, "sc16") == 0){
+        *format = SIM_FILE_SC16;
+    }else if(strcasecmp(str, "cf32") == 0){
+        *format = SIM_FILE_CF32;
+    }else if(strcasecmp(str, "sigmf") == 0){
+        *format = SIM_FILE_SIGMF;
+    }else{
+        return false;
+    }
+    return true;
+}
+
+static char* simSourceToStr(simSource_t source){
+    switch(source){
+        case SIM_SOURCE_TONE:
+            return "tone";
+        case SIM_SOURCE_NOISE:
+            return "noise";
+        case SIM_SOURCE_FILE:
+            return "file";
+        default:
+            return "Unknown";
+    }
+}
+
+void initSimConfig(simConfig_t *config){
+    config->source = SIM_SOURCE_TONE;
+    config->toneFreq = SIM_DEFAULT_TONE_FREQ;
+    config->amplitude = SIM_DEFAULT_AMPLITUDE;
+    config->noiseAmplitude = SIM_DEFAULT_NOISE;
+    config->filePath = NULL;
+    config->fileFormat = SIM_FILE_SC16;
+    config->loop = true;
+    config->unthrottled = false;
+    config->overrunRate = 0;
+    config->overrunLen = SIM_DEFAULT_OVERRUN_LEN;
+    config->jitter_us = 0;
+    config->faultRate = 0;
+}
+
+//xorshift64*
+static uint64_t simRand(simDirection_t *dir){
+    dir->rngState ^= dir->rngState >> 12;
+    dir->rngState ^= dir->rngState << 25;
+    dir->rngState ^= dir->rngState >> 27;
+    return dir->rngState * 0x2545F4914F6CDD1DULL;
+}
+
+//Uniform in [0, 1)
+static double simUniform(simDirection_t *dir){
+    return (simRand(dir) >> 11) * (1.0/9007199254740992.0);
+}
+
+//Approximately Gaussian with unit variance (sum of 4 uniforms)
+static double simGaussian(simDirection_t *dir){
+    double sum = simUniform(dir) + simUniform(dir) + simUniform(dir) + simUniform(dir) - 2.0;
+    return sum*1.7320508075688772; //sqrt(3)
+}
+
+//Returns a copy of path with the suffix replaced.  The replacement is appended if path does not end with the suffix
+static char* replaceSuffix(char *path, char *suffix, char *replacement){
+    size_t pathLen = strlen(path);
+    size_t suffixLen = strlen(suffix);
+    size_t baseLen = pathLen >= suffixLen && strcmp(path+pathLen-suffixLen, suffix) == 0 ? pathLen-suffixLen : pathLen;
+    char *replaced = (char*) malloc(baseLen+strlen(replacement)+1);
+    memcpy(replaced, path, baseLen);
+    strcpy(replaced+baseLen, replacement);
+    return replaced;
+}
+
+//Finds the string value of a key in the SigMF metadata.  A full JSON parser is not needed for the few global keys used
+static bool findSigMFString(char *meta, char *key, char *val, size_t valLen){
+    char *pos = strstr(meta, key);
+    if(pos == NULL){
+        return false;
+    }
+    pos = strchr(pos+strlen(key), ':');
+    if(pos == NULL || (pos = strchr(pos, '"')) == NULL){
+        return false;
+    }
+    pos++;
+    size_t len = strcspn(pos, "\"");
+    if(len >= valLen){
+        return false;
+    }
+    memcpy(val, pos, len);
+    val[len] = '\0';
+    return true;
+}
+
+static bool findSigMFNumber(char *meta, char *key, double *val){
+    char *pos = strstr(meta, key);
+    if(pos == NULL){
+        return false;
+    }
+    pos = strchr(pos+strlen(key), ':');
+    if(pos == NULL){
+        return false;
+    }
+    *val = strtod(pos+1, NULL);
+    return true;
+}
+
+static size_t simFileSampleBytes(simFileSample_t fileSample){
+    switch(fileSample){
+        case SIM_SAMPLE_CF32:
+            return 2*sizeof(float);
+        case SIM_SAMPLE_CI8:
+            return 2*sizeof(int8_t);
+        default:
+            return 2*sizeof(int16_t);
+    }
+}
+
+//Reads the datatype of a SigMF recording and returns the path of the data file
+static char* openSigMF(char *path, unsigned int rxSampRate, simFileSample_t *fileSample){
+    size_t pathLen = strlen(path);
+    bool isMeta = pathLen >= strlen(".sigmf-meta") && strcmp(path+pathLen-strlen(".sigmf-meta"), ".sigmf-meta") == 0;
+    char *metaPath = isMeta ? strdup(path) : replaceSuffix(path, ".sigmf-data", ".sigmf-meta");
+    FILE *metaFile = fopen(metaPath, "r");
+    if(metaFile == NULL){
+        fprintf(stderr, "Unable to open SigMF metadata: %s\n", metaPath);
+        exit(1);
+    }
+    char *meta = (char*) malloc(SIM_SIGMF_META_MAX_BYTES+1);
+    size_t metaLen = fread(meta, 1, SIM_SIGMF_META_MAX_BYTES, metaFile);
+    meta[metaLen] = '\0';
+    fclose(metaFile);
+
+    char datatype[32];
+    if(!findSigMFString(meta, "\"core:datatype\"", datatype, sizeof(datatype))){
+        fprintf(stderr, "SigMF metadata does not specify core:datatype: %s\n", metaPath);
+        exit(1);
+    }
+    if(strcmp(datatype, "ci16_le") == 0){
+        *fileSample = SIM_SAMPLE_CI16;
+    }else if(strcmp(datatype, "cf32_le") == 0){
+        *fileSample = SIM_SAMPLE_CF32;
+    }else if(strcmp(datatype, "ci8") == 0){
+        *fileSample = SIM_SAMPLE_CI8;
+    }else{
+        fprintf(stderr, "Unsupported SigMF datatype (ci16_le, ci8, or cf32_le are supported): %s\n", datatype);
+        exit(1);
+    }
+
+    double sampRate;
+    if(findSigMFNumber(meta, "\"core:sample_rate\"", &sampRate) && (unsigned int) sampRate != rxSampRate){
+        printf("Warning: The SigMF recording was captured at %.0f Hz but is replayed at %u Hz\n", sampRate, rxSampRate);
+    }
+
+    free(meta);
+    char *dataPath = replaceSuffix(metaPath, ".sigmf-meta", ".sigmf-data");
+    free(metaPath);
+    return dataPath;
+}
+
+static void mapSimFile(simDevice_t *sim, simConfig_t *config, unsigned int rxSampRate){
+    char *path = config->filePath;
+    char *dataPath = NULL;
+    sim->fileSample = config->fileFormat == SIM_FILE_CF32 ? SIM_SAMPLE_CF32 : SIM_SAMPLE_CI16;
+    if(config->fileFormat == SIM_FILE_SIGMF){
+        dataPath = openSigMF(path, rxSampRate, &sim->fileSample);
+        path = dataPath;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0){
+        fprintf(stderr, "Unable to open simulated source file %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) != 0){
+        fprintf(stderr, "Unable to stat simulated source file %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+
+    size_t sampleBytes = simFileSampleBytes(sim->fileSample);
+    sim->fileLen = fileStat.st_size/sampleBytes;
+    if(sim->fileLen == 0){
+        fprintf(stderr, "Simulated source file does not contain any samples: %s\n", path);
+        exit(1);
+    }
+    sim->fileMapBytes = fileStat.st_size;
+    sim->fileMap = (uint8_t*) mmap(NULL, sim->fileMapBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(sim->fileMap == MAP_FAILED){
+        //With -mlockall, the whole mapping is locked and counts against the memlock limit
+        fprintf(stderr, "Unable to map simulated source file %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+    close(fd);
+
+    //The file is read once from start to end: aggressive kernel readahead and pages can be dropped once read
+    madvise(sim->fileMap, sim->fileMapBytes, MADV_SEQUENTIAL);
+    sim->filePos = 0;
+    sim->fileAdvisedBytes = 0;
+
+    if(dataPath != NULL){
+        free(dataPath);
+    }
+}
+
+//Samples lost to an overrun are skipped in the file as they would be on air
+static void simFileSkip(simDevice_t *sim, uint64_t numSamples){
+    if(sim->config.source != SIM_SOURCE_FILE){
+        return;
+    }
+    if(sim->config.loop){
+        sim->filePos = (sim->filePos + numSamples) % sim->fileLen;
+        sim->fileAdvisedBytes = 0;
+    }else{
+        sim->filePos = sim->filePos + numSamples < sim->fileLen ? sim->filePos + numSamples : sim->fileLen;
+    }
+}
+
+//Requests the next window of the file before the read position reaches it so that the Rx does not block on page faults
+static void simFileReadahead(simDevice_t *sim, size_t bytePos){
+    if(bytePos + SIM_FILE_READAHEAD_BYTES/2 < sim->fileAdvisedBytes || sim->fileAdvisedBytes >= sim->fileMapBytes){
+        return;
+    }
+    size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+    size_t start = sim->fileAdvisedBytes/pageSize*pageSize;
+    size_t end = sim->fileAdvisedBytes + SIM_FILE_READAHEAD_BYTES;
+    if(end > sim->fileMapBytes){
+        end = sim->fileMapBytes;
+    }
+    madvise(sim->fileMap+start, end-start, MADV_WILLNEED);
+    sim->fileAdvisedBytes = end;
+}
+
+simDevice_t* simOpen(simConfig_t *config, unsigned int rxSampRate, unsigned int txSampRate){
+    simDevice_t *sim = (simDevice_t*) malloc(sizeof(simDevice_t));
+    memset(sim, 0, sizeof(simDevice_t));
+    sim->config = *config;
+    clock_gettime(CLOCK_MONOTONIC, &sim->epoch);
+    atomic_init(&sim->failed, false);
+
+    sim->rx.sampRate = rxSampRate;
+    sim->tx.sampRate = txSampRate;
+    sim->rx.rngState = 0x9E3779B97F4A7C15ULL;
+    sim->tx.rngState = 0xD1B54A32D192ED03ULL;
+
+    for(int chan = 0; chan<BLADERF_MAX_CHANNELS; chan++){
+        sim->phasorRe[chan] = 1;
+        sim->phasorIm[chan] = 0;
+    }
+    double step = rxSampRate > 0 ? 2*M_PI*config->toneFreq/rxSampRate : 0;
+    sim->stepRe = cos(step);
+    sim->stepIm = sin(step);
+
+    if(config->source == SIM_SOURCE_FILE){
+        if(config->filePath == NULL){
+            fprintf(stderr, "A file is required for the simulated file source\n");
+            exit(1);
+        }
+        mapSimFile(sim, config, rxSampRate);
+    }
+
+    return sim;
+}
+
+void simClose(simDevice_t *sim, char *label, bool print){
+    if(print && sim->rx.configured){
+        printf("[%s] Simulated Rx: Injected Overruns: %lu, Emulated Overruns: %lu, Dropped Samples: %lu\n", label,
+               sim->rx.injectedOverruns, sim->rx.emulatedOverruns, sim->rx.samplesDropped);
+    }
+    if(print && sim->tx.configured){
+        printf("[%s] Simulated Tx: Underruns: %lu, Late Bursts: %lu\n", label, sim->tx.underruns, sim->tx.latePasts);
+    }
+    if(sim->fileMap != NULL){
+        munmap(sim->fileMap, sim->fileMapBytes);
+    }
+    free(sim);
+}
+
+static simDirection_t* simDirection(simDevice_t *sim, bool tx){
+    return tx ? &sim->tx : &sim->rx;
+}
+
+//The sample clock of the direction.  When unthrottled, the clock follows the samples rather than the other way around
+static uint64_t simClock(simDevice_t *sim, simDirection_t *dir){
+    if(sim->config.unthrottled){
+        return dir->sampleCount;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) (difftimespec(&now, &sim->epoch)*dir->sampRate);
+}
+
+//Injected failures occur at random (approximately Poisson) in sample time and fail both directions
+static bool simFailed(simDevice_t *sim, simDirection_t *dir, uint64_t sampsPerChan){
+    if(sim->config.faultRate > 0 && simUniform(dir) < sim->config.faultRate*sampsPerChan/dir->sampRate){
+        atomic_store_explicit(&sim->failed, true, memory_order_relaxed);
+    }
+    return atomic_load_explicit(&sim->failed, memory_order_relaxed);
+}
+
+static void addSecToTimespec(struct timespec *ts, double sec){
+    time_t wholeSec = (time_t) sec;
+    ts->tv_sec += wholeSec;
+    ts->tv_nsec += (long) ((sec - wholeSec)*1e9);
+    while(ts->tv_nsec >= 1000000000){
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+//Sleeps until the sample clock reaches the timestamp, then for a random delay of up to the configured jitter.  As with
+//libbladeRF, a timeout_ms of 0 uses the timeout of the stream.  Returns false (after sleeping for the timeout) if the
+//wait would be longer than the timeout
+static bool simWaitUntil(simDevice_t *sim, simDirection_t *dir, uint64_t timestamp, unsigned int timeout_ms){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    struct timespec wake = now;
+    if(!sim->config.unthrottled){
+        struct timespec target = sim->epoch;
+        addSecToTimespec(&target, ((double) timestamp)/dir->sampRate);
+        if(difftimespec(&target, &now) > 0){
+            wake = target;
+        }
+    }
+    if(sim->config.jitter_us > 0){
+        addSecToTimespec(&wake, simUniform(dir)*sim->config.jitter_us*1e-6);
+    }
+    bool timedOut = false;
+    unsigned int waitTimeout_ms = timeout_ms != 0 ? timeout_ms : dir->timeout_ms;
+    if(waitTimeout_ms != 0 && difftimespec(&wake, &now) > waitTimeout_ms*1e-3){
+        wake = now;
+        addSecToTimespec(&wake, waitTimeout_ms*1e-3);
+        timedOut = true;
+    }
+    if(difftimespec(&wake, &now) > 0){
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL) == EINTR){}
+    }
+    return !timedOut;
+}
+
+int simSyncConfig(simDevice_t *sim, bladerf_channel_layout layout, bladerf_format format,
+                  unsigned int numBuffers, unsigned int bufferSize, unsigned int numTransfers, unsigned int timeout_ms){
+    if(format == BLADERF_FORMAT_PACKET_META){
+        return BLADERF_ERR_UNSUPPORTED;
+    }
+    if(numTransfers >= numBuffers || bufferSize == 0 || bufferSize % 1024 != 0){
+        return BLADERF_ERR_INVAL;
+    }
+
+    bool tx = layout == BLADERF_TX_X1 || layout == BLADERF_TX_X2;
+    simDirection_t *dir = simDirection(sim, tx);
+    dir->numChannels = layout == BLADERF_RX_X2 || layout == BLADERF_TX_X2 ? 2 : 1;
+    dir->format = format;
+    dir->bufferedSamples = ((uint64_t) numBuffers)*bufferSize/dir->numChannels;
+    dir->timeout_ms = timeout_ms;
+    dir->started = false;
+    dir->configured = true;
+    return 0;
+}
+
+int simEnableModule(simDevice_t *sim, bladerf_channel ch, bool enable){
+    simDirection_t *dir = simDirection(sim, BLADERF_CHANNEL_IS_TX(ch));
+    int chan = ch >> 1;
+    if(chan >= BLADERF_MAX_CHANNELS){
+        return BLADERF_ERR_INVAL;
+    }
+    dir->enabled[chan] = enable;
+    if(!enable){
+        //The stream restarts from the current time when re-enabled
+        dir->started = false;
+    }
+    return 0;
+}
+
+static bool simFormatIsSC8(bladerf_format format){
+    return format == BLADERF_FORMAT_SC8_Q7 || format == BLADERF_FORMAT_SC8_Q7_META;
+}
+
+static void simFillRx(simDevice_t *sim, void *samples, unsigned int numSamples){
+    simDirection_t *dir = &sim->rx;
+    int numChannels = dir->numChannels;
+    bool sc8 = simFormatIsSC8(dir->format);
+    int16_t *samplesSC16 = (int16_t*) samples;
+    int8_t *samplesSC8 = (int8_t*) samples;
+
+    if(sim->config.source == SIM_SOURCE_FILE){
+        size_t sampleBytes = simFileSampleBytes(sim->fileSample);
+        simFileReadahead(sim, (sim->filePos+numSamples)*sampleBytes);
+        float cf32Scale = sc8 ? BLADERF_FULL_RANGE_VALUE_SC8 : BLADERF_FULL_RANGE_VALUE;
+        for(unsigned int i = 0; i<numSamples; i++){
+            int16_t re, im;
+            if(sim->fileSample == SIM_SAMPLE_CF32){
+                float *fileSample = (float*) (sim->fileMap + sim->filePos*sampleBytes);
+                float reScaled = fileSample[0]*cf32Scale;
+                float imScaled = fileSample[1]*cf32Scale;
+                re = (int16_t) lroundf(reScaled > cf32Scale ? cf32Scale : (reScaled < -cf32Scale-1 ? -cf32Scale-1 : reScaled));
+                im = (int16_t) lroundf(imScaled > cf32Scale ? cf32Scale : (imScaled < -cf32Scale-1 ? -cf32Scale-1 : imScaled));
+            }else if(sim->fileSample == SIM_SAMPLE_CI8){
+                //Back to the 12 bit scale unless the stream is also SC8_Q7
+                int8_t *fileSample = (int8_t*) (sim->fileMap + sim->filePos*sampleBytes);
+                re = sc8 ? fileSample[0] : (int16_t) (fileSample[0]*16);
+                im = sc8 ? fileSample[1] : (int16_t) (fileSample[1]*16);
+            }else{
+                int16_t *fileSample = (int16_t*) (sim->fileMap + sim->filePos*sampleBytes);
+                re = sc8 ? fileSample[0] >> 4 : fileSample[0];
+                im = sc8 ? fileSample[1] >> 4 : fileSample[1];
+            }
+            if(sc8){
+                samplesSC8[2*i] = (int8_t) re;
+                samplesSC8[2*i+1] = (int8_t) im;
+            }else{
+                samplesSC16[2*i] = re;
+                samplesSC16[2*i+1] = im;
+            }
+
+            sim->filePos++;
+            if(sim->filePos == sim->fileLen && sim->config.loop){
+                sim->filePos = 0;
+                sim->fileAdvisedBytes = 0;
+                simFileReadahead(sim, 0);
+            }
+        }
+        return;
+    }
+
+    double fullScale = sc8 ? BLADERF_FULL_RANGE_VALUE_SC8 : BLADERF_FULL_RANGE_VALUE;
+    double minVal = -fullScale-1;
+    double amplitude = sim->config.source == SIM_SOURCE_TONE ? sim->config.amplitude*fullScale : 0;
+    double noise = sim->config.noiseAmplitude*fullScale;
+    for(unsigned int i = 0; i<numSamples; i++){
+        int chan = i%numChannels;
+        double re = amplitude*sim->phasorRe[chan];
+        double im = amplitude*sim->phasorIm[chan];
+        if(noise > 0){
+            re += noise*simGaussian(dir);
+            im += noise*simGaussian(dir);
+        }
+        re = re > fullScale ? fullScale : (re < minVal ? minVal : re);
+        im = im > fullScale ? fullScale : (im < minVal ? minVal : im);
+        if(sc8){
+            samplesSC8[2*i] = (int8_t) lround(re);
+            samplesSC8[2*i+1] = (int8_t) lround(im);
+        }else{
+            samplesSC16[2*i] = (int16_t) lround(re);
+            samplesSC16[2*i+1] = (int16_t) lround(im);
+        }
+
+        double nextRe = sim->phasorRe[chan]*sim->stepRe - sim->phasorIm[chan]*sim->stepIm;
+        double nextIm = sim->phasorRe[chan]*sim->stepIm + sim->phasorIm[chan]*sim->stepRe;
+        sim->phasorRe[chan] = nextRe;
+        sim->phasorIm[chan] = nextIm;
+    }
+
+    //Keep the phasors on the unit circle
+    for(int chan = 0; chan<numChannels; chan++){
+        double mag = sqrt(sim->phasorRe[chan]*sim->phasorRe[chan] + sim->phasorIm[chan]*sim->phasorIm[chan]);
+        sim->phasorRe[chan] /= mag;
+        sim->phasorIm[chan] /= mag;
+    }
+}
+
+int simSyncRx(simDevice_t *sim, void *samples, unsigned int numSamples, struct bladerf_metadata *meta, unsigned int timeout_ms){
+    simDirection_t *dir = &sim->rx;
+    if(!dir->configured || numSamples % dir->numChannels != 0){
+        return BLADERF_ERR_INVAL;
+    }
+    uint64_t sampsPerChan = numSamples/dir->numChannels;
+    bool overrun = false;
+    if(simFailed(sim, dir, sampsPerChan)){
+        return BLADERF_ERR_IO;
+    }
+
+    uint64_t now = simClock(sim, dir);
+    if(!dir->started){
+        dir->sampleCount = now;
+        dir->started = true;
+    }
+    if(meta != NULL && !(meta->flags & BLADERF_META_FLAG_RX_NOW) && meta->timestamp > dir->sampleCount){
+        //Scheduled read: the samples before the requested timestamp are discarded
+        simFileSkip(sim, (meta->timestamp - dir->sampleCount)*dir->numChannels);
+        dir->sampleCount = meta->timestamp;
+    }
+
+    //The stream buffers filled while waiting for the caller: the hardware dropped the samples that did not fit
+    if(!sim->config.unthrottled && now > dir->sampleCount + dir->bufferedSamples){
+        uint64_t skip = now - dir->sampleCount - dir->bufferedSamples;
+        dir->sampleCount += skip;
+        dir->samplesDropped += skip;
+        simFileSkip(sim, skip*dir->numChannels);
+        dir->emulatedOverruns++;
+        overrun = true;
+    }
+
+    //Injected overruns occur at random (approximately Poisson) in sample time
+    if(sim->config.overrunRate > 0 && simUniform(dir) < sim->config.overrunRate*sampsPerChan/dir->sampRate){
+        dir->sampleCount += sim->config.overrunLen;
+        dir->samplesDropped += sim->config.overrunLen;
+        simFileSkip(sim, ((uint64_t) sim->config.overrunLen)*dir->numChannels);
+        dir->injectedOverruns++;
+        overrun = true;
+    }
+
+    //The samples after the last full buffer of the file are not returned
+    if(sim->config.source == SIM_SOURCE_FILE && !sim->config.loop && sim->filePos + numSamples > sim->fileLen){
+        return SIM_END_OF_FILE;
+    }
+
+    //The last sample of the buffer needs to have been sampled
+    if(!simWaitUntil(sim, dir, dir->sampleCount + sampsPerChan, timeout_ms)){
+        return BLADERF_ERR_TIMEOUT;
+    }
+    simFillRx(sim, samples, numSamples);
+
+    if(meta != NULL){
+        meta->timestamp = dir->sampleCount;
+        meta->actual_count = numSamples;
+        meta->status = overrun ? BLADERF_META_STATUS_OVERRUN : 0;
+    }
+    dir->sampleCount += sampsPerChan;
+
+    return 0;
+}
+
+int simSyncTx(simDevice_t *sim, const void *samples, unsigned int numSamples, struct bladerf_metadata *meta, unsigned int timeout_ms){
+    simDirection_t *dir = &sim->tx;
+    if(!dir->configured || numSamples % dir->numChannels != 0){
+        return BLADERF_ERR_INVAL;
+    }
+    uint64_t sampsPerChan = numSamples/dir->numChannels;
+    if(simFailed(sim, dir, sampsPerChan)){
+        return BLADERF_ERR_IO;
+    }
+    uint64_t now = simClock(sim, dir);
+
+    if(meta != NULL && (meta->flags & BLADERF_META_FLAG_TX_BURST_START)){
+        if(meta->flags & BLADERF_META_FLAG_TX_NOW){
+            dir->sampleCount = now;
+        }else if(meta->timestamp < now && !sim->config.unthrottled){
+            dir->latePasts++;
+            return BLADERF_ERR_TIME_PAST;
+        }else{
+            dir->sampleCount = meta->timestamp;
+        }
+        dir->queueStart = dir->sampleCount;
+        dir->started = true;
+    }else if(!dir->started){
+        //Streaming starts with the first buffer
+        dir->sampleCount = now;
+        dir->queueStart = now;
+        dir->started = true;
+    }else if(!sim->config.unthrottled && dir->sampleCount < now){
+        //The queue ran dry before these samples arrived
+        dir->underruns++;
+        dir->sampleCount = now;
+        dir->queueStart = now;
+    }
+
+    //Block until the stream buffers have room.  Samples leave the buffers once the clock passes them (or the burst starts)
+    uint64_t roomTimestamp = 0;
+    if(dir->sampleCount + sampsPerChan > dir->queueStart + dir->bufferedSamples){
+        roomTimestamp = dir->sampleCount + sampsPerChan - dir->bufferedSamples;
+    }
+    if(!simWaitUntil(sim, dir, roomTimestamp, timeout_ms)){
+        return BLADERF_ERR_TIMEOUT;
+    }
+    dir->sampleCount += sampsPerChan;
+
+    if(meta != NULL && (meta->flags & BLADERF_META_FLAG_TX_BURST_END)){
+        dir->started = false;
+    }
+
+    return 0;
+}
+
+int simGetTimestamp(simDevice_t *sim, bladerf_direction dir, bladerf_timestamp *timestamp){
+    if(atomic_load_explicit(&sim->failed, memory_order_relaxed)){
+        return BLADERF_ERR_IO;
+    }
+    *timestamp = simClock(sim, simDirection(sim, dir == BLADERF_TX));
+    return 0;
+}
+
+void simReportChannelState(simDevice_t *sim, bool tx, int chanNum){
+    char chanHelpStr[5];
+    snprintf(chanHelpStr, 5, tx ? "Tx%d" : "Rx%d", chanNum);
+    simDirection_t *dir = simDirection(sim, tx);
+
+    printf("[%s] Simulated     : %s\n", chanHelpStr, sim->config.unthrottled ? "Unthrottled" : "Real Time");
+    printf("[%s] Samp Rate (Hz): %10u\n", chanHelpStr, dir->sampRate);
+    if(!tx){
+        printf("[%s] Source        : %s\n", chanHelpStr, simSourceToStr(sim->config.source));
+    }
+}
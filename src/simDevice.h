@@ -0,0 +1,78 @@
+//
+// Simulated bladeRF for benchmarking and testing the Rx/Tx pipeline without a board.  Implements the subset of the
+// libbladeRF sync interface used by the Rx and Tx threads (see radioDevice.h).
+//
+
+#ifndef BLADERFTOFIFO_SIMDEVICE_H
+#define BLADERFTOFIFO_SIMDEVICE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <libbladeRF.h>
+
+typedef enum{
+    SIM_SOURCE_TONE = 0,  //Complex tone (plus noise)
+    SIM_SOURCE_NOISE = 1, //Gaussian noise only
+    SIM_SOURCE_FILE = 2   //I/Q recording (see simFileFormat_t).  MIMO recordings are interleaved by channel
+} simSource_t;
+
+typedef enum{
+    SIM_FILE_SC16 = 0, //Raw interleaved SC16_Q11 I/Q (ex. from bladeRF-cli)
+    SIM_FILE_CF32 = 1, //Raw interleaved float I/Q, full scale is 1.0
+    SIM_FILE_SIGMF = 2 //SigMF recording (ci16_le, ci8, or cf32_le).  The path is the .sigmf-meta or .sigmf-data file
+} simFileFormat_t;
+
+#define SIM_END_OF_FILE (1) //Returned by simSyncRx when a file source that is not looped runs out of samples
+
+typedef struct{
+    simSource_t source;
+    double toneFreq;       //Hz (baseband)
+    double amplitude;      //Tone amplitude relative to full scale
+    double noiseAmplitude; //Noise standard deviation relative to full scale (added to the tone)
+    char *filePath;        //SIM_SOURCE_FILE
+    simFileFormat_t fileFormat;
+    bool loop;             //Repeat the file rather than ending the stream
+    bool unthrottled;      //Produce and consume samples as fast as possible rather than at the sample rate
+    double overrunRate;    //Average number of injected Rx overruns per second of samples
+    uint32_t overrunLen;   //Samples (per channel) dropped by an injected overrun
+    double jitter_us;      //Maximum random delay added to each sync call (us)
+    double faultRate;      //Average number of injected device failures per second of samples (in each direction)
+} simConfig_t;
+
+typedef struct simDevice_s simDevice_t;
+
+//Returns false if the string is not a known source ("tone", "noise", or "file")
+bool parseSimSource(char *str, simSource_t *source);
+
+//Returns false if the string is not a known file format ("sc16", "cf32", or "sigmf")
+bool parseSimFileFormat(char *str, simFileFormat_t *format);
+
+void initSimConfig(simConfig_t *config);
+
+//Creates the simulated device.  The source file is mapped rather than read.  Exits if it cannot be mapped
+simDevice_t* simOpen(simConfig_t *config, unsigned int rxSampRate, unsigned int txSampRate);
+
+//Prints the counters of injected and emulated events when print is set
+void simClose(simDevice_t *sim, char *label, bool print);
+
+//After an injected failure, the stream calls of both directions return BLADERF_ERR_IO until the device is reopened (as
+//after a USB error).
+//The simulated device follows the libbladeRF conventions: num_samples counts the samples of all channels, the
+//timestamps count samples per channel, and errors are BLADERF_ERR_* codes.  A stream call returns
+//BLADERF_ERR_TIMEOUT if the simulated samples (or buffer space) are not available within the timeout, the samples
+//are not consumed.
+int simSyncConfig(simDevice_t *sim, bladerf_channel_layout layout, bladerf_format format,
+                  unsigned int numBuffers, unsigned int bufferSize, unsigned int numTransfers, unsigned int timeout_ms);
+
+int simEnableModule(simDevice_t *sim, bladerf_channel ch, bool enable);
+
+int simSyncRx(simDevice_t *sim, void *samples, unsigned int numSamples, struct bladerf_metadata *meta, unsigned int timeout_ms);
+
+int simSyncTx(simDevice_t *sim, const void *samples, unsigned int numSamples, struct bladerf_metadata *meta, unsigned int timeout_ms);
+
+int simGetTimestamp(simDevice_t *sim, bladerf_direction dir, bladerf_timestamp *timestamp);
+
+void simReportChannelState(simDevice_t *sim, bool tx, int chanNum);
+
+#endif //BLADERFTOFIFO_SIMDEVICE_H
@@ -0,0 +1,117 @@
+//
+// Per-stage latency histograms of the Rx and Tx threads
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stageTiming.h"
+
+static uint64_t stageTimingNowNs(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t) now.tv_sec)*1000000000 + (uint64_t) now.tv_nsec;
+}
+
+stageTiming_t* stageTimingCreate(char *label, bool tx){
+#ifdef STAGE_TIMING
+    stageTiming_t *timing = (stageTiming_t*) aligned_alloc(64, (sizeof(stageTiming_t) + 63)/64*64);
+    if(timing == NULL){
+        fprintf(stderr, "Unable to allocate the stage timing histograms\n");
+        exit(1);
+    }
+    memset(timing, 0, sizeof(stageTiming_t));
+    timing->label = label;
+    if(tx){
+        timing->numStages = TX_NUM_STAGES;
+        timing->stageNames[TX_STAGE_FIFO] = "FIFO Wait";
+        timing->stageNames[TX_STAGE_CONVERT] = "Conversion";
+        timing->stageNames[TX_STAGE_SYNC] = "bladerf_sync_tx";
+        timing->stageNames[TX_STAGE_FEEDBACK] = "Feedback";
+    }else{
+        timing->numStages = RX_NUM_STAGES;
+        timing->stageNames[RX_STAGE_SYNC] = "bladerf_sync_rx";
+        timing->stageNames[RX_STAGE_TAPS] = "Taps";
+        timing->stageNames[RX_STAGE_CONVERT] = "Conversion";
+        timing->stageNames[RX_STAGE_FIFO] = "FIFO Handoff";
+    }
+    for(int stage = 0; stage<STAGE_TIMING_MAX_STAGES; stage++){
+        for(int bucket = 0; bucket<STAGE_TIMING_BUCKETS; bucket++){
+            atomic_init(&timing->counts[stage][bucket], 0);
+        }
+        atomic_init(&timing->maxTicks[stage], 0);
+    }
+    timing->startNs = stageTimingNowNs();
+    timing->startTicks = stageTimingTicks();
+    return timing;
+#else
+    (void) label;
+    (void) tx;
+    return NULL;
+#endif
+}
+
+void stageTimingFree(stageTiming_t *timing){
+    free(timing);
+}
+
+//The largest value recorded in the bucket
+static uint64_t stageTimingBucketMax(int bucket){
+    if(bucket < STAGE_TIMING_SUB_BUCKETS){
+        return (uint64_t) bucket;
+    }
+    int shift = (bucket >> STAGE_TIMING_SUB_BUCKET_BITS) - 1;
+    uint64_t low = ((uint64_t) (STAGE_TIMING_SUB_BUCKETS + (bucket & (STAGE_TIMING_SUB_BUCKETS - 1)))) << shift;
+    return low + (((uint64_t) 1) << shift) - 1;
+}
+
+void stageTimingReport(stageTiming_t *timing, char *serial){
+    if(timing == NULL){
+        return;
+    }
+
+    double nsPerTick = 1;
+    uint64_t elapsedTicks = stageTimingTicks() - timing->startTicks;
+    uint64_t elapsedNs = stageTimingNowNs() - timing->startNs;
+    if(elapsedTicks > 0){
+        nsPerTick = (double) elapsedNs/elapsedTicks;
+    }
+
+    const double percentiles[] = {50, 99, 99.9};
+    const int numPercentiles = sizeof(percentiles)/sizeof(percentiles[0]);
+    for(int stage = 0; stage<timing->numStages; stage++){
+        //Copy the counts so that the total matches the buckets while the thread keeps recording
+        uint64_t counts[STAGE_TIMING_BUCKETS];
+        uint64_t total = 0;
+        for(int bucket = 0; bucket<STAGE_TIMING_BUCKETS; bucket++){
+            counts[bucket] = atomic_load_explicit(&timing->counts[stage][bucket], memory_order_relaxed);
+            total += counts[bucket];
+        }
+        uint64_t maxTicks = atomic_load_explicit(&timing->maxTicks[stage], memory_order_relaxed);
+
+        printf("[%s] %s %-16s Count %10lu", serial, timing->label, timing->stageNames[stage], total);
+        if(total == 0){
+            printf("\n");
+            continue;
+        }
+        int bucket = 0;
+        uint64_t cumulative = counts[0];
+        for(int p = 0; p<numPercentiles; p++){
+            uint64_t rank = (uint64_t) (percentiles[p]/100.0*total + 0.5);
+            if(rank < 1){
+                rank = 1;
+            }
+            while(cumulative < rank && bucket < STAGE_TIMING_BUCKETS-1){
+                bucket++;
+                cumulative += counts[bucket];
+            }
+            uint64_t valueTicks = stageTimingBucketMax(bucket);
+            if(valueTicks > maxTicks){
+                valueTicks = maxTicks;
+            }
+            printf(", p%g %9.2f us", percentiles[p], valueTicks*nsPerTick/1e3);
+        }
+        printf(", Max %9.2f us\n", maxTicks*nsPerTick/1e3);
+    }
+}
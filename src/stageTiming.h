@@ -0,0 +1,103 @@
+//
+// Per-stage latency histograms of the Rx and Tx threads.  Built with the STAGE_TIMING CMake option (-DSTAGE_TIMING=ON),
+// otherwise the STAGE_TIMING_* macros compile to nothing and no histograms are allocated.
+//
+
+#ifndef BLADERFTOFIFO_STAGETIMING_H
+#define BLADERFTOFIFO_STAGETIMING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+//Stages are timed with the TSC (CLOCK_MONOTONIC on other architectures) and recorded in log bucketed (HDR style)
+//histograms.  Values below 2^STAGE_TIMING_SUB_BUCKET_BITS ticks are exact.  Above that, each power of 2 is split into
+//2^STAGE_TIMING_SUB_BUCKET_BITS buckets (at most 1/16 relative error).
+#define STAGE_TIMING_SUB_BUCKET_BITS (4)
+#define STAGE_TIMING_SUB_BUCKETS (1 << STAGE_TIMING_SUB_BUCKET_BITS)
+#define STAGE_TIMING_BUCKETS ((64 - STAGE_TIMING_SUB_BUCKET_BITS + 1) << STAGE_TIMING_SUB_BUCKET_BITS)
+#define STAGE_TIMING_MAX_STAGES (4)
+
+typedef enum{
+    RX_STAGE_SYNC = 0,    //bladerf_sync_rx
+    RX_STAGE_TAPS = 1,    //Recording and capture copies of the bladeRF buffer
+    RX_STAGE_CONVERT = 2, //Deinterleave and conversion of a bladeRF buffer
+    RX_STAGE_FIFO = 3,    //Handoff of a block to the Rx FIFOs (including drops and the staging backlog)
+    RX_NUM_STAGES = 4
+} rxStage_t;
+
+typedef enum{
+    TX_STAGE_FIFO = 0,     //readFifo of a block
+    TX_STAGE_CONVERT = 1,  //Conversion of a block
+    TX_STAGE_SYNC = 2,     //bladerf_sync_tx
+    TX_STAGE_FEEDBACK = 3, //Return of the feedback token
+    TX_NUM_STAGES = 4
+} txStage_t;
+
+//The histograms are only written by the owning thread.  Relaxed atomics are used so that a report from another
+//thread (ex. on SIGUSR1) sees untorn counts
+typedef struct{
+    char *label;
+    int numStages;
+    char *stageNames[STAGE_TIMING_MAX_STAGES];
+    uint64_t startTicks; //The tick rate is calibrated against CLOCK_MONOTONIC between creation and each report
+    uint64_t startNs;
+    atomic_uint_fast64_t counts[STAGE_TIMING_MAX_STAGES][STAGE_TIMING_BUCKETS];
+    atomic_uint_fast64_t maxTicks[STAGE_TIMING_MAX_STAGES];
+} stageTiming_t;
+
+static inline uint64_t stageTimingTicks(void){
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t) now.tv_sec)*1000000000 + (uint64_t) now.tv_nsec;
+#endif
+}
+
+static inline int stageTimingBucket(uint64_t ticks){
+    if(ticks < STAGE_TIMING_SUB_BUCKETS){
+        return (int) ticks;
+    }
+    int shift = 63 - __builtin_clzll(ticks) - STAGE_TIMING_SUB_BUCKET_BITS;
+    return ((shift + 1) << STAGE_TIMING_SUB_BUCKET_BITS) + (int) ((ticks >> shift) & (STAGE_TIMING_SUB_BUCKETS - 1));
+}
+
+static inline void stageTimingRecord(stageTiming_t *timing, int stage, uint64_t ticks){
+    atomic_uint_fast64_t *count = &timing->counts[stage][stageTimingBucket(ticks)];
+    atomic_store_explicit(count, atomic_load_explicit(count, memory_order_relaxed) + 1, memory_order_relaxed);
+    if(ticks > atomic_load_explicit(&timing->maxTicks[stage], memory_order_relaxed)){
+        atomic_store_explicit(&timing->maxTicks[stage], ticks, memory_order_relaxed);
+    }
+}
+
+#ifdef STAGE_TIMING
+#define STAGE_TIMING_START(start) uint64_t start = stageTimingTicks()
+#define STAGE_TIMING_END(timing, stage, start) stageTimingRecord((timing), (stage), stageTimingTicks() - (start))
+//For stages done in pieces (ex. the conversion of a block split across bladeRF buffers)
+#define STAGE_TIMING_DECLARE(accum) uint64_t accum = 0
+#define STAGE_TIMING_ADD(accum, start) ((accum) += stageTimingTicks() - (start))
+#define STAGE_TIMING_RECORD(timing, stage, ticks) stageTimingRecord((timing), (stage), (ticks))
+#else
+#define STAGE_TIMING_START(start)
+#define STAGE_TIMING_END(timing, stage, start)
+#define STAGE_TIMING_DECLARE(accum)
+#define STAGE_TIMING_ADD(accum, start)
+#define STAGE_TIMING_RECORD(timing, stage, ticks)
+#endif
+
+//Returns NULL when built without STAGE_TIMING
+stageTiming_t* stageTimingCreate(char *label, bool tx);
+
+void stageTimingFree(stageTiming_t *timing);
+
+//Prints the count, p50, p99, p99.9, and max of each stage (in us).  No-op for NULL
+void stageTimingReport(stageTiming_t *timing, char *serial);
+
+#endif //BLADERFTOFIFO_STAGETIMING_H
@@ -0,0 +1,70 @@
+//
+// Measures how long the Rx/Tx threads take to reach steady state after starting
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "startupTrace.h"
+#include "helpers.h"
+
+void startupTraceInit(startupTrace_t *trace){
+    clock_gettime(CLOCK_MONOTONIC, &trace->threadStart);
+    trace->setupSec = 0;
+    trace->numTraced = 0;
+    trace->reported = false;
+}
+
+void startupTraceSetupDone(startupTrace_t *trace){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    trace->setupSec = difftimespec(&now, &trace->threadStart);
+}
+
+void startupTraceBuffer(startupTrace_t *trace, double processingSec){
+    if(!startupTraceActive(trace)){
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    trace->processingSec[trace->numTraced] = processingSec;
+    trace->bufferEndSec[trace->numTraced] = difftimespec(&now, &trace->threadStart);
+    trace->numTraced++;
+}
+
+static int compareDouble(const void *a, const void *b){
+    double aVal = *((const double*) a);
+    double bVal = *((const double*) b);
+    return (aVal > bVal) - (aVal < bVal);
+}
+
+void startupTraceReport(startupTrace_t *trace, char *label){
+    if(trace->reported){
+        return;
+    }
+    trace->reported = true;
+
+    if(trace->numTraced == 0){
+        printf("%s Startup: Setup: %.3f ms, no buffers processed\n", label, trace->setupSec*1e3);
+        return;
+    }
+
+    double sorted[STARTUP_TRACE_LEN];
+    memcpy(sorted, trace->processingSec, sizeof(double)*trace->numTraced);
+    qsort(sorted, trace->numTraced, sizeof(double), compareDouble);
+    double median = sorted[trace->numTraced/2];
+
+    int lastSlow = -1;
+    for(int i = 0; i<trace->numTraced; i++){
+        if(trace->processingSec[i] > median*STARTUP_TRACE_STEADY_FACTOR){
+            lastSlow = i;
+        }
+    }
+    //Steady from the buffer after the last slow one
+    double steadySec = lastSlow < 0 ? trace->bufferEndSec[0] - trace->processingSec[0] : trace->bufferEndSec[lastSlow];
+
+    printf("%s Startup: Setup: %.3f ms, First Buffer: %.3f ms (Processing: %.3f us), Steady State: %.3f ms after %d buffer(s) (Median Processing: %.3f us)\n",
+           label, trace->setupSec*1e3, trace->bufferEndSec[0]*1e3, trace->processingSec[0]*1e6, steadySec*1e3, lastSlow+1, median*1e6);
+}
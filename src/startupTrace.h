@@ -0,0 +1,40 @@
+//
+// Measures how long the Rx/Tx threads take to reach steady state after starting
+//
+
+#ifndef BLADERFTOFIFO_STARTUPTRACE_H
+#define BLADERFTOFIFO_STARTUPTRACE_H
+
+#include <stdbool.h>
+#include <time.h>
+
+#define STARTUP_TRACE_LEN (64) //Number of buffers (bladeRF buffers for Rx, FIFO blocks for Tx) traced after streaming starts
+#define STARTUP_TRACE_STEADY_FACTOR (2.0) //A buffer is steady once its processing time is within this factor of the median
+
+//The processing time of the first STARTUP_TRACE_LEN buffers is recorded.  Steady state is reached after the last
+//buffer whose processing time exceeds STARTUP_TRACE_STEADY_FACTOR times the median.  Page faults, cold caches, and
+//lazy initialization show up as long processing times in the first buffers.
+typedef struct{
+    struct timespec threadStart;
+    double setupSec; //Time from thread start to streaming (FIFOs opened, buffers allocated, stream configured)
+    int numTraced;
+    double bufferEndSec[STARTUP_TRACE_LEN]; //Time from thread start to the end of processing each buffer
+    double processingSec[STARTUP_TRACE_LEN];
+    bool reported;
+} startupTrace_t;
+
+void startupTraceInit(startupTrace_t *trace);
+
+void startupTraceSetupDone(startupTrace_t *trace);
+
+//Records the processing time of a buffer (ending now).  No-op after STARTUP_TRACE_LEN buffers.
+void startupTraceBuffer(startupTrace_t *trace, double processingSec);
+
+static inline bool startupTraceActive(startupTrace_t *trace){
+    return trace->numTraced < STARTUP_TRACE_LEN;
+}
+
+//Prints the startup timing once (after STARTUP_TRACE_LEN buffers or, if fewer were processed, at shutdown)
+void startupTraceReport(startupTrace_t *trace, char *label);
+
+#endif //BLADERFTOFIFO_STARTUPTRACE_H
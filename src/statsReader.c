@@ -0,0 +1,196 @@
+//
+// Attaches (read only) to the stats segment published by bladeRFToFIFO -statsName <name> and periodically prints the
+// rates and the live counters of every board.  Does not disturb the radio: the counters are only read.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "statsSegment.h"
+
+#define STATS_READER_DEFAULT_PERIOD (1.0)
+
+typedef struct{
+    uint64_t samples;
+    uint64_t fifoWaitNs;
+    uint64_t syncCalls;
+    uint64_t syncNs;
+} statsSnapshot_t;
+
+void printHelp(){
+    printf("bladeRFStats <statsName>\n");
+    printf("\n");
+    printf("Optional Arguments:\n");
+    printf("-period: Period (in seconds) between reports.  Default: %.1f\n", STATS_READER_DEFAULT_PERIOD);
+    printf("-once: Print the totals since the radio started and exit\n");
+}
+
+static volatile bool stop = false;
+
+static void signal_handler(int signum){
+    (void) signum;
+    stop = true;
+}
+
+static uint64_t loadCounter(atomic_uint_fast64_t *counter){
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+static void takeSnapshot(pipelineStats_t *stats, statsSnapshot_t *snapshot){
+    snapshot->samples = loadCounter(&stats->samplesTransferred);
+    snapshot->fifoWaitNs = loadCounter(&stats->fifoWaitNs);
+    snapshot->syncCalls = loadCounter(&stats->syncCalls);
+    snapshot->syncNs = loadCounter(&stats->syncNs);
+}
+
+//Rates are over the interval since the previous snapshot
+static void printDirection(char *label, pipelineStats_t *stats, statsSnapshot_t *prev, double intervalNs, bool rx){
+    statsSnapshot_t now;
+    takeSnapshot(stats, &now);
+
+    double rate = (now.samples - prev->samples)/(intervalNs*1e-9)/1e6;
+    double fifoWaitPct = 100.0*(now.fifoWaitNs - prev->fifoWaitNs)/intervalNs;
+    uint64_t syncCalls = now.syncCalls - prev->syncCalls;
+    double syncMean_us = syncCalls > 0 ? (now.syncNs - prev->syncNs)/1e3/syncCalls : 0;
+    uint64_t fifoSize = loadCounter(&stats->fifoSizeBytes);
+    double fifoPct = fifoSize > 0 ? 100.0*loadCounter(&stats->fifoOccupancyBytes)/fifoSize : 0;
+
+    printf("  %s: %8.3f MS/s, %12lu Samples, FIFO %5.1f%% Full, FIFO Wait %5.1f%%, libbladeRF Call %8.1f us (Max %8.1f us)",
+           label, rate, now.samples, fifoPct, fifoWaitPct, syncMean_us, loadCounter(&stats->syncMaxNs)/1e3);
+    if(rx){
+        printf(", Dropped %lu Samples", loadCounter(&stats->samplesDropped));
+    }else{
+        printf(", Underflows %lu (%lu Samples Inserted)", loadCounter(&stats->underflows), loadCounter(&stats->samplesInserted));
+    }
+    printf(", Clipped %lu", loadCounter(&stats->samplesClipped));
+    uint64_t hops = loadCounter(&stats->hops);
+    if(hops > 0){
+        printf(", Hops %lu (Missed %lu, Retune Max %.1f us)", hops, loadCounter(&stats->hopsMissed), loadCounter(&stats->retuneMaxNs)/1e3);
+    }
+    uint64_t recoveries = loadCounter(&stats->recoveries);
+    if(recoveries > 0){
+        printf(", Recoveries %lu (Mean %.1f ms, Max %.1f ms)", recoveries,
+               loadCounter(&stats->recoveryNs)/1e6/recoveries, loadCounter(&stats->recoveryMaxNs)/1e6);
+    }
+    printf("\n");
+
+    *prev = now;
+}
+
+int main(int argc, char **argv) {
+    char *statsName = NULL;
+    double period = STATS_READER_DEFAULT_PERIOD;
+    bool once = false;
+
+    if (argc < 2) {
+        printHelp();
+        exit(1);
+    }
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp("-period", argv[i]) == 0) {
+            i++; //Get the actual argument
+
+            if (i < argc) {
+                period = strtod(argv[i], NULL);
+                if (period <= 0) {
+                    printf("-period must be positive\n");
+                    exit(1);
+                }
+            } else {
+                printf("Missing argument for -period\n");
+                exit(1);
+            }
+        } else if (strcmp("-once", argv[i]) == 0) {
+            once = true;
+        } else if (strcmp("-h", argv[i]) == 0 || strcmp("--help", argv[i]) == 0) {
+            printHelp();
+            exit(0);
+        } else if (statsName == NULL) {
+            statsName = argv[i];
+        } else {
+            printf("Unknown CLI option: %s\n", argv[i]);
+            exit(1);
+        }
+    }
+
+    if(statsName == NULL){
+        printHelp();
+        exit(1);
+    }
+
+    //Map the header first to find the size of the segment
+    int fd = shm_open(statsName, O_RDONLY, 0);
+    if(fd < 0){
+        fprintf(stderr, "Unable to open the stats segment %s: %s\n", statsName, strerror(errno));
+        exit(1);
+    }
+    statsSegment_t *header = (statsSegment_t*) mmap(NULL, sizeof(statsSegment_t), PROT_READ, MAP_SHARED, fd, 0);
+    if(header == MAP_FAILED){
+        fprintf(stderr, "Unable to map the stats segment %s: %s\n", statsName, strerror(errno));
+        exit(1);
+    }
+    if(atomic_load_explicit(&header->magic, memory_order_acquire) != STATS_SEGMENT_MAGIC){
+        fprintf(stderr, "%s is not an initialized stats segment\n", statsName);
+        exit(1);
+    }
+    if(header->version != STATS_SEGMENT_VERSION){
+        fprintf(stderr, "%s has version %u, expected %d\n", statsName, header->version, STATS_SEGMENT_VERSION);
+        exit(1);
+    }
+    uint32_t numPipelines = header->numPipelines;
+    munmap(header, sizeof(statsSegment_t));
+
+    statsSegment_t *segment = (statsSegment_t*) mmap(NULL, statsSegmentSize(numPipelines), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(segment == MAP_FAILED){
+        fprintf(stderr, "Unable to map the stats segment %s: %s\n", statsName, strerror(errno));
+        exit(1);
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    //The first report covers the time since the radio started
+    statsSnapshot_t *prev = (statsSnapshot_t*) calloc(2*numPipelines, sizeof(statsSnapshot_t));
+    uint64_t prevTime = segment->startTime_ns;
+    while(!stop){
+        if(!once){
+            usleep((useconds_t) (period*1e6));
+        }
+        uint64_t now = pipelineStatsNow();
+        double intervalNs = (double) (now - prevTime);
+        prevTime = now;
+
+        printf("---- %s (PID %d, %.1f s) ----\n", statsName, segment->pid, (now - segment->startTime_ns)/1e9);
+        for(uint32_t i = 0; i<numPipelines; i++){
+            statsPipeline_t *pipeline = &segment->pipelines[i];
+            printf("[%s] %u Channel%s, Block %u Samples\n", pipeline->serial, pipeline->numChannels,
+                   pipeline->numChannels == 1 ? "" : "s", pipeline->blockLen);
+            if(pipeline->rxEnabled){
+                printDirection("Rx", &pipeline->rx, &prev[2*i  ], intervalNs, true);
+            }
+            if(pipeline->txEnabled){
+                printDirection("Tx", &pipeline->tx, &prev[2*i+1], intervalNs, false);
+            }
+        }
+        fflush(stdout);
+
+        //The segment outlives a crashed radio (it is unlinked at a clean exit)
+        if(once || (kill(segment->pid, 0) != 0 && errno == ESRCH)){
+            break;
+        }
+    }
+
+    free(prev);
+    munmap(segment, statsSegmentSize(numPipelines));
+    return 0;
+}
@@ -0,0 +1,55 @@
+//
+// Live telemetry segment
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "statsSegment.h"
+
+statsSegment_t* openStatsSegment(char *name, int numPipelines){
+    size_t segmentBytes = statsSegmentSize(numPipelines);
+    statsSegment_t *segment;
+    if(name == NULL){
+        segment = (statsSegment_t*) mmap(NULL, segmentBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }else{
+        //A segment left behind by a previous run is replaced
+        shm_unlink(name);
+        int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+        if(fd < 0 || ftruncate(fd, (off_t) segmentBytes) != 0){
+            fprintf(stderr, "Unable to create the stats segment %s: %s\n", name, strerror(errno));
+            exit(1);
+        }
+        segment = (statsSegment_t*) mmap(NULL, segmentBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+    }
+    if(segment == MAP_FAILED){
+        fprintf(stderr, "Unable to map the stats segment: %s\n", strerror(errno));
+        exit(1);
+    }
+
+    //The mapping is zeroed
+    segment->version = STATS_SEGMENT_VERSION;
+    segment->numPipelines = (uint32_t) numPipelines;
+    segment->pid = (int32_t) getpid();
+    segment->startTime_ns = pipelineStatsNow();
+    for(int i = 0; i<numPipelines; i++){
+        initPipelineStats(&segment->pipelines[i].rx);
+        initPipelineStats(&segment->pipelines[i].tx);
+    }
+    atomic_store_explicit(&segment->magic, STATS_SEGMENT_MAGIC, memory_order_release);
+    return segment;
+}
+
+void closeStatsSegment(statsSegment_t *segment, char *name){
+    munmap(segment, statsSegmentSize(segment->numPipelines));
+    if(name != NULL){
+        shm_unlink(name);
+    }
+}
@@ -0,0 +1,51 @@
+//
+// Live telemetry.  The counters of every radio pipeline (pipelineStats.h) live in a stats segment.  With -statsName, the
+// segment is a named shared memory segment that other processes (ex. bladeRFStats) can map read only while the radio
+// runs.  The Rx and Tx threads update the counters in place, publishing them costs nothing extra.
+//
+
+#ifndef BLADERFTOFIFO_STATSSEGMENT_H
+#define BLADERFTOFIFO_STATSSEGMENT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "pipelineStats.h"
+
+#define STATS_SEGMENT_MAGIC (0x53465242) //"BRFS"
+#define STATS_SEGMENT_VERSION (3)
+#define STATS_SERIAL_STRLEN (64)
+
+typedef struct{
+    char serial[STATS_SERIAL_STRLEN];
+    uint32_t rxEnabled;
+    uint32_t txEnabled;
+    uint32_t numChannels;
+    uint32_t blockLen;
+    uint32_t rxSampRate;
+    uint32_t txSampRate;
+    pipelineStats_t rx;
+    pipelineStats_t tx;
+} statsPipeline_t;
+
+typedef struct{
+    atomic_uint_fast32_t magic; //Set once the segment is initialized
+    uint32_t version;
+    uint32_t numPipelines;
+    int32_t pid; //Of the bladeRFToFIFO process
+    uint64_t startTime_ns; //CLOCK_MONOTONIC
+    statsPipeline_t pipelines[];
+} statsSegment_t;
+
+static inline size_t statsSegmentSize(uint32_t numPipelines){
+    return sizeof(statsSegment_t) + numPipelines*sizeof(statsPipeline_t);
+}
+
+//Creates the segment (a private allocation if name is NULL) with zeroed counters.  Exits if the segment cannot be created
+statsSegment_t* openStatsSegment(char *name, int numPipelines);
+
+//Unlinks the named segment
+void closeStatsSegment(statsSegment_t *segment, char *name);
+
+#endif //BLADERFTOFIFO_STATSSEGMENT_H
@@ -5,107 +5,612 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <math.h>
 #include <sys/mman.h>
 #include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <libbladeRF.h>
 
 #include "depends/BerkeleySharedMemoryFIFO.h"
 #include "txThread.h"
+#include "blockHeaders.h"
 #include "helpers.h"
+#include "sampleConversion.h"
+#include "rtPolicy.h"
+#include "startupTrace.h"
+
+#define TX_IDLE_SPIN_SEC (1e-3) //Waits with no deadline poll continuously for this long before sleeping between polls
+#define TX_IDLE_POLL_US (100)
+
+bool parseTxUnderflowPolicy(char *str, txUnderflowPolicy_t *policy){
+    if(strcmp(str, "wait") == 0){
+        *policy = TX_UNDERFLOW_WAIT;
+    }else if(strcmp(str, "zero") == 0){
+        *policy = TX_UNDERFLOW_ZERO;
+    }else if(strcmp(str, "hold") == 0){
+        *policy = TX_UNDERFLOW_HOLD;
+    }else{
+        return false;
+    }
+    return true;
+}
+
+char* txUnderflowPolicyToStr(txUnderflowPolicy_t policy){
+    switch(policy){
+        case TX_UNDERFLOW_WAIT:
+            return "wait";
+        case TX_UNDERFLOW_ZERO:
+            return "zero";
+        case TX_UNDERFLOW_HOLD:
+            return "hold";
+        default:
+            return "Unknown";
+    }
+}
+
+//Converts numToProcess samples from each channel's shared memory FIFO buffer (starting at sharedMemPos) into the
+//bladeRF buffer (starting at bladeRFBufferPos, in samples per channel).  In MIMO mode, each channel is converted into its
+//own buffer before being interleaved into the bladeRF buffer.
+static int convertTxChannels(SAMPLE_COMPONENT_DATATYPE **sharedMemFIFO_re, SAMPLE_COMPONENT_DATATYPE **sharedMemFIFO_im, int sharedMemPos,
+                              sampleFormat_t sampleFormat, void *bladeRFSampBuffer, void **bladeRFChanSampBuffer, int bladeRFBufferPos, int numChannels, int numToProcess,
+                              SAMPLE_COMPONENT_DATATYPE scaleFactor, iqCorrection_t *corrections, bool saturate){
+    int clipped = 0;
+    if(numChannels == 1){
+        clipped += convertTxBladeRFSamples(sampleFormat, sharedMemFIFO_re[0]+sharedMemPos, sharedMemFIFO_im[0]+sharedMemPos, bladeRFSampBuffer, bladeRFBufferPos, numToProcess,
+                                           scaleFactor, &corrections[0], saturate);
+    }else{
+        for(int chan = 0; chan<numChannels; chan++) {
+            clipped += convertTxBladeRFSamples(sampleFormat, sharedMemFIFO_re[chan]+sharedMemPos, sharedMemFIFO_im[chan]+sharedMemPos, bladeRFChanSampBuffer[chan], 0, numToProcess,
+                                               scaleFactor, &corrections[chan], saturate);
+        }
+        interleaveX2(sampleFormat, bladeRFChanSampBuffer[0], bladeRFChanSampBuffer[1], bladeRFSampBuffer, bladeRFBufferPos, numToProcess);
+    }
+    return clipped;
+}
+
+//Ends the current burst by sending a single zero sample marked as the end of the burst.
+//Used when the producer does not supply a block to end the burst on (ex. a new burst started before the last ended)
+static int endTxBurst(radioDevice_t *device, int numChannels){
+    int16_t zeroSamp[2*BLADERF_MAX_CHANNELS] = {0}; //Large enough for either sample format
+    struct bladerf_metadata meta;
+    memset(&meta, 0, sizeof(meta));
+    meta.flags = BLADERF_META_FLAG_TX_BURST_END;
+    return radioDeviceSyncTx(device, zeroSamp, numChannels, &meta, 0);
+}
+
+//Polls until a block is available from every channel's FIFO.  Returns false if the deadline passes (or the thread is
+//stopped) first.  The channels are processed in lockstep so all of them need to have a block.  Without a deadline (an
+//idle producer), the polls are spaced by TX_IDLE_POLL_US after TX_IDLE_SPIN_SEC so that an idle Tx does not hold a core
+static bool waitForTxBlocks(sharedMemoryFIFO_t *txFifo, int numChannels, size_t fifoBlockSizeBytes, double deadlineSec, volatile bool *stop){
+    struct timespec waitStart, now;
+    clock_gettime(CLOCK_MONOTONIC, &waitStart);
+    while(!(*stop)){
+        bool ready = true;
+        for(int chan = 0; chan<numChannels && ready; chan++) {
+            ready = hasDataForReading(fifoBlockSizeBytes, &txFifo[chan]);
+        }
+        if(ready){
+            return true;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double waitSec = difftimespec(&now, &waitStart);
+        if(waitSec >= deadlineSec){
+            return false;
+        }
+        if(isinf(deadlineSec) && waitSec >= TX_IDLE_SPIN_SEC){
+            usleep(TX_IDLE_POLL_US);
+        }
+    }
+    return false;
+}
+
+//Fills the (interleaved) bladeRF buffer from startFrame to endFrame (in samples per channel) according to the underflow
+//policy.  A frame is one sample from each channel.  With TX_UNDERFLOW_HOLD, the last frame before startFrame is repeated.
+//If startFrame is 0, the last frame of the buffer (the end of the previously sent buffer) is repeated.
+static void fillTxUnderflow(txUnderflowPolicy_t policy, void *bladeRFSampBuffer, size_t frameBytes, int startFrame, int endFrame){
+    char *buffer = (char*) bladeRFSampBuffer;
+    if(policy == TX_UNDERFLOW_HOLD){
+        char holdFrame[4*BLADERF_MAX_CHANNELS]; //Large enough for either sample format
+        int holdIdx = startFrame > 0 ? startFrame-1 : endFrame-1;
+        memcpy(holdFrame, buffer + holdIdx*frameBytes, frameBytes);
+        for(int i = startFrame; i<endFrame; i++){
+            memcpy(buffer + i*frameBytes, holdFrame, frameBytes);
+        }
+    }else{
+        memset(buffer + startFrame*frameBytes, 0, (endFrame-startFrame)*frameBytes);
+    }
+}
+
+size_t txFeedbackFifoSizeBytes(int32_t fifoSizeBlocks){
+    //This does not get sent in blocks, it gets sent as a single FEEDBACK_DATATYPE per transaction
+    return sizeof(FEEDBACK_DATATYPE)*fifoSizeBlocks;
+}
+
+//Configures the stream (the libbladeRF worker thread is created here) and enables the channels (see
+//radioDeviceStartStream_t)
+static bool txStartStream(void *uncastArgs){
+    txThreadArgs_t *args = (txThreadArgs_t*) uncastArgs;
+    radioDevice_t *device = args->device;
+    int numChannels = args->numChannels;
+    //Burst mode requires metadata to carry the timestamps and burst flags
+    bladerf_format format = bladeRFFormat(args->sampleFormat, args->burstMode);
+    bladerf_channel_layout layout = numChannels == 2 ? BLADERF_TX_X2 : BLADERF_TX_X1;
+    int status = radioDeviceSyncConfig(device, layout, format,
+                                       args->bladeRFNumBuffers, args->bladeRFBlockLen, args->bladeRFNumTransfers, args->bladeRFTimeout,
+                                       args->workerCpu, args->rtPolicy, args->workerPriority, "Tx");
+    if (status != 0) {
+        fprintf(stderr, "Failed to configure bladeRF Tx: %s\n",
+                bladerf_strerror(status));
+        return false;
+    }
+
+    //Start Tx
+    for(int chan = 0; chan<numChannels; chan++) {
+        status = radioDeviceEnableModule(device, BLADERF_CHANNEL_TX(chan), true);
+        if (status != 0) {
+            fprintf(stderr, "Failed to start bladeRF Tx%d: %s\n", chan, bladerf_strerror(status));
+            return false;
+        }
+    }
+    return true;
+}
+
+//Maps the burst timestamps relative to the Tx epoch onto the device clock, which restarts when the device is reopened
+typedef struct{
+    bladerf_timestamp epoch; //Device time of relative time 0
+    bladerf_timestamp refTimestamp; //Device time at refNs
+    uint64_t refNs;
+} txBurstClock_t;
+
+//Reopens the device after a failed stream call (see radioDeviceRecover) and restarts the stream.  The samples of the
+//failed call are not sent.  In burst mode, the epoch is moved so that relative time keeps following the wall clock.
+//Returns false if the stream could not be recovered
+static bool txRecover(txThreadArgs_t *args, int status, txBurstClock_t *burstClock){
+    //RADIO_DEVICE_REOPENED: the Rx already reopened the device after a failure
+    if(status != RADIO_DEVICE_REOPENED){
+        fprintf(stderr, "Failed BladeRF Tx: %s\n", bladerf_strerror(status));
+    }
+    uint64_t failNs = pipelineStatsNow();
+    if(!radioDeviceRecover(args->device, true, txStartStream, args, args->stop, args->print)){
+        return false;
+    }
+
+    if(burstClock != NULL){
+        bladerf_timestamp deviceNow;
+        status = radioDeviceGetTimestamp(args->device, BLADERF_TX, &deviceNow);
+        if(status != 0){
+            fprintf(stderr, "Failed to get bladeRF Tx timestamp: %s\n", bladerf_strerror(status));
+            return false;
+        }
+        uint64_t nowNs = pipelineStatsNow();
+        //Unsigned arithmetic wraps, the epoch can be "negative" on the new device clock
+        bladerf_timestamp elapsed = (bladerf_timestamp) ((nowNs - burstClock->refNs)*1e-9*args->sampRate);
+        burstClock->epoch = burstClock->epoch + (deviceNow - burstClock->refTimestamp) - elapsed;
+        burstClock->refTimestamp = deviceNow;
+        burstClock->refNs = nowNs;
+    }
+
+    uint64_t outageNs = pipelineStatsNow() - failNs;
+    pipelineStatsRecovery(args->stats, outageNs);
+    if(args->print){
+        printf("Tx restarted after %.1f ms\n", outageNs/1e6);
+    }
+    return true;
+}
 
 void* txThread(void* uncastArgs){
     txThreadArgs_t* args = (txThreadArgs_t*) uncastArgs;
-    char *txSharedName = args->txSharedName;
-    char *txFeedbackSharedName = args->txFeedbackSharedName;
+    startupTrace_t startupTrace;
+    startupTraceInit(&startupTrace);
+    int numChannels = args->numChannels;
     volatile bool *stop = args->stop;
+    pipelineStats_t *stats = args->stats;
+#ifdef STAGE_TIMING
+    stageTiming_t *timing = args->timing; //Only used by the STAGE_TIMING_* macros
+#endif
+    traceBuffer_t *trace = args->trace;
+    controlMailbox_t *control = args->control;
+    hopper_t *hopper = args->hopper;
 
     int32_t blockLen = args->blockLen;
     int32_t fifoSizeBlocks = args->fifoSizeBlocks;
 
     bool print = args->print;
 
-    struct bladerf *dev = args->dev;
-    SAMPLE_COMPONENT_DATATYPE fullRangeValue = args->fullRangeValue; //Will scale this to be 2047
+    radioDevice_t *device = args->device;
+    sampleFormat_t sampleFormat = args->sampleFormat;
+    SAMPLE_COMPONENT_DATATYPE fullRangeValue = args->fullRangeValue; //Will scale this to be the full range of the sample format
     bool saturate = args->saturate;
     uint32_t bladeRFBlockLen = args->bladeRFBlockLen;
-    uint32_t bladeRFNumBuffers = args->bladeRFNumBuffers;
-    uint32_t bladeRFNumTransfers = args->bladeRFNumTransfers;
+    bool burstMode = args->burstMode;
+    uint64_t burstLeadSamples = args->burstLeadSamples;
+    txUnderflowPolicy_t underflowPolicy = args->underflowPolicy;
+    double underflowDeadlineSec = args->underflowDeadlineSec;
+    double flushIdleSec = args->flushIdleSec;
 
-    SAMPLE_COMPONENT_DATATYPE scaleFactor = (SAMPLE_COMPONENT_DATATYPE) BLADERF_FULL_RANGE_VALUE / fullRangeValue;
+    size_t bladeRFSampleBytes = bladeRFSampleSize(sampleFormat);
+    SAMPLE_COMPONENT_DATATYPE scaleFactor = (SAMPLE_COMPONENT_DATATYPE) bladeRFFullRangeValue(sampleFormat) / fullRangeValue;
+    //The DC offsets are given in the 12 bit DAC scale
+    double dcOffsetScale = (double) bladeRFFullRangeValue(sampleFormat) / BLADERF_FULL_RANGE_VALUE;
+
+    //In MIMO mode, the bladeRF buffer contains the interleaved samples from each channel
+    uint32_t bladeRFSampsPerChan = bladeRFBlockLen/numChannels;
 
     //Get the pre-distortion parameters
-    //Scale down to a float
-    float dc_I = (float) args->dcOffsetI;
-    float dc_Q = (float) args->dcOffsetQ;
-    double iq_A_dbl, iq_C_dbl, iq_D_dbl;
-    getIQImbalCorrections(args->iqGain, args->iqPhase_deg, &iq_A_dbl, &iq_C_dbl, &iq_D_dbl);
-    float iq_A = (float) iq_A_dbl;
-    float iq_C = (float) iq_C_dbl;
-    float iq_D = (float) iq_D_dbl;
-    printf("Tx: DC Offset (I, Q)=(%5.2f, %5.2f), I/Q Imbalance (Gain, Phase.deg)=(%5.3f, %5.3f), Correction (A, C, D)=(%5.2f, %5.2f, %5.2f)\n", dc_I, dc_Q, args->iqGain, args->iqPhase_deg, iq_A, iq_C, iq_D);
+    iqCorrection_t corrections[BLADERF_MAX_CHANNELS];
+    for(int chan = 0; chan<numChannels; chan++) {
+        initIQCorrection(&corrections[chan], args->dcOffsetI[chan]*dcOffsetScale, args->dcOffsetQ[chan]*dcOffsetScale, args->iqGain[chan], args->iqPhase_deg[chan]);
+        char label[8];
+        snprintf(label, 8, "Tx%d", chan);
+        printIQCorrection(label, &corrections[chan], args->iqGain[chan], args->iqPhase_deg[chan]);
+    }
 
     //---- Constants for opening FIFOs ----
-    sharedMemoryFIFO_t txFifo;
-    sharedMemoryFIFO_t txfbFifo;
+    sharedMemoryFIFO_t txFifo[BLADERF_MAX_CHANNELS];
+    sharedMemoryFIFO_t txfbFifo[BLADERF_MAX_CHANNELS];
 
-    initSharedMemoryFIFO(&txFifo);
-    initSharedMemoryFIFO(&txfbFifo);
-
-    size_t fifoBufferBlockSizeBytes = SAMPLE_SIZE*blockLen;
+    //In burst mode, each block is prefixed with a txBlockHeader_t
+    size_t fifoBlockHeaderSizeBytes = burstMode ? sizeof(txBlockHeader_t) : 0;
+    size_t fifoBufferBlockSizeBytes = fifoBlockHeaderSizeBytes + SAMPLE_SIZE*blockLen;
     size_t fifoBufferSizeBytes = fifoBufferBlockSizeBytes*fifoSizeBlocks;
     size_t txfbFifoBufferBlockSizeBytes = sizeof(FEEDBACK_DATATYPE); //This does not get sent in blocks, it gets sent as a single FEEDBACK_DATATYPE per transaction
-    size_t txfbFifoBufferSizeBytes = txfbFifoBufferBlockSizeBytes*fifoSizeBlocks;
 
-    //Initialize Producer FIFOs first to avoid deadlock
-    producerOpenInitFIFO(txFeedbackSharedName, txfbFifoBufferSizeBytes, &txfbFifo);
-    consumerOpenFIFOBlock(txSharedName, fifoBufferSizeBytes, &txFifo);
+    //The producer FIFOs were created during bring-up (overlapped with the board configuration) to avoid deadlock
+    for(int chan = 0; chan<numChannels; chan++) {
+        txfbFifo[chan] = args->feedbackFifos[chan];
+    }
+    for(int chan = 0; chan<numChannels; chan++) {
+        initSharedMemoryFIFO(&txFifo[chan]);
+        if(consumerOpenFIFOUnlessStopped(args->txSharedName[chan], fifoBufferSizeBytes, &txFifo[chan], stop) == 0){
+            //Stopped before the producer opened the FIFO
+            for(int openChan = 0; openChan<chan; openChan++) {
+                cleanupConsumer(&txFifo[openChan]);
+            }
+            return NULL;
+        }
+    }
+    atomic_store_explicit(&stats->fifoSizeBytes, fifoBufferSizeBytes, memory_order_relaxed);
 
     //Allocate Buffers
-    SAMPLE_COMPONENT_DATATYPE* sharedMemFIFOSampBuffer = (SAMPLE_COMPONENT_DATATYPE*) vitis_aligned_alloc(MEM_ALIGNMENT, fifoBufferBlockSizeBytes);
+    char* sharedMemFIFOBlockBuffer[BLADERF_MAX_CHANNELS];
+    txBlockHeader_t* sharedMemFIFOBlockHeader[BLADERF_MAX_CHANNELS];
+    SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_re[BLADERF_MAX_CHANNELS];
+    SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_im[BLADERF_MAX_CHANNELS];
+    for(int chan = 0; chan<numChannels; chan++) {
+        sharedMemFIFOBlockBuffer[chan] = (char*) vitis_aligned_alloc(MEM_ALIGNMENT, fifoBufferBlockSizeBytes);
+        sharedMemFIFOBlockHeader[chan] = (txBlockHeader_t*) sharedMemFIFOBlockBuffer[chan];
+        SAMPLE_COMPONENT_DATATYPE* sharedMemFIFOSampBuffer = (SAMPLE_COMPONENT_DATATYPE*) (sharedMemFIFOBlockBuffer[chan] + fifoBlockHeaderSizeBytes);
+        sharedMemFIFO_re[chan] = sharedMemFIFOSampBuffer;
+        sharedMemFIFO_im[chan] = sharedMemFIFOSampBuffer+blockLen;
+    }
     //While this array can be of "any reasonable size" according to https://www.nuand.com/bladeRF-doc/libbladeRF/v2.2.1/sync_no_meta.html,
     //will keep it the same as the requested bladeRF buffer lengths at the underlying bladeRF buffer length has to be filled in order to send samples down to the FPGA
-    //The elements are complex 16 bit numbers (32 bits total)
-    int16_t* bladeRFSampBuffer = (int16_t*) vitis_aligned_alloc(MEM_ALIGNMENT, sizeof(int16_t)*2*bladeRFBlockLen);
-
-    SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_re = sharedMemFIFOSampBuffer;
-    SAMPLE_COMPONENT_DATATYPE *sharedMemFIFO_im = sharedMemFIFOSampBuffer+blockLen;
+    //The elements are complex 16 bit numbers (32 bits total) for SC16_Q11 or complex 8 bit numbers (16 bits total) for SC8_Q7
+    //In burst mode, each shared memory FIFO block is sent to the bladeRF in a single call so the buffer needs to be at least blockLen (per channel)
+    uint32_t bladeRFSampBufferPerChanLen = (burstMode && blockLen > bladeRFSampsPerChan) ? blockLen : bladeRFSampsPerChan;
+    void* bladeRFSampBuffer = vitis_aligned_alloc(MEM_ALIGNMENT, bladeRFSampleBytes*bladeRFSampBufferPerChanLen*numChannels);
+
+    //In MIMO mode, each channel is converted into its own buffer before being interleaved into the bladeRF buffer
+    void* bladeRFChanSampBuffer[BLADERF_MAX_CHANNELS];
+    for(int chan = 0; chan<numChannels; chan++) {
+        bladeRFChanSampBuffer[chan] = numChannels == 1 ? NULL : vitis_aligned_alloc(MEM_ALIGNMENT, bladeRFSampleBytes*bladeRFSampBufferPerChanLen);
+    }
 
-    int status = bladerf_sync_config(dev, BLADERF_TX_X1, BLADERF_FORMAT_SC16_Q11,
-                                     bladeRFNumBuffers, bladeRFBlockLen, bladeRFNumTransfers,
-                                 0);
-    if (status != 0) {
-        fprintf(stderr, "Failed to configure bladeRF Tx: %s\n",
-                bladerf_strerror(status));
-        exit(1);
+    //Prefault and lock the working buffers from this (pinned) thread so that they are local to it and the first blocks
+    //do not incur page faults
+    bool buffersLocked = prefaultBuffer(bladeRFSampBuffer, bladeRFSampleBytes*bladeRFSampBufferPerChanLen*numChannels);
+    for(int chan = 0; chan<numChannels; chan++) {
+        buffersLocked &= prefaultBuffer(sharedMemFIFOBlockBuffer[chan], fifoBufferBlockSizeBytes);
+        if(bladeRFChanSampBuffer[chan] != NULL) {
+            buffersLocked &= prefaultBuffer(bladeRFChanSampBuffer[chan], bladeRFSampleBytes*bladeRFSampBufferPerChanLen);
+        }
+    }
+    if(!buffersLocked){
+        printf("Warning: Unable to lock Tx buffers in memory\n");
     }
 
-    //Start Tx
-    status = bladerf_enable_module(dev, BLADERF_TX, true);
-    if (status != 0) {
-        fprintf(stderr, "Failed to start bladeRF Tx: %s\n", bladerf_strerror(status));
+    if(!txStartStream(args)){
         return NULL;
     }
+    int status;
+
+    startupTraceSetupDone(&startupTrace);
 
     //Main Loop
     if(print){
         printf("Configured Tx\n");
-        reportBladeRFChannelState(dev, true, 0);
+        for(int chan = 0; chan<numChannels; chan++) {
+            radioDeviceReportChannelState(device, true, chan);
+        }
     }
 
     bool running = true;
+
+    //---- Burst Mode ----
+    //Each block from the FIFO is sent to the bladeRF in a single call with the metadata derived from the block header.
+    //libbladeRF handles packing the bursts into the underlying bladeRF buffers and the FPGA idles between bursts.
+    txBurstClock_t burstClock;
+    memset(&burstClock, 0, sizeof(burstClock));
+    if(burstMode){
+        status = radioDeviceGetTimestamp(device, BLADERF_TX, &burstClock.refTimestamp);
+        if(status != 0){
+            fprintf(stderr, "Failed to get bladeRF Tx timestamp: %s\n", bladerf_strerror(status));
+            return NULL;
+        }
+        burstClock.refNs = pipelineStatsNow();
+        burstClock.epoch = burstClock.refTimestamp + burstLeadSamples;
+        if(print){
+            printf("Tx Burst Mode Epoch (Samples): %lu\n", burstClock.epoch);
+        }
+    }
+
+    bool inBurst = false;
+    bool burstInterrupted = false; //The rest of a burst interrupted by a device reopen (or dropped as late) is not sent
+    uint64_t txBlockNum = 0; //FIFO blocks read (traced with the events of each block)
+    uint64_t txSampleIndex = 0; //Samples (per channel) read from the FIFOs, runtime changes are stamped with it
+    while(burstMode && running && !(*stop)){
+        #ifdef DEBUG
+        printf("About to read Tx burst block from Shared Memory FIFO\n");
+        #endif
+        uint64_t waitStart = pipelineStatsNow();
+        STAGE_TIMING_START(fifoStart);
+        //Wait here rather than in readFifo so that a stop is seen while the producer is idle
+        if(!waitForTxBlocks(txFifo, numChannels, fifoBufferBlockSizeBytes, INFINITY, stop)){
+            break;
+        }
+        for(int chan = 0; chan<numChannels && running; chan++) {
+            int samplesRead = readFifo(sharedMemFIFOBlockBuffer[chan], fifoBufferBlockSizeBytes, 1, &txFifo[chan]);
+            if (samplesRead != 1) {
+                //Done!
+                running = false;
+            }
+        }
+        STAGE_TIMING_END(timing, TX_STAGE_FIFO, fifoStart);
+        traceSpan(trace, TRACE_FIFO_WAIT, waitStart, txBlockNum);
+        pipelineStatsFifoWait(stats, waitStart, pipelineStatsNow());
+        pipelineStatsFifoOccupancy(stats, (uint64_t) atomic_load(txFifo[0].fifoCount));
+        if(!running){
+            break;
+        }
+        if(controlMailboxPending(control)){
+            //This block is the first with the change applied
+            controlMailboxApply(control, txSampleIndex, device, true, numChannels, corrections, dcOffsetScale,
+                                args->dcOffsetI, args->dcOffsetQ, args->iqGain, args->iqPhase_deg);
+        }
+
+        //The startup trace covers the conversion of each FIFO block
+        bool tracing = print && startupTraceActive(&startupTrace);
+        double blockProcessingSec = 0;
+
+        //In MIMO mode, the burst is described by the header of channel 0.  The channels must agree on the number of samples
+        uint32_t blockFlags = sharedMemFIFOBlockHeader[0]->flags;
+        int32_t numSamples = sharedMemFIFOBlockHeader[0]->numSamples;
+        if(numSamples < 0 || numSamples > blockLen){
+            fprintf(stderr, "Tx burst block had an invalid number of samples: %d\n", numSamples);
+            return NULL;
+        }
+        for(int chan = 1; chan<numChannels; chan++) {
+            if(sharedMemFIFOBlockHeader[chan]->numSamples != numSamples){
+                fprintf(stderr, "Tx burst block for channel %d had a different number of samples (%d) than channel 0 (%d)\n", chan, sharedMemFIFOBlockHeader[chan]->numSamples, numSamples);
+                return NULL;
+            }
+        }
+
+        struct bladerf_metadata meta;
+        memset(&meta, 0, sizeof(meta));
+
+        bool hopScheduled = false;
+        if(blockFlags & TX_BLOCK_FLAG_BURST_START){
+            if(inBurst){
+                fprintf(stderr, "Warning: Tx burst started before the previous burst ended, ending previous burst\n");
+                status = endTxBurst(device, numChannels);
+                if(status != 0 && !txRecover(args, status, &burstClock)){
+                    return NULL;
+                }
+            }
+            burstInterrupted = false;
+
+            meta.flags |= BLADERF_META_FLAG_TX_BURST_START;
+            if(blockFlags & TX_BLOCK_FLAG_TX_NOW){
+                meta.flags |= BLADERF_META_FLAG_TX_NOW;
+            }else if(blockFlags & TX_BLOCK_FLAG_ABSOLUTE_TIME){
+                meta.timestamp = sharedMemFIFOBlockHeader[0]->timestamp;
+            }else{
+                meta.timestamp = burstClock.epoch + sharedMemFIFOBlockHeader[0]->timestamp;
+                if((int64_t) meta.timestamp < 0){
+                    //Before the device was reopened (the epoch is "negative" on the new device clock): in the past
+                    meta.timestamp = 0;
+                }
+            }
+            inBurst = true;
+
+            if((blockFlags & TX_BLOCK_FLAG_HOP) && hopper != NULL){
+                //Queued on the FPGA before the burst samples are submitted
+                uint32_t hopIndex = sharedMemFIFOBlockHeader[0]->hopIndex;
+                status = hopperRetuneTx(hopper, hopIndex, (meta.flags & BLADERF_META_FLAG_TX_NOW) ? BLADERF_RETUNE_NOW : meta.timestamp);
+                if(status != 0){
+                    fprintf(stderr, "Warning: Tx hop to entry %u failed: %s\n", hopIndex, bladerf_strerror(status));
+                }
+                hopScheduled = status == 0;
+            }
+        }else if(!inBurst && numSamples > 0 && !burstInterrupted){
+            fprintf(stderr, "Warning: Tx burst samples received outside of a burst, starting burst now\n");
+            meta.flags |= BLADERF_META_FLAG_TX_BURST_START | BLADERF_META_FLAG_TX_NOW;
+            inBurst = true;
+        }
+
+        if(inBurst) {
+            if (blockFlags & TX_BLOCK_FLAG_BURST_END) {
+                meta.flags |= BLADERF_META_FLAG_TX_BURST_END;
+            }
+
+            //A burst cannot be ended with 0 samples, send a zero sample to end it
+            int numToSend = numSamples;
+            if (numToSend == 0) {
+                for(int chan = 0; chan<numChannels; chan++) {
+                    sharedMemFIFO_re[chan][0] = 0;
+                    sharedMemFIFO_im[chan][0] = 0;
+                }
+                numToSend = 1;
+            }
+
+            if (numSamples > 0 || (meta.flags & BLADERF_META_FLAG_TX_BURST_END)) {
+                struct timespec convertStart, convertEnd;
+                if(tracing){
+                    clock_gettime(CLOCK_MONOTONIC, &convertStart);
+                }
+                STAGE_TIMING_START(convertTicksStart);
+                uint64_t convertTraceStart = traceNow(trace);
+                int clipped = convertTxChannels(sharedMemFIFO_re, sharedMemFIFO_im, 0, sampleFormat, bladeRFSampBuffer, bladeRFChanSampBuffer, 0, numChannels, numToSend,
+                                                scaleFactor, corrections, saturate);
+                pipelineStatsClipped(stats, (uint64_t) clipped);
+                STAGE_TIMING_END(timing, TX_STAGE_CONVERT, convertTicksStart);
+                traceSpan(trace, TRACE_CONVERT, convertTraceStart, txBlockNum);
+                if(tracing){
+                    clock_gettime(CLOCK_MONOTONIC, &convertEnd);
+                    blockProcessingSec += difftimespec(&convertEnd, &convertStart);
+                }
+
+                #ifdef DEBUG
+                printf("Tx Burst Samples Being Sent to BladeRF, Samples: %d, Flags: 0x%x, Timestamp: %lu\n", numToSend, meta.flags, meta.timestamp);
+                #endif
+                //In MIMO mode, the number of samples includes the samples for each channel
+                STAGE_TIMING_START(syncStart);
+                uint64_t syncTraceStart = traceNow(trace);
+                status = radioDeviceSyncTx(device, bladeRFSampBuffer, numToSend*numChannels, &meta, 0);
+                STAGE_TIMING_END(timing, TX_STAGE_SYNC, syncStart);
+                traceSpan(trace, TRACE_DEVICE_SUBMIT, syncTraceStart, txBlockNum);
+                if (status == BLADERF_ERR_TIME_PAST) {
+                    //The requested time has already passed, drop the burst (its remaining blocks are skipped until the next
+                    //burst starts rather than being sent now)
+                    fprintf(stderr, "Warning: Tx burst timestamp %lu is in the past, dropping burst\n", meta.timestamp);
+                    burstInterrupted = !(meta.flags & BLADERF_META_FLAG_TX_BURST_END);
+                    inBurst = false;
+                    if(hopScheduled){
+                        //The retune took effect immediately
+                        pipelineStatsHopMissed(stats);
+                    }
+                } else if (status != 0) {
+                    if(!txRecover(args, status, &burstClock)){
+                        return NULL;
+                    }
+                    //The burst state was lost with the old device
+                    burstInterrupted = inBurst && !(meta.flags & BLADERF_META_FLAG_TX_BURST_END);
+                    inBurst = false;
+                }
+            }
+
+            if (meta.flags & BLADERF_META_FLAG_TX_BURST_END) {
+                inBurst = false;
+            }
+        }
+
+        //Send feedback to TX so that it can send more
+        FEEDBACK_DATATYPE tokensReturned = 1;
+        STAGE_TIMING_START(feedbackStart);
+        uint64_t feedbackTraceStart = traceNow(trace);
+        for(int chan = 0; chan<numChannels; chan++) {
+            writeFifo(&tokensReturned, txfbFifoBufferBlockSizeBytes, 1, &txfbFifo[chan]);
+        }
+        STAGE_TIMING_END(timing, TX_STAGE_FEEDBACK, feedbackStart);
+        traceSpan(trace, TRACE_FEEDBACK, feedbackTraceStart, txBlockNum);
+        pipelineStatsAddBlock(stats, numSamples);
+        txBlockNum++;
+        txSampleIndex += numSamples;
+        if(tracing){
+            startupTraceBuffer(&startupTrace, blockProcessingSec);
+            if(!startupTraceActive(&startupTrace)){
+                startupTraceReport(&startupTrace, "Tx");
+            }
+        }
+    }
+
+    if(burstMode && inBurst){
+        status = endTxBurst(device, numChannels);
+        if(status != 0){
+            fprintf(stderr, "Failed BladeRF Tx: %s\n", bladerf_strerror(status));
+        }
+    }
+
+    //---- Streaming Mode ----
+    //With an underflow policy other than TX_UNDERFLOW_WAIT, the radio is kept fed while the producer is late.  When no
+    //block arrives before the deadline, the rest of the bladeRF buffer is filled and sent.  This repeats until a block
+    //arrives, keeping the stream continuous so that the timing of later samples is known.
+    //With -txFlushIdle, a partially filled bladeRF buffer is padded with zeros and sent once the Tx FIFOs have been idle
+    //for flushIdleSec so that the end of a transmission is not held in host memory until the next block arrives.
     int bladeRFBufferPos = 0;
-    while(running && !(*stop)){
+    size_t bladeRFFrameBytes = bladeRFSampleBytes*numChannels;
+    while(!burstMode && running && !(*stop)){
+        bool late = false;
+        while(!(*stop)){
+            bool flushPending = flushIdleSec > 0 && bladeRFBufferPos > 0;
+            if(!flushPending && underflowPolicy == TX_UNDERFLOW_WAIT){
+                //Nothing to do until the next block (polled rather than blocking in readFifo so that a stop is seen)
+                waitForTxBlocks(txFifo, numChannels, fifoBufferBlockSizeBytes, INFINITY, stop);
+                break;
+            }
+            if(waitForTxBlocks(txFifo, numChannels, fifoBufferBlockSizeBytes, flushPending ? flushIdleSec : underflowDeadlineSec, stop)){
+                break;
+            }
+            if(*stop){
+                break;
+            }
+
+            if(flushPending){
+                fillTxUnderflow(TX_UNDERFLOW_ZERO, bladeRFSampBuffer, bladeRFFrameBytes, bladeRFBufferPos, bladeRFSampsPerChan);
+                pipelineStatsFlush(stats, bladeRFSampsPerChan - bladeRFBufferPos);
+            }else{
+                if(!late){
+                    pipelineStatsUnderflow(stats);
+                    traceInstant(trace, TRACE_TX_UNDERFLOW, txBlockNum);
+                    late = true;
+                }
+                fillTxUnderflow(underflowPolicy, bladeRFSampBuffer, bladeRFFrameBytes, bladeRFBufferPos, bladeRFSampsPerChan);
+                pipelineStatsInsertSamples(stats, bladeRFSampsPerChan - bladeRFBufferPos);
+            }
+            STAGE_TIMING_START(syncStart);
+            uint64_t syncTraceStart = traceNow(trace);
+            status = radioDeviceSyncTx(device, bladeRFSampBuffer, bladeRFBlockLen, NULL, 0);
+            STAGE_TIMING_END(timing, TX_STAGE_SYNC, syncStart);
+            traceSpan(trace, TRACE_DEVICE_SUBMIT, syncTraceStart, txBlockNum);
+            if(status != 0 && !txRecover(args, status, NULL)){
+                return NULL;
+            }
+            bladeRFBufferPos = 0;
+        }
+        if(*stop){
+            break;
+        }
+
         //Get samples from tx FIFO (ok to block)
         #ifdef DEBUG
         printf("About to read Tx samples from Shared Memory FIFO\n");
         #endif
-        int samplesRead = readFifo(sharedMemFIFOSampBuffer, fifoBufferBlockSizeBytes, 1, &txFifo);
-        if (samplesRead != 1) {
-            //Done!
-            running = false;
+        //In MIMO mode, each channel has its own FIFO.  The channels are processed in lockstep.
+        uint64_t waitStart = pipelineStatsNow();
+        STAGE_TIMING_START(fifoStart);
+        for(int chan = 0; chan<numChannels && running; chan++) {
+            int samplesRead = readFifo(sharedMemFIFOBlockBuffer[chan], fifoBufferBlockSizeBytes, 1, &txFifo[chan]);
+            if (samplesRead != 1) {
+                //Done!
+                running = false;
+            }
+        }
+        STAGE_TIMING_END(timing, TX_STAGE_FIFO, fifoStart);
+        traceSpan(trace, TRACE_FIFO_WAIT, waitStart, txBlockNum);
+        pipelineStatsFifoWait(stats, waitStart, pipelineStatsNow());
+        pipelineStatsFifoOccupancy(stats, (uint64_t) atomic_load(txFifo[0].fifoCount));
+        if(!running){
             break;
         }
+        if(controlMailboxPending(control)){
+            //This block is the first with the change applied
+            controlMailboxApply(control, txSampleIndex, device, true, numChannels, corrections, dcOffsetScale,
+                                args->dcOffsetI, args->dcOffsetQ, args->iqGain, args->iqPhase_deg);
+        }
         #ifdef DEBUG
         printf("Read Tx samples from Shared Memory FIFO\n");
         #endif
@@ -113,69 +618,50 @@ void* txThread(void* uncastArgs){
         //Copy to bladeRF buffer, and sync (if filled a full buffer)
         //Do this until all data from shared memory FIFO has been consumed - keep any remainder
         int sharedMemPos = 0;
+        //The startup trace covers the conversion of each FIFO block
+        bool tracing = print && startupTraceActive(&startupTrace);
+        double blockProcessingSec = 0;
+        //The conversion of the block is recorded as one stage (excluding the bladeRF calls it is split by)
+        STAGE_TIMING_DECLARE(convertTicks);
         while(sharedMemPos<blockLen) {
             //Find the number of samples to handle
-            int remainingSamplesBladeRFSpace = bladeRFBlockLen - bladeRFBufferPos;
+            int remainingSamplesBladeRFSpace = bladeRFSampsPerChan - bladeRFBufferPos;
             int remainingSharedMemoryToProcess = blockLen - sharedMemPos;
             int numToProcess = remainingSamplesBladeRFSpace < remainingSharedMemoryToProcess ? remainingSamplesBladeRFSpace : remainingSharedMemoryToProcess;
             #ifdef DEBUG
             printf("Tx Samples Being Processed: %d\n", numToProcess);
             #endif
 
-            //Predistort Here for I/Q Imbalance
-            float iqPredistort_re[numToProcess];
-            float iqPredistort_im[numToProcess];
-            for (int i = 0; i < numToProcess; i++) {
-                iqPredistort_re[i] = iq_A*sharedMemFIFO_re[sharedMemPos+i];
-                iqPredistort_im[i] = iq_C*sharedMemFIFO_re[sharedMemPos+i] + iq_D*sharedMemFIFO_im[sharedMemPos+i];
-            }
-
-            //Scale and Subtract DC Offset, then Round
-            //Copy to bladeRF buffer and perform interleave
-            long scaled_re[numToProcess];
-            long scaled_im[numToProcess];
-            for (int i = 0; i < numToProcess; i++) {
-                scaled_re[i] = SAMPLE_ROUND_FCTN(iqPredistort_re[i] * scaleFactor - dc_I);
-                scaled_im[i] = SAMPLE_ROUND_FCTN(iqPredistort_im[i] * scaleFactor - dc_Q);
-            }
-
-            long scaled_thresh_re[numToProcess];
-            long scaled_thresh_im[numToProcess];
-            for (int i = 0; i < numToProcess; i++) {
-                scaled_thresh_re[i] = scaled_re[i];
-                scaled_thresh_im[i] = scaled_im[i];
-                if (saturate) {
-                    if (scaled_thresh_re[i] > BLADERF_FULL_RANGE_VALUE) {
-                        scaled_thresh_re[i] = BLADERF_FULL_RANGE_VALUE;
-                    } else if (scaled_thresh_re[i] < -BLADERF_FULL_RANGE_VALUE) {
-                        scaled_thresh_re[i] = -BLADERF_FULL_RANGE_VALUE;
-                    }
-
-                    if (scaled_thresh_im[i] > BLADERF_FULL_RANGE_VALUE) {
-                        scaled_thresh_im[i] = BLADERF_FULL_RANGE_VALUE;
-                    } else if (scaled_thresh_im[i] < -BLADERF_FULL_RANGE_VALUE) {
-                        scaled_thresh_im[i] = -BLADERF_FULL_RANGE_VALUE;
-                    }
-                }
+            struct timespec convertStart, convertEnd;
+            if(tracing){
+                clock_gettime(CLOCK_MONOTONIC, &convertStart);
             }
-
-            for (int i = 0; i < numToProcess; i++) {
-                bladeRFSampBuffer[2 * (bladeRFBufferPos+i)    ] = (int16_t) scaled_thresh_re[i];
-                bladeRFSampBuffer[2 * (bladeRFBufferPos+i) + 1] = (int16_t) scaled_thresh_im[i];
-                // printf("Tx: %5d, %5d\n", bladeRFSampBuffer[2 * (bladeRFBufferPos+i)    ], bladeRFSampBuffer[2 * (bladeRFBufferPos+i) + 1]);
+            STAGE_TIMING_START(convertTicksStart);
+            uint64_t convertTraceStart = traceNow(trace);
+            int clipped = convertTxChannels(sharedMemFIFO_re, sharedMemFIFO_im, sharedMemPos, sampleFormat, bladeRFSampBuffer, bladeRFChanSampBuffer, bladeRFBufferPos, numChannels, numToProcess,
+                                            scaleFactor, corrections, saturate);
+            pipelineStatsClipped(stats, (uint64_t) clipped);
+            STAGE_TIMING_ADD(convertTicks, convertTicksStart);
+            traceSpan(trace, TRACE_CONVERT, convertTraceStart, txBlockNum);
+            if(tracing){
+                clock_gettime(CLOCK_MONOTONIC, &convertEnd);
+                blockProcessingSec += difftimespec(&convertEnd, &convertStart);
             }
 
             sharedMemPos += numToProcess;
             bladeRFBufferPos += numToProcess;
 
-            if(bladeRFBufferPos>=bladeRFBlockLen){
+            if(bladeRFBufferPos>=bladeRFSampsPerChan){
                 #ifdef DEBUG
                 printf("Tx Samples Being Sent to BladeRF, bladeRFBlockLen: %d\n", bladeRFBlockLen);
                 #endif
                 //Filled the bladeRF buffer
-                status = bladerf_sync_tx(dev, bladeRFSampBuffer, bladeRFBlockLen, NULL, 0);
-                if(status != 0){
-                    fprintf(stderr, "Failed BladeRF Tx: %s\n", bladerf_strerror(status));
+                STAGE_TIMING_START(syncStart);
+                uint64_t syncTraceStart = traceNow(trace);
+                status = radioDeviceSyncTx(device, bladeRFSampBuffer, bladeRFBlockLen, NULL, 0);
+                STAGE_TIMING_END(timing, TX_STAGE_SYNC, syncStart);
+                traceSpan(trace, TRACE_DEVICE_SUBMIT, syncTraceStart, txBlockNum);
+                if(status != 0 && !txRecover(args, status, NULL)){
                     return NULL;
                 }
                 #ifdef DEBUG
@@ -186,30 +672,68 @@ void* txThread(void* uncastArgs){
             }
 
         }//Finished processing block from
+        STAGE_TIMING_RECORD(timing, TX_STAGE_CONVERT, convertTicks);
 
         #ifdef DEBUG
         printf("Sending Feedback Token for Tx\n");
         #endif
         //Send feedback to TX so that it can send more
         FEEDBACK_DATATYPE tokensReturned = 1;
-        writeFifo(&tokensReturned, txfbFifoBufferBlockSizeBytes, 1, &txfbFifo);
+        STAGE_TIMING_START(feedbackStart);
+        uint64_t feedbackTraceStart = traceNow(trace);
+        for(int chan = 0; chan<numChannels; chan++) {
+            writeFifo(&tokensReturned, txfbFifoBufferBlockSizeBytes, 1, &txfbFifo[chan]);
+        }
+        STAGE_TIMING_END(timing, TX_STAGE_FEEDBACK, feedbackStart);
+        traceSpan(trace, TRACE_FEEDBACK, feedbackTraceStart, txBlockNum);
+        pipelineStatsAddBlock(stats, blockLen);
+        txBlockNum++;
+        txSampleIndex += blockLen;
+        if(tracing){
+            startupTraceBuffer(&startupTrace, blockProcessingSec);
+            if(!startupTraceActive(&startupTrace)){
+                startupTraceReport(&startupTrace, "Tx");
+            }
+        }
         #ifdef DEBUG
         printf("Sent Feedback Token for Tx\n");
         #endif
     }
 
     //Stop Tx
-    status = bladerf_enable_module(dev, BLADERF_TX, false);
-    if (status != 0) {
-        fprintf(stderr, "Failed to stop bladeRF Tx: %s\n", bladerf_strerror(status));
-        return NULL;
+    for(int chan = 0; chan<numChannels; chan++) {
+        status = radioDeviceEnableModule(device, BLADERF_CHANNEL_TX(chan), false);
+        if (status != 0) {
+            fprintf(stderr, "Failed to stop bladeRF Tx%d: %s\n", chan, bladerf_strerror(status));
+            return NULL;
+        }
     }
     if(print){
+        startupTraceReport(&startupTrace, "Tx");
+        if(!burstMode && underflowPolicy != TX_UNDERFLOW_WAIT){
+            printf("Tx Underflowed %lu Times, Inserted %lu Samples with the %s underflow policy\n",
+                   atomic_load_explicit(&stats->underflows, memory_order_relaxed),
+                   atomic_load_explicit(&stats->samplesInserted, memory_order_relaxed),
+                   txUnderflowPolicyToStr(underflowPolicy));
+        }
+        if(!burstMode && flushIdleSec > 0){
+            printf("Tx Flushed %lu Partial Buffers, Padded %lu Samples\n",
+                   atomic_load_explicit(&stats->flushes, memory_order_relaxed),
+                   atomic_load_explicit(&stats->samplesPadded, memory_order_relaxed));
+        }
         printf("BladeRF Tx Stopped");
     }
 
-    free(sharedMemFIFOSampBuffer);
+    for(int chan = 0; chan<numChannels; chan++) {
+        free(sharedMemFIFOBlockBuffer[chan]);
+        if(bladeRFChanSampBuffer[chan] != NULL) {
+            free(bladeRFChanSampBuffer[chan]);
+        }
+    }
     free(bladeRFSampBuffer);
+    for(int chan = 0; chan<numChannels; chan++) {
+        cleanupConsumer(&txFifo[chan]);
+    }
 
     return NULL;
 }
\ No newline at end of file
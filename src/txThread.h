@@ -8,10 +8,36 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "helpers.h"
+#include "pipelineStats.h"
+#include "stageTiming.h"
+#include "eventTrace.h"
+#include "sampleConversion.h"
+#include "rtPolicy.h"
+#include "radioDevice.h"
+#include "controlMailbox.h"
+#include "hopper.h"
+#include "depends/BerkeleySharedMemoryFIFO.h"
+
+//What the Tx thread does when the Shared Memory FIFO producer misses its deadline (streaming mode)
+typedef enum{
+    TX_UNDERFLOW_WAIT = 0, //Wait for the producer (the DAC underruns and libbladeRF's timing drifts)
+    TX_UNDERFLOW_ZERO = 1, //Fill the rest of the libbladeRF buffer with zeros and send it
+    TX_UNDERFLOW_HOLD = 2  //Fill the rest of the libbladeRF buffer with the last sample and send it
+} txUnderflowPolicy_t;
+
+//Returns false if the string is not a known policy ("wait", "zero", or "hold")
+bool parseTxUnderflowPolicy(char *str, txUnderflowPolicy_t *policy);
+
+char* txUnderflowPolicyToStr(txUnderflowPolicy_t policy);
+
+//Size of the Tx feedback FIFO
+size_t txFeedbackFifoSizeBytes(int32_t fifoSizeBlocks);
 
 typedef struct{
-    char *txSharedName;
-    char *txFeedbackSharedName;
+    char *txSharedName[BLADERF_MAX_CHANNELS]; //One FIFO (and feedback FIFO) per channel
+    char *txFeedbackSharedName[BLADERF_MAX_CHANNELS];
+    sharedMemoryFIFO_t *feedbackFifos; //Producer side of the feedback FIFOs, created during bring-up (see txFeedbackFifoSizeBytes)
+    int numChannels; //1 for SISO (BLADERF_TX_X1), 2 for MIMO (BLADERF_TX_X2)
 
     //Shared Memory FIFO Params
     int32_t blockLen;
@@ -19,20 +45,42 @@ typedef struct{
 
     volatile bool *stop; //Used to stop ADC/DAC in the event that the program is signaled (for orderly shutdown)
     bool print;
+    pipelineStats_t *stats; //Counters for the status report
+    stageTiming_t *timing; //Per-stage latency histograms (NULL when built without STAGE_TIMING)
+    traceBuffer_t *trace; //Block lifecycle events (NULL if not tracing)
+    controlMailbox_t *control; //Runtime changes from the control socket (NULL if there is none)
+    hopper_t *hopper; //Hops on the TX_BLOCK_FLAG_HOP markers (NULL if not hopping on the markers)
 
     //BladeRFParams
-    struct bladerf *dev;
-    SAMPLE_COMPONENT_DATATYPE fullRangeValue; //Will scale this to be 2047
+    radioDevice_t *device; //bladeRF board or simulated bladeRF
+    sampleFormat_t sampleFormat; //Format of the samples on the link to the bladeRF (SC16_Q11 or SC8_Q7)
+    SAMPLE_COMPONENT_DATATYPE fullRangeValue; //Will scale this to be the full range of the sample format (2047 for SC16_Q11, 127 for SC8_Q7)
     bool saturate;
     uint32_t bladeRFBlockLen; //Needs to be a multiple of 1024, example gives 8192
     uint32_t bladeRFNumBuffers; //Example gives 16
     uint32_t bladeRFNumTransfers;
+    uint32_t bladeRFTimeout; //Stream timeout (ms)
+    uint32_t sampRate; //Used to keep the burst timestamps on the same timeline after the device is reopened (radioDeviceRecover)
+    //Placement of the libbladeRF worker thread (created by bladerf_sync_config)
+    rtPolicy_t rtPolicy;
+    int workerCpu; //-1 to inherit from this thread
+    int workerPriority; //-1 to inherit from this thread
+
+    //Burst Mode (each Tx FIFO block is prefixed with a txBlockHeader_t)
+    bool burstMode;
+    uint64_t burstLeadSamples; //Offset from the time the Tx is started to the Tx epoch (relative time 0)
+
+    //Underflow handling (streaming mode)
+    txUnderflowPolicy_t underflowPolicy;
+    double underflowDeadlineSec; //How long to wait for a block from the producer before filling
+    double flushIdleSec; //How long the FIFOs can be idle before a partial bladeRF buffer is padded and sent (0 to disable)
 
-    //Impairments
-    double dcOffsetI;
-    double dcOffsetQ;
-    double iqGain;
-    double iqPhase_deg;
+    //Impairments (per channel)
+    //The DC offsets are in the 12 bit ADC/DAC scale regardless of the sample format
+    double dcOffsetI[BLADERF_MAX_CHANNELS];
+    double dcOffsetQ[BLADERF_MAX_CHANNELS];
+    double iqGain[BLADERF_MAX_CHANNELS];
+    double iqPhase_deg[BLADERF_MAX_CHANNELS];
 
 } txThreadArgs_t;
 